@@ -8,3 +8,6 @@ uint32_t hash_impl (const void *addr, std::size_t len, uint32_t seed) {
   return val;
 }
 
+void hash128_impl (const void *addr, std::size_t len, uint32_t seed, uint64_t out[2]) {
+  lmmh_x64_128 (addr,len,seed,out);
+}
@@ -2,8 +2,10 @@
 #define _HASH__
 
 #include <cstddef>
+#include <cstdint>
 
 uint32_t hash_impl (const void *addr, std::size_t len, uint32_t seed);
+void hash128_impl (const void *addr, std::size_t len, uint32_t seed, uint64_t out[2]);
 
 namespace Words {
   namespace Hash {
@@ -11,6 +13,11 @@ namespace Words {
 	uint32_t Hash (const T* data, std::size_t size,uint32_t seed) {
 	  return hash_impl (data,size*sizeof(T),seed);
 	}
+
+	template<class T>
+	void Hash128 (const T* data, std::size_t size,uint32_t seed, uint64_t out[2]) {
+	  hash128_impl (data,size*sizeof(T),seed,out);
+	}
   }
 }
 
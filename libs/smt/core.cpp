@@ -1,3 +1,5 @@
+#include <chrono>
+
 #include "smt/smtsolvers.hpp"
 
 namespace Words {
@@ -17,11 +19,16 @@ namespace Words {
 	
 	SMTSolver msolve = SMTSolver::Z3;
 	size_t defaultTimeout = 0;
+	bool reuseSolvers = false;
 	
 	void setDefaultTimeout (size_t t) {
 	  defaultTimeout = t;
 	}
 	
+	void setSolverReuse (bool b) {
+	  reuseSolvers = b;
+	}
+	
 	void setSMTSolver (SMTSolver i) {
 #ifdef ENABLEZ3
 	  if (i ==  SMTSolver::Z3Str3) {
@@ -79,5 +86,108 @@ namespace Words {
 	  
 	  return solver;
 	}
+
+	namespace {
+	  using Clock = std::chrono::steady_clock;
+
+	  double elapsed (Clock::time_point start) {
+		return std::chrono::duration<double,std::milli> (Clock::now () - start).count ();
+	  }
+
+	  // Only the Z3 solvers have scopes
+	  bool reusing () {
+		return reuseSolvers && msolve != SMTSolver::CVC4;
+	  }
+
+	  bool declaredFor (const std::weak_ptr<Words::Context>& declared, const Words::Options& opt) {
+		auto c = declared.lock ();
+		return c && c == opt.context;
+	  }
+	}
+
+	Solver& Session::open (const Words::Options& opt) {
+	  auto start = Clock::now ();
+	  if (scoped) {
+		solver->pop ();
+		scoped = false;
+	  }
+	  if (!reusing () || !solver || !declaredFor (context,opt) || uses == queriesPerSolver) {
+		auto fresh = makeSolver ();
+		std::lock_guard<std::mutex> lock (mutex);
+		if (interrupted)
+		  fresh->interrupt ();
+		solver = std::move (fresh);
+		context = opt.context;
+		uses = 0;
+		stats.contexts++;
+	  }
+	  // Already declared symbols are skipped by the solver
+	  for (auto v : opt.context->getVariableAlphabet ())
+		solver->addVariable (v);
+	  for (auto t : opt.context->getTerminalAlphabet ())
+		solver->addTerminal (t);
+	  stats.setupTime += elapsed (start);
+	  // A heuristic may have changed it for the previous query
+	  solver->setTimeout (defaultTimeout);
+	  if (reusing ()) {
+		solver->push ();
+		scoped = true;
+	  }
+	  uses++;
+	  stats.queries++;
+	  return *solver;
+	}
+
+	IntegerSolver& Session::openInteger (const Words::Options& opt) {
+	  auto start = Clock::now ();
+	  if (intscoped) {
+		intsolver->pop ();
+		intscoped = false;
+	  }
+	  if (!reusing () || !intsolver || !declaredFor (intcontext,opt) || intuses == queriesPerSolver) {
+		auto fresh = makeIntSolver ();
+		std::lock_guard<std::mutex> lock (mutex);
+		if (interrupted)
+		  fresh->interrupt ();
+		intsolver = std::move (fresh);
+		intcontext = opt.context;
+		intuses = 0;
+		stats.contexts++;
+	  }
+	  for (auto v : opt.context->getVariableAlphabet ())
+		intsolver->addVariable (v);
+	  stats.setupTime += elapsed (start);
+	  intsolver->setTimeout (defaultTimeout);
+	  if (reusing ()) {
+		intsolver->push ();
+		intscoped = true;
+	  }
+	  intuses++;
+	  stats.queries++;
+	  return *intsolver;
+	}
+
+	void Session::interrupt () {
+	  std::lock_guard<std::mutex> lock (mutex);
+	  interrupted = true;
+	  if (solver)
+		solver->interrupt ();
+	  if (intsolver)
+		intsolver->interrupt ();
+	}
+
+	void Session::clearInterrupt () {
+	  std::lock_guard<std::mutex> lock (mutex);
+	  interrupted = false;
+	  if (solver)
+		solver->clearInterrupt ();
+	  if (intsolver)
+		intsolver->clearInterrupt ();
+	}
+
+	Session& getSession () {
+	  thread_local Session session;
+	  return session;
+	}
   }
 }
@@ -48,6 +48,10 @@ namespace Words {
 	  return Words::SMT::SolverResult::Unknown;
 	}
       }
+
+      virtual void interrupt () {
+	engine.interrupt ();
+      }
 	  
       virtual void addVariable (Words::Variable* v){
 	std::stringstream str;
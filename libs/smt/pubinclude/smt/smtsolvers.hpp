@@ -3,6 +3,7 @@
 
 
 #include <memory>
+#include <mutex>
 #include "words/exceptions.hpp"
 #include "words/words.hpp"
 
@@ -36,6 +37,16 @@ namespace Words {
 	  virtual void addEquation (const Words::Equation& ) {}
 	  virtual void evaluate (Words::Variable*, Words::WordBuilder& wb) = 0;
 	  virtual void setTimeout (size_t) { throw Words::WordException ("Timeout not implemented");}
+	  // Makes a running solve () give up with Unknown, may be called from
+	  // another thread. Solvers that support clearInterrupt () also give up
+	  // on every later solve () until it is called.
+	  virtual void interrupt () {}
+	  virtual void clearInterrupt () {}
+	  // Equations and constraints added after push () are dropped again by
+	  // the matching pop (). Variables and terminals must be added before
+	  // the first push ().
+	  virtual void push () { throw Words::WordException ("Scopes not implemented");}
+	  virtual void pop () { throw Words::WordException ("Scopes not implemented");}
 	  
 	  template<class iterator>
 	  void addEquations (iterator begin, iterator end) {
@@ -58,6 +69,11 @@ namespace Words {
 	
 	void setSMTSolver (SMTSolver);
 	void setDefaultTimeout (size_t);	  
+	// Whether sessions reuse their solvers, off by default. Reused solvers
+	// run in Z3's incremental mode, which answers small queries much faster
+	// but may give up on hard ones a fresh solver solves. CVC4 solvers are
+	// never reused.
+	void setSolverReuse (bool);
 	Solver_ptr makeSolver (); 
 	
 
@@ -89,10 +105,82 @@ namespace Words {
 	  virtual SolverResult solve () {return SolverResult::Unknown;}
 	  virtual size_t evaluate (Words::Variable*) = 0;
 	  virtual void setTimeout (size_t) { throw Words::WordException ("Timeout not implemented");}
+	  // As for Solver
+	  virtual void interrupt () {}
+	  virtual void clearInterrupt () {}
+	  virtual void push () { throw Words::WordException ("Scopes not implemented");}
+	  virtual void pop () { throw Words::WordException ("Scopes not implemented");}
 	};
 
 	using IntSolver_ptr = std::unique_ptr<IntegerSolver>;
 	IntSolver_ptr makeIntSolver (); 
+
+	struct SessionStatistics {
+	  std::size_t queries = 0;
+	  // Solvers made, each with a context of its own
+	  std::size_t contexts = 0;
+	  // Milliseconds spent making solvers and declaring symbols
+	  double setupTime = 0;
+
+	  SessionStatistics operator- (const SessionStatistics& o) const {
+		SessionStatistics res;
+		res.queries = queries - o.queries;
+		res.contexts = contexts - o.contexts;
+		res.setupTime = setupTime - o.setupTime;
+		return res;
+	  }
+
+	  SessionStatistics& operator+= (const SessionStatistics& o) {
+		queries += o.queries;
+		contexts += o.contexts;
+		setupTime += o.setupTime;
+		return *this;
+	  }
+	};
+
+	// With setSolverReuse (true), keeps a string and an integer solver alive
+	// across queries, so that their contexts are not made anew for every
+	// query; otherwise every query gets new solvers. The variables and
+	// terminals of a Words::Context are declared once; each query gets a
+	// scope of its own, dropped again when the next one is opened. Queries
+	// on another Words::Context get new solvers, and so does every
+	// queriesPerSolver-th query, as solvers keep some state from each
+	// query they answer.
+	class Session {
+	public:
+	  // Solver with the symbols of opt declared and an empty scope for the
+	  // equations and constraints of the query. Stays valid until the next
+	  // call to open.
+	  Solver& open (const Words::Options& opt);
+	  IntegerSolver& openInteger (const Words::Options& opt);
+
+	  // Interrupts the queries of the open solvers, and of those opened
+	  // later, until clearInterrupt (). May be called from another thread.
+	  void interrupt ();
+	  void clearInterrupt ();
+
+	  const SessionStatistics& statistics () const {return stats;}
+
+	  static const std::size_t queriesPerSolver = 1000;
+
+	private:
+	  // Guards solver and intsolver against interrupt ()
+	  std::mutex mutex;
+	  bool interrupted = false;
+	  Solver_ptr solver;
+	  IntSolver_ptr intsolver;
+	  std::weak_ptr<Words::Context> context;
+	  std::weak_ptr<Words::Context> intcontext;
+	  std::size_t uses = 0;
+	  std::size_t intuses = 0;
+	  bool scoped = false;
+	  bool intscoped = false;
+	  SessionStatistics stats;
+	};
+
+	// The session of the calling thread. Sessions are not thread safe, so
+	// each thread has its own.
+	Session& getSession ();
   }
 }
 
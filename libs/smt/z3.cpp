@@ -1,10 +1,12 @@
 #include <z3.h>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 #include <functional>
 #include <set>
-#include "passthrough.hpp"
 #include "words/exceptions.hpp"
 #include "smt/smtsolvers.hpp"
 #include "words/linconstraint.hpp"
@@ -18,6 +20,49 @@ namespace Words {
 	}
 	
 	  
+	// Runs Z3_solver_check so that other threads can interrupt it. Z3 drops
+	// an interrupt arriving before the check is under way, so interrupt ()
+	// repeats it until the check returns, and every later check gives up
+	// right away until clear ().
+	class Interruptible {
+	public:
+	  Z3_lbool check (Z3_context context, Z3_solver solver) {
+		{
+		  std::lock_guard<std::mutex> lock (mutex);
+		  if (interrupted)
+			return Z3_L_UNDEF;
+		  checking = true;
+		}
+		auto res = Z3_solver_check (context,solver);
+		{
+		  std::lock_guard<std::mutex> lock (mutex);
+		  checking = false;
+		}
+		checked.notify_all ();
+		return res;
+	  }
+
+	  void interrupt (Z3_context context) {
+		std::unique_lock<std::mutex> lock (mutex);
+		interrupted = true;
+		while (checking) {
+		  Z3_interrupt (context);
+		  checked.wait_for (lock,std::chrono::milliseconds (10));
+		}
+	  }
+
+	  void clear () {
+		std::lock_guard<std::mutex> lock (mutex);
+		interrupted = false;
+	  }
+
+	private:
+	  std::mutex mutex;
+	  std::condition_variable checked;
+	  bool interrupted = false;
+	  bool checking = false;
+	};
+
 	class Z3Solver : public Words::SMT::Solver {
 	public:
 	  Z3Solver () {
@@ -30,6 +75,9 @@ namespace Words {
 	  }
 	  
 	  virtual ~Z3Solver () {
+		if (model) {
+		  Z3_model_dec_ref (context,model);
+		}
 		Z3_solver_dec_ref(context, solver);
 		Z3_del_config(cfg);
 		Z3_del_context(context);
@@ -37,7 +85,8 @@ namespace Words {
 		
 	  
 	  virtual Words::SMT::SolverResult solve () {
-	    if (timeout) {
+	    // The parameters stay with the solver, so a reused one needs them reset
+	    if (timeout != appliedTimeout) {
 		  Z3_params solverParams = Z3_mk_params(context);
 		  Z3_params_inc_ref(context, solverParams);
 		  Z3_symbol timeoutParamStrSymbol = Z3_mk_string_symbol(context, "timeout");
@@ -48,10 +97,11 @@ namespace Words {
 							 timeout); 
 		  Z3_solver_set_params(context, solver, solverParams);
 		  Z3_params_dec_ref(context, solverParams);
+		  appliedTimeout = timeout;
 		}
-		switch (Z3_solver_check (context,solver)) {
+		switch (interruptible.check (context,solver)) {
 		case Z3_L_TRUE:
-		  model = Z3_solver_get_model (context,solver);
+		  setModel (Z3_solver_get_model (context,solver));
 		  return Words::SMT::SolverResult::Satis;
 		  break;
 		case Z3_L_FALSE:
@@ -62,8 +112,27 @@ namespace Words {
 		  return Words::SMT::SolverResult::Unknown;
 		}
 	  }
+
+	  virtual void interrupt () {
+		interruptible.interrupt (context);
+	  }
+
+	  virtual void clearInterrupt () {
+		interruptible.clear ();
+	  }
+
+	  virtual void push () {
+		Z3_solver_push (context,solver);
+	  }
+
+	  virtual void pop () {
+		Z3_solver_pop (context,solver,1);
+	  }
 	  
 	  virtual void addVariable (Words::Variable* v){
+		if (asts.count (v)) {
+		  return;
+		}
 		std::stringstream str;
 		v->output (str);
 		auto symb = Z3_mk_string_symbol (context,str.str().c_str());
@@ -97,19 +166,26 @@ namespace Words {
 		  throw Words::ConstraintUnsupported ();
 	  }
 
+	  // The variables are not restricted to the alphabet, so the model may
+	  // use other characters, epsilon's among them. They all become the same
+	  // terminal, which keeps both sides of every equation equal and every
+	  // length the same.
 	  virtual void evaluate (Words::Variable* v, Words::WordBuilder& wb) {
 		Z3_ast ast;
 		Z3_model_eval (context,model,asts.at(v),true,&ast);
-		auto str = Z3_get_string (context,ast);
-		auto context = v->getContext();
-		auto epsilon = context->getEpsilon ();
-		char dummy = epsilon->getTerminal()->getChar ();
-		PassthroughStream<Words::WordBuilder> stream (wb,terminals,dummy);
-		while (*str != '\0') {
-		  stream << *str;
-		  str++;
+		unsigned length = 0;
+		auto str = Z3_get_lstring (context,ast,&length);
+		char epsilon = v->getContext()->getEpsilon ()->getChar ();
+		char other = epsilon;
+		for (auto t : v->getContext()->getTerminalAlphabet ()) {
+		  if (!t->isEpsilon ()) {
+			other = t->getChar ();
+			break;
+		  }
+		}
+		for (unsigned i = 0; i < length; i++) {
+		  wb << (str[i] != epsilon && terminals.count (str[i]) ? str[i] : other);
 		}
-		
 	  }
 	  
 	  
@@ -177,15 +253,25 @@ namespace Words {
 	  void setTimeout (size_t t ) {timeout = t;}
 	  
 	private:
+	  void setModel (Z3_model m) {
+		Z3_model_inc_ref (context,m);
+		if (model) {
+		  Z3_model_dec_ref (context,model);
+		}
+		model = m;
+	  }
+	  
 	  Z3_context context;
 	  Z3_config cfg;
 	  std::unordered_map<Words::IEntry*,Z3_ast> asts;
 	  Z3_sort strsort;
 	  Z3_sort intsort;
 	  Z3_solver solver;
-	  Z3_model model;
+	  Z3_model model = nullptr;
 	  std::set<char> terminals;
-	  size_t timeout;
+	  size_t timeout = 0;
+	  size_t appliedTimeout = 0;
+	  Interruptible interruptible;
 	  };
 
 	class Z3IntegerSolver : public Words::SMT::IntegerSolver {
@@ -199,13 +285,18 @@ namespace Words {
 	  }
 	  
 	  virtual ~Z3IntegerSolver () {
+		if (model) {
+		  Z3_model_dec_ref (context,model);
+		}
 		Z3_solver_dec_ref(context, solver);
 		Z3_del_config(cfg);
 		Z3_del_context(context);
 	  }
 	  
 	  virtual void addVariable (const Words::Variable* v) {
-		
+		if (asts.count (v)) {
+		  return;
+		}
 		std::stringstream str;
 		v->output (str);
 		auto symb = Z3_mk_string_symbol (context,str.str().c_str());
@@ -236,8 +327,24 @@ namespace Words {
 	    }
 	  }
 	  
+	  virtual void push () {
+		Z3_solver_push (context,solver);
+	  }
+
+	  virtual void pop () {
+		Z3_solver_pop (context,solver,1);
+	  }
+
+	  virtual void interrupt () {
+		interruptible.interrupt (context);
+	  }
+
+	  virtual void clearInterrupt () {
+		interruptible.clear ();
+	  }
+	  
 	  virtual Words::SMT::SolverResult solve () {
-	    if (timeout) {
+	    if (timeout != appliedTimeout) {
 	      Z3_params solverParams = Z3_mk_params(context);
 	      Z3_symbol timeoutParamStrSymbol = Z3_mk_string_symbol(context, "timeout");
 	      Z3_params_inc_ref(context, solverParams);
@@ -247,11 +354,12 @@ namespace Words {
 				 timeout); 
 	      Z3_solver_set_params(context, solver, solverParams);
 	      Z3_params_dec_ref(context, solverParams);
+	      appliedTimeout = timeout;
 	    }
 	    
-	    switch (Z3_solver_check (context,solver)) {
+	    switch (interruptible.check (context,solver)) {
 	    case Z3_L_TRUE:
-	      model = Z3_solver_get_model (context,solver);
+	      setModel (Z3_solver_get_model (context,solver));
 	      return Words::SMT::SolverResult::Satis;
 	      break;
 	    case Z3_L_FALSE:	
@@ -274,14 +382,24 @@ namespace Words {
 	  void setTimeout (size_t t ) {timeout = t;}
 	  
 	private:
+	  void setModel (Z3_model m) {
+		Z3_model_inc_ref (context,m);
+		if (model) {
+		  Z3_model_dec_ref (context,model);
+		}
+		model = m;
+	  }
+	  
 	  Z3_context context;
 	  Z3_config cfg;
 	  std::unordered_map<const Words::IEntry*,Z3_ast> asts;
 	  Z3_sort intsort;
 	  Z3_solver solver;
-	  Z3_model model;
+	  Z3_model model = nullptr;
 	  std::set<char> terminals;
 	  size_t timeout = 0; 
+	  size_t appliedTimeout = 0;
+	  Interruptible interruptible;
 	};
 	
 	Words::SMT::Solver_ptr makeZ3Solver () {
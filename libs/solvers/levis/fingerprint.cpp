@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <iterator>
+
+#include "words/words.hpp"
+#include "words/linconstraint.hpp"
+#include "host/hash.hpp"
+#include "fingerprint.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  namespace {
+		enum ConstraintTag : uint32_t {
+		  LinearTag = 0,
+		  UnrestrictedTag = 1,
+		  OtherTag = 2
+		};
+
+		uint32_t token (const IEntry* e) {
+		  return e->symbol ().raw ();
+		}
+
+		void serialise (const Words::Word& w, std::vector<uint32_t>& form) {
+		  form.push_back (static_cast<uint32_t> (std::distance (w.ebegin (), w.eend ())));
+		  for (auto it = w.ebegin (); it != w.eend (); ++it) {
+			form.push_back (token (*it));
+		  }
+		}
+
+		void serialise (int64_t n, std::vector<uint32_t>& form) {
+		  auto u = static_cast<uint64_t> (n);
+		  form.push_back (static_cast<uint32_t> (u));
+		  form.push_back (static_cast<uint32_t> (u >> 32));
+		}
+
+		IEntry* entry (uint32_t token, const Words::Context& context) {
+		  return context.getEntry (Symbol::fromRaw (token));
+		}
+
+		Words::Word deserialiseWord (const uint32_t*& pos, const Words::Context& context) {
+		  std::vector<IEntry*> entries (*pos++);
+		  for (auto& e : entries) {
+			e = entry (*pos++,context);
+		  }
+		  return Words::Word (std::move (entries));
+		}
+
+		int64_t deserialiseNumber (const uint32_t*& pos) {
+		  uint64_t u = pos[0] | (static_cast<uint64_t> (pos[1]) << 32);
+		  pos += 2;
+		  return static_cast<int64_t> (u);
+		}
+
+		const std::size_t initialCapacity = 1024;
+
+		// Numbers the variables in the order they are first met
+		class Renaming {
+		public:
+		  void reset () {
+			for (auto i : met) {
+			  ids[i] = None;
+			}
+			met.clear ();
+		  }
+
+		  uint32_t token (const IEntry* e) {
+			if (!e->isVariable ()) {
+			  return Levis::token (e);
+			}
+			auto i = e->getIndex ();
+			if (i >= ids.size ()) {
+			  ids.resize (i + 1,None);
+			}
+			if (ids[i] == None) {
+			  ids[i] = static_cast<uint32_t> (met.size ());
+			  met.push_back (i);
+			}
+			return Symbol (IEntry::Kind::Variable,ids[i]).raw ();
+		  }
+
+		private:
+		  static constexpr uint32_t None = ~uint32_t (0);
+		  std::vector<uint32_t> ids;
+		  std::vector<std::size_t> met;
+		};
+
+		constexpr uint32_t Renaming::None;
+
+		void serialise (const Words::Word& w, std::vector<uint32_t>& form, Renaming& names) {
+		  form.push_back (static_cast<uint32_t> (std::distance (w.ebegin (), w.eend ())));
+		  for (auto it = w.ebegin (); it != w.eend (); ++it) {
+			form.push_back (names.token (*it));
+		  }
+		}
+
+		void serialise (const Words::Equation& eq, std::vector<uint32_t>& form, Renaming& names) {
+		  form.push_back (static_cast<uint32_t> (eq.type));
+		  serialise (eq.lhs, form, names);
+		  serialise (eq.rhs, form, names);
+		}
+
+		// Pieces of a form kept in one buffer, ordered by their contents
+		struct Pieces {
+		  void clear () {
+			buffer.clear ();
+			starts.clear ();
+			order.clear ();
+		  }
+
+		  void close () {
+			starts.push_back (buffer.size ());
+		  }
+
+		  void sort () {
+			order.resize (starts.size ());
+			for (std::size_t i = 0; i < order.size (); i++) {
+			  order[i] = i;
+			}
+			std::stable_sort (order.begin (),order.end (),[this] (std::size_t a, std::size_t b) {
+			  return std::lexicographical_compare (begin (a),end (a),begin (b),end (b));
+			});
+		  }
+
+		  std::vector<uint32_t>::const_iterator begin (std::size_t i) const {return buffer.begin () + (i ? starts[i-1] : 0);}
+		  std::vector<uint32_t>::const_iterator end (std::size_t i) const {return buffer.begin () + starts[i];}
+
+		  std::vector<uint32_t> buffer;
+		  std::vector<std::size_t> starts;
+		  std::vector<std::size_t> order;
+		};
+
+		void serialiseConstraints (const Words::Options& opt, std::vector<uint32_t>& form) {
+		  form.push_back (static_cast<uint32_t> (opt.constraints.size ()));
+			for (auto& c : opt.constraints) {
+			  if (c->isLinear ()) {
+				auto lin = c->getLinconstraint ();
+				form.push_back (LinearTag);
+				form.push_back (static_cast<uint32_t> (std::distance (lin->begin (), lin->end ())));
+				for (auto& vvar : *lin) {
+				  form.push_back (token (vvar.entry));
+				  serialise (vvar.number, form);
+				}
+				serialise (lin->getRHS (), form);
+			  }
+			  else if (c->isUnrestricted ()) {
+				form.push_back (UnrestrictedTag);
+				form.push_back (token (c->getUnrestricted ()->getUnrestrictedVar ()));
+			  }
+			  else {
+				// No compact form, fall back on the constraint's own hash
+				form.push_back (OtherTag);
+				form.push_back (c->hash (0));
+			  }
+			}
+		  }
+	  }
+
+	  void serialise (const Words::Options& opt, std::vector<uint32_t>& form) {
+		form.clear ();
+		form.push_back (static_cast<uint32_t> (opt.equations.size ()));
+		for (auto& eq : opt.equations) {
+		  form.push_back (static_cast<uint32_t> (eq.type));
+		  serialise (eq.lhs, form);
+		  serialise (eq.rhs, form);
+		}
+		serialiseConstraints (opt, form);
+	  }
+
+	  bool hasCompactForm (const Words::Options& opt) {
+		return opt.recons.empty () && std::all_of (opt.constraints.begin (),opt.constraints.end (),[] (const Constraints::Constraint_ptr& c) {
+		  return c->isLinear () || c->isUnrestricted ();
+		});
+	  }
+
+	  std::shared_ptr<Words::Options> deserialise (const uint32_t*& pos, const std::shared_ptr<Words::Context>& context) {
+		auto opt = std::make_shared<Words::Options> ();
+		opt->context = context;
+		opt->equations.resize (*pos++);
+		for (auto& eq : opt->equations) {
+		  eq.type = static_cast<Words::Equation::EqType> (*pos++);
+		  eq.lhs = deserialiseWord (pos,*context);
+		  eq.rhs = deserialiseWord (pos,*context);
+		  eq.ctxt = context.get ();
+		}
+		opt->constraints.resize (*pos++);
+		for (auto& c : opt->constraints) {
+		  if (*pos++ == LinearTag) {
+			std::vector<Constraints::VarMultiplicity> variables;
+			for (uint32_t i = *pos++; i > 0; i--) {
+			  auto e = entry (*pos++,*context);
+			  variables.emplace_back (e,deserialiseNumber (pos));
+			}
+			auto rhs = deserialiseNumber (pos);
+			c = std::make_shared<Constraints::LinearConstraint> (std::move (variables),rhs);
+		  }
+		  else {
+			c = std::make_shared<Constraints::Unrestricted> (entry (*pos++,*context));
+		  }
+		}
+		return opt;
+	  }
+
+	  bool canonicalise (const Words::Options& opt, std::vector<uint32_t>& form) {
+		// Regular constraints are not renamed along with the equations
+		if (!hasCompactForm (opt)) {
+		  return false;
+		}
+		thread_local Renaming names;
+		thread_local Pieces pieces;
+		thread_local std::vector<std::pair<uint32_t,int64_t>> terms;
+
+		// Equations ordered by their form with variables numbered per
+		// equation, which does not depend on the names of the variables
+		pieces.clear ();
+		for (auto& eq : opt.equations) {
+		  names.reset ();
+		  serialise (eq,pieces.buffer,names);
+		  pieces.close ();
+		}
+		pieces.sort ();
+		names.reset ();
+		form.clear ();
+		form.push_back (static_cast<uint32_t> (opt.equations.size ()));
+		for (auto i : pieces.order) {
+		  serialise (opt.equations[i],form,names);
+		}
+
+		pieces.clear ();
+		for (auto& c : opt.constraints) {
+		  if (c->isLinear ()) {
+			auto lin = c->getLinconstraint ();
+			terms.clear ();
+			for (auto& vvar : *lin) {
+			  terms.emplace_back (names.token (vvar.entry),vvar.number);
+			}
+			std::sort (terms.begin (),terms.end ());
+			pieces.buffer.push_back (LinearTag);
+			pieces.buffer.push_back (static_cast<uint32_t> (terms.size ()));
+			for (auto& t : terms) {
+			  pieces.buffer.push_back (t.first);
+			  serialise (t.second,pieces.buffer);
+			}
+			serialise (lin->getRHS (),pieces.buffer);
+		  }
+		  else {
+			pieces.buffer.push_back (UnrestrictedTag);
+			pieces.buffer.push_back (names.token (c->getUnrestricted ()->getUnrestrictedVar ()));
+		  }
+		  pieces.close ();
+		}
+		pieces.sort ();
+		form.push_back (static_cast<uint32_t> (opt.constraints.size ()));
+		for (auto i : pieces.order) {
+		  form.insert (form.end (),pieces.begin (i),pieces.end (i));
+		}
+		return true;
+	  }
+
+	  Fingerprint fingerprint (const std::vector<uint32_t>& form) {
+		uint64_t out[2];
+		Words::Hash::Hash128<uint32_t> (form.data (), form.size (), 0, out);
+		Fingerprint f;
+		f.high = out[0];
+		f.low = out[1];
+		if (f.empty ()) {
+		  f.low = 1;
+		}
+		return f;
+	  }
+
+	  Fingerprint fingerprint (const Words::Options& opt) {
+		// The words stand in by their digests, which are kept with them and
+		// shared with the system the words were copied from, so only the
+		// words changed since then are hashed again
+		thread_local std::vector<uint32_t> digests;
+		digests.clear ();
+		digests.push_back (static_cast<uint32_t> (opt.equations.size ()));
+		uint64_t digest[2];
+		for (auto& eq : opt.equations) {
+		  digests.push_back (static_cast<uint32_t> (eq.type));
+		  for (auto w : {&eq.lhs, &eq.rhs}) {
+			w->digest (digest);
+			for (auto d : digest) {
+			  digests.push_back (static_cast<uint32_t> (d));
+			  digests.push_back (static_cast<uint32_t> (d >> 32));
+			}
+		  }
+		}
+		serialiseConstraints (opt, digests);
+		return fingerprint (digests);
+	  }
+
+	  Fingerprint passedKey (const Words::Options& opt, bool exact, bool canonical, std::vector<uint32_t>& form, uint64_t& tag) {
+		auto f = fingerprint (opt);
+		tag = 0;
+		if (canonical) {
+		  tag = f.low;
+		  if (canonicalise (opt, form)) {
+			return fingerprint (form);
+		  }
+		}
+		if (exact) {
+		  serialise (opt, form);
+		}
+		return f;
+	  }
+
+	  PassedSet::PassedSet (bool exact, bool canonical) : slots (initialCapacity), exact (exact), canonical (canonical) {
+		if (exact) {
+		  offsets.resize (initialCapacity);
+		}
+		if (canonical) {
+		  tags.resize (initialCapacity);
+		}
+	  }
+
+	  bool PassedSet::insert (const Words::Options& opt) {
+		uint64_t tag;
+		auto f = passedKey (opt, exact, canonical, scratch, tag);
+		return insert (f, scratch, tag);
+	  }
+
+	  bool PassedSet::contains (const Words::Options& opt) const {
+		uint64_t tag;
+		auto f = passedKey (opt, exact, canonical, scratch, tag);
+		return contains (f, scratch, tag);
+	  }
+
+	  bool PassedSet::insert (const Fingerprint& f, const std::vector<uint32_t>& form, uint64_t tag) {
+		if (2 * (entries + 1) > slots.size ()) {
+		  grow ();
+		}
+		bool found;
+		auto slot = findSlot (f, form, found);
+		if (found) {
+		  countMerge (slot, tag);
+		  return false;
+		}
+		slots[slot] = f;
+		if (exact) {
+		  offsets[slot] = forms.size ();
+		  forms.push_back (static_cast<uint32_t> (form.size ()));
+		  forms.insert (forms.end (), form.begin (), form.end ());
+		}
+		if (canonical) {
+		  tags[slot] = tag;
+		}
+		entries++;
+		return true;
+	  }
+
+	  bool PassedSet::contains (const Fingerprint& f, const std::vector<uint32_t>& form, uint64_t tag) const {
+		bool found;
+		auto slot = findSlot (f, form, found);
+		if (found) {
+		  countMerge (slot, tag);
+		}
+		return found;
+	  }
+
+	  void PassedSet::countMerge (std::size_t slot, uint64_t tag) const {
+		if (canonical && tags[slot] != tag) {
+		  renamings++;
+		}
+	  }
+
+	  std::size_t PassedSet::memoryUsage () const {
+		return slots.capacity () * sizeof (Fingerprint) +
+		  offsets.capacity () * sizeof (uint64_t) +
+		  tags.capacity () * sizeof (uint64_t) +
+		  forms.capacity () * sizeof (uint32_t);
+	  }
+
+	  std::size_t PassedSet::findSlot (const Fingerprint& f, const std::vector<uint32_t>& form, bool& found) const {
+		auto mask = slots.size () - 1;
+		for (auto slot = f.low & mask;; slot = (slot + 1) & mask) {
+		  if (slots[slot].empty ()) {
+			found = false;
+			return slot;
+		  }
+		  if (slots[slot] == f) {
+			if (!exact || sameForm (slot, form)) {
+			  found = true;
+			  return slot;
+			}
+			falseMatches++;
+		  }
+		}
+	  }
+
+	  bool PassedSet::sameForm (std::size_t slot, const std::vector<uint32_t>& form) const {
+		auto stored = forms.begin () + offsets[slot];
+		return *stored == form.size () && std::equal (form.begin (), form.end (), stored + 1);
+	  }
+
+	  ConcurrentPassedSet::ConcurrentPassedSet (bool exact, bool canonical, std::size_t n) : exact (exact), canonical (canonical) {
+		for (std::size_t i = 0; i < n; i++) {
+		  shards.push_back (std::make_unique<Shard> (exact, canonical));
+		}
+	  }
+
+	  bool ConcurrentPassedSet::insert (const Words::Options& opt) {
+		thread_local std::vector<uint32_t> form;
+		uint64_t tag;
+		auto f = passedKey (opt, exact, canonical, form, tag);
+		auto& s = shard (f);
+		std::lock_guard<std::mutex> lock (s.mutex);
+		if (!s.set.insert (f, form, tag)) {
+		  return false;
+		}
+		entries++;
+		return true;
+	  }
+
+	  bool ConcurrentPassedSet::contains (const Words::Options& opt) const {
+		thread_local std::vector<uint32_t> form;
+		uint64_t tag;
+		auto f = passedKey (opt, exact, canonical, form, tag);
+		auto& s = shard (f);
+		std::lock_guard<std::mutex> lock (s.mutex);
+		return s.set.contains (f, form, tag);
+	  }
+
+	  std::size_t ConcurrentPassedSet::merged () const {
+		std::size_t res = 0;
+		for (auto& s : shards) {
+		  std::lock_guard<std::mutex> lock (s->mutex);
+		  res += s->set.merged ();
+		}
+		return res;
+	  }
+
+	  std::size_t ConcurrentPassedSet::memoryUsage () const {
+		std::size_t res = 0;
+		for (auto& s : shards) {
+		  std::lock_guard<std::mutex> lock (s->mutex);
+		  res += s->set.memoryUsage ();
+		}
+		return res;
+	  }
+
+	  void PassedSet::grow () {
+		std::vector<Fingerprint> old (2 * slots.size ());
+		std::vector<uint64_t> oldOffsets (exact ? old.size () : 0);
+		std::vector<uint64_t> oldTags (canonical ? old.size () : 0);
+		std::swap (old, slots);
+		std::swap (oldOffsets, offsets);
+		std::swap (oldTags, tags);
+		auto mask = slots.size () - 1;
+		for (std::size_t i = 0; i < old.size (); i++) {
+		  if (old[i].empty ()) {
+			continue;
+		  }
+		  // Entries are distinct, so no need to compare with the ones moved already
+		  auto slot = old[i].low & mask;
+		  while (!slots[slot].empty ()) {
+			slot = (slot + 1) & mask;
+		  }
+		  slots[slot] = old[i];
+		  if (exact) {
+			offsets[slot] = oldOffsets[i];
+		  }
+		  if (canonical) {
+			tags[slot] = oldTags[i];
+		  }
+		}
+	  }
+	}
+  }
+}
@@ -0,0 +1,141 @@
+#ifndef _FINGERPRINT_
+#define _FINGERPRINT_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "words/words.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  // 128-bit hash of an equation system. The all-zero fingerprint is
+	  // never produced and marks free slots in a PassedSet.
+	  struct Fingerprint {
+		uint64_t high = 0;
+		uint64_t low = 0;
+		bool operator== (const Fingerprint& o) const {return high == o.high && low == o.low;}
+		bool operator!= (const Fingerprint& o) const {return !(*this == o);}
+		bool empty () const {return !high && !low;}
+	  };
+
+	  struct FingerprintHash {
+		std::size_t operator() (const Fingerprint& f) const {return static_cast<std::size_t> (f.low);}
+	  };
+
+	  // Compact form of the equations and constraints of a system (the same
+	  // parts eqhash covers): one 32-bit token per symbol, its index tagged
+	  // with its kind, and every word and list prefixed by its length. Two
+	  // systems over the same context are equal iff their forms are.
+	  void serialise (const Words::Options&, std::vector<uint32_t>& form);
+
+	  // Whether the form of the system holds all of it, which is the case
+	  // without regular constraints and constraints other than linear and
+	  // unrestricted ones
+	  bool hasCompactForm (const Words::Options&);
+
+	  // The system over context whose form starts at pos, which is moved
+	  // past it. The system must have had a compact form.
+	  std::shared_ptr<Words::Options> deserialise (const uint32_t*& pos, const std::shared_ptr<Words::Context>& context);
+
+	  // The form of the system with its variables renamed in the order they
+	  // are first met and its equations and constraints in a normal order.
+	  // It is the form of a system equal to the given one up to renaming, so
+	  // systems with the same canonical form are equally satisfiable;
+	  // renamings of each other mostly get the same one. Returns false,
+	  // leaving form alone, for systems without a compact form.
+	  bool canonicalise (const Words::Options&, std::vector<uint32_t>& form);
+
+	  Fingerprint fingerprint (const std::vector<uint32_t>& form);
+
+	  // Built from the digests of the words instead of their symbols, so it
+	  // differs from the fingerprint of the form, and only the words that
+	  // changed since they were copied are hashed again
+	  Fingerprint fingerprint (const Words::Options&);
+
+	  // Open addressing set of fingerprints with linear probing. With exact
+	  // set, the serialised form of every system is kept as well and
+	  // compared whenever fingerprints match, so two different systems
+	  // sharing a fingerprint are still told apart. With canonical set,
+	  // systems are looked up by their canonical form, so renamings of a
+	  // system in the set are found as well.
+	  class PassedSet {
+	  public:
+		PassedSet (bool exact = false, bool canonical = false);
+
+		// Returns true if the system was not in the set already
+		bool insert (const Words::Options&);
+		bool contains (const Words::Options&) const;
+
+		// tag tells renamings apart from the system itself for merged ()
+		bool insert (const Fingerprint&, const std::vector<uint32_t>& form, uint64_t tag = 0);
+		bool contains (const Fingerprint&, const std::vector<uint32_t>& form, uint64_t tag = 0) const;
+
+		std::size_t size () const {return entries;}
+		// Bytes used by the table and the stored forms
+		std::size_t memoryUsage () const;
+		// Fingerprint matches the exact check found to be different systems
+		std::size_t collisions () const {return falseMatches;}
+		// Systems found in the set as renamings of another one
+		std::size_t merged () const {return renamings;}
+		bool isExact () const {return exact;}
+
+	  private:
+		// The slot holding the system, or the free slot where it belongs
+		std::size_t findSlot (const Fingerprint&, const std::vector<uint32_t>& form, bool& found) const;
+		bool sameForm (std::size_t slot, const std::vector<uint32_t>& form) const;
+		void countMerge (std::size_t slot, uint64_t tag) const;
+		void grow ();
+
+		std::vector<Fingerprint> slots;
+		// Only used with exact: where the form of each slot starts in forms
+		std::vector<uint64_t> offsets;
+		std::vector<uint32_t> forms;
+		// Only used with canonical: the fingerprint of each slot's system
+		// before renaming
+		std::vector<uint64_t> tags;
+		std::size_t entries = 0;
+		mutable std::size_t falseMatches = 0;
+		mutable std::size_t renamings = 0;
+		mutable std::vector<uint32_t> scratch;
+		bool exact;
+		bool canonical;
+	  };
+
+	  // PassedSet shared by several threads. The fingerprints are spread over
+	  // shards with a lock each, so threads rarely wait for each other.
+	  class ConcurrentPassedSet {
+	  public:
+		ConcurrentPassedSet (bool exact = false, bool canonical = false, std::size_t shards = 64);
+
+		bool insert (const Words::Options&);
+		bool contains (const Words::Options&) const;
+
+		std::size_t size () const {return entries;}
+		std::size_t memoryUsage () const;
+		std::size_t merged () const;
+		bool isExact () const {return exact;}
+		bool isCanonical () const {return canonical;}
+
+	  private:
+		struct Shard {
+		  Shard (bool exact, bool canonical) : set (exact, canonical) {}
+		  std::mutex mutex;
+		  PassedSet set;
+		};
+
+		Shard& shard (const Fingerprint& f) const {return *shards[f.high % shards.size ()];}
+
+		std::vector<std::unique_ptr<Shard>> shards;
+		std::atomic<std::size_t> entries {0};
+		bool exact;
+		bool canonical;
+	  };
+	}
+  }
+}
+
+#endif
@@ -16,36 +16,35 @@ namespace Words {
 		agattr(graph,AGNODE,const_cast<char*>("fillcolor"),const_cast<char*>("white"));
 		agattr(graph,AGNODE,const_cast<char*>("style"),const_cast<char*>("filled"));;
 
-		auto it = g.begin();
-        auto end = g.end();
-		for (; it != end; ++it) {
-		  auto& e = *it;
-		  auto from = e->from;
-		  auto to = e->to;
-		  std::stringstream fstr;
-		  std::stringstream tstr;
-		  std::stringstream ledge;
-		  if (from -> opt)
-			fstr << *(from->opt);
-		  if (to->opt)
-			tstr << *(to->opt);
+		for (auto& to : g) {
+		  for (auto i = to.incoming; i != Node::NoEdge; i = g.edge (i).next) {
+			auto& e = g.edge (i);
+			auto from = e.from;
+			std::stringstream fstr;
+			std::stringstream tstr;
+			std::stringstream ledge;
+			if (from -> opt)
+			  fstr << *(from->opt);
+			if (to.opt)
+			  tstr << *(to.opt);
 
-		  ledge << e->subs;
-		  auto fromn = agnode (graph,const_cast<char*> (fstr.str().c_str()),1);
-		  auto ton = agnode (graph,const_cast<char*> (tstr.str().c_str()),1);
+			ledge << g.substitution (e);
+			auto fromn = agnode (graph,const_cast<char*> (fstr.str().c_str()),1);
+			auto ton = agnode (graph,const_cast<char*> (tstr.str().c_str()),1);
 
-		  if (from->ranSMTSolver)
-			agset (fromn,const_cast<char*>("fillcolor"),"blue");
-		  if (to->ranSMTSolver)
-			agset (ton,const_cast<char*>("fillcolor"),"blue");
-		  
-		  
-		  agset (fromn,const_cast<char*>("label"),const_cast<char*>(fstr.str().c_str()));
-		  agset (ton,const_cast<char*>("label"),const_cast<char*>(tstr.str().c_str()));
-		  
-		  auto edge = agedge(graph,fromn,ton,const_cast<char*>(ledge.str().c_str()),1);
-		  agset (edge,const_cast<char*>("label"),const_cast<char*>(ledge.str().c_str()));
+			if (from->ranSMTSolver)
+			  agset (fromn,const_cast<char*>("fillcolor"),"blue");
+			if (to.ranSMTSolver)
+			  agset (ton,const_cast<char*>("fillcolor"),"blue");
+			
+			
+			agset (fromn,const_cast<char*>("label"),const_cast<char*>(fstr.str().c_str()));
+			agset (ton,const_cast<char*>("label"),const_cast<char*>(tstr.str().c_str()));
+			
+			auto edge = agedge(graph,fromn,ton,const_cast<char*>(ledge.str().c_str()),1);
+			agset (edge,const_cast<char*>("label"),const_cast<char*>(ledge.str().c_str()));
 		  }
+		}
 		
 		auto out = fopen ((name+".dot").c_str(),"w");
 		agwrite (graph,out);
@@ -1,121 +1,158 @@
 #ifndef _GRAPH_
 #define _GRAPH_
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <stack>
 
 #include "words/words.hpp"
+#include "fingerprint.hpp"
 
 namespace Words {
   namespace Solvers {
 	namespace Levis {
-	  struct Edge;
+	  // Nodes only keep their system when the graph is drawn; otherwise the
+	  // system is gone once the search has expanded it
 	  struct Node {
+		static const uint32_t NoEdge = ~uint32_t (0);
+#ifdef ENABLEGRAPH
 		Node (const std::shared_ptr<Words::Options>& o) : opt(o) {}
 		std::shared_ptr<Words::Options> opt;
-		std::vector<Edge*> incoming;
-		bool isRoot () {return !incoming.size();}
-		bool ranSMTSolver = false;
+#else
+		Node (const std::shared_ptr<Words::Options>&) {}
+#endif
+		// The last edge into the node, chained to the earlier ones
+		uint32_t incoming = NoEdge;
+		// Derivations start at a root even if it is reached again later
+		bool root = false;
+		bool isRoot () const {return root || incoming == NoEdge;}
+		std::atomic<bool> ranSMTSolver {false};
 	  };
-	  
+
+	  // The substitution of an edge lives in the graph's log: pairs times a
+	  // variable followed by the entries of its image and a nullptr
 	  struct Edge {
-		Edge (Node* f, Node* t,const Words::Substitution& subs) : from(f),
-																  to (t),
-																  subs(subs) {}
-			  
 		Node* from;
-		Node * to;
-		Words::Substitution subs;
+		std::size_t offset;
+		uint32_t pairs;
+		// The edge into the same node before this one
+		uint32_t next;
 	  };
 	  
+	  // Nodes and edges can be added from several threads at once
 	  class Graph {
 	  public:
 		Node* makeNode (const std::shared_ptr<Words::Options>& opt) {
-		  auto hash = opt->eqhash (0);
-		  auto it = nodes.find (hash);
+		  auto key = fingerprint (*opt);
+		  std::lock_guard<std::mutex> lock (mutex);
+		  auto it = nodes.find (key);
 		  if (it != nodes.end()) {
-			return it->second.get();
+			return it->second;
 		  }
 		  else {
-			auto nnode = std::make_unique<Node> (opt);
-			auto res = nnode.get ();
-			nodes.insert (std::make_pair (hash,std::move(nnode)));
+			store.emplace_back (opt);
+			auto res = &store.back ();
+			nodes.insert (std::make_pair (key,res));
 			return res;
 		  }
 		}
 
 		Node* makeDummyNode () {
-		  auto hash = 0;
-		  auto it = nodes.find (hash);
-		  
-		  auto nnode = std::make_unique<Node> (nullptr);
-		  auto res = nnode.get ();
-		  nodes.insert (std::make_pair (hash,std::move(nnode)));
-		  return res;
+		  std::lock_guard<std::mutex> lock (mutex);
+		  store.emplace_back (nullptr);
+		  return &store.back ();
 		}
 
 		
 		Node* getNode (const Words::Options& n) {
-		  return nodes.find(n.eqhash(0))->second.get();
+		  auto key = fingerprint (n);
+		  std::lock_guard<std::mutex> lock (mutex);
+		  return nodes.find(key)->second;
 		}
 
-		Edge* addEdge (Node* from, Node* to,const Words::Substitution& s) {
-		  auto edge = std::make_unique<Edge> (from,to,s);
-		  to->incoming.push_back (edge.get());
-		  edges.push_back(std::move(edge));
-		  return edges.back().get();
+		void addEdge (Node* from, Node* to,const Words::Substitution& s) {
+		  std::lock_guard<std::mutex> lock (mutex);
+		  if (from->isRoot ()) {
+			from->root = true;
+		  }
+		  Edge edge;
+		  edge.from = from;
+		  edge.offset = log.size ();
+		  edge.pairs = static_cast<uint32_t> (s.size ());
+		  edge.next = to->incoming;
+		  for (auto& p : s) {
+			log.push_back (p.first);
+			log.insert (log.end(),p.second.ebegin(),p.second.eend());
+			log.push_back (nullptr);
+		  }
+		  to->incoming = static_cast<uint32_t> (edges.size ());
+		  edges.push_back (edge);
 		}
 		
-		auto begin () const {return edges.begin();}
-		auto end () const {return edges.end();}
-		
-	  private:
-		std::unordered_map<uint32_t,std::unique_ptr<Node>> nodes;
-		std::vector<std::unique_ptr<Edge> > edges;
-	  };
-
-	  inline Words::Substitution replaceInSub (const Words::Substitution& orig, const Words::Substitution& solution) {		
-        Words::Substitution nnew = orig;
-        std::vector<std::pair<IEntry*,IEntry*>> varEquals;
-
-        for (auto& elem : orig) {
-            if (elem.second.characters() < 1)
-                continue;
-
-            auto subsb = elem.second.ebegin();
-            auto subse = elem.second.eend();
+		// The substitution from the root to n, while other threads may still
+		// be adding edges
+		Words::Substitution rootSolution (Node* n) {
+		  std::lock_guard<std::mutex> lock (mutex);
+		  return findRootSolution (n);
+		}
 
-            for (auto it = subsb; it != subse; ++it) {
-                if((*it)->isVariable() && (*it) != elem.first ){
-                    //std::cout << "works..." << (*it)->getRepr() << " " << elem.first->getRepr() << std::endl;
-                    if (solution.count(*it)){
-                        //std::cout << "Okay, it's " << solution.at(*it) << std::endl;
-                        nnew[elem.first].substitudeVariable(*it,solution.at(*it));
-                    } else {
-                        //std::cout << "Okay, not present!" << std::endl;
-                        nnew[elem.first].substitudeVariable(*it,Words::Word());
-                    }
-                }
-            }
-        }
+		Words::Substitution substitution (const Edge& e) const {
+		  Words::Substitution res;
+		  auto it = log.begin () + e.offset;
+		  for (uint32_t i = 0; i < e.pairs; i++) {
+			auto var = *it++;
+			auto end = std::find (it,log.end(),nullptr);
+			res[var] = Words::Word (std::vector<IEntry*> (it,end));
+			it = end + 1;
+		  }
+		  return res;
+		}
 
-		for (const auto& elem : solution) {
-          if (nnew.count(elem.first))
-			nnew[elem.first].substitudeVariable (elem.first,elem.second);
-          else
-			nnew[elem.first] = elem.second;
-        }
+		const Edge& edge (uint32_t i) const {return edges[i];}
 
-        // set open substitutions to the empty word
-        for (auto& oelem : nnew) {
-              oelem.second.substitudeVariable(oelem.first,Words::Word());
-        }
+		std::size_t memoryUsage () const {
+		  return store.size () * sizeof (Node) +
+			nodes.size () * (sizeof (Fingerprint) + 2 * sizeof (Node*)) +
+			nodes.bucket_count () * sizeof (Node*) +
+			edges.capacity () * sizeof (Edge) +
+			log.capacity () * sizeof (IEntry*);
+		}
+		
+		auto begin () const {return store.begin();}
+		auto end () const {return store.end();}
+		
+	  private:
+		Words::Substitution findRootSolution (Node* n) const;
+		
+		std::unordered_map<Fingerprint,Node*,FingerprintHash> nodes;
+		// Nodes do not move when more are added
+		std::deque<Node> store;
+		std::vector<Edge> edges;
+		std::vector<IEntry*> log;
+		std::mutex mutex;
+	  };
 
+	  // The solution of the source of an edge from the substitution along it
+	  // and the solution of its target. Solutions only hold terminals, so
+	  // every image is done in one pass, with the variables the solution
+	  // leaves open erased.
+	  inline Words::Substitution replaceInSub (const Words::Substitution& orig, const Words::Substitution& solution) {
+		Words::Substitution nnew = solution;
+		Words::SubstitutionTable table (solution,true);
+		for (auto& elem : orig) {
+		  auto& image = nnew[elem.first];
+		  image = elem.second;
+		  image.substitute (table);
+		}
 		return nnew;
-      }
+	  }
 	  
-	  inline Words::Substitution findRootSolution (Node* n) {
+	  inline Words::Substitution Graph::findRootSolution (Node* n) const {
 		struct SearchNode {
 		  SearchNode (Node* n, const Words::Substitution& s) : n(n), subs(s) {} 
 		  Node* n;
@@ -123,6 +160,7 @@ namespace Words {
 		};
 		Words::Substitution final;
 		std::stack<SearchNode> waiting;
+		std::unordered_set<Node*> visited;
 		waiting.push(SearchNode (n,final));
 		
 		while (waiting.size()) {
@@ -131,10 +169,10 @@ namespace Words {
 		  if (cur.n->isRoot()) {
 			return cur.subs;
 		  }
-		  else {
-			for (auto edge : cur.n->incoming) {
-			  Words::Substitution subs = replaceInSub (edge->subs,cur.subs);
-			  waiting.push (SearchNode (edge->from,subs));
+		  else if (visited.insert (cur.n).second) {
+			for (auto i = cur.n->incoming; i != Node::NoEdge; i = edges[i].next) {
+			  Words::Substitution subs = replaceInSub (substitution (edges[i]),cur.subs);
+			  waiting.push (SearchNode (edges[i].from,subs));
 			}
 		  }
 		}
@@ -13,7 +13,7 @@ namespace Words {
 	  class SMTHeuristic {
 	  public:
 		virtual bool doRunSMTSolver (const Words::Options& from,const Words::Options&, const PassedWaiting& ) const { return true;}
-		virtual void configureSolver (Words::SMT::Solver_ptr&) {}
+		virtual void configureSolver (Words::SMT::Solver&) {}
 		virtual std::string getDescription () const  {return "Unknown";}
 	  };
 
@@ -27,7 +27,7 @@ namespace Words {
 		  return pw.size() > bound;
 		}
 		
-		virtual void configureSolver (Words::SMT::Solver_ptr&) override {}
+		virtual void configureSolver (Words::SMT::Solver&) override {}
 		virtual std::string getDescription () const override {return (Formatter ("WaitingListLimit - %1%") % bound).str();};
 	  private:
 		size_t bound;
@@ -46,8 +46,8 @@ namespace Words {
 			  
 		}
 		
-		virtual void configureSolver (Words::SMT::Solver_ptr& solver) override {
-		  solver->setTimeout (timeout);
+		virtual void configureSolver (Words::SMT::Solver& solver) override {
+		  solver.setTimeout (timeout);
 		}
 		
 	  private:
@@ -74,7 +74,7 @@ namespace Words {
 		}
 
 
-		virtual void configureSolver (Words::SMT::Solver_ptr&) override {
+		virtual void configureSolver (Words::SMT::Solver&) override {
 		}
         virtual std::string getDescription () const override {return (Formatter ("Fixed equation length exceeded - %1%") % eqLengthBound).str();};
 		
@@ -103,7 +103,7 @@ namespace Words {
 		  return eqsSize;
         }
 		
-		virtual void configureSolver (Words::SMT::Solver_ptr&) override {}
+		virtual void configureSolver (Words::SMT::Solver&) override {}
         virtual std::string getDescription () const override {return (Formatter ("Equation growth - %1%") % scale).str();};
 
 	  private:
@@ -135,7 +135,7 @@ namespace Words {
           }
         }
 
-        virtual void configureSolver (Words::SMT::Solver_ptr&) override {}
+        virtual void configureSolver (Words::SMT::Solver&) override {}
 
       private:
         double scale = 1.25;
@@ -152,7 +152,7 @@ namespace Words {
         virtual std::string getDescription () const override {return "No SMT Solver";};
 
 
-        virtual void configureSolver (Words::SMT::Solver_ptr&) override {}
+        virtual void configureSolver (Words::SMT::Solver&) override {}
       };
     }
   }
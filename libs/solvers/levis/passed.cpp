@@ -1,30 +1,111 @@
+#include <algorithm>
 #include <queue>
+#include <set>
 #include <stack>
+#include <vector>
 #include "solvers/solvers.hpp"
 #include "words/words.hpp"
 #include "passed.hpp"
+#include "spill.hpp"
 
 namespace Words {
   namespace Solvers {
     namespace Levis {	  
 
-      SearchOrder order;
+      SearchOrder order = SearchOrder::BreadthFirst;
       std::unique_ptr<SearchQueue> queue = nullptr;
+      bool exactPassed = false;
+      bool canonicalPassed = false;
+      std::size_t spillThreshold = 0;
+      std::string profileFile;
+
+      namespace {
+	// Rough bytes taken by a system, not counting what it shares with others
+	std::size_t estimate (const Words::Options& opt) {
+	  std::size_t bytes = sizeof (Words::Options) + opt.equations.size () * sizeof (Words::Equation) + opt.constraints.size () * 64;
+	  for (auto& eq : opt.equations) {
+	    bytes += (eq.lhs.entries () + eq.rhs.entries ()) * sizeof (IEntry*);
+	  }
+	  return bytes;
+	}
+      }
       
+      // Once the systems in memory take more than the spill threshold, the
+      // newer ones go to a SpillFile. The queue is then the systems in
+      // memory older than those in the file (head), the file and the systems
+      // newer than those in the file (tail).
       class Queue : public SearchQueue {
       public:
 	using Element = std::shared_ptr<Words::Options>;
-	virtual std::size_t size () const {return queue.size();} 
-	virtual Element front () const {return queue.front();}
-	virtual void pop () {queue.pop ();}
-	virtual void push (const Element& elem) {queue.push (elem);}
+	virtual std::size_t size () const {return head.size() + file.size() + tail.size();} 
+	virtual Element front () const {return head.front();}
+	virtual void pop () {
+	  bytes -= estimate (*head.front ());
+	  head.pop_front ();
+	  if (head.empty ()) {
+	    refill ();
+	  }
+	}
+	virtual void push (const Element& elem) {
+	  bytes += estimate (*elem);
+	  if (file.empty ()) {
+	    head.push_back (elem);
+	  }
+	  else {
+	    tail.push_back (elem);
+	  }
+	  if (spillThreshold && bytes > spillThreshold) {
+	    spill ();
+	  }
+	}
 	virtual void clear () {
-	  std::queue<Element> empty;
-	  std::swap (empty,queue);
+	  head.clear ();
+	  tail.clear ();
+	  file.clear ();
+	  bytes = 0;
 	}
 	virtual const std::string getName () const {return "BFS";} 
+	virtual const std::string getStatistics () const {
+	  if (!file.writtenStates ()) {
+	    return "";
+	  }
+	  return (Formatter ("On disk: %1%, spilled: %2% (%3% MB)") % file.size () % file.writtenStates () % (file.writtenBytes () >> 20)).str();
+	}
+	virtual std::size_t spilledStates () const {return file.writtenStates ();}
+	virtual std::size_t spilledBytes () const {return file.writtenBytes ();}
+	virtual std::size_t spillFileBytes () const {return file.fileBytes ();}
       private:
-	std::queue<Element> queue;
+	// Writes the newer half of head, or all of tail, to the file. The
+	// oldest system stays in head for front ().
+	void spill () {
+	  auto& from = file.empty () ? head : tail;
+	  auto first = file.empty () ? (head.size () + 1) / 2 : 0;
+	  for (auto it = from.begin () + first; it != from.end (); ++it) {
+	    bytes -= estimate (**it);
+	    file.write (*it);
+	  }
+	  from.erase (from.begin () + first,from.end ());
+	}
+
+	// Reads back half the threshold, and tail once the file is empty
+	void refill () {
+	  std::size_t read = 0;
+	  while (!file.empty () && (head.empty () || read < spillThreshold / 2)) {
+	    head.push_back (file.read ());
+	    auto e = estimate (*head.back ());
+	    bytes += e;
+	    read += e;
+	  }
+	  if (file.empty ()) {
+	    head.insert (head.end (),tail.begin (),tail.end ());
+	    tail.clear ();
+	  }
+	}
+
+	std::deque<Element> head;
+	SpillFile file;
+	std::deque<Element> tail;
+	std::size_t bytes = 0;
       };
       
       class Stack : public SearchQueue {
@@ -43,11 +124,109 @@ namespace Words {
 	std::stack<Element> stack;
       };
 
+      // Binary heap ordered by priority, ties broken by insertion order
+      class Heap : public SearchQueue {
+      public:
+	using Element = std::shared_ptr<Words::Options>;
+	Heap (PriorityFunction priority, const std::string& name) : priority (priority), name (name) {}
+	virtual std::size_t size () const {return heap.size();} 
+	virtual Element front () const {return heap.front().elem;}
+	virtual void pop () {
+	  std::pop_heap (heap.begin(),heap.end(),Later ());
+	  heap.pop_back ();
+	  pops++;
+	}
+	virtual void push (const Element& elem) {
+	  heap.push_back (Entry {priority (*elem),pushes++,elem});
+	  std::push_heap (heap.begin(),heap.end(),Later ());
+	}
+	virtual void clear () {
+	  heap.clear ();
+	}
+	virtual const std::string getName () const {return "BestFirst - " + name;}
+	virtual const std::string getStatistics () const {
+	  return (Formatter ("Heap pushes: %1%, pops: %2%") % pushes % pops).str();
+	}
+      private:
+	struct Entry {
+	  double priority;
+	  std::size_t order;
+	  Element elem;
+	};
+	struct Later {
+	  bool operator() (const Entry& a, const Entry& b) const {
+	    return a.priority > b.priority || (a.priority == b.priority && a.order > b.order);
+	  }
+	};
+	PriorityFunction priority;
+	std::string name;
+	std::vector<Entry> heap;
+	std::size_t pushes = 0;
+	std::size_t pops = 0;
+      };
+
+      namespace {
+	double totalLength (const Words::Options& opt) {
+	  std::size_t length = 0;
+	  for (auto& eq : opt.equations) {
+	    length += eq.lhs.characters () + eq.rhs.characters ();
+	  }
+	  return length;
+	}
+
+	double variableTerminalRatio (const Words::Options& opt) {
+	  std::size_t terminals = 0;
+	  std::size_t variables = 0;
+	  for (auto& eq : opt.equations) {
+	    eq.lhs.sepearteCharacterCount (terminals,variables);
+	    eq.rhs.sepearteCharacterCount (terminals,variables);
+	  }
+	  return static_cast<double> (variables) / std::max<std::size_t> (terminals,1);
+	}
+
+	double distinctVariables (const Words::Options& opt) {
+	  std::vector<IEntry*> variables;
+	  for (auto& eq : opt.equations) {
+	    eq.lhs.getVariables (variables);
+	    eq.rhs.getVariables (variables);
+	  }
+	  return std::set<IEntry*> (variables.begin(),variables.end()).size ();
+	}
+      }
+
+      template<>
+      void setSearchOrder<SearchOrder::BestFirst,PriorityFunction> (PriorityFunction f) {
+	queue = std::make_unique<Heap> (f,"Custom");
+	order = SearchOrder::BestFirst;
+      }
+
       template<>
-      void setSearchOrder<SearchOrder::DepthFirst> () {queue = std::make_unique<Stack> ();}
+      void setSearchOrder<SearchOrder::BestFirst,Priority> (Priority p) {
+	switch (p) {
+	case Priority::TotalLength:
+	  queue = std::make_unique<Heap> (totalLength,"TotalLength");
+	  break;
+	case Priority::VariableTerminalRatio:
+	  queue = std::make_unique<Heap> (variableTerminalRatio,"VariableTerminalRatio");
+	  break;
+	case Priority::DistinctVariables:
+	  queue = std::make_unique<Heap> (distinctVariables,"DistinctVariables");
+	  break;
+	}
+	order = SearchOrder::BestFirst;
+      }
 
       template<>
-      void setSearchOrder<SearchOrder::BreadthFirst> () {queue = std::make_unique<Queue> ();}
+      void setSearchOrder<SearchOrder::DepthFirst> () {
+	queue = std::make_unique<Stack> ();
+	order = SearchOrder::DepthFirst;
+      }
+
+      template<>
+      void setSearchOrder<SearchOrder::BreadthFirst> () {
+	queue = std::make_unique<Queue> ();
+	order = SearchOrder::BreadthFirst;
+      }
 
       SearchQueue& getQueue () {
 	if (!queue) {
@@ -56,6 +235,83 @@ namespace Words {
 	assert(queue);
 	return* queue;
       }
+
+      WorkDeque::WorkDeque (std::atomic<std::size_t>& pending) : fifo (order != SearchOrder::DepthFirst),
+								  pending (pending) {}
+
+      std::size_t WorkDeque::size () const {
+	std::lock_guard<std::mutex> lock (mutex);
+	return elements.size ();
+      }
+
+      SearchQueue::Element WorkDeque::front () const {
+	std::lock_guard<std::mutex> lock (mutex);
+	return fifo ? elements.front () : elements.back ();
+      }
+
+      void WorkDeque::pop () {
+	std::lock_guard<std::mutex> lock (mutex);
+	if (fifo) {
+	  elements.pop_front ();
+	}
+	else {
+	  elements.pop_back ();
+	}
+      }
+
+      void WorkDeque::push (const Element& elem) {
+	std::lock_guard<std::mutex> lock (mutex);
+	pending++;
+	elements.push_back (elem);
+      }
+
+      void WorkDeque::clear () {
+	std::lock_guard<std::mutex> lock (mutex);
+	pending -= elements.size ();
+	elements.clear ();
+      }
+
+      bool WorkDeque::take (Element& elem) {
+	std::lock_guard<std::mutex> lock (mutex);
+	if (elements.empty ()) {
+	  return false;
+	}
+	if (fifo) {
+	  elem = std::move (elements.front ());
+	  elements.pop_front ();
+	}
+	else {
+	  elem = std::move (elements.back ());
+	  elements.pop_back ();
+	}
+	return true;
+      }
+
+      bool WorkDeque::steal (Element& elem) {
+	std::lock_guard<std::mutex> lock (mutex);
+	if (elements.empty ()) {
+	  return false;
+	}
+	elem = std::move (elements.front ());
+	elements.pop_front ();
+	return true;
+      }
+
+      void setExactPassedCheck (bool b) {exactPassed = b;}
+
+      SearchOrder getSearchOrder () {return order;}
+
+      bool useExactPassedCheck () {return exactPassed;}
+
+      void setSpillThreshold (std::size_t bytes) {spillThreshold = bytes;}
+
+      void setCanonicalPassed (bool b) {canonicalPassed = b;}
+
+      bool useCanonicalPassed () {return canonicalPassed;}
+
+      void setProfileFile (const std::string& name) {profileFile = name;}
+
+      const std::string& getProfileFile () {return profileFile;}
       
     }
   }
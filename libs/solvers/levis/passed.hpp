@@ -1,10 +1,14 @@
 #ifndef _PASSED_
 #define _PASSED_
 
+#include <atomic>
+#include <deque>
 #include <memory>
-#include <set>
+#include <mutex>
 
 #include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "fingerprint.hpp"
 
 namespace Words {
   namespace Solvers {
@@ -19,25 +23,64 @@ namespace Words {
 	    virtual void push (const Element& elem) = 0;
 	    virtual void clear () = 0;
 	    virtual const std::string getName () const {return "Unknown";} 
+	    // Shown in the progress output
+	    virtual const std::string getStatistics () const {return "";}
+	    // Systems written to disk, and their bytes, since the queue was made
+	    virtual std::size_t spilledStates () const {return 0;}
+	    virtual std::size_t spilledBytes () const {return 0;}
+	    // Bytes the systems on disk take right now
+	    virtual std::size_t spillFileBytes () const {return 0;}
 	  };
 
 	  SearchQueue& getQueue ();
+	  SearchOrder getSearchOrder ();
+	  bool useExactPassedCheck ();
+	  bool useCanonicalPassed ();
+	  const std::string& getProfileFile ();
+	  	  
+	  // The queue of one thread in a parallel search. The thread itself takes
+	  // the newest element for DFS and the oldest otherwise, so BestFirst is
+	  // explored breadth first. Other threads steal the oldest ones. pending
+	  // counts the elements pushed to any of the deques and not yet
+	  // expanded: whoever removes an element decrements it once done
+	  // expanding it.
+	  class WorkDeque : public SearchQueue {
+	  public:
+	    WorkDeque (std::atomic<std::size_t>& pending);
+	    std::size_t size () const override;
+	    Element front () const override;
+	    void pop () override;
+	    void push (const Element& elem) override;
+	    void clear () override;
+	    const std::string getName () const override {return "WorkStealing";}
+
+	    // Remove the next element in search order (take) or the oldest
+	    // (steal), if any
+	    bool take (Element& elem);
+	    bool steal (Element& elem);
+
+	  private:
+	    mutable std::mutex mutex;
+	    std::deque<Element> elements;
+	    bool fifo;
+	    std::atomic<std::size_t>& pending;
+	  };
 	  	  
 	  class PassedWaiting {
 	  public:
-	    PassedWaiting (SearchQueue& ptr) : queue (ptr) {}
+	    PassedWaiting (SearchQueue& ptr, bool exact = useExactPassedCheck (), bool canonical = useCanonicalPassed ()) : passed (exact,canonical), queue (ptr) {}
+	    // Passed states are looked up in and added to shared, which other
+	    // threads use as well
+	    PassedWaiting (SearchQueue& ptr, ConcurrentPassedSet& shared) : passed (shared.isExact (),shared.isCanonical ()), shared (&shared), queue (ptr) {}
 	    using Element = std::shared_ptr<Words::Options>;
 	    void insert (const Element& elem) {
-	      auto hash = elem->eqhash(0);
-	      if (!passed.count (hash)) {
-		passed.insert(hash);
+	      if (shared ? shared->insert (*elem) : passed.insert (*elem)) {
 		queue.push (elem);
 	      }
 	    }
 	    
 	    bool contains(const Element& elem){
-	      auto hash = elem->eqhash(0);
-	      return passed.count(hash);
+	      return shared ? shared->contains (*elem) : passed.contains (*elem);
 	    }
 	    
 	    Element pullElement () {
@@ -51,7 +94,18 @@ namespace Words {
 	    }
 	    
 	    std::size_t passedsize () const  {
-	      return passed.size ();
+	      return shared ? shared->size () : passed.size ();
+	    }
+
+	    // States dropped as renamings of a passed one
+	    std::size_t mergedsize () const  {
+	      return shared ? shared->merged () : passed.merged ();
+	    }
+
+	    // Bytes of the passed list per state in it
+	    std::size_t passedmemory () const  {
+	      auto states = passedsize ();
+	      return states ? (shared ? shared->memoryUsage () : passed.memoryUsage ()) / states : 0;
 	    }
 	    
 	    void clear() {
@@ -59,7 +113,8 @@ namespace Words {
 	    }
 	    
 	  private:
-	    std::set<uint32_t> passed;
+	    PassedSet passed;
+	    ConcurrentPassedSet* shared = nullptr;
 	    SearchQueue& queue;
 	  };
 	  
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstring>
+
+#include "profile.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  namespace {
+		const char* phaseNames[] = {"Rules","Simplifier","LinearConstraints","Hashing","SMT","RootSolution"};
+		const char* prunedNames[] = {"Duplicate","Unsat","SimplifierSat"};
+
+		// Keeper only lets its friends add entries
+		class PhaseKeeper : public Timing::Keeper {
+		public:
+		  using Timing::Keeper::addEntry;
+		};
+
+		double milliseconds (std::chrono::nanoseconds t) {
+		  return std::chrono::duration<double,std::milli> (t).count ();
+		}
+
+		std::vector<std::pair<const char*,std::size_t>> sorted (std::vector<std::pair<const char*,std::size_t>> firings) {
+		  std::sort (firings.begin (),firings.end (),[] (const auto& a, const auto& b) {return std::strcmp (a.first,b.first) < 0;});
+		  return firings;
+		}
+	  }
+
+	  std::size_t Profile::firedCount (const char* rule) const {
+		for (auto& f : firings) {
+		  if (f.first == rule) {
+			return f.second;
+		  }
+		}
+		return 0;
+	  }
+
+	  Profile& Profile::operator+= (const Profile& other) {
+		for (auto& f : other.firings) {
+		  auto it = std::find_if (firings.begin (),firings.end (),[&f] (const auto& g) {return g.first == f.first;});
+		  if (it == firings.end ()) {
+			firings.push_back (f);
+		  }
+		  else {
+			it->second += f.second;
+		  }
+		}
+		successors += other.successors;
+		for (std::size_t i = 0; i < prunes.size (); i++) {
+		  prunes[i] += other.prunes[i];
+		}
+		for (std::size_t i = 0; i < times.size (); i++) {
+		  times[i] += other.times[i];
+		}
+		return *this;
+	  }
+
+	  void Profile::print (std::ostream& os) const {
+		for (auto& f : sorted (firings)) {
+		  os << "Fired" << f.first << ": " << f.second << " \n";
+		}
+		os << "SuccessorsProduced: " << successors << " \n";
+		for (std::size_t i = 0; i < prunes.size (); i++) {
+		  os << "Pruned" << prunedNames[i] << ": " << prunes[i] << " \n";
+		}
+		for (std::size_t i = 0; i < times.size (); i++) {
+		  os << "Time" << phaseNames[i] << ": " << milliseconds (times[i]) << " ms \n";
+		}
+	  }
+
+	  void Profile::printJSON (std::ostream& os) const {
+		os << "{\n  \"rules\": {";
+		bool first = true;
+		for (auto& f : sorted (firings)) {
+		  os << (first ? "" : ",") << "\n    \"" << f.first << "\": " << f.second;
+		  first = false;
+		}
+		os << "\n  },\n  \"successors\": {\n    \"Produced\": " << successors;
+		for (std::size_t i = 0; i < prunes.size (); i++) {
+		  os << ",\n    \"" << prunedNames[i] << "\": " << prunes[i];
+		}
+		os << "\n  },\n  \"milliseconds\": {";
+		for (std::size_t i = 0; i < times.size (); i++) {
+		  os << (i ? "," : "") << "\n    \"" << phaseNames[i] << "\": " << milliseconds (times[i]);
+		}
+		os << "\n  }\n}\n";
+	  }
+
+	  Timing::Keeper Profile::timing () const {
+		PhaseKeeper keep;
+		for (std::size_t i = 0; i < times.size (); i++) {
+		  keep.addEntry (std::string ("Levis ") + phaseNames[i],milliseconds (times[i]));
+		}
+		return keep;
+	  }
+	}
+  }
+}
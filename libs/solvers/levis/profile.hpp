@@ -0,0 +1,102 @@
+#ifndef _LEVIS_PROFILE__
+#define _LEVIS_PROFILE__
+
+// Rule firings, pruned successors and time per phase of the Levis search.
+// They are only kept in builds with ENABLELEVISPROFILE, otherwise the
+// macros below leave nothing behind.
+#ifdef ENABLELEVISPROFILE
+
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "solvers/timing.hpp"
+
+#define LEVISPROFILE(x) x
+// The value of the expression, its time added to the phase
+#define LEVISTIME(profile,phase,...) [&] () {::Words::Solvers::Levis::PhaseTimer timer (profile,phase); return __VA_ARGS__;} ()
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  enum class Phase {
+		Rules,
+		Simplifier,
+		LinearConstraints,
+		Hashing,
+		SMT,
+		RootSolution,
+		Count
+	  };
+
+	  // Why a successor was dropped
+	  enum class Pruned {
+		Duplicate,
+		Unsat,
+		SimplifierSat,
+		Count
+	  };
+
+	  class Profile {
+	  public:
+		// Rules are told apart by the address of their name
+		void fired (const char* rule) {
+		  for (auto& f : firings) {
+			if (f.first == rule) {
+			  f.second++;
+			  return;
+			}
+		  }
+		  firings.emplace_back (rule,1);
+		}
+
+		void produced () {successors++;}
+		void pruned (Pruned p) {prunes[static_cast<std::size_t> (p)]++;}
+		void add (Phase p, std::chrono::nanoseconds t) {times[static_cast<std::size_t> (p)] += t;}
+
+		std::size_t firedCount (const char* rule) const;
+		std::size_t producedCount () const {return successors;}
+		std::size_t prunedCount (Pruned p) const {return prunes[static_cast<std::size_t> (p)];}
+		std::chrono::nanoseconds time (Phase p) const {return times[static_cast<std::size_t> (p)];}
+
+		Profile& operator+= (const Profile&);
+
+		// One "Name: value" line per counter, as getMoreInformation prints them
+		void print (std::ostream&) const;
+		void printJSON (std::ostream&) const;
+		// The phase times, in milliseconds
+		Timing::Keeper timing () const;
+
+	  private:
+		std::vector<std::pair<const char*,std::size_t>> firings;
+		std::size_t successors = 0;
+		std::array<std::size_t,static_cast<std::size_t> (Pruned::Count)> prunes {};
+		std::array<std::chrono::nanoseconds,static_cast<std::size_t> (Phase::Count)> times {};
+	  };
+
+	  class PhaseTimer {
+	  public:
+		PhaseTimer (Profile& p, Phase phase) : profile (p),
+											   phase (phase),
+											   start (std::chrono::steady_clock::now ()) {}
+		~PhaseTimer () {
+		  profile.add (phase,std::chrono::steady_clock::now () - start);
+		}
+
+	  private:
+		Profile& profile;
+		Phase phase;
+		std::chrono::steady_clock::time_point start;
+	  };
+	}
+  }
+}
+
+#else
+#define LEVISPROFILE(x)
+#define LEVISTIME(profile,phase,...) __VA_ARGS__
+#endif
+
+#endif
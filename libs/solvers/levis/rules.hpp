@@ -2,6 +2,42 @@
 #define _RULES
 
 #include "words/words.hpp"
+#include "profile.hpp"
+
+// The system s with subs applied. Words without the substituted variable
+// keep sharing their entries with s.
+inline std::shared_ptr<Words::Options> successor (const Words::Options& s, const Words::Substitution& subs) {
+  auto snew = s.copy();
+  Words::substitute (*snew,Words::SubstitutionTable (subs));
+  return snew;
+}
+
+// Flags the equations of successor (s,subs) which differ from those of s,
+// i.e. the ones containing a substituted variable
+inline void changedEquations (const Words::Options& s, const Words::Substitution& subs, std::vector<bool>& changed) {
+  changed.assign (s.equations.size (),false);
+  for (std::size_t i = 0; i < s.equations.size (); i++) {
+    for (auto& x : subs) {
+      if (s.equations[i].lhs.containsVariable (x.first) || s.equations[i].rhs.containsVariable (x.first)) {
+	changed[i] = true;
+	break;
+      }
+    }
+  }
+}
+
+// The successor of s by First, nullptr if First does not apply to s
+template<class Handler,class First>
+std::shared_ptr<Words::Options> applyRule (Handler& h,const Words::Options& s,Words::Substitution& subs) {
+  (void) h; // only used when profiling
+  LEVISPROFILE (Words::Solvers::Levis::PhaseTimer timer (h.getProfile (),Words::Solvers::Levis::Phase::Rules);)
+  auto& e = s.equations[0]; // grab the first equations; maybe add some cool heuristics here...
+  First::runRule (e,subs);
+  if (subs.size() == 0)
+    return nullptr;
+  LEVISPROFILE (h.getProfile ().fired (First::name);)
+  return successor (s,subs);
+}
 
 template<class Handler,class...RuleSequence>
 struct RuleSequencer {
@@ -11,24 +47,12 @@ struct RuleSequencer {
 template<class Handler,class First, class... RuleSequence>
 struct RuleSequencer<Handler,First,RuleSequence...> {
   static void runRules (Handler& h,const Words::Options& s) {
-    auto e = s.equations[0]; // grab the first equations; maybe add some cool heuristics here...
     Words::Substitution subs;
-    First::runRule (e,subs);
+    auto snew = applyRule<Handler,First> (h,s,subs);
 
-    if (subs.size() == 0)
+    if (!snew)
         RuleSequencer<Handler,RuleSequence...>::runRules(h,s);
     else {
-        std::vector<Words::Equation> newEquations;
-        for(auto ee : s.equations){
-            for(auto x : subs){ // should only contain a single substitution at this point
-                ee.lhs.substitudeVariable(x.first,x.second);
-                ee.rhs.substitudeVariable(x.first,x.second);
-                newEquations.push_back(ee);
-            }
-        }
-        auto snew = s.copy();
-        snew->equations = newEquations;
-
         //std::cout << "Choosen: " << typeid(First).name() << std::endl;
 
         if (!h.handle (s,snew,subs)) {
@@ -41,26 +65,14 @@ struct RuleSequencer<Handler,First,RuleSequence...> {
 template<class Handler,class First>
 struct RuleSequencer<Handler,First> {
   static void runRules (Handler& h,const Words::Options& s) {
-    auto e = s.equations[0]; // grab the first equations; maybe add some cool heuristics here...
     Words::Substitution subs;
-    First::runRule (e,subs);
+    auto snew = applyRule<Handler,First> (h,s,subs);
 
-    if (subs.size() == 0)
+    if (!snew)
         return;
 
-    std::vector<Words::Equation> newEquations;
-    for(auto ee : s.equations){
-        for(auto x : subs){ // should only contain a single substitution at this point
-            ee.lhs.substitudeVariable(x.first,x.second);
-            ee.rhs.substitudeVariable(x.first,x.second);
-            newEquations.push_back(ee);
-        }
-    }
-
     //std::cout << typeid(First).name() << std::endl;
 
-    auto snew = s.copy();
-    snew->equations = newEquations;
     h.handle (s,snew,subs);
   }
   
@@ -68,6 +80,7 @@ struct RuleSequencer<Handler,First> {
 
 
 struct DummyRule {
+  static constexpr const char* name = "DummyRule";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
     return;
   }
@@ -76,6 +89,7 @@ struct DummyRule {
 // Actual rules
 // Xw = Yw' /\ X = YX --> w = Xw'
 struct PrefixReasoningLeftHandSide {
+  static constexpr const char* name = "PrefixReasoningLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -90,6 +104,7 @@ struct PrefixReasoningLeftHandSide {
 
 // Xw = Yw' /\ Y = XY --> Xw = w'
 struct PrefixReasoningRightHandSide {
+  static constexpr const char* name = "PrefixReasoningRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -104,6 +119,7 @@ struct PrefixReasoningRightHandSide {
 
 // Xw = Yw' /\ Y = X --> w = w'
 struct PrefixReasoningEqual {
+  static constexpr const char* name = "PrefixReasoningEqual";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -118,6 +134,7 @@ struct PrefixReasoningEqual {
 
 // wX = w'Y /\ X = XY --> wX = w'
 struct SuffixReasoningLeftHandSide {
+  static constexpr const char* name = "SuffixReasoningLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -132,6 +149,7 @@ struct SuffixReasoningLeftHandSide {
 
 // wX = w'Y /\ Y = YX --> w = w'Y
 struct SuffixReasoningRightHandSide {
+  static constexpr const char* name = "SuffixReasoningRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -146,6 +164,7 @@ struct SuffixReasoningRightHandSide {
 
 // wX = w'Y /\ Y = X --> w = w'
 struct SuffixReasoningEqual {
+  static constexpr const char* name = "SuffixReasoningEqual";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -160,6 +179,7 @@ struct SuffixReasoningEqual {
 
 // Xw = aw' /\ X = 1 --> w = aw'
 struct PrefixEmptyWordLeftHandSide {
+  static constexpr const char* name = "PrefixEmptyWordLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -174,6 +194,7 @@ struct PrefixEmptyWordLeftHandSide {
 
 // aw = Xw' /\ X = 1 --> aw = w'
 struct PrefixEmptyWordRightHandSide {
+  static constexpr const char* name = "PrefixEmptyWordRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -188,6 +209,7 @@ struct PrefixEmptyWordRightHandSide {
 
 // Xw = aw' /\ X = aX --> Xw = w'
 struct PrefixLetterLeftHandSide {
+  static constexpr const char* name = "PrefixLetterLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -202,6 +224,7 @@ struct PrefixLetterLeftHandSide {
 
 // aw = Xw' /\ X = aX --> w = Xw'
 struct PrefixLetterRightHandSide {
+  static constexpr const char* name = "PrefixLetterRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -217,6 +240,7 @@ struct PrefixLetterRightHandSide {
 //
 // wX = w'a /\ X = 1 --> w = w'a
 struct SuffixEmptyWordLeftHandSide {
+  static constexpr const char* name = "SuffixEmptyWordLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -231,6 +255,7 @@ struct SuffixEmptyWordLeftHandSide {
 
 // wa = w'X /\ X = 1 --> wa = w'
 struct SuffixEmptyWordRightHandSide {
+  static constexpr const char* name = "SuffixEmptyWordRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -245,6 +270,7 @@ struct SuffixEmptyWordRightHandSide {
 
 // wX = w'a /\ X = Xa --> wX = w'
 struct SuffixLetterLeftHandSide {
+  static constexpr const char* name = "SuffixLetterLeftHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -259,6 +285,7 @@ struct SuffixLetterLeftHandSide {
 
 // wa = w'X /\ X = Xa --> w = w'X
 struct SuffixLetterRightHandSide {
+  static constexpr const char* name = "SuffixLetterRightHandSide";
   static void runRule (const Words::Equation& e, Words::Substitution& sub) {
       if (e.lhs.characters() < 1 || e.rhs.characters() < 1)
           return;
@@ -272,6 +299,7 @@ struct SuffixLetterRightHandSide {
 };
 
 struct GuessConstIsOneVariable {
+  static constexpr const char* name = "GuessConstIsOneVariable";
   static void runRule (const Words::Equation& eq, Words::Substitution& sub) {
 	const Words::Word* constside;
 	const Words::Word* varside;
@@ -1,6 +1,11 @@
 #include <sstream>
 #include <iostream>
+#include <fstream>
 #include <set>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
 
 #include <numeric>
 
@@ -40,9 +45,12 @@ namespace Words {
 	return true;
       }
 
-      Words::SMT::SolverResult solveDummy (const Words::Options& opt, Words::Substitution& s) {
+      Words::SMT::SolverResult solveDummy (Words::SMT::Session& session, const Words::Options& opt, Words::Substitution& s, const std::atomic<bool>& stop) {
+	// The search is being interrupted
+	if (stop)
+	  return Words::SMT::SolverResult::Unknown;
 	std::set<const Words::IEntry*> unrestricted;
-	auto intsolver = Words::SMT::makeIntSolver ();
+	auto intsolver = &session.openInteger (opt);
 	for (auto& t : opt.constraints) {
 	  if (t->isLinear()) {
 	    auto lin = t->getLinconstraint ();
@@ -80,7 +88,10 @@ namespace Words {
 	  
       class Handler {
       public:
-        Handler (PassedWaiting& w, Graph& g,Words::Substitution& s) : waiting(w),graph(g),subs(s) {
+        Handler (PassedWaiting& w, Graph& g,Words::Substitution& s,const std::atomic<bool>& stop) : waiting(w),graph(g),subs(s),
+								       stop (stop),
+								       session (Words::SMT::getSession ()),
+								       sessionStart (session.statistics ()) {
 	  smtSolverCalls = 0;
         }
         // criteria for external solver calls
@@ -155,6 +166,11 @@ namespace Words {
 	  for (; cit != cend; ++cit) {
 	    if ((*cit)->isLinear ()) {
 	      auto lin = (*cit)->getLinconstraint();
+	      if (!lin->lhsEmpty () && std::none_of (lin->begin (), lin->end (), [&sub] (const Constraints::VarMultiplicity& vvar) {return sub.count (vvar.entry);})) {
+		// Rebuilding it would give the same constraint
+		newConstraints.push_back (*cit);
+		continue;
+	      }
 	      auto builder = Words::Constraints::makeLinConstraintBuilder (Words::Constraints::Cmp::LEq);
 	      builder->addRHS (lin->getRHS ());
 	      for (auto& vvar : *lin) {
@@ -193,10 +209,13 @@ namespace Words {
 	//returns true if successor generation should stop
 	//
 	bool handle (const Words::Options& from, std::shared_ptr<Words::Options>& to, const Words::Substitution& sub) {
+	  LEVISPROFILE (profile.produced ();)
           //auto beforeSimp = to->copy ();
 	  // Simplification
-          if(!modifyLinearConstraints(to, sub))
+          if(!LEVISTIME (profile,Phase::LinearConstraints,modifyLinearConstraints(to, sub))) {
+	    LEVISPROFILE (profile.pruned (Pruned::Unsat);)
 	    return false;
+	  }
 		  
 	/*
 	          std::cout << "#######################################"<< std::endl;
@@ -211,23 +230,30 @@ namespace Words {
 	  */		
 	  Words::Substitution simplSub;
 	  std::vector<Constraints::Constraint_ptr> ptr;
-	  auto res = Words::Solvers::CoreSimplifier::solverReduce (*to,simplSub,ptr);
+	  // from is simplified already, so only what sub changed needs another look
+	  DirtyEquations dirty;
+	  changedEquations (from,sub,dirty);
+	  auto res = LEVISTIME (profile,Phase::Simplifier,Words::Solvers::CoreSimplifier::solverReduce (*to,simplSub,ptr,dirty));
 		  
 	  //std::copy(ptr.begin(),ptr.end(),std::back_inserter (to->constraints));
 	    /*std::cout << "Second modification:" << *to << std::endl;
 	       std::cout << "Substitution was: " << simplSub << std::endl;
 	       std::cout << "###########################################"<< std::endl;
 	     */	
-	  if(!modifyLinearConstraints(to, simplSub))
+	  if(!LEVISTIME (profile,Phase::LinearConstraints,modifyLinearConstraints(to, simplSub))) {
+	    LEVISPROFILE (profile.pruned (Pruned::Unsat);)
 	    return false;
+	  }
 
 	  if (res==Simplified::ReducedNsatis){
 	    	//std::cout << "c Simplifier reported UNSAT" << std::endl;
+		 LEVISPROFILE (profile.pruned (Pruned::Unsat);)
 		 return false;
 	  }
 		  
-          if (waiting.contains(to)){
+          if (LEVISTIME (profile,Phase::Hashing,waiting.contains(to))){
 	    	 //std::cout << "???" << std::endl;
+		 LEVISPROFILE (profile.pruned (Pruned::Duplicate);)
 		 return false;
 	   }
 	  
@@ -235,28 +261,29 @@ namespace Words {
 	  auto simpnode = graph.makeNode (beforeSimp);
 	  auto nnode = graph.makeNode (to);
 		  
-	  Edge* edge = graph.addEdge (node,simpnode,sub);
+	  graph.addEdge (node,simpnode,sub);
 
           if (simpnode != nnode)
-            edge = graph.addEdge (simpnode,nnode,simplSub);
+            graph.addEdge (simpnode,nnode,simplSub);
 		  
 	  SMTHeuristic& heur = getSMTHeuristic ();
 	  Words::Substitution solution;
           
 	  
 	  if (res==Simplified::ReducedSatis ) {
+	    LEVISPROFILE (profile.pruned (Pruned::SimplifierSat);)
             if (linearsSatisfiedByEmpty (*to)) {
 	      result = Words::Solvers::Result::HasSolution;
-	      subs = findRootSolution (nnode);
+	      subs = LEVISTIME (profile,Phase::RootSolution,graph.rootSolution (nnode));
 	      // rebuild subsitution here!>
 	      waiting.clear();
 	      return true;
 	    }
-	    else if (solveDummy (*to,solution) == Words::SMT::SolverResult::Satis ) {
+	    else if (LEVISTIME (profile,Phase::SMT,solveDummy (session,*to,solution,stop)) == Words::SMT::SolverResult::Satis ) {
 	      auto dnode = graph.makeDummyNode ();
 	      graph.addEdge (nnode,dnode,solution);
 	      result = Words::Solvers::Result::HasSolution;
-	      subs = findRootSolution (dnode);
+	      subs = LEVISTIME (profile,Phase::RootSolution,graph.rootSolution (dnode));
 	      waiting.clear();
 	      return true;
 	    }
@@ -269,7 +296,7 @@ namespace Words {
             return runSMTSolver (nnode,to,heur);
           }
 	  else {
-	    waiting.insert(to);
+	    LEVISTIME (profile,Phase::Hashing,waiting.insert(to));
 	  }
 
 
@@ -284,30 +311,38 @@ namespace Words {
 	}
 
         bool runSMTSolver (Node* n, const std::shared_ptr<Words::Options>& from, SMTHeuristic& heur) {
+	  // The search is being interrupted
+	  if (stop)
+	    return false;
           smtSolverCalls = smtSolverCalls+1;
 	  n->ranSMTSolver = true;
-	  auto smtsolver = Words::SMT::makeSolver ();
+	  LEVISPROFILE (std::unique_ptr<PhaseTimer> timer = std::make_unique<PhaseTimer> (profile,Phase::SMT);)
+	  auto& smtsolver = session.open (*from);
 	  heur.configureSolver (smtsolver);
-	  Words::SMT::buildEquationSystem (*smtsolver,*from);
-          switch (smtsolver->solve()) {
+	  smtsolver.addEquations (from->equations.begin(),from->equations.end());
+	  smtsolver.addConstraints (from->constraints.begin(),from->constraints.end());
+	  auto solved = smtsolver.solve();
+	  LEVISPROFILE (timer.reset ();)
+          switch (solved) {
 	  case Words::SMT::SolverResult::Satis: {
 	    std::shared_ptr<Words::Options> tt = from->copy ();
 	    tt->equations.clear();
 			
 	    Words::Substitution finalSolution;
-	    Words::SMT::retriveSubstitution (*smtsolver,*tt,finalSolution);
+	    Words::SMT::retriveSubstitution (smtsolver,*tt,finalSolution);
 	    auto nnode = graph.makeNode (tt);
 	    graph.addEdge (n,nnode,finalSolution);
-	    subs = findRootSolution (nnode);
+	    subs = LEVISTIME (profile,Phase::RootSolution,graph.rootSolution (nnode));
 	    waiting.clear();
 	    result = Words::Solvers::Result::HasSolution;
 	    return true;
 	    break;
 	  }
 	  case Words::SMT::SolverResult::Unknown:
-	    waiting.insert (from);
+	    LEVISTIME (profile,Phase::Hashing,waiting.insert (from));
 	    break;
 	  case Words::SMT::SolverResult::NSatis:
+	    LEVISPROFILE (profile.pruned (Pruned::Unsat);)
 	    break;
 	  } 
 	  return false;
@@ -321,13 +356,34 @@ namespace Words {
 	  return smtSolverCalls;
         }
 
+	// The SMT queries made on this thread since the handler was made
+	auto getSessionStatistics () const {
+	  return session.statistics () - sessionStart;
+	}
+
+	Words::SMT::Session& getSession () {
+	  return session;
+	}
+
+#ifdef ENABLELEVISPROFILE
+	Profile& getProfile () {
+	  return profile;
+	}
+#endif
+
       private:
 	PassedWaiting& waiting;
 	Graph& graph;
 	Words::Substitution& subs;
+	const std::atomic<bool>& stop;
+	Words::SMT::Session& session;
+	Words::SMT::SessionStatistics sessionStart;
 	Words::Solvers::Result result = Words::Solvers::Result::NoIdea;
         size_t smtSolverCalls;
+	LEVISPROFILE (Profile profile;)
       };
+
+      using Rules = RuleSequencer<Handler,PrefixReasoningLeftHandSide,PrefixReasoningRightHandSide,PrefixReasoningEqual,PrefixEmptyWordLeftHandSide,PrefixEmptyWordRightHandSide,PrefixLetterLeftHandSide,PrefixLetterRightHandSide,SuffixReasoningLeftHandSide,SuffixReasoningRightHandSide,SuffixReasoningEqual,SuffixEmptyWordLeftHandSide,SuffixEmptyWordRightHandSide,SuffixLetterLeftHandSide,SuffixLetterRightHandSide>;
 	  
       ::Words::Solvers::Result Solver::Solve (Words::Options& opt,::Words::Solvers::MessageRelay& relay)   {
 	relay.pushMessage ("Levis Algorithm");
@@ -339,11 +395,22 @@ namespace Words {
 	  return ::Words::Solvers::Result::NoIdea;
 	PassedWaiting waiting (getQueue());
 	Graph graph;
-        Handler handler (waiting,graph,sub);
+        Handler handler (waiting,graph,sub,stop);
+	WatchedSession watched (*this,handler.getSession ());
         smtSolverCalls = 0;
+        passedStates = 0;
+        passedBytes = 0;
+        mergedStates = 0;
+        spilledStates = 0;
+        spilledBytes = 0;
+        auto spilledBefore = getQueue().spilledStates();
+        auto spilledBytesBefore = getQueue().spilledBytes();
+        smtStatistics = Words::SMT::SessionStatistics ();
+	LEVISPROFILE (profile = Profile ();)
 
 	if (opt.equations.size() == 0) {
-	  auto res = solveDummy (opt,sub); 
+	  auto res = solveDummy (handler.getSession (),opt,sub,stop); 
+	  smtStatistics = handler.getSessionStatistics ();
 	  if ( res == Words::SMT::SolverResult::Satis ) {
 	    return Words::Solvers::Result::HasSolution;
 	  }
@@ -383,17 +450,18 @@ namespace Words {
 	  if (linearsSatisfiedByEmpty (*insert)) {
 	    auto fnode = graph.makeNode (first); 
 	    graph.addEdge (fnode,inode,simplSub);
-	    sub = findRootSolution (inode);
+	    sub = graph.rootSolution (inode);
 	    return Words::Solvers::Result::HasSolution;
           } else {
 	    Words::Substitution solution;
 	    auto fnode = graph.makeNode (first);
 	    graph.addEdge (fnode,inode,simplSub);
-	    auto res = solveDummy (*insert,solution); 
+	    auto res = solveDummy (handler.getSession (),*insert,solution,stop); 
+	    smtStatistics = handler.getSessionStatistics ();
 	    if ( res == Words::SMT::SolverResult::Satis) {
 	      auto dnode = graph.makeDummyNode ();
 	      graph.addEdge (inode,dnode,solution);
-	      sub = findRootSolution (dnode);
+	      sub = graph.rootSolution (dnode);
 	      return Words::Solvers::Result::HasSolution;
 	    }
 	    else if (res == Words::SMT::SolverResult::NSatis) {
@@ -405,22 +473,39 @@ namespace Words {
 	  }
 	}
 	//auto insert = opt.copy ();
+	else if (threads > 1) {
+	  return explore (insert,graph,relay);
+	}
 	else {
 	  waiting.insert (insert);
 	}
-	while (waiting.size()) {
+	while (waiting.size() && !stop) {
           auto cur = waiting.pullElement ();
 	
 	//std::cout << "---------" << std::endl;
 	//std::cout << "Consider the equation: " << waiting.size() << " " << *cur << std::endl;
 
-	  RuleSequencer<Handler,PrefixReasoningLeftHandSide,PrefixReasoningRightHandSide,PrefixReasoningEqual,PrefixEmptyWordLeftHandSide,PrefixEmptyWordRightHandSide,PrefixLetterLeftHandSide,PrefixLetterRightHandSide,SuffixReasoningLeftHandSide,SuffixReasoningRightHandSide,SuffixReasoningEqual,SuffixEmptyWordLeftHandSide,SuffixEmptyWordRightHandSide,SuffixLetterLeftHandSide,SuffixLetterRightHandSide>::runRules (handler,*cur);
+	  Rules::runRules (handler,*cur);
 
          // RuleSequencer<Handler,GuessConstIsOneVariable,PrefixReasoningLeftHandSide,PrefixReasoningRightHandSide,PrefixReasoningEqual,PrefixEmptyWordLeftHandSide,PrefixEmptyWordRightHandSide,PrefixLetterLeftHandSide,PrefixLetterRightHandSide,SuffixReasoningLeftHandSide,SuffixReasoningRightHandSide,SuffixReasoningEqual,SuffixEmptyWordLeftHandSide,SuffixEmptyWordRightHandSide,SuffixLetterLeftHandSide,SuffixLetterRightHandSide>::runRules (handler,*cur);
-          relay.progressMessage ((Words::Solvers::Formatter ("Passed: %1%, Waiting: %2%") % waiting.passedsize() % waiting.size()).str());
+          auto statistics = getQueue().getStatistics();
+          relay.progressMessage ((Words::Solvers::Formatter ("Passed: %1% (%3% bytes each), Waiting: %2%%4%") % waiting.passedsize() % waiting.size() % waiting.passedmemory() % (statistics.empty() ? "" : ", " + statistics)).str());
 	}
 
         smtSolverCalls = handler.getSMTSolverCalls();
+        smtStatistics = handler.getSessionStatistics ();
+        passedStates = waiting.passedsize();
+        passedBytes = waiting.passedmemory();
+        mergedStates = waiting.mergedsize();
+        spilledStates = getQueue().spilledStates() - spilledBefore;
+        spilledBytes = getQueue().spilledBytes() - spilledBytesBefore;
+	LEVISPROFILE (profile = handler.getProfile ();)
+	writeProfile ();
+
+        if (stop && handler.getResult() == Words::Solvers::Result::NoIdea) {
+	  // The search space was not exhausted
+	  return Words::Solvers::Result::NoIdea;
+        }
 
         if (handler.getResult() == Words::Solvers::Result::NoIdea ){
 	  return Words::Solvers::Result::DefinitelyNoSolution;
@@ -430,6 +515,127 @@ namespace Words {
         return handler.getResult ();
       }
 
+      void Solver::interrupt () {
+	std::lock_guard<std::mutex> lock (sessionsMutex);
+	stop = true;
+	for (auto session : sessions) {
+	  session->interrupt ();
+	}
+      }
+
+      void Solver::watch (Words::SMT::Session& session) {
+	std::lock_guard<std::mutex> lock (sessionsMutex);
+	if (stop) {
+	  session.interrupt ();
+	}
+	sessions.push_back (&session);
+      }
+
+      void Solver::unwatch (Words::SMT::Session& session) {
+	std::lock_guard<std::mutex> lock (sessionsMutex);
+	sessions.erase (std::find (sessions.begin (),sessions.end (),&session));
+	// The thread may run other searches
+	session.clearInterrupt ();
+      }
+
+      void Solver::writeProfile () {
+#ifdef ENABLELEVISPROFILE
+	if (getProfileFile ().empty ())
+	  return;
+	std::ofstream os (getProfileFile ());
+	if (!os) {
+	  throw Words::WordException ("Cannot write the profile to " + getProfileFile ());
+	}
+	profile.printJSON (os);
+#endif
+      }
+
+      ::Words::Solvers::Result Solver::explore (const std::shared_ptr<Words::Options>& start, Graph& graph, ::Words::Solvers::MessageRelay& relay) {
+	relay.pushMessage ((Formatter ("Exploring with %1% threads") % threads).str());
+	if (getSearchOrder () == SearchOrder::BestFirst) {
+	  relay.pushMessage ((Formatter ("%1% is not supported with several threads, exploring breadth first instead") % getQueue ().getName ()).str());
+	}
+	ConcurrentPassedSet passed (useExactPassedCheck (),useCanonicalPassed ());
+	std::atomic<size_t> pending {0};
+	std::vector<std::unique_ptr<WorkDeque>> deques;
+	for (size_t i = 0; i < threads; i++) {
+	  deques.push_back (std::make_unique<WorkDeque> (pending));
+	}
+	PassedWaiting (*deques[0],passed).insert (start);
+
+	std::atomic<bool> found {false};
+	std::atomic<size_t> smtCalls {0};
+	std::mutex errorMutex;
+	std::mutex statisticsMutex;
+	std::exception_ptr error;
+	auto work = [&] (size_t t) {
+	  try {
+	    PassedWaiting waiting (*deques[t],passed);
+	    Words::Substitution subs;
+	    Handler handler (waiting,graph,subs,stop);
+	    WatchedSession watched (*this,handler.getSession ());
+	    SearchQueue::Element cur;
+	    while (!stop && !found) {
+	      bool got = deques[t]->take (cur);
+	      for (size_t i = 1; !got && i < threads; i++) {
+		got = deques[(t + i) % threads]->steal (cur);
+	      }
+	      if (!got) {
+		if (!pending) {
+		  break;
+		}
+		std::this_thread::yield ();
+		continue;
+	      }
+	      Rules::runRules (handler,*cur);
+	      pending--;
+	      if (handler.getResult () == Words::Solvers::Result::HasSolution && !found.exchange (true)) {
+		sub = subs;
+	      }
+	      if (t == 0) {
+		relay.progressMessage ((Words::Solvers::Formatter ("Passed: %1%, Waiting: %2%") % passed.size() % pending.load()).str());
+	      }
+	    }
+	    smtCalls += handler.getSMTSolverCalls ();
+	    std::lock_guard<std::mutex> lock (statisticsMutex);
+	    smtStatistics += handler.getSessionStatistics ();
+	    LEVISPROFILE (profile += handler.getProfile ();)
+	  }
+	  catch (...) {
+	    std::lock_guard<std::mutex> lock (errorMutex);
+	    if (!error) {
+	      error = std::current_exception ();
+	    }
+	    found = true;
+	  }
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+	  workers.emplace_back (work,t);
+	}
+	for (auto& w : workers) {
+	  w.join ();
+	}
+	if (error) {
+	  std::rethrow_exception (error);
+	}
+
+	smtSolverCalls = smtCalls;
+	passedStates = passed.size ();
+	passedBytes = passedStates ? passed.memoryUsage () / passedStates : 0;
+	mergedStates = passed.merged ();
+	writeProfile ();
+	if (found) {
+	  return Words::Solvers::Result::HasSolution;
+	}
+	if (stop) {
+	  // The search space was not exhausted
+	  return Words::Solvers::Result::NoIdea;
+	}
+	return Words::Solvers::Result::DefinitelyNoSolution;
+      }
+
 
 
 
@@ -1,39 +1,92 @@
 #ifndef _SAT_SOLVER__
 #define _SAT_SOLVER__
 
+#include <atomic>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 #include "words/words.hpp"
 #include "words/constraints.hpp"
 #include "solvers/solvers.hpp"
 #include "solvers/timing.hpp"
+#include "smt/smtsolvers.hpp"
+#include "profile.hpp"
 
 namespace Words {
   namespace Solvers {
 	namespace Levis {
+	  class Graph;
 	  
 	  class Solver : public ::Words::Solvers::Solver {
 	  public:
-		Solver ()  {} 
+		// With more than one thread, the search is spread over threads
+		// stealing work from each other
+		Solver (size_t threads = 1) : threads (threads) {} 
 		Result Solve (Words::Options&,Words::Solvers::MessageRelay&) override;
 		//Should only be called if Result returned HasSolution
 		void getResults (Words::Solvers::ResultGatherer& r) override {
             std::stringstream str;
             r.setSubstitution (sub);
+            LEVISPROFILE (r.timingInfo (profile.timing ());)
 		}
 
         void getMoreInformation (std::ostream& os) override {
             os << "SMTCalls: " << smtSolverCalls << " \n";
+            os << "PassedStates: " << passedStates << " \n";
+            os << "BytesPerPassedState: " << passedBytes << " \n";
+            os << "MergedStates: " << mergedStates << " \n";
+            os << "SpilledStates: " << spilledStates << " \n";
+            os << "SpilledBytes: " << spilledBytes << " \n";
+            os << "SMTQueries: " << smtStatistics.queries << " \n";
+            os << "SMTContexts: " << smtStatistics.contexts << " \n";
+            os << "SMTSetupTime: " << smtStatistics.setupTime << " ms \n";
+            LEVISPROFILE (profile.print (os);)
         }
+
+		// Also interrupts the SMT queries the search is running
+		void interrupt () override;
 		
 	  private:
+		// Lets interrupt () reach the SMT session of the calling thread
+		// while in scope
+		class WatchedSession {
+		public:
+		  WatchedSession (Solver& solver, Words::SMT::Session& session) : solver (solver), session (session) {solver.watch (session);}
+		  ~WatchedSession () {solver.unwatch (session);}
+		private:
+		  Solver& solver;
+		  Words::SMT::Session& session;
+		};
+
+		void watch (Words::SMT::Session&);
+		void unwatch (Words::SMT::Session&);
+		Result explore (const std::shared_ptr<Words::Options>& start, Graph& graph, Words::Solvers::MessageRelay&);
+		// Writes the profile to the file set with setProfileFile, if any
+		void writeProfile ();
+
+        size_t threads;
         Words::Substitution sub;
         size_t smtSolverCalls;
+        size_t passedStates = 0;
+        size_t passedBytes = 0;
+        size_t mergedStates = 0;
+        size_t spilledStates = 0;
+        size_t spilledBytes = 0;
+        Words::SMT::SessionStatistics smtStatistics;
+		LEVISPROFILE (Profile profile;)
+		std::atomic<bool> stop{false};
+		// The sessions of the threads searching, guarded by sessionsMutex
+		std::mutex sessionsMutex;
+		std::vector<Words::SMT::Session*> sessions;
 	  };
 	}
 
 	template<>
 	Solver_ptr makeSolver<Types::Levis> ( ) {return std::make_unique<Levis::Solver> ();}
+
+	template<>
+	Solver_ptr makeSolver<Types::Levis,size_t> (size_t threads) {return std::make_unique<Levis::Solver> (threads);}
 	
 	
 	
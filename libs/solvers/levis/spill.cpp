@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "words/exceptions.hpp"
+#include "fingerprint.hpp"
+#include "spill.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  namespace {
+		// Records are the number of words of the form, the index of the
+		// context and the form. Systems without a compact form are marked
+		// with Kept in place of the context and have no form.
+		const uint32_t Kept = ~uint32_t (0);
+		const std::size_t header = 2;
+	  }
+
+	  SpillFile::SpillFile () {}
+
+	  SpillFile::~SpillFile () {
+		unmap ();
+		if (file) {
+		  std::fclose (file);
+		}
+	  }
+
+	  void SpillFile::open () {
+		// Removed by the system once closed
+		file = std::tmpfile ();
+		if (!file) {
+		  throw Words::WordException ("Cannot create a file for the waiting list");
+		}
+	  }
+
+	  uint32_t SpillFile::contextIndex (const std::shared_ptr<Words::Context>& context) {
+		auto it = std::find (contexts.begin (),contexts.end (),context);
+		if (it == contexts.end ()) {
+		  contexts.push_back (context);
+		  it = contexts.end () - 1;
+		}
+		return static_cast<uint32_t> (it - contexts.begin ());
+	  }
+
+	  void SpillFile::write (const std::shared_ptr<Words::Options>& opt) {
+		if (!file) {
+		  open ();
+		}
+		record.assign (header,0);
+		if (hasCompactForm (*opt)) {
+		  serialise (*opt,form);
+		  record[0] = static_cast<uint32_t> (form.size ());
+		  record[1] = contextIndex (opt->context);
+		  record.insert (record.end (),form.begin (),form.end ());
+		}
+		else {
+		  record[1] = Kept;
+		  kept.push_back (opt);
+		}
+		auto bytes = record.size () * sizeof (uint32_t);
+		if (std::fwrite (record.data (),sizeof (uint32_t),record.size (),file) != record.size ()) {
+		  throw Words::WordException ("Cannot write the waiting list to disk");
+		}
+		writeOffset += bytes;
+		totalBytes += bytes;
+		totalStates++;
+		records++;
+	  }
+
+	  std::shared_ptr<Words::Options> SpillFile::read () {
+		if (readOffset >= mappedBytes) {
+		  if (2 * readOffset > writeOffset) {
+			compact ();
+		  }
+		  map ();
+		}
+		auto pos = mapped + readOffset / sizeof (uint32_t);
+		auto words = pos[0];
+		auto context = pos[1];
+		pos += header;
+		readOffset += (header + words) * sizeof (uint32_t);
+		records--;
+		std::shared_ptr<Words::Options> res;
+		if (context == Kept) {
+		  res = kept.front ();
+		  kept.pop_front ();
+		}
+		else {
+		  res = deserialise (pos,contexts[context]);
+		}
+		if (!records) {
+		  clear ();
+		}
+		return res;
+	  }
+
+	  void SpillFile::clear () {
+		unmap ();
+		if (file) {
+		  std::rewind (file);
+		  if (ftruncate (fileno (file),0)) {
+			throw Words::WordException ("Cannot empty the waiting list file");
+		  }
+		}
+		writeOffset = 0;
+		readOffset = 0;
+		records = 0;
+		kept.clear ();
+	  }
+
+	  void SpillFile::compact () {
+		unmap ();
+		if (std::fflush (file)) {
+		  throw Words::WordException ("Cannot write the waiting list to disk");
+		}
+		auto fd = fileno (file);
+		std::vector<char> buffer (1 << 16);
+		std::size_t from = readOffset;
+		std::size_t to = 0;
+		// Front to back, as the target comes before the source
+		while (from < writeOffset) {
+		  auto n = pread (fd,buffer.data (),std::min (buffer.size (),writeOffset - from),from);
+		  if (n <= 0 || pwrite (fd,buffer.data (),n,to) != n) {
+			throw Words::WordException ("Cannot compact the waiting list file");
+		  }
+		  from += n;
+		  to += n;
+		}
+		if (ftruncate (fd,to) || std::fseek (file,0,SEEK_END)) {
+		  throw Words::WordException ("Cannot compact the waiting list file");
+		}
+		writeOffset = to;
+		readOffset = 0;
+	  }
+
+	  void SpillFile::map () {
+		unmap ();
+		if (std::fflush (file)) {
+		  throw Words::WordException ("Cannot write the waiting list to disk");
+		}
+		auto res = mmap (nullptr,writeOffset,PROT_READ,MAP_SHARED,fileno (file),0);
+		if (res == MAP_FAILED) {
+		  throw Words::WordException ("Cannot map the waiting list file");
+		}
+		mapped = static_cast<const uint32_t*> (res);
+		mappedBytes = writeOffset;
+		// Read once, front to back
+		madvise (res,mappedBytes,MADV_SEQUENTIAL);
+	  }
+
+	  void SpillFile::unmap () {
+		if (mapped) {
+		  munmap (const_cast<uint32_t*> (mapped),mappedBytes);
+		  mapped = nullptr;
+		  mappedBytes = 0;
+		}
+	  }
+	}
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef _SPILL_
+#define _SPILL_
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "words/words.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Levis {
+	  // Systems written to a temporary file in their serialised form and
+	  // read back, through a memory mapping of the file, in the order they
+	  // were written. Systems without a compact form stay in memory but
+	  // keep their place in the order. The file is emptied whenever all of
+	  // it has been read, and the part not read yet is moved to its start
+	  // once more than half of it has been, so the file stays about the
+	  // size of the systems still in it.
+	  class SpillFile {
+	  public:
+		SpillFile ();
+		~SpillFile ();
+		SpillFile (const SpillFile&) = delete;
+		SpillFile& operator= (const SpillFile&) = delete;
+
+		void write (const std::shared_ptr<Words::Options>&);
+		// The oldest system not read yet, must not be empty
+		std::shared_ptr<Words::Options> read ();
+		void clear ();
+
+		std::size_t size () const {return records;}
+		bool empty () const {return !records;}
+
+		// Systems and bytes written to the file so far, clear () included
+		std::size_t writtenStates () const {return totalStates;}
+		std::size_t writtenBytes () const {return totalBytes;}
+		// Bytes the file currently takes
+		std::size_t fileBytes () const {return writeOffset;}
+
+	  private:
+		void open ();
+		// Maps the file up to where it has been written
+		void map ();
+		void unmap ();
+		// Moves the records not read yet to the start of the file
+		void compact ();
+		uint32_t contextIndex (const std::shared_ptr<Words::Context>&);
+
+		std::FILE* file = nullptr;
+		const uint32_t* mapped = nullptr;
+		std::size_t mappedBytes = 0;
+		std::size_t writeOffset = 0;
+		std::size_t readOffset = 0;
+		std::size_t records = 0;
+		std::size_t totalStates = 0;
+		std::size_t totalBytes = 0;
+		std::vector<std::shared_ptr<Words::Context>> contexts;
+		std::deque<std::shared_ptr<Words::Options>> kept;
+		std::vector<uint32_t> record;
+		std::vector<uint32_t> form;
+	  };
+	}
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include <exception>
+#include <thread>
+
+#include "words/exceptions.hpp"
+#include "words/words.hpp"
+#include "solver.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Portfolio {
+
+	  namespace {
+		bool isDefinitive (Result res) {
+		  return res == Result::HasSolution || res == Result::DefinitelyNoSolution;
+		}
+
+		// Translates the results of a member back to the symbols of the original system
+		class TranslatingGatherer : public ResultGatherer {
+		public:
+		  TranslatingGatherer (ResultGatherer& r, const std::map<const IEntry*,IEntry*>& entries, Words::Context& ctx) : r(r),ctx(ctx) {
+			for (auto& e : entries) {
+			  original.insert (std::make_pair (e.second,const_cast<IEntry*> (e.first)));
+			}
+		  }
+
+		  void setSubstitution (Words::Substitution& s) override {
+			Words::Substitution translated;
+			for (auto& sub : s) {
+			  auto it = original.find (sub.first);
+			  // Variables introduced by the member are not part of the original system
+			  if (it == original.end ())
+				continue;
+			  std::vector<IEntry*> word;
+			  for (auto c : sub.second) {
+				auto oit = original.find (c);
+				word.push_back (oit != original.end () ? oit->second : ctx.addTerminal (c->getTerminal()->getChar ()));
+			  }
+			  translated[it->second] = Words::Word (std::move(word));
+			}
+			r.setSubstitution (translated);
+		  }
+
+		  void diagnosticString (const std::string& s) override {r.diagnosticString (s);}
+		  void timingInfo (const Timing::Keeper& s) override {r.timingInfo (s);}
+
+		private:
+		  ResultGatherer& r;
+		  Words::Context& ctx;
+		  std::map<IEntry*,IEntry*> original;
+		};
+	  }
+
+	  Result Solver::Solve (Words::Options& opt,MessageRelay& relay) {
+		relay.pushMessage ((Formatter ("Portfolio of %1% solvers") % members.size()).str());
+		context = opt.context;
+		entries.assign (members.size(),{});
+		std::vector<std::shared_ptr<Words::Options>> copies;
+		for (size_t i = 0; i < members.size(); i++) {
+		  copies.push_back (opt.deepCopy (entries[i]));
+		}
+
+		std::mutex relayMutex;
+		std::vector<Result> results (members.size(),Result::NoIdea);
+		std::vector<std::exception_ptr> errors (members.size());
+		std::vector<std::thread> threads;
+		for (size_t i = 0; i < members.size(); i++) {
+		  threads.emplace_back ([&,i]() {
+			SynchronisedRelay memberRelay (relay,relayMutex,members[i].first);
+			try {
+			  results[i] = members[i].second->Solve (*copies[i],memberRelay);
+			}
+			catch (...) {
+			  errors[i] = std::current_exception ();
+			}
+			if (isDefinitive (results[i])) {
+			  std::lock_guard<std::mutex> lock (mutex);
+			  if (winner < 0) {
+				winner = static_cast<int> (i);
+				for (size_t j = 0; j < members.size(); j++) {
+				  if (j != i)
+					members[j].second->interrupt ();
+				}
+			  }
+			}
+		  });
+		}
+		for (auto& t : threads) {
+		  t.join ();
+		}
+
+		if (winner >= 0) {
+		  relay.pushMessage ((Formatter ("Portfolio: %1% decided the instance") % members[winner].first).str());
+		  return results[winner];
+		}
+		for (auto& e : errors) {
+		  if (e)
+			std::rethrow_exception (e);
+		}
+		for (auto res : results) {
+		  if (res == Result::NoSolution)
+			return Result::NoSolution;
+		}
+		return Result::NoIdea;
+	  }
+
+	  void Solver::getResults (ResultGatherer& r) {
+		if (winner < 0)
+		  return;
+		TranslatingGatherer gatherer (r,entries[winner],*context);
+		members[winner].second->getResults (gatherer);
+	  }
+
+	  void Solver::getMoreInformation (std::ostream& os) {
+		for (auto& m : members) {
+		  os << m.first << ":\n";
+		  m.second->getMoreInformation (os);
+		}
+	  }
+
+	  void Solver::enableDiagnosticOutput () {
+		for (auto& m : members) {
+		  m.second->enableDiagnosticOutput ();
+		}
+	  }
+
+	  void Solver::interrupt () {
+		std::lock_guard<std::mutex> lock (mutex);
+		for (auto& m : members) {
+		  m.second->interrupt ();
+		}
+	  }
+	}
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef _PORTFOLIO_SOLVER__
+#define _PORTFOLIO_SOLVER__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+
+namespace Words {
+  namespace Solvers {
+	namespace Portfolio {
+
+	  // Runs its members on separate threads, each on its own deep copy of the equation system.
+	  // The first member reporting HasSolution or DefinitelyNoSolution wins, the others are interrupted.
+	  class Solver : public ::Words::Solvers::Solver {
+	  public:
+		Solver (Members members) : members(std::move(members)) {}
+		Result Solve (Words::Options&,Words::Solvers::MessageRelay&) override;
+		//Should only be called if Result returned HasSolution
+		void getResults (Words::Solvers::ResultGatherer& r) override;
+		void getMoreInformation (std::ostream& os) override;
+		void enableDiagnosticOutput () override;
+		void interrupt () override;
+
+	  private:
+		Members members;
+		// Symbols of the copy solved by each member, by symbol of the original system
+		std::vector<std::map<const IEntry*,IEntry*>> entries;
+		std::shared_ptr<Words::Context> context;
+		std::mutex mutex;
+		int winner = -1;
+	  };
+	}
+
+	template<>
+	Solver_ptr makeSolver<Types::Portfolio,Portfolio::Members> (Portfolio::Members members) {return std::make_unique<Portfolio::Solver> (std::move(members));}
+
+  }
+}
+
+#endif
@@ -25,6 +25,11 @@ using EquationSystemSimplifier = Simplifier<Words::Options, Words::Substitution>
 
 using RegularConstraintSimplifier = Simplifier<Words::Options, Words::Substitution>;
 
+// One flag per equation of a system, by position: false if the equation is
+// the unchanged result of an earlier run of the equation simplifier, and so
+// need not be simplified again.
+using DirtyEquations = std::vector<bool>;
+
 template <class T, class... Ts>
 class SequenceSimplifier2;
 
@@ -32,6 +37,9 @@ template <class T, class First>
 class SequenceSimplifier2<T, First> {
    public:
     static Simplified solverReduce(T& eq, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr) { return First::solverReduce(eq, s, cstr); }
+    static Simplified solverReduce(T& eq, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr, DirtyEquations& dirty) {
+        return First::solverReduce(eq, s, cstr, dirty);
+    }
 };
 
 template <class T, class First, class... Ts>
@@ -46,6 +54,16 @@ class SequenceSimplifier2<T, First, Ts...> {
             return SequenceSimplifier2<T, Ts...>::solverReduce(eq, s, cstr);
         }
     }
+
+    static Simplified solverReduce(T& eq, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr, DirtyEquations& dirty) {
+        auto res = First::solverReduce(eq, s, cstr, dirty);
+        if (res == Simplified::ReducedSatis || res == Simplified::ReducedNsatis)
+            return res;
+        else {
+            s.clear();
+            return SequenceSimplifier2<T, Ts...>::solverReduce(eq, s, cstr, dirty);
+        }
+    }
 };
 
 class TreeFlatteningSimplifier : public RegularConstraintSimplifier {
@@ -186,10 +204,21 @@ template <class Sub>
 class RunAllEq : public EquationSystemSimplifier {
    public:
     static Simplified solverReduce(Words::Options& opt, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr) {
+        DirtyEquations dirty(opt.equations.size(), true);
+        return solverReduce(opt, s, cstr, dirty);
+    }
+
+    // Only runs Sub on the dirty equations. Afterwards none is dirty.
+    static Simplified solverReduce(Words::Options& opt, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr, DirtyEquations& dirty) {
         std::vector<Equation> eqs;
         std::vector<Constraints::Constraint_ptr> cstr2;
         std::vector<Constraints::Constraint_ptr> tmp;
-        for (auto& eq : opt.equations) {
+        for (size_t i = 0; i < opt.equations.size(); i++) {
+            auto& eq = opt.equations[i];
+            if (!dirty[i]) {
+                eqs.push_back(eq);
+                continue;
+            }
             s.clear();
             cstr2.clear();
             auto res = Sub::solverReduce(eq, s, cstr2);
@@ -225,6 +254,7 @@ class RunAllEq : public EquationSystemSimplifier {
 
         opt.equations.clear();
         opt.equations = eqs;
+        dirty.assign(opt.equations.size(), false);
         if (opt.equations.size()) return Simplified::JustReduced;
         return Simplified::ReducedSatis;
     }
@@ -235,34 +265,38 @@ class PrefixReducer {
     static Simplified solverReduce(Words::Equation& eq, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr) {
         auto& lhs = eq.lhs;
         auto& rhs = eq.rhs;
-        while (lhs.ebegin() != lhs.eend() && rhs.ebegin() != rhs.eend()) {
-            Word::entry_iterator lfirst = eq.lhs.ebegin();
-            Word::entry_iterator rfirst = eq.rhs.ebegin();
-            if (*lfirst == *rfirst) {
-                if ((*lfirst)->isVariable()) {
-                    cstr.push_back(Constraints::Constraint_ptr(new Constraints::Unrestricted(*lfirst)));
-                    s[(*lfirst)] = Words::Word();
+        // Scanned through the const views, so words shared with other
+        // systems are only copied once an entry is actually removed
+        const Word& clhs = lhs;
+        const Word& crhs = rhs;
+        while (clhs.entries() && crhs.entries()) {
+            IEntry* lfirst = *clhs.ebegin();
+            IEntry* rfirst = *crhs.ebegin();
+            if (lfirst == rfirst) {
+                if (lfirst->isVariable()) {
+                    cstr.push_back(Constraints::Constraint_ptr(new Constraints::Unrestricted(lfirst)));
+                    s[lfirst] = Words::Word();
                 }
 
-                lhs.erase_entry(lfirst);
-                rhs.erase_entry(rfirst);
+                lhs.erase_entry(lhs.ebegin());
+                rhs.erase_entry(rhs.ebegin());
 
-            } else if ((*lfirst)->isSequence() && (*rfirst)->isSequence()) {
-                Words::Sequence* ll = (*lfirst)->getSequence();
-                Words::Sequence* rr = (*rfirst)->getSequence();
+            } else if (lfirst->isSequence() && rfirst->isSequence()) {
+                Words::Sequence* ll = lfirst->getSequence();
+                Words::Sequence* rr = rfirst->getSequence();
                 if (*ll < *rr) {
                     auto seqdiff = *rr - *ll;
                     auto seq = eq.ctxt->addSequence(seqdiff);
-                    eq.lhs.erase_entry(lfirst);
-                    eq.rhs.replace_entry(rfirst, seq);
+                    lhs.erase_entry(lhs.ebegin());
+                    rhs.replace_entry(rhs.ebegin(), seq);
 
                 }
 
                 else if (*rr < *ll) {
                     auto seqdiff = *ll - *rr;
                     auto seq = eq.ctxt->addSequence(seqdiff);
-                    eq.rhs.erase_entry(rfirst);
-                    eq.lhs.replace_entry(lfirst, seq);
+                    rhs.erase_entry(rhs.ebegin());
+                    lhs.replace_entry(lhs.ebegin(), seq);
 
                 } else {
                     cstr.clear();
@@ -273,7 +307,7 @@ class PrefixReducer {
             } else
                 break;
         }
-        if (lhs.ebegin() == lhs.eend() && rhs.ebegin() == rhs.eend()) {
+        if (!clhs.entries() && !crhs.entries()) {
             return Simplified::ReducedSatis;
         }
         s.clear();
@@ -286,31 +320,34 @@ class SuffixReducer {
     static Simplified solverReduce(Words::Equation& eq, Substitution& s, std::vector<Constraints::Constraint_ptr>& cstr) {
         auto& lhs = eq.lhs;
         auto& rhs = eq.rhs;
-        while (lhs.ebegin() != lhs.eend() && rhs.ebegin() != rhs.eend()) {
-            auto lrfirst = lhs.rebegin();
-            auto rrfirst = rhs.rebegin();
-            if (*lrfirst == *rrfirst) {
-                if ((*lrfirst)->isVariable()) {
-                    cstr.push_back(Constraints::Constraint_ptr(new Constraints::Unrestricted(*lrfirst)));
+        // See PrefixReducer
+        const Word& clhs = lhs;
+        const Word& crhs = rhs;
+        while (clhs.entries() && crhs.entries()) {
+            IEntry* llast = *clhs.rebegin();
+            IEntry* rlast = *crhs.rebegin();
+            if (llast == rlast) {
+                if (llast->isVariable()) {
+                    cstr.push_back(Constraints::Constraint_ptr(new Constraints::Unrestricted(llast)));
                 }
 
-                eq.lhs.erase_entry(lrfirst);
-                eq.rhs.erase_entry(rrfirst);
-            } else if ((*lrfirst)->isSequence() && (*rrfirst)->isSequence()) {
-                Words::Sequence* ll = (*lrfirst)->getSequence();
-                Words::Sequence* rr = (*rrfirst)->getSequence();
+                lhs.erase_entry(lhs.rebegin());
+                rhs.erase_entry(rhs.rebegin());
+            } else if (llast->isSequence() && rlast->isSequence()) {
+                Words::Sequence* ll = llast->getSequence();
+                Words::Sequence* rr = rlast->getSequence();
                 if (ll->isSuffixOf(*rr)) {
                     auto seqdiff = rr->chopTail(*ll);
                     auto seq = eq.ctxt->addSequence(seqdiff);
-                    eq.lhs.erase_entry(lrfirst);
-                    eq.rhs.replace_entry(rrfirst, seq);
+                    lhs.erase_entry(lhs.rebegin());
+                    rhs.replace_entry(rhs.rebegin(), seq);
                 }
 
                 else if (rr->isSuffixOf(*ll)) {
                     auto seqdiff = ll->chopTail(*rr);
                     auto seq = eq.ctxt->addSequence(seqdiff);
-                    eq.rhs.erase_entry(rrfirst);
-                    eq.lhs.replace_entry(lrfirst, seq);
+                    rhs.erase_entry(rhs.rebegin());
+                    lhs.replace_entry(lhs.rebegin(), seq);
                 } else {
                     s.clear();
                     cstr.clear();
@@ -321,7 +358,7 @@ class SuffixReducer {
                 break;
             }
         }
-        if (lhs.ebegin() == lhs.eend() && rhs.ebegin() == rhs.eend()) {
+        if (!clhs.entries() && !crhs.entries()) {
             return Simplified::ReducedSatis;
         }
         s.clear();
@@ -346,6 +383,10 @@ class ConstSequenceMismatch : public EquationSimplifier {
         } else
             return Simplified::JustReduced;
 
+        // Nothing to match against, e.g. after a variable was replaced by the empty word
+        if (constSide->ebegin() == constSide->eend())
+            return Simplified::JustReduced;
+
         std::vector<Words::Sequence*> consts;
         variableSide->getSequences(consts);
         assert((*constSide->ebegin())->isSequence());
@@ -372,8 +413,10 @@ class ConstSequenceFolding {
         std::vector<Words::IEntry*> nword;
         Words::Context::SeqInput nseq;
 
-        Words::Word::entry_iterator begin = lhs.ebegin();
-        Words::Word::entry_iterator end = lhs.eend();
+        // Only reads lhs, so its entries stay shared until the assignment below
+        const Words::Word& word = lhs;
+        Words::Word::const_entry_iterator begin = word.ebegin();
+        Words::Word::const_entry_iterator end = word.eend();
         for (auto it = begin; it != end; ++it) {
             if ((*it)->isVariable()) {
                 if (nseq.size()) {
@@ -407,7 +450,14 @@ class SubstitutionReasoningNew {
         return Inner::solverReduce(eq, subs, cstr);
     }
 
-    static Simplified solverReduce(Words::Options& opt, Substitution& substitution, std::vector<Constraints::Constraint_ptr>&) {
+    static Simplified solverReduce(Words::Options& opt, Substitution& substitution, std::vector<Constraints::Constraint_ptr>& cstr) {
+        DirtyEquations dirty(opt.equations.size(), true);
+        return solverReduce(opt, substitution, cstr, dirty);
+    }
+
+    // Clean equations the selected variable does not occur in are kept as
+    // they are, rather than being run through Inner again
+    static Simplified solverReduce(Words::Options& opt, Substitution& substitution, std::vector<Constraints::Constraint_ptr>&, DirtyEquations& dirty) {
         // return Simplified::JustReduced;
 
         std::vector<Words::Equation>::iterator it = opt.equations.begin();
@@ -436,6 +486,7 @@ class SubstitutionReasoningNew {
                 // std::cout << "c Found something to simplify: " << variable->getRepr() << " == " << *subsWord << std::endl;
 
                 std::vector<Words::Equation> eqs;
+                DirtyEquations kept;
                 assert(subsWord);
                 for (auto& mapit : substitution) {
                     mapit.second.substitudeVariable(variable, *subsWord);
@@ -448,6 +499,12 @@ class SubstitutionReasoningNew {
                         continue;
                     }
 
+                    if (!dirty[iit - opt.equations.begin()] && !iit->lhs.containsVariable(variable) && !iit->rhs.containsVariable(variable)) {
+                        eqs.push_back(*iit);
+                        kept.push_back(false);
+                        continue;
+                    }
+
                     // std::cout << "c Applying substitution to " << iit->lhs << " == " << iit->rhs << std::endl;
 
                     std::vector<Constraints::Constraint_ptr> cstr;
@@ -458,6 +515,7 @@ class SubstitutionReasoningNew {
                     } else if (res == Simplified::JustReduced) {
                         // std::copy (cstr.begin(),cstr.end(),std::back_inserter(opt.constraints));
                         eqs.push_back(*iit);
+                        kept.push_back(false);
                     }
                 }
 
@@ -485,6 +543,7 @@ class SubstitutionReasoningNew {
                 */
 
                 opt.equations = eqs;
+                dirty = kept;
                 it = opt.equations.begin();
                 end = opt.equations.end();
 
@@ -509,6 +568,7 @@ class SubstitutionReasoningNew {
                 std::vector<Constraints::Constraint_ptr> cstr;
                 ConstSequenceFolding::solverReduce(eq, dummy, cstr);
                 opt.equations.push_back(eq);
+                dirty.push_back(true);
             }
         }
 
@@ -655,11 +715,6 @@ class ParikhMatrixMismatch : public EquationSimplifier {
     }
 
     static Simplified solverReduce(Words::Equation& eq, Substitution&, std::vector<Constraints::Constraint_ptr>&) {
-        Words::Algorithms::ParikhMatrix lhs_p_pm;
-        Words::Algorithms::ParikhMatrix lhs_s_pm;
-        Words::Algorithms::ParikhMatrix rhs_p_pm;
-        Words::Algorithms::ParikhMatrix rhs_s_pm;
-
         // Avoid the calculation of an empty parikh image
         // std::cout << "PARIK EQUATION: " << eq.lhs << " == " << eq.rhs << std::endl;
         // std::cout << eq.lhs.characters() << " " << eq.lhs << std::endl;
@@ -672,50 +727,47 @@ class ParikhMatrixMismatch : public EquationSimplifier {
             return oneSideEmptyCheck(eq.lhs);
         }
 
-        Words::Algorithms::calculateParikhMatrices(eq.lhs, lhs_p_pm, lhs_s_pm);
-        Words::Algorithms::calculateParikhMatrices(eq.rhs, rhs_p_pm, rhs_s_pm);
-
-        bool processPrefix = true;
-        bool processSuffix = false;
-        bool terminalsAlignPrefix = true;
-        bool terminalsAlignSuffix = true;
-        size_t rSize = eq.rhs.characters();
-        size_t lSize = eq.lhs.characters();
-        int minSize = std::min(rSize, lSize);
-        int sri = 0;
-        int sli = 0;
-        auto terminalAlphabet = eq.ctxt->getTerminalAlphabet();
-        auto variableAlphabet = eq.ctxt->getVariableAlphabet();
+        // The left side minus the right side, one position of each at a time
+        thread_local Words::Algorithms::ParikhBalance balance;
+        balance.reset(*eq.ctxt);
+        auto lit = eq.lhs.begin();
+        auto lend = eq.lhs.end();
+        auto rit = eq.rhs.begin();
+        auto rend = eq.rhs.end();
+        for (size_t i = 0; lit != lend && rit != rend; ++lit, ++rit, ++i) {
+            balance.add(*lit);
+            balance.remove(*rit);
+            // Unbalanced equation check: prefixes of the same length with
+            // the same variables need the same terminals
+            if (i > 0 && balance.variablesBalanced() && !balance.terminalsBalanced()) {
+                // std::cout << "u Parikh UNSAT 2" << std::endl;
+                return Simplified::ReducedNsatis;
+            }
+        }
+        for (; lit != lend; ++lit) {
+            balance.add(*lit);
+        }
+        for (; rit != rend; ++rit) {
+            balance.remove(*rit);
+        }
 
         // Quick linear unsat check based on the parik image of the equation
         bool seenTwoVariables = false;
-        int sumRhs = 0;
-        int coefficentLhs = 0;
+        int64_t sumRhs = 0;
+        int64_t coefficentLhs = 0;
 
         for (auto a : eq.ctxt->getVariableAlphabet()) {
             if (coefficentLhs != 0) {
                 seenTwoVariables = true;
                 break;  //  saw two variables, we can not do anything at this point
             } else {
-                if (rhs_p_pm[rSize - 1].count(a) == 1 && lhs_p_pm[lSize - 1].count(a) == 1) {
-                    coefficentLhs = (lhs_p_pm[lSize - 1][a] - rhs_p_pm[rSize - 1][a]);
-                } else if (lhs_p_pm[lSize - 1].count(a) == 1) {
-                    coefficentLhs = lhs_p_pm[lSize - 1][a];
-                } else if (rhs_p_pm[rSize - 1].count(a) == 1) {
-                    coefficentLhs = -rhs_p_pm[rSize - 1][a];
-                }
+                coefficentLhs = balance[a];
             }
         }
 
         if (!seenTwoVariables) {
             for (auto a : eq.ctxt->getTerminalAlphabet()) {
-                if (rhs_p_pm[rSize - 1].count(a) == 1 && lhs_p_pm[lSize - 1].count(a) == 1) {
-                    sumRhs = sumRhs + (lhs_p_pm[lSize - 1][a] - rhs_p_pm[rSize - 1][a]);
-                } else if (lhs_p_pm[lSize - 1].count(a) == 1) {
-                    sumRhs = sumRhs + lhs_p_pm[lSize - 1][a];
-                } else if (rhs_p_pm[rSize - 1].count(a) == 1) {
-                    sumRhs = sumRhs - rhs_p_pm[rSize - 1][a];
-                }
+                sumRhs = sumRhs + balance[a];
             }
 
             if (coefficentLhs != 0 && (sumRhs % coefficentLhs) != 0) {
@@ -724,65 +776,7 @@ class ParikhMatrixMismatch : public EquationSimplifier {
             }
         }
 
-        // Unbalanced equation check
-        // this is dirty...
-
-        //
-
-        for (int i = 1; i < minSize; i++) {
-            sri = (rSize - 1) - i;
-            sli = (lSize - 1) - i;
-
-            Words::Algorithms::ParikhImage lhs_p_pi = lhs_p_pm[i];
-            Words::Algorithms::ParikhImage rhs_p_pi = rhs_p_pm[i];
-            Words::Algorithms::ParikhImage lhs_s_pi = lhs_s_pm[sli];
-            Words::Algorithms::ParikhImage rhs_s_pi = rhs_s_pm[sri];
-
-            // Process variables
-            for (auto x : variableAlphabet) {
-                if (processPrefix) {
-                    if (lhs_p_pi[x] != rhs_p_pi[x]) {
-                        processPrefix = false;
-                    }
-                }
-                if (processSuffix) {
-                    if (lhs_s_pi[x] != rhs_s_pi[x]) {
-                        processSuffix = false;
-                    }
-                }
-                if (!processPrefix && !processSuffix) {
-                    break;
-                }
-            }
-            // Process terminals
-            for (auto x : terminalAlphabet) {
-                if (processPrefix) {
-                    if (lhs_p_pi[x] != rhs_p_pi[x]) {
-                        terminalsAlignPrefix = false;
-                    }
-                }
-                if (processSuffix) {
-                    if (lhs_s_pi[x] != rhs_s_pi[x]) {
-                        terminalsAlignSuffix = false;
-                    }
-                }
-                if (!processPrefix && !processSuffix) {
-                    break;
-                }
-            }
-
-            if ((processPrefix && !terminalsAlignPrefix) || (processSuffix && !terminalsAlignSuffix)) {
-                // std::cout << "u Parikh UNSAT 2" << std::endl;
-                return Simplified::ReducedNsatis;
-            }
-
-            processPrefix = true;
-            processSuffix = false;
-            terminalsAlignPrefix = true;
-            terminalsAlignSuffix = true;
-        }
         return Simplified::JustReduced;
-        ;
     }
 };
 
@@ -5,6 +5,11 @@
 #include <memory>
 #include <boost/format.hpp>
 #include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "words/words.hpp"
 #include "solvers/timing.hpp"
@@ -16,7 +21,8 @@ namespace Words {
 					  SatEncodingOld,
 					  Reachability,
 					  PureSMT,
-					  Levis
+					  Levis,
+					  Portfolio
 	};
 
 	enum class Result {
@@ -36,11 +42,39 @@ namespace Words {
 
 	  enum class SearchOrder{
 				 DepthFirst,
-				 BreadthFirst
+				 BreadthFirst,
+				 BestFirst
 	  };
+
+	  // Best-first search expands the system with the smallest priority first
+	  enum class Priority {
+		TotalLength,
+		VariableTerminalRatio,
+		DistinctVariables
+	  };
+
+	  using PriorityFunction = std::function<double (const Words::Options&)>;
 	  
+	  // BestFirst takes either a Priority or, as
+	  // setSearchOrder<SearchOrder::BestFirst,PriorityFunction>, a function
 	  template<SearchOrder,class ...Args>
 	  void setSearchOrder (Args...);
+
+	  // Compare the systems themselves, not just their fingerprints, when
+	  // looking them up in the passed list
+	  void setExactPassedCheck (bool);
+
+	  // Treat systems equal up to renaming of variables as the same system
+	  // in the passed list, so only one of them is explored
+	  void setCanonicalPassed (bool);
+
+	  // Bytes of waiting systems the breadth-first search order keeps in
+	  // memory before writing newer ones to a temporary file, 0 for no limit
+	  void setSpillThreshold (std::size_t);
+
+	  // File the profile of each search is written to as JSON, empty for
+	  // none. Only builds with ENABLE_PROFILINGLEVIS keep a profile.
+	  void setProfileFile (const std::string&);
 	  
 	}
 	
@@ -89,6 +123,25 @@ namespace Words {
       size_t i = 0;
 	  timep last;
 	};
+
+	// Forwards the messages of solvers running on different threads to one relay,
+	// all relays sharing a mutex are serialised. Messages are prefixed with the solver name.
+	class SynchronisedRelay : public MessageRelay {
+	public:
+	  SynchronisedRelay (MessageRelay& relay, std::mutex& mutex, const std::string& name) : relay(relay),mutex(mutex),name(name) {}
+	  void pushMessage (const std::string& s) override {
+		std::lock_guard<std::mutex> lock (mutex);
+		relay.pushMessage ("[" + name + "] " + s);
+	  }
+	  void progressMessage (const std::string& s) override {
+		std::lock_guard<std::mutex> lock (mutex);
+		relay.progressMessage ("[" + name + "] " + s);
+	  }
+	private:
+	  MessageRelay& relay;
+	  std::mutex& mutex;
+	  std::string name;
+	};
 	
 	//Add Callback function for solver to provide solution details
 	class ResultGatherer {
@@ -113,11 +166,18 @@ namespace Words {
 	  virtual void getResults (ResultGatherer& r) = 0;
       virtual void getMoreInformation (std::ostream&){};
 	  virtual void enableDiagnosticOutput () {}
+	  //Asks a running Solve to give up with NoIdea as soon as possible, may be called from another thread
+	  virtual void interrupt () {}
 
 	  virtual ~Solver () = default;
 	};
 
 	using Solver_ptr =std::unique_ptr<Solver>;
+
+	namespace Portfolio {
+	  //Solvers of a portfolio, with names for their messages
+	  using Members = std::vector<std::pair<std::string,Solver_ptr>>;
+	}
 	
 	template<Types,typename ...Args>
 	Solver_ptr makeSolver (Args... args);
@@ -20,6 +20,11 @@ namespace Words {
 
 	  auto begin () const {return entry.begin();}
 	  auto end () const {return entry.end();}
+
+	  void append (const Keeper& other) {
+		for (auto& e : other)
+		  entry.emplace_back (e.name,e.time);
+	  }
 	protected:
 	  void addEntry (const std::string& name, double time ) {
 		entry.emplace_back (name,time);
@@ -23,7 +23,17 @@ namespace Words {
 		auto smtsolver = Words::SMT::makeSolver ();
 		buildEquationSystem (*smtsolver,opt);
 		relay.pushMessage ((Words::Solvers::Formatter (("Using: %1%")) % smtsolver->getVersionString ()).str());
+		{
+		  std::lock_guard<std::mutex> lock (mutex);
+		  if (stop)
+			return ::Words::Solvers::Result::NoIdea;
+		  running = smtsolver.get();
+		}
 		auto res = smtsolver->solve ();
+		{
+		  std::lock_guard<std::mutex> lock (mutex);
+		  running = nullptr;
+		}
 		switch (res) {
 		case Words::SMT::SolverResult::Satis:
 		  Words::SMT::retriveSubstitution (*smtsolver,opt,sub);
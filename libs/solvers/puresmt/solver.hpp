@@ -1,12 +1,14 @@
 #ifndef _SAT_SOLVER__
 #define _SAT_SOLVER__
 
+#include <mutex>
 #include <sstream>
 
 #include "words/words.hpp"
 #include "words/constraints.hpp"
 #include "solvers/solvers.hpp"
 #include "solvers/timing.hpp"
+#include "smt/smtsolvers.hpp"
 
 namespace Words {
   namespace Solvers {
@@ -21,9 +23,20 @@ namespace Words {
 		void getResults (Words::Solvers::ResultGatherer& r) override {
 		  r.setSubstitution (sub);
 		}
+
+		void interrupt () override {
+		  std::lock_guard<std::mutex> lock (mutex);
+		  stop = true;
+		  if (running)
+			running->interrupt ();
+		}
 		
 	  private:
 		Words::Substitution sub;
+		// The SMT solver of the running Solve, guarded by mutex
+		Words::SMT::Solver* running = nullptr;
+		bool stop = false;
+		std::mutex mutex;
 	  };
 	}
 
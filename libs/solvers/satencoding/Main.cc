@@ -45,9 +45,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "solvers/timing.hpp"
 #include "words/words.hpp"
 #include "regular/encoding.h"
+#include "encodingcontext.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <set>
 #include <sstream>
 #include <string>
@@ -94,1004 +98,43 @@ private:
     std::ostream *out;
 };
 
-//=================================================================================================
-map<pair<pair<int, int>, int>, Var> variableVars;
-map<char, int> terminalIndices, variableIndices;
-map<int, char> index2Terminal, index2Varible, var2Terminal;
-
-// Maps terminals to indices
-map<Words::Terminal *, int> tIndices;
-
-// Maps variables to index in word equation, inverse of `index2v
-map<Words::Variable *, int> vIndices;
-
-// Maps indices in the equation to terminals, inverse of tIndices
-map<int, Words::Terminal *> index2t;
-
-// Maps index in wor equation to variable, inverse of `vIndices`
-map<int, Words::Variable *> index2v;
-
-Words::Options input_options;
-
-vector<string> input_equations_lhs, input_equations_rhs;
-vector<map<pair<int, int>, Var>> equations_lhs, equations_rhs; // SAT encoding
-map<pair<int, int>, Var> constantsVars;
-map<int, int> maxPadding;
-int globalMaxPadding;
-
-vector<vector<Var>> stateTables;
-vector<int> stateTableColumns, stateTableRows;
-vector<map<int, int>> input_linears_lhs;
-vector<int> input_linears_rhs;
-
 int getIndex(int numCols, int row, int col) { return row * numCols + col; }
 
-// oneHotEncoding[i,j] == |X_i|=j
-map<pair<int, int>, Lit> oneHotEncoding;
-
-int sigmaSize;
-// int gammaSize; // Variable Alphabet size
-
-Var trueConst, falseConst;
-
-void clear() {
-    stateTableColumns.clear();
-    stateTableRows.clear();
-    stateTables.clear();
-    maxPadding.clear();
-    constantsVars.clear();
-    var2Terminal.clear();
-    variableVars.clear();
-    oneHotEncoding.clear();
-}
-
-void clearIndexMaps() {
-    index2t.clear();
-    index2v.clear();
-    tIndices.clear();
-    vIndices.clear();
-    sigmaSize = 0;
-}
-
-void clearLinears() {
-    input_linears_lhs.clear();
-    input_linears_rhs.clear();
-    input_linears_lhs.clear();
-    input_linears_rhs.clear();
-}
-
-void readSymbols(string &s) { std::cout << "xxx" << std::endl; }
-
-void readSymbols(Words::Word &s) {
-    for (auto e: s) {
-        if (e->isSequence()) {
-            std::cout << "c SEQUENCE!" << std::endl;
-            // TODO: Add Sequences
-        } else if (e->isTerminal()) {
-            if (tIndices.count(e->getTerminal()) == 0) {
-                tIndices[e->getTerminal()] = sigmaSize++;
-                index2t[sigmaSize - 1] = e->getTerminal();
-            }
-        } else if (e->isVariable()) {
-            if (vIndices.count(e->getVariable()) == 0) {
-                int tmp = vIndices.size();
-                vIndices[e->getVariable()] = tmp;
-                index2v[tmp] = e->getVariable();
-            }
-        }
-    }
-}
-
-// lhs <-> /\ rhs
-void reify_and(Solver &s, Lit lhs, vec<Lit> &rhs) {
-    assert(rhs.size() > 0 && "reifying empty list? ");
-    // lhs -> rhs[i]
-    for (int i = 0; i < rhs.size(); i++) {
-        vec<Lit> ps;
-        ps.push(rhs[i]);
-        ps.push(~lhs);
-        s.addClause(ps);
-    }
-    // /\rhs -> lhs
-    vec<Lit> ps;
-    for (int i = 0; i < rhs.size(); i++)
-        ps.push(~rhs[i]);
-    ps.push(lhs);
-    s.addClause(ps);
-}
-
-// lhs <-> \/ rhs
-void reify_or(Solver &s, Lit lhs, vec<Lit> &rhs) {
-    assert(rhs.size() > 0 && "reifying empty list? ");
-    // rhs[i] -> lhs
-    for (int i = 0; i < rhs.size(); i++) {
-        vec<Lit> ps;
-        ps.push(~rhs[i]);
-        ps.push(lhs);
-        s.addClause(ps);
-    }
-    // lhs -> \/ rhs
-    vec<Lit> ps;
-    for (int i = 0; i < rhs.size(); i++)
-        ps.push(rhs[i]);
-    ps.push(~lhs);
-    s.addClause(ps);
-}
-
-void addOneHotEncoding(Solver &s) {
-    int numVars = vIndices.size();
-
-    assert(numVars > 0);
-    for (int i = 0; i < numVars; i++) {
-        // oneHot[i,0] <-> x_i[0]=epsilon
-        oneHotEncoding[make_pair(i, 0)] =
-                mkLit(variableVars[make_pair(make_pair(i, 0), sigmaSize)]);
-        for (int j = 1; j < maxPadding[i]; j++) {
-            Var v = s.newVar();
-            vec<Lit> ps;
-            assert(variableVars.count(make_pair(make_pair(i, j), sigmaSize)));
-            assert(variableVars.count(make_pair(make_pair(i, j - 1), sigmaSize)));
-            ps.push(mkLit(variableVars[make_pair(make_pair(i, j),
-                                                 sigmaSize)])); // x[j] = epsilon
-            ps.push(~mkLit(variableVars[make_pair(make_pair(i, j - 1),
-                                                  sigmaSize)])); // x[j-1] != epsilon
-            reify_and(s, mkLit(v), ps);
-            oneHotEncoding[make_pair(i, j)] = mkLit(v);
-        }
-
-        // Last position: oneHot[i, max] <-> x[max] != epsilon
-        if (maxPadding[i] > 0) {
-            assert(variableVars.count(
-                    make_pair(make_pair(i, maxPadding[i] - 1), sigmaSize)));
-
-            oneHotEncoding[make_pair(i, maxPadding[i])] = ~mkLit(
-                    variableVars[make_pair(make_pair(i, maxPadding[i] - 1), sigmaSize)]);
-        }
-    }
-    // Add a clause that at least one of the one-hot-literals must be true:
-    for (int i = 0; i < numVars; i++) {
-        vec<Lit> ps;
-        for (int j = 0; j <= maxPadding[i]; j++)
-            ps.push(oneHotEncoding[make_pair(i, j)]);
-        s.addClause(ps);
-    }
-}
-
-void getCoefficients(Words::Equation &eq, map<int, int> &coefficients, int &c,
-                     map<int, int> &letter_coefficients) {
-    assert(c == 0);
-
-    for (auto e: eq.lhs) {
-        if (e->isSequence()) {
-            // TODO: Add Sequences
-        } else if (e->isTerminal()) {
-            letter_coefficients[tIndices.at(e->getTerminal())]++;
-            c++;
-        } else if (e->isVariable()) {
-            coefficients[vIndices[e->getVariable()]]--;
-        }
-    }
-
-    for (auto e: eq.rhs) {
-        if (e->isSequence()) {
-            // TODO: Add Sequences
-        } else if (e->isTerminal()) {
-            letter_coefficients[tIndices.at(e->getTerminal())]--;
-            c--;
-        } else if (e->isVariable()) {
-            coefficients[vIndices[e->getVariable()]]++;
-        }
-    }
-}
-
-// TODO: Lin-Constraint (via MDDs)
-
-bool addSizeEqualityConstraint(Solver &s, Words::Equation &eq,
-                               StreamWrapper &out) {
-    map<int, int> coefficients, letter_coefficients;
-    int rhs =
-            0; // amount of terminal symbols if we substract rhs count from lhs count
-    getCoefficients(eq, coefficients, rhs, letter_coefficients);
-
-    // quick parikh unsat for testing ;)
-    /*bool allZero = true;
-
-    for (auto const& e : coefficients) {
-          allZero = allZero and (e.second == 0);
-    }
-    if (allZero){
-          for (auto const& e : letter_coefficients) {
-            cout << index2Terminal[e.first] <<" " << e.second << endl;
-            if (e.second != 0){
-                  cout << "c Unsat due to parikh image mismatch!" << endl;
-                  return false;
-            }
-          }
-    }*/
-
-    set<pair<int, int>> states;
-    int numVars = vIndices.size();
-    states.insert(make_pair(-1, 0)); // state for the empty prefix
-    vector<int> currentRow;
-
-    map<pair<int, int>, set<pair<int, int>>> predecessors, successors;
-    currentRow.push_back(0);
-
-    set<int> nextRow;
-
-    for (int i = 0; i < numVars; i++) {
-        for (int j = 0; j < currentRow.size(); j++) {
-            for (int k = 0; k <= maxPadding[i]; k++) {
-                int nextValue = currentRow[j] + k * coefficients[i];
-                nextRow.insert(nextValue);
-                states.insert(make_pair(i, nextValue));
-            }
-        }
-        currentRow.clear();
-        currentRow.insert(currentRow.end(), nextRow.begin(), nextRow.end());
-        nextRow.clear();
-    }
-    if (out) {
-        (out << (Words::Solvers::Formatter("Created %d numStates for MDD! ") %
-                 states.size())
-                .str())
-                .endl();
-    }
-    // printf("c created %d states for MDD! \n", numStates.size());
-    /*for(set<pair<int, int> >::iterator it = states.begin() ; it !=
-      numStates.end();it++){ cout << "initial state: " << it->first << " " <<
-      it->second << endl;
-      }*/
-    if (states.count(make_pair(numVars - 1, rhs)) == 0) {
-        return false;
-    }
-
-    set<pair<int, int>> markedStates;
-    vector<pair<int, int>> queue;
-    int nextIndex = 0;
-    // Mark final state
-    markedStates.insert(make_pair(numVars - 1, rhs));
-    queue.push_back(make_pair(numVars - 1, rhs));
-    while (nextIndex < queue.size()) {
-        pair<int, int> currentState = queue[nextIndex];
-        nextIndex++;
-        int this_var = currentState.first;
-        if (this_var < 0) {
-            // Okay, I reached the root
-            markedStates.insert(currentState);
-        } else {
-            assert(this_var >= 0 && this_var < numVars);
-            for (int j = 0; j <= maxPadding[this_var]; j++) {
-                pair<int, int> predecessor = make_pair(
-                        this_var - 1, currentState.second - j * coefficients[this_var]);
-                if (states.count(predecessor)) {
-                    if (markedStates.count(predecessor) == 0)
-                        queue.push_back(predecessor);
-
-                    markedStates.insert(predecessor);
-                    predecessors[currentState].insert(predecessor);
-                    successors[predecessor].insert(currentState);
-                }
-            }
-        }
-    }
-    Words::Solvers::Formatter ff("have %1% marked numStates!");
-    (out << (ff % markedStates.size()).str()).endl();
-    // printf("c have %d marked numStates! \n", markedStates.size());
-    map<pair<int, int>, Var> partialSumVariables;
-    for (set<pair<int, int>>::iterator it = markedStates.begin();
-         it != markedStates.end(); it++) {
-        partialSumVariables[*it] = s.newVar();
-    }
-    assert(partialSumVariables.count(make_pair(-1, 0)));
-    s.addClause(mkLit(partialSumVariables[make_pair(-1, 0)]));
-
-    assert(partialSumVariables.count(make_pair(numVars - 1, rhs)));
-    s.addClause(mkLit(partialSumVariables[make_pair(numVars - 1, rhs)]));
-
-    // Add clauses: A[i-1,j] /\ x_i = c -> A[i, j+a_i * c]
-    for (set<pair<int, int>>::iterator it = markedStates.begin();
-         it != markedStates.end(); it++) {
-        // cout << "Have marked state " << it->first << " " << it->second << " and "
-        // << s.nFreeVars() << " free variables" << endl;
-        int this_var = it->first + 1;
-        if (this_var >= numVars) {
-            assert(this_var == numVars);
-            assert(it->second == rhs);
-            (out << "adding unit clause! ").endl();
-            s.addClause(mkLit(partialSumVariables[*it]));
-        } else {
-            assert(maxPadding.count(this_var));
-            int successorsFound = 0;
-            int lastVarAssignmentThatFit = -1;
-            for (int i = 0; i <= maxPadding[this_var]; i++) {
-                int new_sum = it->second + i * coefficients[this_var];
-                assert(states.count(make_pair(this_var, new_sum)));
-
-                vec<Lit> ps;
-                assert(partialSumVariables.count(*it));
-                ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
-                if (oneHotEncoding.count(make_pair(this_var, i)) == 0) {
-                    cout << "Cannot find oneHot for variable " << this_var
-                         << " and value " << i << endl;
-                }
-                assert(oneHotEncoding.count(make_pair(this_var, i)));
-                ps.push(~oneHotEncoding[make_pair(this_var, i)]); // this_var=i
-
-                if (markedStates.count(make_pair(this_var, new_sum))) {
-                    successorsFound++;
-                    assert(markedStates.count(make_pair(this_var, new_sum)));
-                    assert(partialSumVariables.count(make_pair(this_var, new_sum)));
-                    ps.push(mkLit(partialSumVariables[make_pair(this_var, new_sum)]));
-                    lastVarAssignmentThatFit = i;
-                }
-                if (!s.addClause(ps)) {
-                    (out << "got false while adding a clause! ").endl();
-                }
-            }
-            assert(successorsFound > 0);
-            if (successorsFound == 1) {
-                assert(lastVarAssignmentThatFit >= 0);
-                vec<Lit> ps;
-                assert(partialSumVariables.count(*it));
-                ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
-                // printf("c only one successor, adding unit clause! \n");
-                ps.push(oneHotEncoding[make_pair(
-                        this_var,
-                        lastVarAssignmentThatFit)]); // Only one successor. Thus, if A[i,j]
-                // is active, this immediately implies
-                // the value of x[i]
-                s.addClause(ps);
-            }
-        }
-    }
-    return true;
-}
-
-void oldEncoding(Solver &S, int szLHS, int szRHS, vector<Var> &stateVars,
-                 map<pair<int, int>, Var> &w1, map<pair<int, int>, Var> &w2,
-                 StreamWrapper &out, bool localOptimisation) {
-    // int equationSizes = szRHS;
-    // cout << "now have equationSize " << equationSizes << endl;
-    // TODO:
-    // equality-predicates
-    map<pair<int, int>, Var> wordsMatch;
-    for (int i = 0; i <= szLHS; i++) {
-        for (int j = 0; j <= szRHS; j++) {
-            if (i == szLHS || j == szRHS) {
-                Var v = S.newVar();
-                S.addClause(~mkLit(v));
-                wordsMatch[make_pair(i, j)] = v;
-            } else {
-                vec<Lit> atoms;
-                for (int k = 0; k <= sigmaSize; k++) {
-                    Var v = S.newVar();
-                    atoms.push(mkLit(v));
-                    // v <-> w1[i]=k /\ w2[j] = k
-                    vec<Lit> ps;
-                    ps.push(mkLit(w1[make_pair(i, k)]));
-                    ps.push(mkLit(w2[make_pair(j, k)]));
-                    reify_and(S, mkLit(v), ps);
-                }
-                Var v = S.newVar();
-                wordsMatch[make_pair(i, j)] = v;
-                // wordsMatch[i,j] = \/ atoms
-                reify_or(S, mkLit(v), atoms);
-            }
-        }
-    }
-    // automaton:
-    // s[i,j] is true <-> left hand side and ride hand side matched up to indices
-    // (i-1, j-1) thus, s[0,0] is always true
-
-    // Empty prefixes match
-    S.addClause(mkLit(stateVars[getIndex(szRHS + 1, 0, 0)]));
-    // Final state is active
-    S.addClause(mkLit(stateVars[getIndex(szRHS + 1, szLHS, szRHS)]));
-
-    if (out) {
-        Words::Solvers::Formatter ff("Have automaton size %1% times %2% and "
-                                     "created %3% many state variables");
-        (out << (ff % szLHS % szRHS % stateVars.size()).str()).endl();
-    }
-    for (int i = 0; i <= szLHS; i++) {
-        for (int j = 0; j <= szRHS; j++) {
-            vec<Lit> or_rhs;
-            // Case 1: state (i-1, j-1) was active and match at position (i-1,j-1)
-            if (i > 0 && j > 0) {
-                Var v = S.newVar();
-                vec<Lit> ps;
-                assert(wordsMatch.count(make_pair(i - 1, j - 1)));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i - 1, j - 1)]));
-                ps.push(mkLit(wordsMatch[make_pair(i - 1, j - 1)]));
-                reify_and(S, mkLit(v), ps);
-                or_rhs.push(mkLit(v));
-            }
-
-            ///////////////////////
-            /// \brief v2
-            ///
-
-            if (i > 0) {
-                // v2 <-> S(i-1, j) /\ !match /\ w1[i-1] = epsilon
-                Var v = S.newVar();
-                vec<Lit> ps;
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i - 1, j)]));
-                assert(wordsMatch.count(make_pair(i - 1, j)));
-                ps.push(~mkLit(wordsMatch[make_pair(i - 1, j)]));
-                ps.push(mkLit(w1[make_pair(i - 1, sigmaSize)]));
-
-                reify_and(S, mkLit(v), ps);
-                or_rhs.push(mkLit(v));
-            }
-
-            /////////////////////
-            /// \brief v3
-            ///
-
-            if (j > 0) {
-                // v3 <-> S(i, j-1) /\ !match /\ w2[j-1] = epsilon
-                Var v = S.newVar();
-                vec<Lit> ps;
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j - 1)]));
-                assert(wordsMatch.count(make_pair(i, j - 1)));
-                ps.push(~mkLit(wordsMatch[make_pair(i, j - 1)]));
-                ps.push(mkLit(w2[make_pair(j - 1, sigmaSize)]));
-
-                reify_and(S, mkLit(v), ps);
-                or_rhs.push(mkLit(v));
-            }
-
-            // S(i,j) <-> v1 \/ v2 \/ v3 (if all of them exist)
-
-            if (or_rhs.size() == 0) {
-                assert(i == 0 && j == 0);
-            } else if (or_rhs.size() < 3) {
-                assert(or_rhs.size() == 1 && (i == 0 || j == 0));
-            }
-
-            if (or_rhs.size() > 0) {
-                reify_or(S, mkLit(stateVars[getIndex(szRHS + 1, i, j)]), or_rhs);
-            }
-        }
-    }
-    if (localOptimisation) {
-        for (int i = 0; i < szLHS; i++) {
-            for (int j = 0; j < szRHS; j++) {
-                assert(stateVars[getIndex(szRHS + 1, i, j)] != var_Undef);
-                assert(stateVars[getIndex(szRHS + 1, i + 1, j)] != var_Undef);
-                assert(stateVars[getIndex(szRHS + 1, i, j + 1)] != var_Undef);
-                assert(stateVars[getIndex(szRHS + 1, i + 1, j + 1)] != var_Undef);
-                vec<Lit> ps;
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-                S.addClause(ps);
-            }
-        }
-    }
-    for (map<pair<int, int>, Var>::iterator it = wordsMatch.begin();
-         it != wordsMatch.end(); it++) {
-        S.setDecisionVar(it->second, false);
-    }
-}
-
-void newEncoding(Solver &S, int szLHS, int szRHS, vector<Var> &stateVars,
-                 map<pair<int, int>, Var> &w1, map<pair<int, int>, Var> &w2) {
-    for (int i = 0; i < szLHS; i++) {
-        for (int j = 0; j < szRHS; j++) {
-            // assert(S.okay());
-            // s(i,j) active -> exactly one of the successors is active
-            assert(stateVars[getIndex(szRHS + 1, i, j)] != var_Undef);
-            assert(stateVars[getIndex(szRHS + 1, i + 1, j)] != var_Undef);
-            assert(stateVars[getIndex(szRHS + 1, i, j + 1)] != var_Undef);
-            assert(stateVars[getIndex(szRHS + 1, i + 1, j + 1)] != var_Undef);
-
-            vec<Lit> ps;
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            int nBefore = S.nClauses();
-            S.addClause(ps);
-            ps.clear();
-            /*if(S.nClauses() == nBefore){
-              printf("c clause for i=%d and j=%d is ignored! \n", i, j);
-              }*/
-
-            // (i,j) is active and (i+1, j) --> none of the others
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            // (i,j) is active and (i+1, j+1) --> none of the others
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            S.addClause(ps);
-            ps.clear();
-
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-            // (i,j) is active and (i, j+1) --> none of the others
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            S.addClause(ps);
-            ps.clear();
-
-            /////////////////////////////////////////////////////////////////////
-            // s(i,j) /\ w1[i] = epsilon /\ w2[j] != epsilon -> s(i+1, j)
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(w1[make_pair(i, sigmaSize)]));
-            ps.push(mkLit(w2[make_pair(j, sigmaSize)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            S.addClause(ps);
-            ps.clear();
-
-            // s(i,j) /\ w1[i] != epsilon -> NOT s(i+1, j)
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(mkLit(w1[make_pair(i, sigmaSize)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-            S.addClause(ps);
-            ps.clear();
-
-            /////////////////////////////////////////////////////////////////////
-            // s(i,j) /\ w1[i] != epsilon /\ w2[j] = epsilon -> s(i, j+1)
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(mkLit(w1[make_pair(i, sigmaSize)]));
-            ps.push(~mkLit(w2[make_pair(j, sigmaSize)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            // s(i,j) /\ w2[j] != epsilon -> NOT s(i, j+1)
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(mkLit(w2[make_pair(j, sigmaSize)]));
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            /////////////////////////////////////////////////////////////////////
-            // s(i,j) /\ w1[i] = epsilon /\ w2[j] = epsilon -> s(i+1, j+1)
-            ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-            ps.push(~mkLit(w1[make_pair(i, sigmaSize)]));
-            ps.push(~mkLit(w2[make_pair(j, sigmaSize)]));
-            ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-            S.addClause(ps);
-            ps.clear();
-
-            /////////////////////////////////////////////////////////////////////
-            // s(i,j) /\ s(i+1, j+1) => w1[i] = w2[j]
-            for (int k = 0; k <= sigmaSize; k++) {
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-                ps.push(~mkLit(w1[make_pair(i, k)]));
-                ps.push(mkLit(w2[make_pair(j, k)]));
-                S.addClause(ps);
-                ps.clear();
-
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-                ps.push(mkLit(w1[make_pair(i, k)]));
-                ps.push(~mkLit(w2[make_pair(j, k)]));
-                S.addClause(ps);
-                ps.clear();
-            }
-            assert(ps.size() == 0);
-            if (i > 0 && j > 0) {
-                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
-                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
-                S.addClause(ps);
-                ps.clear();
-            }
-        }
-    }
-}
-// TODO: Sets of equations (-> thus, functions for each equation)
-
-// localOptimisation: add clauses s(i,j) -> (s(i+1, j) \/ s(i+1, j+1) \/
-// s(i,j+1))
-template<bool newEncode = true>
-void encodeEquation(Solver &S, Words::Equation &eq, bool localOptimisation,
-                    bool fillUntilSquare, StreamWrapper &out) {
-    map<pair<int, int>, Var> w1, w2;
-    int szLHS = 0;
-    int szRHS = 0;
-    int column = 0;
-
-    // w1 resp. lhs
-    for (auto e: eq.lhs) {
-
-        if (e->isSequence()) {
-            // TODO: Add Sequences
-        } else if (e->isTerminal()) {
-            for (int j = 0; j <= sigmaSize; j++) {
-                w1[make_pair(column, j)] =
-                        constantsVars[make_pair(tIndices.at(e->getTerminal()), j)];
-            }
-            column++;
-        } else if (e->isVariable()) {
-            // cout << "c Looking for variable " << input_w1[i] << endl;
-            assert(maxPadding.count(vIndices[e->getVariable()]));
-            for (int j = 0; j < maxPadding[vIndices[e->getVariable()]]; j++) {
-                for (int k = 0; k <= sigmaSize; k++) {
-                    assert(variableVars.count(
-                            make_pair(make_pair(vIndices[e->getVariable()], j), k)));
-                    w1[make_pair(column, k)] = variableVars[make_pair(
-                            make_pair(vIndices[e->getVariable()], j), k)];
-                }
-                column++;
-            }
-        }
-    }
-
-    szLHS = column;
-    if (out) {
-        (out << "c LHS done. We have " << szLHS << " many colums.").endl();
-    }
-
-    column = 0;
-    // w2 resp. rhs
-    for (auto e: eq.rhs) {
-        if (e->isSequence()) {
-            // TODO: Add Sequences
-        } else if (e->isTerminal()) {
-            for (int j = 0; j <= sigmaSize; j++) {
-                w2[make_pair(column, j)] =
-                        constantsVars[make_pair(tIndices.at(e->getTerminal()), j)];
-            }
-            column++;
-        } else if (e->isVariable()) {
-            // cout << "c Looking for variable " << input_w1[i] << endl;
-            assert(maxPadding.count(vIndices[e->getVariable()]));
-            for (int j = 0; j < maxPadding[vIndices[e->getVariable()]]; j++) {
-                for (int k = 0; k <= sigmaSize; k++) {
-                    assert(variableVars.count(
-                            make_pair(make_pair(vIndices[e->getVariable()], j), k)));
-                    w2[make_pair(column, k)] = variableVars[make_pair(
-                            make_pair(vIndices[e->getVariable()], j), k)];
-                }
-                column++;
-            }
-        }
-    }
-
-    szRHS = column;
-    if (out) {
-        (out << "c RHS done. We have " << szRHS << " many colums.").endl();
-    }
-
-    bool ignorePadding = false;
-    // bool fillUntilSquare = false;
-    if (ignorePadding) {
-        if (szLHS < szRHS)
-            szRHS = szLHS;
-        if (szRHS < szLHS)
-            szLHS = szRHS;
-    }
-    if (fillUntilSquare) {
-        if (szLHS < szRHS) {
-            if (out)
-                (out << "c Padding left-hand side: ").endl();
-            for (; szLHS < szRHS; szLHS++) {
-                for (int j = 0; j <= sigmaSize; j++) {
-                    assert(w1.count(make_pair(szLHS, j)) == false);
-                    w1[make_pair(szLHS, j)] = constantsVars[make_pair(sigmaSize, j)];
-                }
-            }
-        }
-        if (szLHS > szRHS) {
-            if (out)
-                (out << "c Padding right-hand side: ").endl();
-            for (; szRHS < szLHS; szRHS++) {
-                for (int j = 0; j <= sigmaSize; j++) {
-                    w2[make_pair(szRHS, j)] = constantsVars[make_pair(sigmaSize, j)];
-                }
-            }
-        }
-        assert(szRHS == szLHS);
-    }
-    if (out) {
-        (out << (Words::Solvers::Formatter("creating table of size %1% x %2%") %
-                 szLHS % szRHS)
-                .str())
-                .endl();
-    }
-
-    // map<pair<int, int>, Var> stateVars;
-    vector<Var> stateVars((szLHS + 1) * (szRHS + 1), var_Undef);
-    int lastIndex = -1;
-    for (int i = 0; i <= szLHS; i++) {
-        for (int j = 0; j <= szRHS; j++) {
-            assert(getIndex(szRHS + 1, i, j) == lastIndex + 1);
-            lastIndex = getIndex(szRHS + 1, i, j);
-            assert(stateVars[getIndex(szRHS + 1, i, j)] == var_Undef);
-            stateVars[getIndex(szRHS + 1, i, j)] = S.newVar();
-        }
-    }
-
-    // Empty prefixes match
-    S.addClause(mkLit(stateVars[getIndex(szRHS + 1, 0, 0)]));
-    // Final state is active
-    S.addClause(mkLit(stateVars[getIndex(szRHS + 1, szLHS, szRHS)]));
-
-    if (newEncode) {
-        newEncoding(S, szLHS, szRHS, stateVars, w1, w2);
-    } else {
-        oldEncoding(S, szLHS, szRHS, stateVars, w1, w2, out, localOptimisation);
-    }
-
-    for (vector<Var>::iterator it = stateVars.begin(); it != stateVars.end();
-         it++) {
-        if (*it != var_Undef)
-            S.setDecisionVar(*it, false);
-    }
-
-    equations_lhs.push_back(w1);
-    equations_rhs.push_back(w2);
-    stateTables.push_back(stateVars);
-    stateTableColumns.push_back(szRHS + 1);
-    stateTableRows.push_back(szLHS + 1);
-}
-
-// Inequality between variables
-void encodeNotEqual(Solver &s, int firstIndex, int secondIndex, int sigmaSize,
-                    std::ostream *out) {
-    if (out)
-        *out << "c adding inequality between " << firstIndex << " and "
-             << secondIndex << endl;
-
-    vec<Lit> diffVars; // \/ (not matchHere(i) )
-    assert(maxPadding.count(firstIndex));
-    assert(maxPadding.count(secondIndex));
-    int maxVarSize = std::min(maxPadding[firstIndex], maxPadding[secondIndex]);
-    for (int i = 0; i < maxVarSize; i++) {
-        Var matchHere = s.newVar();
-        vec<Lit> match_rhs;
-        for (int k = 0; k <= sigmaSize; k++) {
-            // v <-> x[i]=k  /\ y[i]=k
-            Var v = s.newVar();
-            vec<Lit> ps;
-            assert(variableVars.count(make_pair(make_pair(firstIndex, i), k)));
-            assert(variableVars.count(make_pair(make_pair(secondIndex, i), k)));
-            ps.push(mkLit(variableVars[make_pair(make_pair(firstIndex, i), k)]));
-            ps.push(mkLit(variableVars[make_pair(make_pair(secondIndex, i), k)]));
-            reify_and(s, mkLit(v), ps);
-            match_rhs.push(mkLit(v));
-        }
-        reify_or(s, mkLit(matchHere), match_rhs);
-        diffVars.push(~mkLit(matchHere));
-    }
-    // TODO: Make sure this also works if sizes are not equal:
-    if (maxPadding[firstIndex] > maxPadding[secondIndex]) {
-        assert(variableVars.count(
-                make_pair(make_pair(firstIndex, maxPadding[secondIndex]), sigmaSize)));
-        diffVars.push(~mkLit(variableVars[make_pair(
-                make_pair(firstIndex, maxPadding[secondIndex]), sigmaSize)]));
-    } else if (maxPadding[firstIndex] < maxPadding[secondIndex]) {
-        assert(variableVars.count(
-                make_pair(make_pair(secondIndex, maxPadding[firstIndex]), sigmaSize)));
-        diffVars.push(~mkLit(variableVars[make_pair(
-                make_pair(secondIndex, maxPadding[firstIndex]), sigmaSize)]));
-    }
-    s.addClause(diffVars);
-}
-
-void sharpenBounds(Solver &s, Words::Equation &eq, StreamWrapper &out) {
-    map<int, int> coefficients, letter_coefficients;
-    int c = 0;
-    getCoefficients(eq, coefficients, c, letter_coefficients);
-    if (out) {
-        (out << "Got equation ").endl();
-        for (map<int, int>::iterator it = coefficients.begin();
-             it != coefficients.end(); it++) {
-            out << it->second << " * " << index2v[it->first]->getRepr() << " ";
-        }
-        (out << "= " << c).endl();
-    }
-    for (map<int, int>::iterator it = coefficients.begin();
-         it != coefficients.end(); it++) {
-        if (it->second != 0) { // only consider unbalanced variables!
-            int rhs = c;
-            for (map<int, int>::iterator others = coefficients.begin();
-                 others != coefficients.end(); others++) {
-                if ((it->second < 0) ^
-                    (others->second < 0)) { // get upper bound, thus try to make rhs/a_i
-                    // as large as possible
-
-                    rhs -= others->second * maxPadding[others->first];
-                }
-            }
-            if (out)
-                (out << "c Can infer bound " << index2v[it->first]->getRepr() << " <= "
-                     << rhs << "/" << it->second << " = " << (rhs / it->second))
-                        .endl();
-            rhs /= it->second;
-            if (rhs < maxPadding[it->first])
-                // std::cout << "c Setting new bound for " <<
-                // index2v[it->first]->getRepr() << ": " << rhs << " instead of " <<
-                // maxPadding[it->first] << std::endl;
-                maxPadding[it->first] = rhs;
-        }
-    }
-}
-
-// sum a_i x_i - sum b_j x_j <=  + c, where a_i, b_j >= 0
-
-// Expect x_i as one-hot encoded, with pairs (j, v_j) <-> x_i = j
-bool addLinearEqualityConstraint(Solver &s, map<int, int> &coefficients,
-                                 int &rhs, StreamWrapper &out) {
-    set<pair<int, int>> states;
-    set<pair<int, int>> acceptingStates;
-    int numVars = vIndices.size();
-    states.insert(make_pair(-1, 0)); // state for the empty prefix
-    vector<int> currentRow;
-    map<pair<int, int>, set<pair<int, int>>> predecessors, successors;
-    set<int> nextRow;
-
-    currentRow.push_back(0);
-
-    for (int i = 0; i < numVars; i++) {
-        for (int j = 0; j < currentRow.size(); j++) {
-            for (int k = 0; k <= maxPadding[i]; k++) {
-                int nextValue = currentRow[j] + k * coefficients[i];
-                nextRow.insert(nextValue);
-                states.insert(make_pair(i, nextValue));
-                if (i == numVars - 1 && nextValue <= rhs) {
-                    acceptingStates.insert(make_pair(i, nextValue));
-                }
-            }
-        }
-        currentRow.clear();
-        currentRow.insert(currentRow.end(), nextRow.begin(), nextRow.end());
-        nextRow.clear();
-    }
-    if (out) {
-        (out << (Words::Solvers::Formatter("Created %d numStates for MDD! ") %
-                 states.size())
-                .str())
-                .endl();
-    }
-    // printf("c created %d numStates for MDD! \n", states.size());
-    // for(set<pair<int, int> >::iterator it = numStates.begin() ; it !=
-    // numStates.end();it++){ cout << "initial state: " << it->first << " " <<
-    // it->second << endl;
-    //  }
-
-    if (acceptingStates.size() == 0) {
-        return false;
-    }
-
-    set<pair<int, int>> markedStates;
-    vector<pair<int, int>> queue;
-    int nextIndex = 0;
-    // Mark final numStates
-    for (auto x: acceptingStates) {
-        markedStates.insert(x);
-        queue.push_back(x);
-    }
-    while (nextIndex < queue.size()) {
-        pair<int, int> currentState = queue[nextIndex];
-        nextIndex++;
-        int this_var = currentState.first;
-        if (this_var < 0) {
-            // Okay, I reached the root
-            markedStates.insert(currentState);
-        } else {
-            assert(this_var >= 0 && this_var < numVars);
-            for (int j = 0; j <= maxPadding[this_var]; j++) {
-                pair<int, int> predecessor = make_pair(
-                        this_var - 1, currentState.second - j * coefficients[this_var]);
-                if (states.count(predecessor)) {
-                    if (markedStates.count(predecessor) == 0)
-                        queue.push_back(predecessor);
-
-                    markedStates.insert(predecessor);
-                    predecessors[currentState].insert(predecessor);
-                    successors[predecessor].insert(currentState);
-                }
-            }
-        }
-    }
-    Words::Solvers::Formatter ff(
-            "have %1% marked numStates for linear constraint MDD!");
-    (out << (ff % markedStates.size()).str()).endl();
-    // printf("c have %d marked numStates! \n", markedStates.size());
-    map<pair<int, int>, Var> partialSumVariables;
-    for (set<pair<int, int>>::iterator it = markedStates.begin();
-         it != markedStates.end(); it++) {
-        partialSumVariables[*it] = s.newVar();
-    }
-    assert(partialSumVariables.count(make_pair(-1, 0)));
-    s.addClause(mkLit(partialSumVariables[make_pair(-1, 0)]));
-
-    // Mark all accepting numStates active
-    for (auto x: acceptingStates) {
-        assert(partialSumVariables.count(x));
-        s.addClause(mkLit(partialSumVariables[x]));
-    }
-
-    // Add clauses: A[i-1,j] /\ x_i = c -> A[i, j+a_i * c]
-    for (set<pair<int, int>>::iterator it = markedStates.begin();
-         it != markedStates.end(); it++) {
-        // cout << "Have marked state " << it->first << " " << it->second << " and "
-        // << s.nFreeVars() << " free variables" << endl;
-        int this_var = it->first + 1;
-        if (this_var >= numVars) {
-            assert(this_var == numVars);
-            assert(it->second <= rhs);
-            (out << "adding unit clause! ").endl();
-            s.addClause(mkLit(partialSumVariables[*it]));
-        } else {
-            assert(maxPadding.count(this_var));
-            int successorsFound = 0;
-            int lastVarAssignmentThatFit = -1;
-            for (int i = 0; i <= maxPadding[this_var]; i++) {
-                int new_sum = it->second + i * coefficients[this_var];
-                assert(states.count(make_pair(this_var, new_sum)));
-
-                vec<Lit> ps;
-                assert(partialSumVariables.count(*it));
-                ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
-                if (oneHotEncoding.count(make_pair(this_var, i)) == 0) {
-                    cout << "Cannot find oneHot for variable " << this_var
-                         << " and value " << i << endl;
-                }
-                assert(oneHotEncoding.count(make_pair(this_var, i)));
-                ps.push(~oneHotEncoding[make_pair(this_var, i)]); // this_var=i
-
-                if (markedStates.count(make_pair(this_var, new_sum))) {
-                    successorsFound++;
-                    assert(markedStates.count(make_pair(this_var, new_sum)));
-                    assert(partialSumVariables.count(make_pair(this_var, new_sum)));
-                    ps.push(mkLit(partialSumVariables[make_pair(this_var, new_sum)]));
-                    lastVarAssignmentThatFit = i;
-                }
-                if (!s.addClause(ps)) {
-                    (out << "got false while adding a clause! ").endl();
-                }
-            }
-            assert(successorsFound > 0);
-            if (successorsFound == 1) {
-                assert(lastVarAssignmentThatFit >= 0);
-                vec<Lit> ps;
-                assert(partialSumVariables.count(*it));
-                ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
-                ps.push(oneHotEncoding[make_pair(
-                        this_var,
-                        lastVarAssignmentThatFit)]); // Only one successor. Thus, if A[i,j]
-                // is active, this immediately implies
-                // the value of x[i]
-                s.addClause(ps);
-            }
+// Incremental bound deepening: a single solver is kept alive across the bounds
+// of one instance. Clauses not depending on the bound (the constants table and
+// the per-position letter variables) are added once and grown on demand, while
+// every clause depending on the bound is guarded by `boundSelector`, which is
+// assumed during solving and retired once the next bound is encoded.
+class BoundSolver : public Solver {
+public:
+    // In incremental mode Glucose only checks the watched literals for
+    // satisfied clauses, which misses most clauses of a retired bound
+    void removeRetiredClauses() {
+        assert(decisionLevel() == 0);
+        if (!ok || propagate() != CRef_Undef) {
+            ok = false;
+            return;
         }
+        incremental = false;
+        removeSatisfied(learnts);
+        removeSatisfied(clauses);
+        incremental = true;
+        checkGarbage();
+        rebuildOrderHeap();
+    }
+
+    // Unit propagation alone refutes the formula under assumption p
+    bool refutedByPropagation(Lit p) {
+        assert(decisionLevel() == 0);
+        if (value(p) != l_Undef)
+            return value(p) == l_False;
+        newDecisionLevel();
+        uncheckedEnqueue(p);
+        bool conflict = propagate() != CRef_Undef;
+        cancelUntil(0);
+        return conflict;
     }
-    return true;
-}
-// Variables from regular language
-
-
+};
 
 //=================================================================================================
 // Main:
@@ -1335,37 +378,6 @@ bool unweightedEquation(map<char, vector<int>> lhs_pm,
     }
 }
 
-// quick unsat preprocessing
-bool checkForUnsat() {
-    set<char> variableAlphabet;
-    set<char> terminalAlphabet;
-    for (int i = 0; i < input_equations_lhs.size(); i++) {
-        string lhs = input_equations_lhs[i];
-        string rhs = input_equations_rhs[i];
-
-        if (lhs.size() == 0 || rhs.size() == 0) {
-            continue;
-        }
-
-        // prefix/suffix
-        if (characterMismatch(lhs, rhs)) {
-            return true;
-        }
-        // fetch parikhimages
-        map<char, vector<int>> p_lhs_pm, p_rhs_pm, s_lhs_pm, s_rhs_pm;
-        getAlphabets(lhs, rhs, variableAlphabet, terminalAlphabet);
-        getParikhMatrix(lhs, variableAlphabet, terminalAlphabet, p_lhs_pm,
-                        s_lhs_pm);
-        getParikhMatrix(rhs, variableAlphabet, terminalAlphabet, p_rhs_pm,
-                        s_rhs_pm);
-        if (lengthArgumentFail(lhs, rhs, p_lhs_pm, p_rhs_pm, s_lhs_pm, s_rhs_pm) ||
-            unweightedEquation(p_lhs_pm, p_rhs_pm, lhs.size(), rhs.size())) {
-            return true;
-        }
-    }
-    return false;
-}
-
 //
 void removeLeadingAndEndingSymbols(string &lhs, string &rhs) {
     int rSize = rhs.size();
@@ -1443,442 +455,1576 @@ bool substitude(std::string &str, const char &from, const std::string &to) {
     return replaced;
 }
 
-Words::Solvers::Result
-setupSolverMain(Words::Options &opt) { // std::vector<std::string>& mlhs,
-    // std::vector<std::string>& mrhs) {
-    clearIndexMaps();
-    vector<std::string> input_equations_lhs_tmp;
-    vector<std::string> input_equations_rhs_tmp;
-
-    // Preprocess regular constraints
-    /*
-    std::vector<std::shared_ptr<Words::RegularConstraints::RegConstraint>> preprocessed;
-    for (auto &recon: opt.recons) {
-        recon->expr->flatten();
-        auto strippedRecon = RegularEncoding::stripSuffix(RegularEncoding::stripPrefix(*recon));
-        preprocessed.push_back(std::make_shared<Words::RegularConstraints::RegConstraint>(strippedRecon));
+//=================================================================================================
+// Everything the encoding of one instance needs, see EncodingContext
+struct EncodingContext::State {
+    // variableVars(i, j, k) == x_i[j] is the k-th letter (k == sigmaSize for epsilon)
+    RegularEncoding::VariableTable variableVars;
+    map<char, int> terminalIndices, variableIndices;
+    map<int, char> index2Terminal, index2Varible, var2Terminal;
+
+    // Maps terminals to indices
+    RegularEncoding::SymbolIndices<Words::Terminal> tIndices;
+
+    // Maps variables to index in word equation, inverse of `index2v
+    RegularEncoding::SymbolIndices<Words::Variable> vIndices;
+
+    // Maps indices in the equation to terminals, inverse of tIndices
+    map<int, Words::Terminal *> index2t;
+
+    // Maps index in wor equation to variable, inverse of `vIndices`
+    map<int, Words::Variable *> index2v;
+
+    Words::Options input_options;
+
+    vector<string> input_equations_lhs, input_equations_rhs;
+    vector<vector<Var>> equations_lhs, equations_rhs; // SAT encoding
+    RegularEncoding::ConstantTable constantsVars;
+    vector<int> maxPadding;
+    int globalMaxPadding = 0;
+
+    vector<vector<Var>> stateTables;
+    vector<int> stateTableColumns, stateTableRows;
+    vector<map<int, int>> input_linears_lhs;
+    vector<int> input_linears_rhs;
+
+    // oneHotEncoding[i][j] == |X_i|=j
+    vector<vector<Lit>> oneHotEncoding;
+
+    int sigmaSize = 0;
+    // int gammaSize; // Variable Alphabet size
+
+    Var trueConst = var_Undef, falseConst = var_Undef;
+
+    unique_ptr<BoundSolver> incrementalSolver;
+    // Guards incrementalSolver against interruptSolver, which is called from other threads
+    std::mutex incrementalSolverMutex;
+    std::atomic<bool> interruptRequested{false};
+    Lit boundSelector = lit_Undef;
+    Var firstBoundVar = var_Undef;
+    vector<int> allocatedPadding;
+    // NFAs of the regular constraints, they do not depend on the bound
+    RegularEncoding::AutomatonCache automata;
+
+    void clear() {
+        stateTableColumns.clear();
+        stateTableRows.clear();
+        stateTables.clear();
+        equations_lhs.clear();
+        equations_rhs.clear();
+        maxPadding.clear();
+        var2Terminal.clear();
+        oneHotEncoding.clear();
+    }
+
+    void clearIndexMaps() {
+        index2t.clear();
+        index2v.clear();
+        tIndices.clear();
+        vIndices.clear();
+        sigmaSize = 0;
+    }
+
+    void clearIncremental() {
+        {
+            std::lock_guard<std::mutex> lock(incrementalSolverMutex);
+            incrementalSolver.reset();
+        }
+        boundSelector = lit_Undef;
+        firstBoundVar = var_Undef;
+        allocatedPadding.clear();
+        variableVars.reset(0, 0);
+        constantsVars.reset(0);
+        automata.clear();
+    }
+
+    // Makes the running solveLimited call return l_Undef, as well as those of solvers created before the next resetInterrupt
+    void interruptSolver() {
+        std::lock_guard<std::mutex> lock(incrementalSolverMutex);
+        interruptRequested = true;
+        if (incrementalSolver) {
+            incrementalSolver->interrupt();
+        }
+    }
+
+    void resetInterrupt() {
+        std::lock_guard<std::mutex> lock(incrementalSolverMutex);
+        interruptRequested = false;
+        if (incrementalSolver) {
+            incrementalSolver->clearInterrupt();
+        }
     }
-    opt.recons = preprocessed;
-    */
 
-    input_options = opt;
+    void clearLinears() {
+        input_linears_lhs.clear();
+        input_linears_rhs.clear();
+        input_linears_lhs.clear();
+        input_linears_rhs.clear();
+    }
 
-    std::map<char, std::string> subsitutions;
+    void readSymbols(string &s) { std::cout << "xxx" << std::endl; }
 
-    for (auto &eq: opt.equations) {
-        readSymbols(eq.lhs);
-        readSymbols(eq.rhs);
+    void readSymbols(Words::Word &s) {
+        for (auto e: s) {
+            if (e->isSequence()) {
+                std::cout << "c SEQUENCE!" << std::endl;
+                // TODO: Add Sequences
+            } else if (e->isTerminal()) {
+                if (!tIndices.contains(e->getTerminal())) {
+                    tIndices.insert(e->getTerminal());
+                    index2t[sigmaSize++] = e->getTerminal();
+                }
+            } else if (e->isVariable()) {
+                if (!vIndices.contains(e->getVariable())) {
+                    index2v[vIndices.insert(e->getVariable())] = e->getVariable();
+                }
+            }
+        }
     }
 
-    for (auto rc: opt.recons) {
+    vec<Lit> guardedClause;
+
+    // Adds a clause that only holds for the bound currently being encoded. Like
+    // Solver::addClause, false is returned once the bound became unsatisfiable.
 
-        readSymbols(rc->pattern);
+    bool addGuardedClause(Solver &s) {
+        if (boundSelector == lit_Undef)
+            return s.addClause_(guardedClause);
+        guardedClause.push(~boundSelector);
+        return s.addClause_(guardedClause) && s.value(boundSelector) != l_False;
+    }
 
-        Words::Word exprAlph;
-        unique_ptr<Words::WordBuilder> wb = opt.context->makeWordBuilder(exprAlph);
-        rc->expr->getAlphabet(*wb);
-        wb->flush();
-        readSymbols(exprAlph);
+    bool addBoundClause(Solver &s, const vec<Lit> &ps) {
+        ps.copyTo(guardedClause);
+        return addGuardedClause(s);
+    }
 
+    bool addBoundClause(Solver &s, Lit p) {
+        guardedClause.clear();
+        guardedClause.push(p);
+        return addGuardedClause(s);
+    }
 
+    bool addBoundClause(Solver &s, Lit p, Lit q) {
+        guardedClause.clear();
+        guardedClause.push(p);
+        guardedClause.push(q);
+        return addGuardedClause(s);
     }
 
-    return Words::Solvers::Result::NoIdea;
-}
+    // Adds the clauses of the regular-constraint encoders for the current bound
+    class BoundClauseSink : public RegularEncoding::SolverSink {
+    public:
+        BoundClauseSink(State &state, Solver &s) : SolverSink(s), state(state) {}
 
-void addLinearConstraint(vector<pair<Words::Variable *, int>> lhs, int rhs) {
-    map<int, int> coefficients;
-    for (auto x: lhs) {
-        // NOT CORRECT, THIS NEEDS A FIX!!!!
-        if (vIndices.count(x.first)) {
-            coefficients[vIndices[x.first]] = x.second;
+    protected:
+        void add(vec<Lit> &lits) override { state.addBoundClause(solver, lits); }
+
+    private:
+        State &state;
+    };
+
+    // lhs <-> /\ rhs
+    void reify_and(Solver &s, Lit lhs, vec<Lit> &rhs) {
+        assert(rhs.size() > 0 && "reifying empty list? ");
+        // lhs -> rhs[i]
+        for (int i = 0; i < rhs.size(); i++) {
+            vec<Lit> ps;
+            ps.push(rhs[i]);
+            ps.push(~lhs);
+            addBoundClause(s, ps);
         }
+        // /\rhs -> lhs
+        vec<Lit> ps;
+        for (int i = 0; i < rhs.size(); i++)
+            ps.push(~rhs[i]);
+        ps.push(lhs);
+        addBoundClause(s, ps);
     }
 
-    input_linears_lhs.push_back(coefficients);
-    input_linears_rhs.push_back(rhs);
-}
+    // lhs <-> \/ rhs
+    void reify_or(Solver &s, Lit lhs, vec<Lit> &rhs) {
+        assert(rhs.size() > 0 && "reifying empty list? ");
+        // rhs[i] -> lhs
+        for (int i = 0; i < rhs.size(); i++) {
+            vec<Lit> ps;
+            ps.push(~rhs[i]);
+            ps.push(lhs);
+            addBoundClause(s, ps);
+        }
+        // lhs -> \/ rhs
+        vec<Lit> ps;
+        for (int i = 0; i < rhs.size(); i++)
+            ps.push(rhs[i]);
+        ps.push(~lhs);
+        addBoundClause(s, ps);
+    }
 
-template<bool newencode = true>
-::Words::Solvers::Result runSolver(const bool squareAuto, size_t bound,
-                                   const Words::Context &context,
-                                   Words::Substitution &substitution,
-                                   Words::Solvers::Timing::Keeper &tkeeper,
-                                   std::ostream *odia = nullptr,
-                                   RegularEncoding::EncodingProfiler* profiler = nullptr) {
-
-    clear();
-    auto startTotal = chrono::high_resolution_clock::now();
-    {
-        // Words::Solvers::Timing::Timer overalltimer (tkeeper, "Setup ");
-
-        globalMaxPadding = static_cast<int>(bound);
-        for (size_t i = 0; i < vIndices.size(); i++) {
-            // Padding used for the i-th variable, i.e., the i-th variable will be filled with this value
-            maxPadding[i] = globalMaxPadding;
+    void addOneHotEncoding(Solver &s) {
+        int numVars = vIndices.size();
+
+        assert(numVars > 0);
+        oneHotEncoding.resize(numVars);
+        for (int i = 0; i < numVars; i++) {
+            vector<Lit> &oneHot = oneHotEncoding[i];
+            oneHot.assign(std::max(maxPadding[i] + 1, 1), lit_Undef);
+            // oneHot[i,0] <-> x_i[0]=epsilon, which always holds without positions
+            oneHot[0] = maxPadding[i] > 0 ? mkLit(variableVars(i, 0, sigmaSize)) : mkLit(trueConst);
+            for (int j = 1; j < maxPadding[i]; j++) {
+                Var v = s.newVar();
+                vec<Lit> ps;
+                assert(variableVars.contains(i, j, sigmaSize));
+                assert(variableVars.contains(i, j - 1, sigmaSize));
+                ps.push(mkLit(variableVars(i, j, sigmaSize))); // x[j] = epsilon
+                ps.push(~mkLit(variableVars(i, j - 1, sigmaSize))); // x[j-1] != epsilon
+                reify_and(s, mkLit(v), ps);
+                oneHot[j] = mkLit(v);
+            }
+
+            // Last position: oneHot[i, max] <-> x[max] != epsilon
+            if (maxPadding[i] > 0) {
+                assert(variableVars.contains(i, maxPadding[i] - 1, sigmaSize));
+
+                oneHot[maxPadding[i]] = ~mkLit(variableVars(i, maxPadding[i] - 1, sigmaSize));
+            }
+        }
+        // Add a clause that at least one of the one-hot-literals must be true:
+        for (int i = 0; i < numVars; i++) {
+            vec<Lit> ps;
+            for (int j = 0; j <= maxPadding[i]; j++)
+                ps.push(oneHotEncoding[i][j]);
+            addBoundClause(s, ps);
         }
     }
-    StreamWrapper wrap(odia);
-    Solver S;
-    std::cout << "===================\n";
-    int lin = 0, reg = 0, d = 0; // upper bound on length of variables
-    double initial_time = cpuTime();
-    trueConst = S.newVar();
-    S.addClause(mkLit(trueConst));
-    falseConst = S.newVar();
-    S.addClause(~mkLit(falseConst));
-
-    // assert(lin == 0 && "No linears yet! ");
-    assert(reg == 0 && "No regulars yet! ");
-
-    {
-        // Words::Solvers::Timing::Timer (tkeeper,"Sharpen Bounds ");
-        for (auto &eq: input_options.equations) {
-            sharpenBounds(S, eq, wrap);
+
+    void getCoefficients(Words::Equation &eq, map<int, int> &coefficients, int &c,
+                         map<int, int> &letter_coefficients) {
+        assert(c == 0);
+
+        for (auto e: eq.lhs) {
+            if (e->isSequence()) {
+                // TODO: Add Sequences
+            } else if (e->isTerminal()) {
+                letter_coefficients[tIndices.at(e->getTerminal())]++;
+                c++;
+            } else if (e->isVariable()) {
+                coefficients[vIndices.at(e->getVariable())]--;
+            }
+        }
+
+        for (auto e: eq.rhs) {
+            if (e->isSequence()) {
+                // TODO: Add Sequences
+            } else if (e->isTerminal()) {
+                letter_coefficients[tIndices.at(e->getTerminal())]--;
+                c--;
+            } else if (e->isVariable()) {
+                coefficients[vIndices.at(e->getVariable())]++;
+            }
         }
     }
 
-    int numVars;
-    {
-        std::stringstream ss;
-        ss << "Encoding [bound: " << bound << ", variables : "
-           << input_options.context->getVariableAlphabet().size()
-           << ", equations: " << input_options.equations.size() << "]";
+    // TODO: Lin-Constraint (via MDDs)
+
+    bool addSizeEqualityConstraint(Solver &s, Words::Equation &eq,
+                                   StreamWrapper &out) {
+        map<int, int> coefficients, letter_coefficients;
+        int rhs =
+                0; // amount of terminal symbols if we substract rhs count from lhs count
+        getCoefficients(eq, coefficients, rhs, letter_coefficients);
 
-        Words::Solvers::Timing::Timer overalltimer(tkeeper, ss.str());
-        Words::Solvers::Timing::Timer bla(tkeeper, "Encoding total ");
-        index2t[sigmaSize] = context.getEpsilon();
-        numVars = vIndices.size();
+        // quick parikh unsat for testing ;)
+        /*bool allZero = true;
+
+        for (auto const& e : coefficients) {
+              allZero = allZero and (e.second == 0);
+        }
+        if (allZero){
+              for (auto const& e : letter_coefficients) {
+                cout << index2Terminal[e.first] <<" " << e.second << endl;
+                if (e.second != 0){
+                      cout << "c Unsat due to parikh image mismatch!" << endl;
+                      return false;
+                }
+              }
+        }*/
+
+        set<pair<int, int>> states;
+        int numVars = vIndices.size();
+        states.insert(make_pair(-1, 0)); // state for the empty prefix
+        vector<int> currentRow;
+
+        map<pair<int, int>, set<pair<int, int>>> predecessors, successors;
+        currentRow.push_back(0);
+
+        set<int> nextRow;
 
         for (int i = 0; i < numVars; i++) {
-            (wrap << "bound for " << index2v[i]->getRepr() << ": " << maxPadding[i])
+            for (int j = 0; j < currentRow.size(); j++) {
+                for (int k = 0; k <= maxPadding[i]; k++) {
+                    int nextValue = currentRow[j] + k * coefficients[i];
+                    nextRow.insert(nextValue);
+                    states.insert(make_pair(i, nextValue));
+                }
+            }
+            currentRow.clear();
+            currentRow.insert(currentRow.end(), nextRow.begin(), nextRow.end());
+            nextRow.clear();
+        }
+        if (out) {
+            (out << (Words::Solvers::Formatter("Created %d numStates for MDD! ") %
+                     states.size())
+                    .str())
                     .endl();
         }
-        // Encode variables for terminal symbols
+        // printf("c created %d states for MDD! \n", numStates.size());
+        /*for(set<pair<int, int> >::iterator it = states.begin() ; it !=
+          numStates.end();it++){ cout << "initial state: " << it->first << " " <<
+          it->second << endl;
+          }*/
+        if (states.count(make_pair(numVars - 1, rhs)) == 0) {
+            return false;
+        }
 
-        {
-            // Words::Solvers::Timing::Timer shit (tkeeper,"Encode constants ");
-            // C_{i,j}
-            for (int i = 0; i <= sigmaSize; i++) {
-                for (int j = 0; j <= sigmaSize; j++) {
-                    Var v = S.newVar();
-                    constantsVars[make_pair(i, j)] = v;
-                    // Make variable "true" if i=j, and false otherwise
-                    if (i == j)
-                        S.addClause(mkLit(v));
-                    else
-                        S.addClause(~mkLit(v));
+        set<pair<int, int>> markedStates;
+        vector<pair<int, int>> queue;
+        int nextIndex = 0;
+        // Mark final state
+        markedStates.insert(make_pair(numVars - 1, rhs));
+        queue.push_back(make_pair(numVars - 1, rhs));
+        while (nextIndex < queue.size()) {
+            pair<int, int> currentState = queue[nextIndex];
+            nextIndex++;
+            int this_var = currentState.first;
+            if (this_var < 0) {
+                // Okay, I reached the root
+                markedStates.insert(currentState);
+            } else {
+                assert(this_var >= 0 && this_var < numVars);
+                for (int j = 0; j <= maxPadding[this_var]; j++) {
+                    pair<int, int> predecessor = make_pair(
+                            this_var - 1, currentState.second - j * coefficients[this_var]);
+                    if (states.count(predecessor)) {
+                        if (markedStates.count(predecessor) == 0)
+                            queue.push_back(predecessor);
+
+                        markedStates.insert(predecessor);
+                        predecessors[currentState].insert(predecessor);
+                        successors[predecessor].insert(currentState);
+                    }
                 }
             }
         }
+        Words::Solvers::Formatter ff("have %1% marked numStates!");
+        (out << (ff % markedStates.size()).str()).endl();
+        // printf("c have %d marked numStates! \n", markedStates.size());
+        map<pair<int, int>, Var> partialSumVariables;
+        for (set<pair<int, int>>::iterator it = markedStates.begin();
+             it != markedStates.end(); it++) {
+            partialSumVariables[*it] = s.newVar();
+        }
+        assert(partialSumVariables.count(make_pair(-1, 0)));
+        addBoundClause(s, mkLit(partialSumVariables[make_pair(-1, 0)]));
+
+        assert(partialSumVariables.count(make_pair(numVars - 1, rhs)));
+        addBoundClause(s, mkLit(partialSumVariables[make_pair(numVars - 1, rhs)]));
+
+        // Add clauses: A[i-1,j] /\ x_i = c -> A[i, j+a_i * c]
+        for (set<pair<int, int>>::iterator it = markedStates.begin();
+             it != markedStates.end(); it++) {
+            // cout << "Have marked state " << it->first << " " << it->second << " and "
+            // << s.nFreeVars() << " free variables" << endl;
+            int this_var = it->first + 1;
+            if (this_var >= numVars) {
+                assert(this_var == numVars);
+                assert(it->second == rhs);
+                (out << "adding unit clause! ").endl();
+                addBoundClause(s, mkLit(partialSumVariables[*it]));
+            } else {
+                assert(this_var < (int) maxPadding.size());
+                int successorsFound = 0;
+                int lastVarAssignmentThatFit = -1;
+                for (int i = 0; i <= maxPadding[this_var]; i++) {
+                    int new_sum = it->second + i * coefficients[this_var];
+                    assert(states.count(make_pair(this_var, new_sum)));
 
-        // Take a variable, and index and a sigma, and return if the variable at
-        // index "i" equals sigma g:  x, i, sigma -> BV
+                    vec<Lit> ps;
+                    assert(partialSumVariables.count(*it));
+                    ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
+                    if (oneHotEncoding[this_var][i] == lit_Undef) {
+                        cout << "Cannot find oneHot for variable " << this_var
+                             << " and value " << i << endl;
+                    }
+                    assert(oneHotEncoding[this_var][i] != lit_Undef);
+                    ps.push(~oneHotEncoding[this_var][i]); // this_var=i
+
+                    if (markedStates.count(make_pair(this_var, new_sum))) {
+                        successorsFound++;
+                        assert(markedStates.count(make_pair(this_var, new_sum)));
+                        assert(partialSumVariables.count(make_pair(this_var, new_sum)));
+                        ps.push(mkLit(partialSumVariables[make_pair(this_var, new_sum)]));
+                        lastVarAssignmentThatFit = i;
+                    }
+                    if (!addBoundClause(s, ps)) {
+                        (out << "got false while adding a clause! ").endl();
+                    }
+                }
+                assert(successorsFound > 0);
+                if (successorsFound == 1) {
+                    assert(lastVarAssignmentThatFit >= 0);
+                    vec<Lit> ps;
+                    assert(partialSumVariables.count(*it));
+                    ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
+                    // printf("c only one successor, adding unit clause! \n");
+                    ps.push(oneHotEncoding[this_var]
+                                          [lastVarAssignmentThatFit]); // Only one successor. Thus, if A[i,j]
+                    // is active, this immediately implies
+                    // the value of x[i]
+                    addBoundClause(s, ps);
+                }
+            }
+        }
+        return true;
+    }
 
-        {
-            Words::Solvers::Timing::Timer (tkeeper,"Encode variables ");
-            for (int i = 0; i < numVars; i++) {
-                assert(maxPadding.count(i));
-                for (int j = 0; j < maxPadding[i]; j++) {
+    void oldEncoding(Solver &S, int szLHS, int szRHS, vector<Var> &stateVars,
+                     vector<Var> &w1, vector<Var> &w2,
+                     StreamWrapper &out, bool localOptimisation) {
+        // int equationSizes = szRHS;
+        // cout << "now have equationSize " << equationSizes << endl;
+        // TODO:
+        // equality-predicates
+        map<pair<int, int>, Var> wordsMatch;
+        for (int i = 0; i <= szLHS; i++) {
+            for (int j = 0; j <= szRHS; j++) {
+                if (i == szLHS || j == szRHS) {
+                    Var v = S.newVar();
+                    addBoundClause(S, ~mkLit(v));
+                    wordsMatch[make_pair(i, j)] = v;
+                } else {
+                    vec<Lit> atoms;
                     for (int k = 0; k <= sigmaSize; k++) {
                         Var v = S.newVar();
-                        variableVars[make_pair(make_pair(i, j), k)] = v;
+                        atoms.push(mkLit(v));
+                        // v <-> w1[i]=k /\ w2[j] = k
+                        vec<Lit> ps;
+                        ps.push(mkLit(w1[getIndex(sigmaSize + 1, i, k)]));
+                        ps.push(mkLit(w2[getIndex(sigmaSize + 1, j, k)]));
+                        reify_and(S, mkLit(v), ps);
                     }
-                }
-
-                // Assert that epsilons occur at the end of a substitution
-                for (int j = 0; j + 1 < maxPadding[i]; j++) {
-                    S.addClause(
-                            ~mkLit(variableVars[make_pair(make_pair(i, j), sigmaSize)]),
-                            mkLit(variableVars[make_pair(make_pair(i, j + 1), sigmaSize)]));
+                    Var v = S.newVar();
+                    wordsMatch[make_pair(i, j)] = v;
+                    // wordsMatch[i,j] = \/ atoms
+                    reify_or(S, mkLit(v), atoms);
                 }
             }
         }
+        // automaton:
+        // s[i,j] is true <-> left hand side and ride hand side matched up to indices
+        // (i-1, j-1) thus, s[0,0] is always true
+
+        // Empty prefixes match
+        addBoundClause(S, mkLit(stateVars[getIndex(szRHS + 1, 0, 0)]));
+        // Final state is active
+        addBoundClause(S, mkLit(stateVars[getIndex(szRHS + 1, szLHS, szRHS)]));
+
+        if (out) {
+            Words::Solvers::Formatter ff("Have automaton size %1% times %2% and "
+                                         "created %3% many state variables");
+            (out << (ff % szLHS % szRHS % stateVars.size()).str()).endl();
+        }
+        for (int i = 0; i <= szLHS; i++) {
+            for (int j = 0; j <= szRHS; j++) {
+                vec<Lit> or_rhs;
+                // Case 1: state (i-1, j-1) was active and match at position (i-1,j-1)
+                if (i > 0 && j > 0) {
+                    Var v = S.newVar();
+                    vec<Lit> ps;
+                    assert(wordsMatch.count(make_pair(i - 1, j - 1)));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i - 1, j - 1)]));
+                    ps.push(mkLit(wordsMatch[make_pair(i - 1, j - 1)]));
+                    reify_and(S, mkLit(v), ps);
+                    or_rhs.push(mkLit(v));
+                }
 
-        // Alldifferent: Make sure that each variable is assigned to exactly one
-        // letter from Sigma (or epsilon)
-        // TODO: Do this with linear number of clauses (!!!)
-        {
+                ///////////////////////
+                /// \brief v2
+                ///
 
-            for (int i = 0; i < numVars; i++) {
-                assert(maxPadding.count(i));
-                for (int j = 0; j < maxPadding[i]; j++) {
+                if (i > 0) {
+                    // v2 <-> S(i-1, j) /\ !match /\ w1[i-1] = epsilon
+                    Var v = S.newVar();
                     vec<Lit> ps;
-                    for (int k = 0; k <= sigmaSize; k++) {
-                        assert(variableVars.count(make_pair(make_pair(i, j), k)));
-                        ps.push(mkLit(variableVars[make_pair(make_pair(i, j), k)]));
-                        for (int l = k + 1; l <= sigmaSize; l++) {
-                            assert(variableVars.count(make_pair(make_pair(i, j), l)));
-                            S.addClause(~mkLit(variableVars[make_pair(make_pair(i, j), k)]),
-                                        ~mkLit(variableVars[make_pair(make_pair(i, j), l)]));
-                        }
-                    }
-                    S.addClause(ps);
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i - 1, j)]));
+                    assert(wordsMatch.count(make_pair(i - 1, j)));
+                    ps.push(~mkLit(wordsMatch[make_pair(i - 1, j)]));
+                    ps.push(mkLit(w1[getIndex(sigmaSize + 1, i - 1, sigmaSize)]));
+
+                    reify_and(S, mkLit(v), ps);
+                    or_rhs.push(mkLit(v));
+                }
+
+                /////////////////////
+                /// \brief v3
+                ///
+
+                if (j > 0) {
+                    // v3 <-> S(i, j-1) /\ !match /\ w2[j-1] = epsilon
+                    Var v = S.newVar();
+                    vec<Lit> ps;
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j - 1)]));
+                    assert(wordsMatch.count(make_pair(i, j - 1)));
+                    ps.push(~mkLit(wordsMatch[make_pair(i, j - 1)]));
+                    ps.push(mkLit(w2[getIndex(sigmaSize + 1, j - 1, sigmaSize)]));
+
+                    reify_and(S, mkLit(v), ps);
+                    or_rhs.push(mkLit(v));
+                }
+
+                // S(i,j) <-> v1 \/ v2 \/ v3 (if all of them exist)
+
+                if (or_rhs.size() == 0) {
+                    assert(i == 0 && j == 0);
+                } else if (or_rhs.size() < 3) {
+                    assert(or_rhs.size() == 1 && (i == 0 || j == 0));
+                }
+
+                if (or_rhs.size() > 0) {
+                    reify_or(S, mkLit(stateVars[getIndex(szRHS + 1, i, j)]), or_rhs);
+                }
+            }
+        }
+        if (localOptimisation) {
+            for (int i = 0; i < szLHS; i++) {
+                for (int j = 0; j < szRHS; j++) {
+                    assert(stateVars[getIndex(szRHS + 1, i, j)] != var_Undef);
+                    assert(stateVars[getIndex(szRHS + 1, i + 1, j)] != var_Undef);
+                    assert(stateVars[getIndex(szRHS + 1, i, j + 1)] != var_Undef);
+                    assert(stateVars[getIndex(szRHS + 1, i + 1, j + 1)] != var_Undef);
+                    vec<Lit> ps;
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                    addBoundClause(S, ps);
                 }
             }
         }
+        for (map<pair<int, int>, Var>::iterator it = wordsMatch.begin();
+             it != wordsMatch.end(); it++) {
+            S.setDecisionVar(it->second, false);
+        }
+    }
 
+    void newEncoding(Solver &S, int szLHS, int szRHS, vector<Var> &stateVars,
+                     vector<Var> &w1, vector<Var> &w2) {
+        for (int i = 0; i < szLHS; i++) {
+            for (int j = 0; j < szRHS; j++) {
+                // assert(S.okay());
+                // s(i,j) active -> exactly one of the successors is active
+                assert(stateVars[getIndex(szRHS + 1, i, j)] != var_Undef);
+                assert(stateVars[getIndex(szRHS + 1, i + 1, j)] != var_Undef);
+                assert(stateVars[getIndex(szRHS + 1, i, j + 1)] != var_Undef);
+                assert(stateVars[getIndex(szRHS + 1, i + 1, j + 1)] != var_Undef);
 
-        {
-            // Words::Solvers::Timing::Timer (tkeeper,"Encode OneHot ");
-            addOneHotEncoding(S);
+                vec<Lit> ps;
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                int nBefore = S.nClauses();
+                addBoundClause(S, ps);
+                ps.clear();
+                /*if(S.nClauses() == nBefore){
+                  printf("c clause for i=%d and j=%d is ignored! \n", i, j);
+                  }*/
+
+                // (i,j) is active and (i+1, j) --> none of the others
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                // (i,j) is active and (i+1, j+1) --> none of the others
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+                // (i,j) is active and (i, j+1) --> none of the others
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                /////////////////////////////////////////////////////////////////////
+                // s(i,j) /\ w1[i] = epsilon /\ w2[j] != epsilon -> s(i+1, j)
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(w1[getIndex(sigmaSize + 1, i, sigmaSize)]));
+                ps.push(mkLit(w2[getIndex(sigmaSize + 1, j, sigmaSize)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                // s(i,j) /\ w1[i] != epsilon -> NOT s(i+1, j)
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(mkLit(w1[getIndex(sigmaSize + 1, i, sigmaSize)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                /////////////////////////////////////////////////////////////////////
+                // s(i,j) /\ w1[i] != epsilon /\ w2[j] = epsilon -> s(i, j+1)
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(mkLit(w1[getIndex(sigmaSize + 1, i, sigmaSize)]));
+                ps.push(~mkLit(w2[getIndex(sigmaSize + 1, j, sigmaSize)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                // s(i,j) /\ w2[j] != epsilon -> NOT s(i, j+1)
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(mkLit(w2[getIndex(sigmaSize + 1, j, sigmaSize)]));
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                /////////////////////////////////////////////////////////////////////
+                // s(i,j) /\ w1[i] = epsilon /\ w2[j] = epsilon -> s(i+1, j+1)
+                ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                ps.push(~mkLit(w1[getIndex(sigmaSize + 1, i, sigmaSize)]));
+                ps.push(~mkLit(w2[getIndex(sigmaSize + 1, j, sigmaSize)]));
+                ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                addBoundClause(S, ps);
+                ps.clear();
+
+                /////////////////////////////////////////////////////////////////////
+                // s(i,j) /\ s(i+1, j+1) => w1[i] = w2[j]
+                for (int k = 0; k <= sigmaSize; k++) {
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                    ps.push(~mkLit(w1[getIndex(sigmaSize + 1, i, k)]));
+                    ps.push(mkLit(w2[getIndex(sigmaSize + 1, j, k)]));
+                    addBoundClause(S, ps);
+                    ps.clear();
+
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                    ps.push(mkLit(w1[getIndex(sigmaSize + 1, i, k)]));
+                    ps.push(~mkLit(w2[getIndex(sigmaSize + 1, j, k)]));
+                    addBoundClause(S, ps);
+                    ps.clear();
+                }
+                assert(ps.size() == 0);
+                if (i > 0 && j > 0) {
+                    ps.push(~mkLit(stateVars[getIndex(szRHS + 1, i + 1, j + 1)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j + 1)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i + 1, j)]));
+                    ps.push(mkLit(stateVars[getIndex(szRHS + 1, i, j)]));
+                    addBoundClause(S, ps);
+                    ps.clear();
+                }
+            }
+        }
+    }
+    // TODO: Sets of equations (-> thus, functions for each equation)
+
+    // Appends the sigmaSize + 1 letter variables of one position
+    void pushColumn(vector<Var> &w, const Var *letters) {
+        w.insert(w.end(), letters, letters + sigmaSize + 1);
+    }
+
+    // localOptimisation: add clauses s(i,j) -> (s(i+1, j) \/ s(i+1, j+1) \/
+    // s(i,j+1))
+    template<bool newEncode = true>
+    void encodeEquation(Solver &S, Words::Equation &eq, bool localOptimisation,
+                        bool fillUntilSquare, StreamWrapper &out) {
+        // Column c of w1 (resp. w2) is stored at [c * (sigmaSize + 1), (c + 1) * (sigmaSize + 1))
+        vector<Var> w1, w2;
+        int szLHS = 0;
+        int szRHS = 0;
+
+        // w1 resp. lhs
+        for (auto e: eq.lhs) {
+
+            if (e->isSequence()) {
+                // TODO: Add Sequences
+            } else if (e->isTerminal()) {
+                pushColumn(w1, constantsVars.letters(tIndices.at(e->getTerminal())));
+            } else if (e->isVariable()) {
+                // cout << "c Looking for variable " << input_w1[i] << endl;
+                int x = vIndices.at(e->getVariable());
+                for (int j = 0; j < maxPadding[x]; j++) {
+                    assert(variableVars.contains(x, j, sigmaSize));
+                    pushColumn(w1, variableVars.letters(x, j));
+                }
+            }
         }
 
-        {
-            // Words::Solvers::Timing::Timer (tkeeper,"Encode length abstraction ");
-            for (auto &eq: input_options.equations) {
-                bool succ = addSizeEqualityConstraint(S, eq, wrap);
-                if (!succ) {
-                    return Words::Solvers::Result::NoSolution;
+        szLHS = w1.size() / (sigmaSize + 1);
+        if (out) {
+            (out << "c LHS done. We have " << szLHS << " many colums.").endl();
+        }
+
+        // w2 resp. rhs
+        for (auto e: eq.rhs) {
+            if (e->isSequence()) {
+                // TODO: Add Sequences
+            } else if (e->isTerminal()) {
+                pushColumn(w2, constantsVars.letters(tIndices.at(e->getTerminal())));
+            } else if (e->isVariable()) {
+                // cout << "c Looking for variable " << input_w1[i] << endl;
+                int x = vIndices.at(e->getVariable());
+                for (int j = 0; j < maxPadding[x]; j++) {
+                    assert(variableVars.contains(x, j, sigmaSize));
+                    pushColumn(w2, variableVars.letters(x, j));
                 }
             }
         }
 
-        {
-            // linears
-            // Words::Solvers::Timing::Timer (tkeeper,"Encode linear constraints ");
-            for (int i = 0; i < input_linears_lhs.size(); i++) {
-                // quick check whether a linear constraint can be satisfiable using the
-                // given bounds
-                /* int lhsValue = 0;
-                 for (auto x : input_linears_lhs[i]){
-                         lhsValue=lhsValue+(maxPadding[x.first]*x.second);
-                 }
-                 cout << lhsValue << " " << input_linears_rhs[i] << endl;
-                */
-                // true?
-                /* if (lhsValue > input_linears_rhs[i]){
-                         return Words::Solvers::Result::NoSolution;
-                 //DefinitelyNoSolution;
-                 }*/
-
-                bool succ = addLinearEqualityConstraint(S, input_linears_lhs[i],
-                                                        input_linears_rhs[i], wrap);
-                if (!succ) {
-                    return Words::Solvers::Result::NoSolution;
+        szRHS = w2.size() / (sigmaSize + 1);
+        if (out) {
+            (out << "c RHS done. We have " << szRHS << " many colums.").endl();
+        }
+
+        bool ignorePadding = false;
+        // bool fillUntilSquare = false;
+        if (ignorePadding) {
+            if (szLHS < szRHS)
+                szRHS = szLHS;
+            if (szRHS < szLHS)
+                szLHS = szRHS;
+        }
+        if (fillUntilSquare) {
+            if (szLHS < szRHS) {
+                if (out)
+                    (out << "c Padding left-hand side: ").endl();
+                for (; szLHS < szRHS; szLHS++) {
+                    pushColumn(w1, constantsVars.letters(sigmaSize));
                 }
             }
+            if (szLHS > szRHS) {
+                if (out)
+                    (out << "c Padding right-hand side: ").endl();
+                for (; szRHS < szLHS; szRHS++) {
+                    pushColumn(w2, constantsVars.letters(sigmaSize));
+                }
+            }
+            assert(szRHS == szLHS);
+        }
+        if (out) {
+            (out << (Words::Solvers::Formatter("creating table of size %1% x %2%") %
+                     szLHS % szRHS)
+                    .str())
+                    .endl();
+        }
+
+        // map<pair<int, int>, Var> stateVars;
+        vector<Var> stateVars((szLHS + 1) * (szRHS + 1), var_Undef);
+        int lastIndex = -1;
+        for (int i = 0; i <= szLHS; i++) {
+            for (int j = 0; j <= szRHS; j++) {
+                assert(getIndex(szRHS + 1, i, j) == lastIndex + 1);
+                lastIndex = getIndex(szRHS + 1, i, j);
+                assert(stateVars[getIndex(szRHS + 1, i, j)] == var_Undef);
+                stateVars[getIndex(szRHS + 1, i, j)] = S.newVar();
+            }
         }
 
+        // Empty prefixes match
+        addBoundClause(S, mkLit(stateVars[getIndex(szRHS + 1, 0, 0)]));
+        // Final state is active
+        addBoundClause(S, mkLit(stateVars[getIndex(szRHS + 1, szLHS, szRHS)]));
 
-        bool AUTOMATON = true;
+        if (newEncode) {
+            newEncoding(S, szLHS, szRHS, stateVars, w1, w2);
+        } else {
+            oldEncoding(S, szLHS, szRHS, stateVars, w1, w2, out, localOptimisation);
+        }
 
-        //Handle regular constraints
-        cout << "Current bound: " << bound << "\n";
-        profiler->bound = (int) bound;
+        for (vector<Var>::iterator it = stateVars.begin(); it != stateVars.end();
+             it++) {
+            if (*it != var_Undef)
+                S.setDecisionVar(*it, false);
+        }
 
+        equations_lhs.push_back(w1);
+        equations_rhs.push_back(w2);
+        stateTables.push_back(stateVars);
+        stateTableColumns.push_back(szRHS + 1);
+        stateTableRows.push_back(szLHS + 1);
+    }
 
-        for (const auto &recon: input_options.recons) {
-            if (recon->triviallySat) {
-                continue;
+    // Inequality between variables
+    void encodeNotEqual(Solver &s, int firstIndex, int secondIndex, int sigmaSize,
+                        std::ostream *out) {
+        if (out)
+            *out << "c adding inequality between " << firstIndex << " and "
+                 << secondIndex << endl;
+
+        vec<Lit> diffVars; // \/ (not matchHere(i) )
+        assert(firstIndex < (int) maxPadding.size());
+        assert(secondIndex < (int) maxPadding.size());
+        int maxVarSize = std::min(maxPadding[firstIndex], maxPadding[secondIndex]);
+        for (int i = 0; i < maxVarSize; i++) {
+            Var matchHere = s.newVar();
+            vec<Lit> match_rhs;
+            for (int k = 0; k <= sigmaSize; k++) {
+                // v <-> x[i]=k  /\ y[i]=k
+                Var v = s.newVar();
+                vec<Lit> ps;
+                assert(variableVars.contains(firstIndex, i, k));
+                assert(variableVars.contains(secondIndex, i, k));
+                ps.push(mkLit(variableVars(firstIndex, i, k)));
+                ps.push(mkLit(variableVars(secondIndex, i, k)));
+                reify_and(s, mkLit(v), ps);
+                match_rhs.push(mkLit(v));
+            }
+            reify_or(s, mkLit(matchHere), match_rhs);
+            diffVars.push(~mkLit(matchHere));
+        }
+        // TODO: Make sure this also works if sizes are not equal:
+        if (maxPadding[firstIndex] > maxPadding[secondIndex]) {
+            assert(variableVars.contains(firstIndex, maxPadding[secondIndex], sigmaSize));
+            diffVars.push(~mkLit(variableVars(firstIndex, maxPadding[secondIndex], sigmaSize)));
+        } else if (maxPadding[firstIndex] < maxPadding[secondIndex]) {
+            assert(variableVars.contains(secondIndex, maxPadding[firstIndex], sigmaSize));
+            diffVars.push(~mkLit(variableVars(secondIndex, maxPadding[firstIndex], sigmaSize)));
+        }
+        addBoundClause(s, diffVars);
+    }
+
+    void sharpenBounds(Solver &s, Words::Equation &eq, StreamWrapper &out) {
+        map<int, int> coefficients, letter_coefficients;
+        int c = 0;
+        getCoefficients(eq, coefficients, c, letter_coefficients);
+        if (out) {
+            (out << "Got equation ").endl();
+            for (map<int, int>::iterator it = coefficients.begin();
+                 it != coefficients.end(); it++) {
+                out << it->second << " * " << index2v[it->first]->getRepr() << " ";
+            }
+            (out << "= " << c).endl();
+        }
+        for (map<int, int>::iterator it = coefficients.begin();
+             it != coefficients.end(); it++) {
+            if (it->second != 0) { // only consider unbalanced variables!
+                int rhs = c;
+                for (map<int, int>::iterator others = coefficients.begin();
+                     others != coefficients.end(); others++) {
+                    if ((it->second < 0) ^
+                        (others->second < 0)) { // get upper bound, thus try to make rhs/a_i
+                        // as large as possible
+
+                        rhs -= others->second * maxPadding[others->first];
+                    }
+                }
+                if (out)
+                    (out << "c Can infer bound " << index2v[it->first]->getRepr() << " <= "
+                         << rhs << "/" << it->second << " = " << (rhs / it->second))
+                            .endl();
+                rhs /= it->second;
+                if (rhs < maxPadding[it->first])
+                    // std::cout << "c Setting new bound for " <<
+                    // index2v[it->first]->getRepr() << ": " << rhs << " instead of " <<
+                    // maxPadding[it->first] << std::endl;
+                    maxPadding[it->first] = rhs;
             }
-            //auto strippedRecon = RegularEncoding::stripSuffix(RegularEncoding::stripPrefix(*recon));
-            profiler->exprComplexity = (int) recon->expr->complexity();
-            profiler->starHeight = recon->expr->starHeight();
-            profiler->numStars = recon->expr->numStars();
-            profiler->depth = recon->expr->depth();
-            profiler->longestLiteral = recon->expr->longestLiteral();
-            profiler->shortestLiteral = recon->expr->shortestLiteral();
-            if (recon->expr->isEmpty()) {
-                cout << recon->expr->toString();
-                return Words::Solvers::Result::DefinitelyNoSolution; 
+        }
+    }
+
+    // sum a_i x_i - sum b_j x_j <=  + c, where a_i, b_j >= 0
+
+    // Expect x_i as one-hot encoded, with pairs (j, v_j) <-> x_i = j
+    bool addLinearEqualityConstraint(Solver &s, map<int, int> &coefficients,
+                                     int &rhs, StreamWrapper &out) {
+        set<pair<int, int>> states;
+        set<pair<int, int>> acceptingStates;
+        int numVars = vIndices.size();
+        states.insert(make_pair(-1, 0)); // state for the empty prefix
+        vector<int> currentRow;
+        map<pair<int, int>, set<pair<int, int>>> predecessors, successors;
+        set<int> nextRow;
+
+        currentRow.push_back(0);
+
+        for (int i = 0; i < numVars; i++) {
+            for (int j = 0; j < currentRow.size(); j++) {
+                for (int k = 0; k <= maxPadding[i]; k++) {
+                    int nextValue = currentRow[j] + k * coefficients[i];
+                    nextRow.insert(nextValue);
+                    states.insert(make_pair(i, nextValue));
+                    if (i == numVars - 1 && nextValue <= rhs) {
+                        acceptingStates.insert(make_pair(i, nextValue));
+                    }
+                }
             }
-            set<set<int>> clauses;
-            auto startEnc = chrono::high_resolution_clock::now();
-            if (AUTOMATON) {
-                profiler->automaton = true;
-
-                commons::profileToCsv(vector<RegularEncoding::EncodingProfiler>{*profiler}, "try_");
-
-                RegularEncoding::AutomatonProfiler aprofiler{};
-                RegularEncoding::AutomatonEncoder regEncoder(*recon, context, S, sigmaSize,
-                                                             &vIndices,
-                                                             &maxPadding, &tIndices, &variableVars, &constantsVars,
-                                                             index2t, aprofiler);
-                clauses = regEncoder.encode();
-                
-                profiler->automatonProfiler = aprofiler;
+            currentRow.clear();
+            currentRow.insert(currentRow.end(), nextRow.begin(), nextRow.end());
+            nextRow.clear();
+        }
+        if (out) {
+            (out << (Words::Solvers::Formatter("Created %d numStates for MDD! ") %
+                     states.size())
+                    .str())
+                    .endl();
+        }
+        // printf("c created %d numStates for MDD! \n", states.size());
+        // for(set<pair<int, int> >::iterator it = numStates.begin() ; it !=
+        // numStates.end();it++){ cout << "initial state: " << it->first << " " <<
+        // it->second << endl;
+        //  }
+
+        if (acceptingStates.size() == 0) {
+            return false;
+        }
+
+        set<pair<int, int>> markedStates;
+        vector<pair<int, int>> queue;
+        int nextIndex = 0;
+        // Mark final numStates
+        for (auto x: acceptingStates) {
+            markedStates.insert(x);
+            queue.push_back(x);
+        }
+        while (nextIndex < queue.size()) {
+            pair<int, int> currentState = queue[nextIndex];
+            nextIndex++;
+            int this_var = currentState.first;
+            if (this_var < 0) {
+                // Okay, I reached the root
+                markedStates.insert(currentState);
             } else {
-                profiler->automaton = false;
-                commons::profileToCsv(vector<RegularEncoding::EncodingProfiler>{*profiler}, "try_");
-                RegularEncoding::InductiveProfiler iprofiler{};
-                RegularEncoding::InductiveEncoder regEncoder(*recon, context, S, sigmaSize,
-                                                             &vIndices,
-                                                             &maxPadding, &tIndices, &variableVars, &constantsVars,
-                                                             index2t, iprofiler);
-                clauses = regEncoder.encode();
-                profiler->inductiveProfiler = iprofiler;
-                
+                assert(this_var >= 0 && this_var < numVars);
+                for (int j = 0; j <= maxPadding[this_var]; j++) {
+                    pair<int, int> predecessor = make_pair(
+                            this_var - 1, currentState.second - j * coefficients[this_var]);
+                    if (states.count(predecessor)) {
+                        if (markedStates.count(predecessor) == 0)
+                            queue.push_back(predecessor);
+
+                        markedStates.insert(predecessor);
+                        predecessors[currentState].insert(predecessor);
+                        successors[predecessor].insert(currentState);
+                    }
+                }
             }
-            auto stopEnc = chrono::high_resolution_clock::now();
-            auto encTime = chrono::duration_cast<chrono::milliseconds>(stopEnc-startEnc);
-            profiler->timeEncoding = encTime.count();
-
-            // Convert clauses and add to solver
-            for (const set<int> &cl: clauses) {
-                vec<Lit> clvec;
-                for (int l: cl) {
-                    int isneg = l < 0;
-                    Glucose::Lit lit = mkLit(abs(l));
-                    if (isneg) {
-                        clvec.push(~lit);
-                    } else {
-                        clvec.push(lit);
+        }
+        Words::Solvers::Formatter ff(
+                "have %1% marked numStates for linear constraint MDD!");
+        (out << (ff % markedStates.size()).str()).endl();
+        // printf("c have %d marked numStates! \n", markedStates.size());
+        map<pair<int, int>, Var> partialSumVariables;
+        for (set<pair<int, int>>::iterator it = markedStates.begin();
+             it != markedStates.end(); it++) {
+            partialSumVariables[*it] = s.newVar();
+        }
+        assert(partialSumVariables.count(make_pair(-1, 0)));
+        addBoundClause(s, mkLit(partialSumVariables[make_pair(-1, 0)]));
+
+        // Mark all accepting numStates active
+        for (auto x: acceptingStates) {
+            assert(partialSumVariables.count(x));
+            addBoundClause(s, mkLit(partialSumVariables[x]));
+        }
+
+        // Add clauses: A[i-1,j] /\ x_i = c -> A[i, j+a_i * c]
+        for (set<pair<int, int>>::iterator it = markedStates.begin();
+             it != markedStates.end(); it++) {
+            // cout << "Have marked state " << it->first << " " << it->second << " and "
+            // << s.nFreeVars() << " free variables" << endl;
+            int this_var = it->first + 1;
+            if (this_var >= numVars) {
+                assert(this_var == numVars);
+                assert(it->second <= rhs);
+                (out << "adding unit clause! ").endl();
+                addBoundClause(s, mkLit(partialSumVariables[*it]));
+            } else {
+                assert(this_var < (int) maxPadding.size());
+                int successorsFound = 0;
+                int lastVarAssignmentThatFit = -1;
+                for (int i = 0; i <= maxPadding[this_var]; i++) {
+                    int new_sum = it->second + i * coefficients[this_var];
+                    assert(states.count(make_pair(this_var, new_sum)));
+
+                    vec<Lit> ps;
+                    assert(partialSumVariables.count(*it));
+                    ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
+                    if (oneHotEncoding[this_var][i] == lit_Undef) {
+                        cout << "Cannot find oneHot for variable " << this_var
+                             << " and value " << i << endl;
+                    }
+                    assert(oneHotEncoding[this_var][i] != lit_Undef);
+                    ps.push(~oneHotEncoding[this_var][i]); // this_var=i
+
+                    if (markedStates.count(make_pair(this_var, new_sum))) {
+                        successorsFound++;
+                        assert(markedStates.count(make_pair(this_var, new_sum)));
+                        assert(partialSumVariables.count(make_pair(this_var, new_sum)));
+                        ps.push(mkLit(partialSumVariables[make_pair(this_var, new_sum)]));
+                        lastVarAssignmentThatFit = i;
+                    }
+                    if (!addBoundClause(s, ps)) {
+                        (out << "got false while adding a clause! ").endl();
                     }
                 }
-                S.addClause(clvec);
+                assert(successorsFound > 0);
+                if (successorsFound == 1) {
+                    assert(lastVarAssignmentThatFit >= 0);
+                    vec<Lit> ps;
+                    assert(partialSumVariables.count(*it));
+                    ps.push(~mkLit(partialSumVariables[*it])); // A[this_var-1,j]
+                    ps.push(oneHotEncoding[this_var]
+                                          [lastVarAssignmentThatFit]); // Only one successor. Thus, if A[i,j]
+                    // is active, this immediately implies
+                    // the value of x[i]
+                    addBoundClause(s, ps);
+                }
+            }
+        }
+        return true;
+    }
+
+    // quick unsat preprocessing
+    bool checkForUnsat() {
+        set<char> variableAlphabet;
+        set<char> terminalAlphabet;
+        for (int i = 0; i < input_equations_lhs.size(); i++) {
+            string lhs = input_equations_lhs[i];
+            string rhs = input_equations_rhs[i];
+
+            if (lhs.size() == 0 || rhs.size() == 0) {
+                continue;
             }
 
+            // prefix/suffix
+            if (characterMismatch(lhs, rhs)) {
+                return true;
+            }
+            // fetch parikhimages
+            map<char, vector<int>> p_lhs_pm, p_rhs_pm, s_lhs_pm, s_rhs_pm;
+            getAlphabets(lhs, rhs, variableAlphabet, terminalAlphabet);
+            getParikhMatrix(lhs, variableAlphabet, terminalAlphabet, p_lhs_pm,
+                            s_lhs_pm);
+            getParikhMatrix(rhs, variableAlphabet, terminalAlphabet, p_rhs_pm,
+                            s_rhs_pm);
+            if (lengthArgumentFail(lhs, rhs, p_lhs_pm, p_rhs_pm, s_lhs_pm, s_rhs_pm) ||
+                unweightedEquation(p_lhs_pm, p_rhs_pm, lhs.size(), rhs.size())) {
+                return true;
+            }
         }
+        return false;
+    }
 
+    Words::Solvers::Result
+    setupSolverMain(Words::Options &opt) { // std::vector<std::string>& mlhs,
+        // std::vector<std::string>& mrhs) {
+        clearIndexMaps();
+        clearIncremental();
+        vector<std::string> input_equations_lhs_tmp;
+        vector<std::string> input_equations_rhs_tmp;
 
+        // Preprocess regular constraints
         /*
-        for(int i = 0 ; i < input_equations_lhs.size();i++){
-          encodeEquation<newencode>(S, input_equations_lhs[i],
-        input_equations_rhs[i], true, squareAuto,wrap);
+        std::vector<std::shared_ptr<Words::RegularConstraints::RegConstraint>> preprocessed;
+        for (auto &recon: opt.recons) {
+            recon->expr->flatten();
+            auto strippedRecon = RegularEncoding::stripSuffix(RegularEncoding::stripPrefix(*recon));
+            preprocessed.push_back(std::make_shared<Words::RegularConstraints::RegConstraint>(strippedRecon));
         }
+        opt.recons = preprocessed;
         */
-        {
-            // Words::Solvers::Timing::Timer (tkeeper,"Encode word equations ");
-            for (auto &eq: input_options.equations) {
-                encodeEquation<newencode>(S, eq, true, squareAuto, wrap);
-            }
+
+        input_options = opt;
+
+        std::map<char, std::string> subsitutions;
+
+        for (auto &eq: opt.equations) {
+            readSymbols(eq.lhs);
+            readSymbols(eq.rhs);
         }
-    }
 
-    if (!S.simplify()) {
-        // if (S.certifiedOutput != NULL) fprintf(S.certifiedOutput, "0\n"),
-        // fclose(S.certifiedOutput);
-        if (S.verbosity > 0) {
-            // printf("c
-            // =========================================================================================================\n");
-            // printf("Solved by unit propagation\n");
-            // printStats(S);
-            // printf("\n");
-        }
-        return Words::Solvers::Result::NoSolution;
-        // printf("s UNSATISFIABLE\n");
+        for (auto rc: opt.recons) {
+
+            readSymbols(rc->pattern);
+
+            Words::Word exprAlph;
+            unique_ptr<Words::WordBuilder> wb = opt.context->makeWordBuilder(exprAlph);
+            rc->expr->getAlphabet(*wb);
+            wb->flush();
+            readSymbols(exprAlph);
+
+
+        }
+
+        return Words::Solvers::Result::NoIdea;
     }
 
-    vec<Lit> dummy;
-    // printf("c time for setting up everything: %lf\n", cpuTime());
-    // printf("c okay=%d\n", S.okay());
-    lbool ret;
-    {
-        Words::Solvers::Timing::Timer(tkeeper, "Solving");
-        auto startSolving = chrono::high_resolution_clock::now();
-        ret = S.solveLimited(dummy);
-        auto endSolving = chrono::high_resolution_clock::now();
-        auto durSolving = chrono::duration_cast<chrono::milliseconds>(endSolving - startSolving);
-        auto durTotal = chrono::duration_cast<chrono::milliseconds>(endSolving - startTotal);
-        profiler->timeSolving = durSolving.count();
-        profiler->timeTotal = durTotal.count();
-        if (ret == l_True) {
-            profiler->sat = true;
-        } else {
-            profiler->sat = false;
+    void addLinearConstraint(vector<pair<Words::Variable *, int>> lhs, int rhs) {
+        map<int, int> coefficients;
+        for (auto x: lhs) {
+            // NOT CORRECT, THIS NEEDS A FIX!!!!
+            if (vIndices.contains(x.first)) {
+                coefficients[vIndices.at(x.first)] = x.second;
+            }
         }
+
+        input_linears_lhs.push_back(coefficients);
+        input_linears_rhs.push_back(rhs);
     }
 
+    template<bool newencode = true>
+    ::Words::Solvers::Result runSolver(const bool squareAuto, size_t bound,
+                                       const Words::Context &context,
+                                       Words::Substitution &substitution,
+                                       Words::Solvers::Timing::Keeper &tkeeper,
+                                       std::ostream *odia = nullptr,
+                                       RegularEncoding::EncodingProfiler* profiler = nullptr) {
+
+        clear();
+        auto startTotal = chrono::high_resolution_clock::now();
+        {
+            // Words::Solvers::Timing::Timer overalltimer (tkeeper, "Setup ");
 
-    int stateVarsSeen = 0;
-    int stateVarsOverall = 0;
-    if (wrap) {
-        for (int t = 0; t < stateTables.size(); t++) {
-            vector<Var> &v = stateTables[t];
-            int nCols = stateTableColumns[t];
-            int nRows = stateTableRows[t];
-            (wrap << "print a " << nRows << " x " << nCols << " matrix...").endl();
-            int index = 0;
-            for (int i = 0; i < nRows; i++) {
-                for (int j = 0; j < nCols; j++) {
-                    stateVarsOverall++;
-                    assert(index == getIndex(nCols, i, j));
-                    if (S.varSeen[v[getIndex(nCols, i, j)]]) {
-                        stateVarsSeen++;
-                        wrap << "*";
-                    } else {
-                        wrap << " ";
+            globalMaxPadding = static_cast<int>(bound);
+            // Padding used for the i-th variable, i.e., the i-th variable will be filled with this value
+            maxPadding.assign(vIndices.size(), globalMaxPadding);
+        }
+        StreamWrapper wrap(odia);
+        bool fresh = !incrementalSolver;
+        if (fresh) {
+            std::lock_guard<std::mutex> lock(incrementalSolverMutex);
+            incrementalSolver = std::make_unique<BoundSolver>();
+            incrementalSolver->setIncrementalMode();
+            if (interruptRequested) {
+                incrementalSolver->interrupt();
+            }
+        }
+        BoundSolver &S = *incrementalSolver;
+        // Retire the clauses of the previous bound and guard the ones of this bound
+        if (boundSelector != lit_Undef) {
+            S.addClause(~boundSelector);
+            S.setDecisionVar(var(boundSelector), false);
+            for (Var v = firstBoundVar; v < S.nVars(); v++) {
+                S.setDecisionVar(v, false);
+            }
+            S.removeRetiredClauses();
+        }
+        boundSelector = mkLit(S.newVar());
+        std::cout << "===================\n";
+        int lin = 0, reg = 0, d = 0; // upper bound on length of variables
+        double initial_time = cpuTime();
+        if (fresh) {
+            trueConst = S.newVar();
+            S.addClause(mkLit(trueConst));
+            falseConst = S.newVar();
+            S.addClause(~mkLit(falseConst));
+        }
+
+        // assert(lin == 0 && "No linears yet! ");
+        assert(reg == 0 && "No regulars yet! ");
+
+        {
+            // Words::Solvers::Timing::Timer (tkeeper,"Sharpen Bounds ");
+            for (auto &eq: input_options.equations) {
+                sharpenBounds(S, eq, wrap);
+            }
+        }
+
+        int numVars;
+        {
+            std::stringstream ss;
+            ss << "Encoding [bound: " << bound << ", variables : "
+               << input_options.context->getVariableAlphabet().size()
+               << ", equations: " << input_options.equations.size() << "]";
+
+            Words::Solvers::Timing::Timer overalltimer(tkeeper, ss.str());
+            Words::Solvers::Timing::Timer bla(tkeeper, "Encoding total ");
+            index2t[sigmaSize] = context.getEpsilon();
+            numVars = vIndices.size();
+
+            for (int i = 0; i < numVars; i++) {
+                (wrap << "bound for " << index2v[i]->getRepr() << ": " << maxPadding[i])
+                        .endl();
+            }
+            // Encode variables for terminal symbols
+
+            if (fresh) {
+                // Words::Solvers::Timing::Timer shit (tkeeper,"Encode constants ");
+                // C_{i,j}
+                constantsVars.reset(sigmaSize + 1);
+                variableVars.reset(numVars, sigmaSize + 1);
+                allocatedPadding.assign(numVars, 0);
+                for (int i = 0; i <= sigmaSize; i++) {
+                    for (int j = 0; j <= sigmaSize; j++) {
+                        Var v = S.newVar();
+                        constantsVars(i, j) = v;
+                        // Make variable "true" if i=j, and false otherwise
+                        if (i == j)
+                            S.addClause(mkLit(v));
+                        else
+                            S.addClause(~mkLit(v));
                     }
-                    index++;
                 }
-                (wrap << "|" << i).endl();
             }
-            assert(index == v.size());
-            // wrap << endl;
-        }
-    }
-    if (wrap) {
-        Words::Solvers::Formatter ff("saw %1% out of %2% state variables! ");
-        (wrap << (ff % stateVarsSeen % stateVarsOverall).str())
-                .endl(); //<< std::endl;
-        // std::cout << "c Saw " << stateVarsSeen << " out of " << stateVarsOverall
-        // << " variables!" << std::endl;
-    }
 
-    if (S.showModel && ret == l_True) {
-        // printf("v ");
-        // for (int i = 0; i < S.nVars(); i++)
-        // if (S.model[i] != l_Undef)
-        // printf("%s%s%d", (i==0)?"":" ", (S.model[i]==l_True)?"":"-", i+1);
-        // printf(" 0\n");
-    }
+            // Take a variable, and index and a sigma, and return if the variable at
+            // index "i" equals sigma g:  x, i, sigma -> BV
+            // Positions allocated for an earlier bound are kept, only the missing
+            // ones are added.
+
+            {
+                Words::Solvers::Timing::Timer (tkeeper,"Encode variables ");
+                if (numVars > 0)
+                    variableVars.reservePositions(*std::max_element(maxPadding.begin(), maxPadding.end()));
+                for (int i = 0; i < numVars; i++) {
+                    assert(i < (int) maxPadding.size());
+                    int allocated = allocatedPadding[i];
+                    for (int j = allocated; j < maxPadding[i]; j++) {
+                        for (int k = 0; k <= sigmaSize; k++) {
+                            Var v = S.newVar();
+                            variableVars(i, j, k) = v;
+                        }
+                    }
 
-    if (ret == l_True) {
-        // Got a solution
-        // Pick up the substitution and convert it to something the main solver
-        // understands
-        substitution.clear();
-        for (int i = 0; i < numVars; i++) {
-            assert(maxPadding.count(i));
-            std::vector<Words::IEntry *> sub;
-            for (int j = 0; j < maxPadding[i]; j++) {
-                for (int k = 0; k < sigmaSize; k++) {
-                    if (S.modelValue(variableVars[make_pair(make_pair(i, j), k)]) ==
-                        l_True) {
-                        sub.push_back(index2t[k]);
+                    // Assert that epsilons occur at the end of a substitution
+                    for (int j = std::max(allocated - 1, 0); j + 1 < maxPadding[i]; j++) {
+                        S.addClause(
+                                ~mkLit(variableVars(i, j, sigmaSize)),
+                                mkLit(variableVars(i, j + 1, sigmaSize)));
+                    }
+
+                    // Alldifferent: Make sure that each variable is assigned to exactly one
+                    // letter from Sigma (or epsilon)
+                    // TODO: Do this with linear number of clauses (!!!)
+                    for (int j = allocated; j < maxPadding[i]; j++) {
+                        vec<Lit> ps;
+                        for (int k = 0; k <= sigmaSize; k++) {
+                            assert(variableVars.contains(i, j, k));
+                            ps.push(mkLit(variableVars(i, j, k)));
+                            for (int l = k + 1; l <= sigmaSize; l++) {
+                                assert(variableVars.contains(i, j, l));
+                                S.addClause(~mkLit(variableVars(i, j, k)),
+                                            ~mkLit(variableVars(i, j, l)));
+                            }
+                        }
+                        S.addClause(ps);
                     }
+
+                    if (maxPadding[i] > allocated) {
+                        allocatedPadding[i] = maxPadding[i];
+                    } else if (allocated > std::max(maxPadding[i], 0)) {
+                        // The bound is sharper than an earlier one: cut off the
+                        // surplus positions for this bound only
+                        addBoundClause(S, mkLit(variableVars(i, std::max(maxPadding[i], 0), sigmaSize)));
+                    }
+                }
+            }
+
+
+            // Everything below is owned by this bound
+            firstBoundVar = S.nVars();
+
+            {
+                // Words::Solvers::Timing::Timer (tkeeper,"Encode OneHot ");
+                addOneHotEncoding(S);
+            }
+
+            {
+                // Words::Solvers::Timing::Timer (tkeeper,"Encode length abstraction ");
+                for (auto &eq: input_options.equations) {
+                    bool succ = addSizeEqualityConstraint(S, eq, wrap);
+                    if (!succ) {
+                        return Words::Solvers::Result::NoSolution;
+                    }
+                }
+            }
+
+            {
+                // linears
+                // Words::Solvers::Timing::Timer (tkeeper,"Encode linear constraints ");
+                for (int i = 0; i < input_linears_lhs.size(); i++) {
+                    // quick check whether a linear constraint can be satisfiable using the
+                    // given bounds
+                    /* int lhsValue = 0;
+                     for (auto x : input_linears_lhs[i]){
+                             lhsValue=lhsValue+(maxPadding[x.first]*x.second);
+                     }
+                     cout << lhsValue << " " << input_linears_rhs[i] << endl;
+                    */
+                    // true?
+                    /* if (lhsValue > input_linears_rhs[i]){
+                             return Words::Solvers::Result::NoSolution;
+                     //DefinitelyNoSolution;
+                     }*/
+
+                    bool succ = addLinearEqualityConstraint(S, input_linears_lhs[i],
+                                                            input_linears_rhs[i], wrap);
+                    if (!succ) {
+                        return Words::Solvers::Result::NoSolution;
+                    }
+                }
+            }
+
+
+            bool AUTOMATON = true;
+
+            //Handle regular constraints
+            cout << "Current bound: " << bound << "\n";
+            profiler->bound = (int) bound;
+
+
+            for (const auto &recon: input_options.recons) {
+                if (recon->triviallySat) {
+                    continue;
+                }
+                //auto strippedRecon = RegularEncoding::stripSuffix(RegularEncoding::stripPrefix(*recon));
+                profiler->exprComplexity = (int) recon->expr->complexity();
+                profiler->starHeight = recon->expr->starHeight();
+                profiler->numStars = recon->expr->numStars();
+                profiler->depth = recon->expr->depth();
+                profiler->longestLiteral = recon->expr->longestLiteral();
+                profiler->shortestLiteral = recon->expr->shortestLiteral();
+                if (recon->expr->isEmpty()) {
+                    cout << recon->expr->toString();
+                    return Words::Solvers::Result::DefinitelyNoSolution; 
+                }
+                BoundClauseSink clauses(*this, S);
+                auto startEnc = chrono::high_resolution_clock::now();
+                if (AUTOMATON) {
+                    profiler->automaton = true;
+
+                    commons::profileToCsv(vector<RegularEncoding::EncodingProfiler>{*profiler}, "try_");
+
+                    RegularEncoding::AutomatonProfiler aprofiler{};
+                    RegularEncoding::AutomatonEncoder regEncoder(*recon, context, S, sigmaSize,
+                                                                 &vIndices,
+                                                                 &maxPadding, &tIndices, &variableVars, &constantsVars,
+                                                                 index2t, automata, aprofiler);
+                    regEncoder.encode(clauses);
+
+                    profiler->automatonProfiler = aprofiler;
+                } else {
+                    profiler->automaton = false;
+                    commons::profileToCsv(vector<RegularEncoding::EncodingProfiler>{*profiler}, "try_");
+                    RegularEncoding::InductiveProfiler iprofiler{};
+                    RegularEncoding::InductiveEncoder regEncoder(*recon, context, S, sigmaSize,
+                                                                 &vIndices,
+                                                                 &maxPadding, &tIndices, &variableVars, &constantsVars,
+                                                                 index2t, iprofiler);
+                    regEncoder.encode(clauses);
+                    profiler->inductiveProfiler = iprofiler;
+
+                }
+                auto stopEnc = chrono::high_resolution_clock::now();
+                auto encTime = chrono::duration_cast<chrono::milliseconds>(stopEnc-startEnc);
+                profiler->timeEncoding = encTime.count();
+
+            }
+
+
+            /*
+            for(int i = 0 ; i < input_equations_lhs.size();i++){
+              encodeEquation<newencode>(S, input_equations_lhs[i],
+            input_equations_rhs[i], true, squareAuto,wrap);
+            }
+            */
+            {
+                // Words::Solvers::Timing::Timer (tkeeper,"Encode word equations ");
+                for (auto &eq: input_options.equations) {
+                    encodeEquation<newencode>(S, eq, true, squareAuto, wrap);
                 }
             }
-            substitution[index2v[i]] = std::move(sub);
+        }
+
+        if (!S.simplify() || S.refutedByPropagation(boundSelector)) {
+            // if (S.certifiedOutput != NULL) fprintf(S.certifiedOutput, "0\n"),
+            // fclose(S.certifiedOutput);
+            if (S.verbosity > 0) {
+                // printf("c
+                // =========================================================================================================\n");
+                // printf("Solved by unit propagation\n");
+                // printStats(S);
+                // printf("\n");
+            }
+            return Words::Solvers::Result::NoSolution;
+            // printf("s UNSATISFIABLE\n");
+        }
+
+        vec<Lit> assumptions;
+        assumptions.push(boundSelector);
+        // printf("c time for setting up everything: %lf\n", cpuTime());
+        // printf("c okay=%d\n", S.okay());
+        lbool ret;
+        {
+            Words::Solvers::Timing::Timer(tkeeper, "Solving");
+            auto startSolving = chrono::high_resolution_clock::now();
+            ret = S.solveLimited(assumptions);
+            auto endSolving = chrono::high_resolution_clock::now();
+            auto durSolving = chrono::duration_cast<chrono::milliseconds>(endSolving - startSolving);
+            auto durTotal = chrono::duration_cast<chrono::milliseconds>(endSolving - startTotal);
+            profiler->timeSolving = durSolving.count();
+            profiler->timeTotal = durTotal.count();
+            if (ret == l_True) {
+                profiler->sat = true;
+            } else {
+                profiler->sat = false;
+            }
         }
 
 
+        int stateVarsSeen = 0;
+        int stateVarsOverall = 0;
         if (wrap) {
             for (int t = 0; t < stateTables.size(); t++) {
                 vector<Var> &v = stateTables[t];
+                int nCols = stateTableColumns[t];
+                int nRows = stateTableRows[t];
+                (wrap << "print a " << nRows << " x " << nCols << " matrix...").endl();
                 int index = 0;
-                for (int i = 0; i < stateTableRows[t]; i++) {
-                    for (int j = 0; j < stateTableColumns[t]; j++) {
-
-                        assert(index == getIndex(stateTableColumns[t], i, j));
-                        if (S.modelValue(v[index]) == l_True) {
+                for (int i = 0; i < nRows; i++) {
+                    for (int j = 0; j < nCols; j++) {
+                        stateVarsOverall++;
+                        assert(index == getIndex(nCols, i, j));
+                        if (S.varSeen[v[getIndex(nCols, i, j)]]) {
+                            stateVarsSeen++;
                             wrap << "*";
-                        } else if (S.modelValue(v[index]) == l_False) {
+                        } else {
                             wrap << " ";
-                        } else
-                            wrap << "?";
+                        }
                         index++;
                     }
                     (wrap << "|" << i).endl();
                 }
-                wrap.endl();
+                assert(index == v.size());
+                // wrap << endl;
             }
         }
+        if (wrap) {
+            Words::Solvers::Formatter ff("saw %1% out of %2% state variables! ");
+            (wrap << (ff % stateVarsSeen % stateVarsOverall).str())
+                    .endl(); //<< std::endl;
+            // std::cout << "c Saw " << stateVarsSeen << " out of " << stateVarsOverall
+            // << " variables!" << std::endl;
+        }
+
+        if (S.showModel && ret == l_True) {
+            // printf("v ");
+            // for (int i = 0; i < S.nVars(); i++)
+            // if (S.model[i] != l_Undef)
+            // printf("%s%s%d", (i==0)?"":" ", (S.model[i]==l_True)?"":"-", i+1);
+            // printf(" 0\n");
+        }
 
-        return Words::Solvers::Result::HasSolution;
+        if (ret == l_True) {
+            // Got a solution
+            // Pick up the substitution and convert it to something the main solver
+            // understands
+            substitution.clear();
+            for (int i = 0; i < numVars; i++) {
+                assert(i < (int) maxPadding.size());
+                std::vector<Words::IEntry *> sub;
+                for (int j = 0; j < maxPadding[i]; j++) {
+                    for (int k = 0; k < sigmaSize; k++) {
+                        if (S.modelValue(variableVars(i, j, k)) ==
+                            l_True) {
+                            sub.push_back(index2t[k]);
+                        }
+                    }
+                }
+                substitution[index2v[i]] = std::move(sub);
+            }
+
+
+            if (wrap) {
+                for (int t = 0; t < stateTables.size(); t++) {
+                    vector<Var> &v = stateTables[t];
+                    int index = 0;
+                    for (int i = 0; i < stateTableRows[t]; i++) {
+                        for (int j = 0; j < stateTableColumns[t]; j++) {
+
+                            assert(index == getIndex(stateTableColumns[t], i, j));
+                            if (S.modelValue(v[index]) == l_True) {
+                                wrap << "*";
+                            } else if (S.modelValue(v[index]) == l_False) {
+                                wrap << " ";
+                            } else
+                                wrap << "?";
+                            index++;
+                        }
+                        (wrap << "|" << i).endl();
+                    }
+                    wrap.endl();
+                }
+            }
+
+            return Words::Solvers::Result::HasSolution;
+        }
+
+        return Words::Solvers::Result::NoIdea;
     }
+};
 
-    return Words::Solvers::Result::NoIdea;
+EncodingContext::EncodingContext() : state(std::make_unique<State>()) {}
+
+EncodingContext::~EncodingContext() = default;
+
+Words::Solvers::Result EncodingContext::setupSolverMain(Words::Options &opt) {
+    return state->setupSolverMain(opt);
+}
+
+void EncodingContext::clearLinears() {
+    state->clearLinears();
+}
+
+void EncodingContext::addLinearConstraint(vector<pair<Words::Variable *, int>> lhs, int rhs) {
+    state->addLinearConstraint(std::move(lhs), rhs);
 }
 
+void EncodingContext::interruptSolver() {
+    state->interruptSolver();
+}
+
+void EncodingContext::resetInterrupt() {
+    state->resetInterrupt();
+}
+
+template<bool newencode>
+::Words::Solvers::Result EncodingContext::runSolver(const bool squareAuto, size_t bound,
+                                                    const Words::Context &context,
+                                                    Words::Substitution &substitution,
+                                                    Words::Solvers::Timing::Keeper &tkeeper,
+                                                    std::ostream *odia,
+                                                    RegularEncoding::EncodingProfiler *profiler) {
+    return state->runSolver<newencode>(squareAuto, bound, context, substitution, tkeeper, odia, profiler);
+}
 
 template ::Words::Solvers::Result
-runSolver<true>(const bool squareAuto, size_t, const Words::Context &,
-                Words::Substitution &, Words::Solvers::Timing::Keeper &,
-                std::ostream *, RegularEncoding::EncodingProfiler*);
+EncodingContext::runSolver<true>(const bool squareAuto, size_t, const Words::Context &,
+                                 Words::Substitution &, Words::Solvers::Timing::Keeper &,
+                                 std::ostream *, RegularEncoding::EncodingProfiler*);
 
 template ::Words::Solvers::Result
-runSolver<false>(const bool squareAuto, size_t, const Words::Context &,
-                 Words::Substitution &, Words::Solvers::Timing::Keeper &,
-                 std::ostream *, RegularEncoding::EncodingProfiler*);
+EncodingContext::runSolver<false>(const bool squareAuto, size_t, const Words::Context &,
+                                  Words::Substitution &, Words::Solvers::Timing::Keeper &,
+                                  std::ostream *, RegularEncoding::EncodingProfiler*);
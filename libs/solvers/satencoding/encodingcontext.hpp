@@ -0,0 +1,51 @@
+#ifndef _SAT_ENCODINGCONTEXT__
+#define _SAT_ENCODINGCONTEXT__
+
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "solvers/timing.hpp"
+#include "regular/regencoding.h"
+
+// The SAT encoding of one instance: symbol indices, linear constraints and the
+// incremental SAT solver kept alive across the bounds. Contexts share no
+// state, so different contexts can be used from different threads at the
+// same time. A single context must not, except for interruptSolver and
+// resetInterrupt.
+class EncodingContext {
+public:
+    EncodingContext();
+
+    ~EncodingContext();
+
+    // Reads the symbols of the instance and starts a fresh SAT solver
+    Words::Solvers::Result setupSolverMain(Words::Options &opt);
+
+    void clearLinears();
+
+    void addLinearConstraint(std::vector<std::pair<Words::Variable *, int>> lhs, int rhs);
+
+    // Encodes and solves the instance for the given bound, reusing the solver
+    // of the previous (smaller) bound
+    template<bool newencode>
+    Words::Solvers::Result runSolver(const bool squareAuto, size_t bound, const Words::Context &,
+                                     Words::Substitution &, Words::Solvers::Timing::Keeper &,
+                                     std::ostream * = nullptr,
+                                     RegularEncoding::EncodingProfiler * = nullptr);
+
+    // Makes the running runSolver call return NoIdea, as well as those started
+    // before the next resetInterrupt
+    void interruptSolver();
+
+    void resetInterrupt();
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+#endif
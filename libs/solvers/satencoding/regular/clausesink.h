@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+#include <initializer_list>
+#include <unordered_set>
+#include <vector>
+
+#include "core/Solver.h"
+
+namespace RegularEncoding {
+
+/**
+ * Receives the clauses of an encoding one at a time.
+ * Literals are integers as in DIMACS, -v is the negation of the Glucose variable v.
+ * In deduplication mode repeated literals, tautologies and clauses that were
+ * emitted before are dropped.
+ */
+class ClauseSink {
+   public:
+    explicit ClauseSink(bool deduplicate = false) : deduplicate(deduplicate) {}
+
+    virtual ~ClauseSink() = default;
+
+    // Appends a literal to the current clause
+    void push(int lit) { clause.push_back(lit); }
+
+    // Emits the literals pushed since the last commit as one clause
+    void commit() {
+        if (!deduplicate || normalize()) {
+            numClauses++;
+            numLiterals += clause.size();
+            emit(clause);
+        }
+        clause.clear();
+    }
+
+    void addClause(std::initializer_list<int> lits) {
+        clause.insert(clause.end(), lits);
+        commit();
+    }
+
+    size_t clauses() const { return numClauses; }
+
+    size_t literals() const { return numLiterals; }
+
+   protected:
+    virtual void emit(const std::vector<int> &clause) = 0;
+
+   private:
+    // Sorts the current clause, returns false if it is a tautology or was seen before
+    bool normalize() {
+        std::sort(clause.begin(), clause.end(), [](int a, int b) { return std::abs(a) < std::abs(b) || (std::abs(a) == std::abs(b) && a < b); });
+        clause.erase(std::unique(clause.begin(), clause.end()), clause.end());
+        for (size_t i = 0; i + 1 < clause.size(); i++) {
+            if (clause[i] == -clause[i + 1]) {
+                return false;
+            }
+        }
+        return seen.insert(clause).second;
+    }
+
+    struct ClauseHash {
+        size_t operator()(const std::vector<int> &c) const {
+            size_t h = c.size();
+            for (int l : c) {
+                h ^= std::hash<int>()(l) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+    };
+
+    bool deduplicate;
+    std::vector<int> clause;
+    std::unordered_set<std::vector<int>, ClauseHash> seen;
+    size_t numClauses = 0;
+    size_t numLiterals = 0;
+};
+
+/**
+ * Adds the clauses directly to a solver.
+ */
+class SolverSink : public ClauseSink {
+   public:
+    explicit SolverSink(Glucose::Solver &solver, bool deduplicate = false) : ClauseSink(deduplicate), solver(solver) {}
+
+   protected:
+    void emit(const std::vector<int> &clause) override {
+        lits.clear();
+        for (int l : clause) {
+            lits.push(l < 0 ? ~Glucose::mkLit(-l) : Glucose::mkLit(l));
+        }
+        add(lits);
+    }
+
+    virtual void add(Glucose::vec<Glucose::Lit> &lits) { solver.addClause_(lits); }
+
+    Glucose::Solver &solver;
+
+   private:
+    Glucose::vec<Glucose::Lit> lits;
+};
+
+/**
+ * Collects the clauses in one flat literal array, clause i spans [begin(i), end(i)).
+ */
+class ClauseBuffer : public ClauseSink {
+   public:
+    explicit ClauseBuffer(bool deduplicate = false) : ClauseSink(deduplicate) {}
+
+    size_t size() const { return ends.size(); }
+
+    const int *begin(size_t i) const { return lits.data() + (i == 0 ? 0 : ends[i - 1]); }
+
+    const int *end(size_t i) const { return lits.data() + ends[i]; }
+
+   protected:
+    void emit(const std::vector<int> &clause) override {
+        lits.insert(lits.end(), clause.begin(), clause.end());
+        ends.push_back(lits.size());
+    }
+
+   private:
+    std::vector<int> lits;
+    std::vector<size_t> ends;
+};
+
+}  // namespace RegularEncoding
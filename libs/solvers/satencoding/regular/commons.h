@@ -5,6 +5,7 @@
 #include <iostream>
 #include <numeric>
 #include <functional>
+#include <mutex>
 #include <algorithm>
 #include <sys/stat.h>
 
@@ -167,6 +168,9 @@ namespace commons {
 
 
     void profileToCsv(const std::vector<RegularEncoding::EncodingProfiler> &profiles, string prefix = "") {
+        // Bounds raced on several threads are profiled concurrently
+        static std::mutex fileMutex;
+        std::lock_guard<std::mutex> lock(fileMutex);
         std::ofstream outfile;
 
         if (profiles.empty()) {
@@ -2,6 +2,7 @@
 #include "core/Solver.h"
 #include "nfa.h"
 #include "regencoding.h"
+#include "vartables.h"
 #include "words/regconstraints.hpp"
 #include "words/words.hpp"
 
@@ -32,8 +33,8 @@ int numTerminals(std::vector<FilledPos> &pat, int from = 0, int to = -1);
 
 class Encoder {
    public:
-    Encoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, std::map<Words::Variable *, int> *vIndices, std::map<int, int> *maxPadding,
-            std::map<Words::Terminal *, int> *tIndices, std::map<std::pair<std::pair<int, int>, int>, Glucose::Var> *variableVars, std::map<std::pair<int, int>, Glucose::Var> *constantsVars,
+    Encoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, const SymbolIndices<Words::Variable> *vIndices, const std::vector<int> *maxPadding,
+            const SymbolIndices<Words::Terminal> *tIndices, const VariableTable *variableVars, const ConstantTable *constantsVars,
             std::map<int, Words::Terminal *> &index2t)
         : constraint(std::move(constraint)),
           ctx(ctx),
@@ -56,37 +57,41 @@ class Encoder {
 
     virtual ~Encoder(){};
 
-    virtual std::set<std::set<int>> encode(){};
+    // Emits the clauses of the constraint into the sink
+    virtual void encode(ClauseSink &){};
 
     std::vector<FilledPos> filledPattern(const Words::Word &);
 
    protected:
     Words::RegularConstraints::RegConstraint constraint;
     Words::Context ctx;
-    std::map<Words::Variable *, int> *vIndices;
-    std::map<Words::Terminal *, int> *tIndices;
-    std::map<int, int> *maxPadding;
-    std::map<std::pair<std::pair<int, int>, int>, Glucose::Var> *variableVars;
-    std::map<std::pair<int, int>, Glucose::Var> *constantsVars;
+    const SymbolIndices<Words::Variable> *vIndices;
+    const SymbolIndices<Words::Terminal> *tIndices;
+    const std::vector<int> *maxPadding;
+    const VariableTable *variableVars;
+    const ConstantTable *constantsVars;
     Glucose::Solver &solver;
     int sigmaSize;
     std::map<int, Words::Terminal *> &index2t;
 
+    // Formulas of this encoder live in their own arena, freed with the encoder
+    PropositionalLogic::FormulaArena::Scope formulas;
+
     PropositionalLogic::PLFormula ffalse;
     PropositionalLogic::PLFormula ftrue;
 };
 
 class InductiveEncoder : public Encoder {
    public:
-    InductiveEncoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, std::map<Words::Variable *, int> *vIndices,
-                     std::map<int, int> *maxPadding, std::map<Words::Terminal *, int> *tIndices, std::map<std::pair<std::pair<int, int>, int>, Glucose::Var> *variableVars,
-                     std::map<std::pair<int, int>, Glucose::Var> *constantsVars, std::map<int, Words::Terminal *> &index2t, InductiveProfiler &profiler)
+    InductiveEncoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, const SymbolIndices<Words::Variable> *vIndices,
+                     const std::vector<int> *maxPadding, const SymbolIndices<Words::Terminal> *tIndices, const VariableTable *variableVars,
+                     const ConstantTable *constantsVars, std::map<int, Words::Terminal *> &index2t, InductiveProfiler &profiler)
         : Encoder(constraint, ctx, solver, sigmaSize, vIndices, maxPadding, tIndices, variableVars, constantsVars, index2t),
           profiler(profiler){
 
           };
 
-    std::set<std::set<int>> encode();
+    void encode(ClauseSink &sink);
 
    private:
     PropositionalLogic::PLFormula doEncode(const std::vector<FilledPos> &, const std::shared_ptr<Words::RegularConstraints::RegNode> &expression);
@@ -103,19 +108,53 @@ class InductiveEncoder : public Encoder {
 
     // std::unordered_map<size_t, PropositionalLogic::PLFormula*> ccache;
     InductiveProfiler &profiler;
+    // Encodings skipped due to the length abstraction
+    int skipped = 0;
+};
+
+/**
+ * The bound independent part of the automaton encoding of a regular expression.
+ */
+struct CompiledAutomaton {
+    // Epsilon-free NFA of the expression
+    Automaton::NFA nfa;
+    // Membership checks against nfa
+    std::unique_ptr<Automaton::Simulator> simulator;
+    // Trimmed nfa with an epsilon self-loop on every state, including its length abstraction
+    Automaton::NFA filled;
+    bool acceptsNothing = false;
+};
+
+/**
+ * Compiled automata by regular expression, shared by all encoders of a job.
+ * Entries are keyed by RegNode::hash, the textual form of the expression resolves collisions.
+ */
+class AutomatonCache {
+   public:
+    std::shared_ptr<CompiledAutomaton> find(Words::RegularConstraints::RegNode &expr);
+
+    void insert(Words::RegularConstraints::RegNode &expr, std::shared_ptr<CompiledAutomaton> compiled);
+
+    void clear() { entries.clear(); }
+
+    size_t size() const { return entries.size(); }
+
+   private:
+    std::unordered_multimap<size_t, std::pair<std::string, std::shared_ptr<CompiledAutomaton>>> entries;
 };
 
 class AutomatonEncoder : public Encoder {
    public:
-    AutomatonEncoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, std::map<Words::Variable *, int> *vIndices,
-                     std::map<int, int> *maxPadding, std::map<Words::Terminal *, int> *tIndices, std::map<std::pair<std::pair<int, int>, int>, Glucose::Var> *variableVars,
-                     std::map<std::pair<int, int>, Glucose::Var> *constantsVars, std::map<int, Words::Terminal *> &index2t, AutomatonProfiler &profiler)
+    AutomatonEncoder(Words::RegularConstraints::RegConstraint constraint, Words::Context ctx, Glucose::Solver &solver, int sigmaSize, const SymbolIndices<Words::Variable> *vIndices,
+                     const std::vector<int> *maxPadding, const SymbolIndices<Words::Terminal> *tIndices, const VariableTable *variableVars,
+                     const ConstantTable *constantsVars, std::map<int, Words::Terminal *> &index2t, AutomatonCache &automata, AutomatonProfiler &profiler)
         : Encoder(constraint, ctx, solver, sigmaSize, vIndices, maxPadding, tIndices, variableVars, constantsVars, index2t),
+          automata(automata),
           profiler(profiler){
 
           };
 
-    std::set<std::set<int>> encode();
+    void encode(ClauseSink &sink);
 
    private:
     PropositionalLogic::PLFormula encodeTransition(Automaton::NFA &Mxi, std::vector<FilledPos> filledPat);
@@ -126,17 +165,20 @@ class AutomatonEncoder : public Encoder {
 
     PropositionalLogic::PLFormula encodeInitial(Automaton::NFA &nfa);
 
-    PropositionalLogic::PLFormula encodePredNew(Automaton::NFA &Mxi, std::vector<FilledPos> filledPat, int q, int i, std::set<std::pair<int, int>> &,
-                                                std::map<int, std::set<std::pair<Words::Terminal *, int>>> &);
+    PropositionalLogic::PLFormula encodePredNew(Automaton::NFA &Mxi, std::vector<FilledPos> &filledPat, int q, int i, std::set<std::pair<int, int>> &);
 
     Automaton::NFA filledAutomaton(Automaton::NFA &nfa);
 
+    std::shared_ptr<CompiledAutomaton> compile(Words::RegularConstraints::RegNode &expr);
+
     std::map<std::pair<int, int>, int> stateVars{};
 
     std::unordered_map<int, std::shared_ptr<LengthAbstraction::ArithmeticProgressions>> satewiseLengthAbstraction{};
 
     std::map<int, std::shared_ptr<std::set<int>>> reachable;
 
+    AutomatonCache &automata;
+
     AutomatonProfiler &profiler;
 };
 
@@ -1,4 +1,5 @@
 #include "regencoding.h"
+#include <thread>
 
 using namespace Words::RegularConstraints;
 using namespace Words;
@@ -25,39 +26,86 @@ void NFA::add_final_state(int qf) {
     final_states.insert(qf);
 }
 
-map<int, vector<pair<Terminal *, int>>> NFA::offset_delta(int of) {
-    map<int, vector<pair<Terminal *, int>>> newDelta{};
-    for (const auto &trans : delta) {
-        int q_src = trans.first + of;
-        for (auto target : trans.second) {
-            Terminal *label = target.first;
-            int q_target = target.second + of;
-            if (newDelta.count(q_src) == 1) {
-                newDelta[q_src].push_back(make_pair(label, q_target));
-            } else {
-                vector<pair<Terminal *, int>> newTrans{make_pair(label, q_target)};
-                newDelta[q_src] = newTrans;
-            }
+void NFA::embed(NFA &M, int of) {
+    for (int q = 0; q < M.numStates(); q++) {
+        for (auto &target : M.successors(q)) {
+            add_transition(q + of, target.first, target.second + of);
+        }
+        for (int qtarget : M.epsilonSuccessors(q)) {
+            add_eps_transition(q + of, qtarget + of);
         }
     }
-    return newDelta;
 }
 
-map<int, set<int>> NFA::offset_delta_epsilon(int of) {
-    map<int, set<int>> newDelta{};
-    for (const auto &trans : deltaEpsilon) {
-        int q_src = trans.first + of;
-        for (auto target : trans.second) {
-            int q_target = target + of;
-            if (newDelta.count(q_src) == 1) {
-                newDelta[q_src].insert(q_target);
-            } else {
-                set<int> newTrans{q_target};
-                newDelta[q_src] = newTrans;
-            }
+void NFA::compact() {
+    if (pending.empty() && pendingEps.empty() && (int)outStart.size() == nQ + 1) {
+        return;
+    }
+
+    // Merge the pending transitions into the forward index
+    vector<pair<int, Edge>> all;
+    all.reserve(out.size() + pending.size());
+    for (int q = 0; q + 1 < (int)outStart.size(); q++) {
+        for (int k = outStart[q]; k < outStart[q + 1]; k++) {
+            all.emplace_back(q, out[k]);
         }
     }
-    return newDelta;
+    all.insert(all.end(), pending.begin(), pending.end());
+    pending.clear();
+    sort(all.begin(), all.end());
+    all.erase(unique(all.begin(), all.end()), all.end());
+
+    outStart.assign(nQ + 1, 0);
+    out.clear();
+    out.reserve(all.size());
+    for (auto &trans : all) {
+        outStart[trans.first + 1]++;
+        out.push_back(trans.second);
+    }
+    for (int q = 0; q < nQ; q++) {
+        outStart[q + 1] += outStart[q];
+    }
+
+    // Reverse index
+    inStart.assign(nQ + 1, 0);
+    for (auto &trans : all) {
+        inStart[trans.second.second + 1]++;
+    }
+    for (int q = 0; q < nQ; q++) {
+        inStart[q + 1] += inStart[q];
+    }
+    in.resize(all.size());
+    vector<int> fill(inStart.begin(), inStart.end() - 1);
+    for (auto &trans : all) {
+        in[fill[trans.second.second]++] = make_pair(trans.second.first, trans.first);
+    }
+    for (int q = 0; q < nQ; q++) {
+        sort(in.begin() + inStart[q], in.begin() + inStart[q + 1]);
+    }
+
+    // Epsilon transitions
+    vector<pair<int, int>> allEps;
+    allEps.reserve(eps.size() + pendingEps.size());
+    for (int q = 0; q + 1 < (int)epsStart.size(); q++) {
+        for (int k = epsStart[q]; k < epsStart[q + 1]; k++) {
+            allEps.emplace_back(q, eps[k]);
+        }
+    }
+    allEps.insert(allEps.end(), pendingEps.begin(), pendingEps.end());
+    pendingEps.clear();
+    sort(allEps.begin(), allEps.end());
+    allEps.erase(unique(allEps.begin(), allEps.end()), allEps.end());
+
+    epsStart.assign(nQ + 1, 0);
+    eps.clear();
+    eps.reserve(allEps.size());
+    for (auto &trans : allEps) {
+        epsStart[trans.first + 1]++;
+        eps.push_back(trans.second);
+    }
+    for (int q = 0; q < nQ; q++) {
+        epsStart[q + 1] += epsStart[q];
+    }
 }
 
 void NFA::add_transition(int src_q, Terminal *label, int target_q) {
@@ -69,12 +117,7 @@ void NFA::add_transition(int src_q, Terminal *label, int target_q) {
         ss << "Invalid target state " << target_q << ", nQ is " << nQ << endl;
         throw runtime_error(ss.str());
     }
-    if (delta.count(src_q) == 1) {
-        delta[src_q].insert(make_pair(label, target_q));
-    } else {
-        set<pair<Terminal *, int>> trans{make_pair(label, target_q)};
-        delta[src_q] = trans;
-    }
+    pending.emplace_back(src_q, make_pair(label, target_q));
 }
 
 void NFA::add_eps_transition(int src_q, int target_q) {
@@ -86,57 +129,54 @@ void NFA::add_eps_transition(int src_q, int target_q) {
         ss << "Invalid target state " << target_q << ", nQ is " << nQ << endl;
         throw runtime_error(ss.str());
     }
-    if (deltaEpsilon.count(src_q) == 1) {
-        deltaEpsilon[src_q].insert(target_q);
-    } else {
-        set<int> etrans{target_q};
-        deltaEpsilon[src_q] = etrans;
-    }
+    pendingEps.emplace_back(src_q, target_q);
 }
 
-set<int> NFA::epsilonClosure(int q, set<int> &ignoreStates) {
-    set<int> closure{};
-    if (delta.count(q) == 0 && deltaEpsilon.count(q) == 0) {
-        // Unknown state
-        return closure;
-    }
-    // Don't follow self transitions
-    ignoreStates.insert(q);
-    if(deltaEpsilon.count(q) > 0) {
-        for (auto qtarget : deltaEpsilon[q]) {
-            if (ignoreStates.count(qtarget) == 0) {
-                closure.insert(qtarget);
-                ignoreStates.insert(qtarget);
-                set<int> rec = epsilonClosure(qtarget, ignoreStates);
-                closure.insert(rec.begin(), rec.end());
+vector<int> NFA::epsilonClosure(int q, vector<bool> &seen) {
+    // Don't follow self transitions, seen is reset before returning
+    vector<int> closure{};
+    vector<int> todo{q};
+    seen[q] = true;
+    while (!todo.empty()) {
+        int current = todo.back();
+        todo.pop_back();
+        for (int qtarget : epsilonSuccessors(current)) {
+            if (!seen[qtarget]) {
+                seen[qtarget] = true;
+                closure.push_back(qtarget);
+                todo.push_back(qtarget);
             }
         }
     }
+    seen[q] = false;
+    for (int qe : closure) {
+        seen[qe] = false;
+    }
     return closure;
 }
 
 void NFA::removeEpsilonTransitions() {
-    if (delta.empty()) {
+    if (numTransitions() == 0) {
         return;
     }
     // Add direct transitions, skipping e-transitions
+    vector<bool> seen(nQ, false);
+    vector<pair<int, Edge>> direct{};
     for (int q = 0; q < nQ; q++) {
-        auto tmp = set<int>{};
-        set<int> eclosure = epsilonClosure(q, tmp);
-        for (int qe : eclosure) {
+        for (int qe : epsilonClosure(q, seen)) {
             if (final_states.count(qe) == 1) {
                 add_final_state(q);
             }
             // Add transition q-a->q' if qe-a->q' exists
-            if (delta.count(qe) == 1) {
-                for (auto trans : delta[qe]) {
-                    add_transition(q, trans.first, trans.second);
-                }
+            for (auto &trans : successors(qe)) {
+                direct.emplace_back(q, trans);
             }
         }
     }
+    pending.insert(pending.end(), direct.begin(), direct.end());
     // Remove all epsilon transitions
-    deltaEpsilon.clear();
+    eps.clear();
+    epsStart.assign(nQ + 1, 0);
 }
 
 NFA NFA::reduceToReachableState() {
@@ -145,8 +185,8 @@ NFA NFA::reduceToReachableState() {
     int q0 = M.new_state();
     M.set_initial_state(q0);
 
-    list<int> queue{};
-    map<int, int> visited;
+    vector<int> queue{};
+    vector<int> visited(nQ, -1);
     visited[getInitialState()] = q0;
 
     queue.push_back(getInitialState());
@@ -155,74 +195,239 @@ NFA NFA::reduceToReachableState() {
     M.maxrAbs[q0] = this->maxrAbs[getInitialState()];
     M.minrAbs[q0] = this->minrAbs[getInitialState()];
 
-    while (!queue.empty()) {
-        int current = queue.front();
-        queue.pop_front();
-        if (getFinalStates().count(current) == 1) {
+    auto visit = [&](int q) {
+        if (visited[q] == -1) {
+            int qn = M.new_state();
+            visited[q] = qn;
+            M.minReachable[qn] = this->minReachable[q];
+            M.maxReachable[qn] = this->maxReachable[q];
+            M.maxrAbs[qn] = this->maxrAbs[q];
+            M.minrAbs[qn] = this->minrAbs[q];
+            queue.push_back(q);
+        }
+        return visited[q];
+    };
+
+    for (size_t head = 0; head < queue.size(); head++) {
+        int current = queue[head];
+        if (final_states.count(current) == 1) {
             M.add_final_state(visited[current]);
         }
-        if (delta.count(current) == 1) {
-            for (auto trans : delta[current]) {
-                if (visited.count(trans.second) == 0) {
-                    int qn = M.new_state();
-                    visited[trans.second] = qn;
-                    M.minReachable[qn] = this->minReachable[trans.second];
-                    M.maxReachable[qn] = this->maxReachable[trans.second];
-                    M.maxrAbs[qn] = this->maxrAbs[trans.second];
-                    M.minrAbs[qn] = this->minrAbs[trans.second];
-                    queue.push_back(trans.second);
-                }
-                M.add_transition(visited[current], trans.first, visited[trans.second]);
-            }
+        for (auto &trans : successors(current)) {
+            int qn = visit(trans.second);
+            M.add_transition(visited[current], trans.first, qn);
         }
-        if (deltaEpsilon.count(current) == 1) {
-            for (auto trans : deltaEpsilon[current]) {
-                if (visited.count(trans) == 0) {
-                    int qn = M.new_state();
-                    visited[trans] = qn;
-                    M.minReachable[qn] = this->minReachable[trans];
-                    M.maxReachable[qn] = this->maxReachable[trans];
-                    M.maxrAbs[qn] = this->maxrAbs[trans];
-                    M.minrAbs[qn] = this->minrAbs[trans];
-                    queue.push_back(trans);
-                }
-                M.add_eps_transition(visited[current], visited[trans]);
-            }
+        for (int qtarget : epsilonSuccessors(current)) {
+            int qn = visit(qtarget);
+            M.add_eps_transition(visited[current], qn);
         }
     }
     return M;
 }
 
 bool NFA::accept(const Words::Word &w) {
-    set<int> s{initState};
-    auto tmp = set<int>{};
-    for (int q : epsilonClosure(initState, tmp)) {
-        s.insert(q);
+    vector<bool> seen(nQ, false);
+    vector<int> s{initState};
+    for (int q : epsilonClosure(initState, seen)) {
+        s.push_back(q);
     }
 
+    // mark[q] is the number of the last step that added q
+    vector<int> mark(nQ, -1);
+    int step = 0;
     for (auto e : w) {
         if (e->isVariable()) {
             return false;
         }
-        set<int> succs;
+        vector<int> succs;
         for (int q : s) {
-            if (delta.count(q) > 0) {
-                for (auto trans : delta[q]) {
-                    if (trans.first->getChar() == (e->getTerminal()->getChar()) || trans.first->isEpsilon()) {
-                        succs.insert(trans.second);
-                        auto tmp1 = set<int>{};
-                        for (auto epsq : epsilonClosure(trans.second, tmp1)) {
-                            succs.insert(epsq);
+            for (auto &trans : successors(q)) {
+                if (mark[trans.second] == step) {
+                    // Already added together with its closure
+                    continue;
+                }
+                if (trans.first->getChar() == (e->getTerminal()->getChar()) || trans.first->isEpsilon()) {
+                    mark[trans.second] = step;
+                    succs.push_back(trans.second);
+                    for (auto epsq : epsilonClosure(trans.second, seen)) {
+                        if (mark[epsq] != step) {
+                            mark[epsq] = step;
+                            succs.push_back(epsq);
                         }
                     }
                 }
             }
         }
-        s = succs;
+        s = std::move(succs);
+        step++;
     }
 
-    for (int qf : getFinalStates()) {
-        if (s.count(qf) > 0) {
+    for (int q : s) {
+        if (final_states.count(q) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Simulator::Simulator(NFA &M) : nQ(M.numStates()), blocks((M.numStates() + 63) / 64) {
+    vector<char> alphabet;
+    letterIndex.fill(-1);
+    for (int q = 0; q < nQ; q++) {
+        for (auto &trans : M.successors(q)) {
+            unsigned char c = trans.first->getChar();
+            if (!trans.first->isEpsilon() && letterIndex[c] == -1) {
+                letterIndex[c] = (int)alphabet.size();
+                alphabet.push_back(c);
+            }
+        }
+    }
+    int numLetters = (int)alphabet.size() + 1;
+    for (auto &idx : letterIndex) {
+        if (idx == -1) {
+            idx = numLetters - 1;
+        }
+    }
+
+    // Epsilon closure of every state, including the state itself
+    vector<Block> closure(nQ * blocks, 0);
+    vector<int> todo;
+    for (int q = 0; q < nQ; q++) {
+        Block *cl = closure.data() + q * blocks;
+        cl[q / 64] |= Block(1) << (q % 64);
+        todo.push_back(q);
+        while (!todo.empty()) {
+            int current = todo.back();
+            todo.pop_back();
+            for (int qtarget : M.epsilonSuccessors(current)) {
+                if (!(cl[qtarget / 64] & (Block(1) << (qtarget % 64)))) {
+                    cl[qtarget / 64] |= Block(1) << (qtarget % 64);
+                    todo.push_back(qtarget);
+                }
+            }
+        }
+    }
+
+    initial.assign(blocks, 0);
+    if (M.getInitialState() >= 0) {
+        initial.assign(closure.begin() + M.getInitialState() * blocks, closure.begin() + (M.getInitialState() + 1) * blocks);
+    }
+    final.assign(blocks, 0);
+    for (int qf : M.getFinalStates()) {
+        final[qf / 64] |= Block(1) << (qf % 64);
+    }
+
+    // Epsilon labeled transitions match every letter
+    rows.assign((size_t)numLetters * nQ * blocks, 0);
+    for (int q = 0; q < nQ; q++) {
+        for (auto &trans : M.successors(q)) {
+            const Block *cl = closure.data() + trans.second * blocks;
+            for (int l = 0; l < numLetters; l++) {
+                if (trans.first->isEpsilon() || (l < (int)alphabet.size() && trans.first->getChar() == alphabet[l])) {
+                    Block *r = rows.data() + ((size_t)l * nQ + q) * blocks;
+                    for (size_t k = 0; k < blocks; k++) {
+                        r[k] |= cl[k];
+                    }
+                }
+            }
+        }
+    }
+
+    if (blocks == 1) {
+        byteTables.assign((size_t)numLetters * 8 * 256, 0);
+        for (int l = 0; l < numLetters; l++) {
+            for (int k = 0; k < 8 && 8 * k < nQ; k++) {
+                Block *table = byteTables.data() + ((size_t)l * 8 + k) * 256;
+                for (int v = 1; v < 256; v++) {
+                    int low = __builtin_ctz(v);
+                    int q = 8 * k + low;
+                    table[v] = table[v & (v - 1)] | (q < nQ ? *row(l, q) : 0);
+                }
+            }
+        }
+    }
+}
+
+bool Simulator::accept(const Words::Word &w) const {
+    if (blocks == 1) {
+        return acceptSmall(w);
+    }
+    return acceptWide(w);
+}
+
+vector<bool> Simulator::accept(const vector<Words::Word> &words) const {
+    // vector<bool> packs its entries, so the threads write to bytes of their own range
+    vector<char> accepted(words.size(), 0);
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), words.size() / minWordsPerThread);
+    size_t chunk = threads ? (words.size() + threads - 1) / threads : words.size();
+    auto check = [&](size_t t) {
+        for (size_t i = t * chunk; i < std::min(words.size(), (t + 1) * chunk); i++) {
+            accepted[i] = accept(words[i]);
+        }
+    };
+    vector<std::thread> workers;
+    for (size_t t = 1; t < threads; t++) {
+        workers.emplace_back(check, t);
+    }
+    check(0);
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    return vector<bool>(accepted.begin(), accepted.end());
+}
+
+bool Simulator::acceptSmall(const Words::Word &w) const {
+    Block current = initial[0];
+    for (auto e : w) {
+        if (e->isVariable()) {
+            return false;
+        }
+        int l = letterIndex[(unsigned char)e->getTerminal()->getChar()];
+        const Block *tables = byteTables.data() + (size_t)l * 8 * 256;
+        Block next = 0;
+        for (int k = 0; k < 8 && 8 * k < nQ; k++) {
+            next |= tables[k * 256 + ((current >> (8 * k)) & 0xff)];
+        }
+        if (next == 0) {
+            return false;
+        }
+        current = next;
+    }
+    return (current & final[0]) != 0;
+}
+
+bool Simulator::acceptWide(const Words::Word &w) const {
+    vector<Block> current(initial);
+    vector<Block> next(blocks);
+    for (auto e : w) {
+        if (e->isVariable()) {
+            return false;
+        }
+        int l = letterIndex[(unsigned char)e->getTerminal()->getChar()];
+        std::fill(next.begin(), next.end(), 0);
+        Block *n = next.data();
+        for (size_t b = 0; b < blocks; b++) {
+            for (Block bits = current[b]; bits != 0; bits &= bits - 1) {
+                int q = (int)(b * 64 + __builtin_ctzll(bits));
+                const Block *r = row(l, q);
+                #pragma omp simd
+                for (size_t k = 0; k < blocks; k++) {
+                    n[k] |= r[k];
+                }
+            }
+        }
+        Block any = 0;
+        #pragma omp simd reduction(|:any)
+        for (size_t k = 0; k < blocks; k++) {
+            any |= n[k];
+        }
+        if (any == 0) {
+            return false;
+        }
+        current.swap(next);
+    }
+    for (size_t b = 0; b < blocks; b++) {
+        if (current[b] & final[b]) {
             return true;
         }
     }
@@ -237,18 +442,24 @@ string NFA::toString() {
     }
     ss << nQ - 1 << "};  ";
     ss << "delta = {";
-    for (auto trans : delta) {
-        ss << trans.first << ": [";
-        for (pair<Terminal *, int> target : trans.second) {
+    for (int q = 0; q < nQ; q++) {
+        if (successors(q).empty()) {
+            continue;
+        }
+        ss << q << ": [";
+        for (auto &target : successors(q)) {
             ss << "(" << target.first->getChar() << ", " << target.second << ")";
         }
         ss << "], ";
     }
     ss << "}  ";
     ss << "epsilons = {";
-    for (auto &trans : deltaEpsilon) {
-        ss << trans.first << ": [";
-        for (int dest : trans.second) {
+    for (int q = 0; q < nQ; q++) {
+        if (epsilonSuccessors(q).empty()) {
+            continue;
+        }
+        ss << q << ": [";
+        for (int dest : epsilonSuccessors(q)) {
             ss << dest << " ";
         }
         ss << "], ";
@@ -311,7 +522,7 @@ NFA regexToNfa(Words::RegularConstraints::RegNode &regExpr, Words::Context &ctx)
                 set<int> qFs{q0};
                 for (const auto &sub : opr.getChildren()) {
                     NFA subM = regexToNfa(*sub, ctx);
-                    if (subM.getDelta().empty()) {
+                    if (subM.numTransitions() == 0) {
                         continue;
                     }
 
@@ -324,19 +535,7 @@ NFA regexToNfa(Words::RegularConstraints::RegNode &regExpr, Words::Context &ctx)
 
                     set<int> newqFs{};
 
-                    // Apply offset delta
-                    auto offsetDelta = subM.offset_delta(off);
-                    for (const auto &trans : offsetDelta) {
-                        for (auto &target : trans.second) {
-                            M.add_transition(trans.first, target.first, target.second);
-                        }
-                    }
-                    auto offesetDeltaEps = subM.offset_delta_epsilon(off);
-                    for (const auto &epsTrans : offesetDeltaEps) {
-                        for (const auto &target : epsTrans.second) {
-                            M.add_eps_transition(epsTrans.first, target);
-                        }
-                    }
+                    M.embed(subM, off);
 
                     // Update initial/final states
                     for (int i = 0; i < subM.numStates(); i++) {
@@ -425,7 +624,7 @@ NFA regexToNfa(Words::RegularConstraints::RegNode &regExpr, Words::Context &ctx)
                 auto sub = opr.getChildren()[0];
                 NFA subM = regexToNfa(*sub, ctx);
 
-                if (subM.getDelta().empty()) {
+                if (subM.numTransitions() == 0) {
                     // Star over empty automaton is the automaton itself
                     // eps^* = eps, </>^* = </>
                     return subM;
@@ -437,18 +636,7 @@ NFA regexToNfa(Words::RegularConstraints::RegNode &regExpr, Words::Context &ctx)
                     // Add numStates
                     M.new_state();
                 }
-                auto offesetDeltaEps = subM.offset_delta_epsilon(off);
-                for (const auto &epsTrans : offesetDeltaEps) {
-                    for (const auto &target : epsTrans.second) {
-                        M.add_eps_transition(epsTrans.first, target);
-                    }
-                }
-                auto offsetDelta = subM.offset_delta(off);
-                for (const auto &trans : offsetDelta) {
-                    for (auto &target : trans.second) {
-                        M.add_transition(trans.first, target.first, target.second);
-                    }
-                }
+                M.embed(subM, off);
                 // Update initial/final states
                 for (int i = 0; i < subM.numStates(); i++) {
                     int q = i + off;
@@ -501,18 +689,7 @@ NFA regexToNfa(Words::RegularConstraints::RegNode &regExpr, Words::Context &ctx)
                         // Add numStates
                         int s = M.new_state();
                     }
-                    auto offsetDelta = subM.offset_delta(off);
-                    for (const auto &trans : offsetDelta) {
-                        for (auto &target : trans.second) {
-                            M.add_transition(trans.first, target.first, target.second);
-                        }
-                    }
-                    auto offesetDeltaEps = subM.offset_delta_epsilon(off);
-                    for (const auto &epsTrans : offesetDeltaEps) {
-                        for (const auto &target : epsTrans.second) {
-                            M.add_eps_transition(epsTrans.first, target);
-                        }
-                    }
+                    M.embed(subM, off);
                     // Update initial/final states
                     for (int i = 0; i < subM.numStates(); i++) {
                         int q = i + off;
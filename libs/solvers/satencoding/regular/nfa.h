@@ -1,59 +1,77 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <vector>
 
 #include "words/regconstraints.hpp"
 #include "words/words.hpp"
 
 namespace RegularEncoding::Automaton {
 
+/**
+ * Read-only view on a contiguous range of an automaton's transition arrays.
+ * Views are invalidated by adding transitions to the automaton.
+ */
+template <typename T>
+class Span {
+   public:
+    Span(const T *first, const T *last) : first(first), last(last){};
+
+    const T *begin() const { return first; }
+    const T *end() const { return last; }
+    size_t size() const { return last - first; }
+    bool empty() const { return first == last; }
+
+   private:
+    const T *first;
+    const T *last;
+};
+
+// A labeled edge, the state is the target in the forward index and the source in the reverse index
+using Edge = std::pair<Words::Terminal *, int>;
+
 class NFA {
    private:
-    std::set<int> epsilonClosure(int, std::set<int> &ignoreStates);
+    std::vector<int> epsilonClosure(int, std::vector<bool> &seen);
+
+    /*
+     * Transitions are stored in compressed sparse row form: the edges leaving state q are
+     * out[outStart[q]] ... out[outStart[q+1]-1], sorted by letter and target.
+     * inStart/in is the same index for the incoming edges, epsStart/eps holds the epsilon transitions.
+     * New transitions are collected in the pending lists and merged into the arrays on the next read.
+     */
+    void compact();
 
     int nQ = 0;
-    std::map<int, std::set<std::pair<Words::Terminal *, int>>> delta;
-    std::map<int, std::set<int>> deltaEpsilon;
+    std::vector<int> outStart{0};
+    std::vector<Edge> out;
+    std::vector<int> inStart{0};
+    std::vector<Edge> in;
+    std::vector<int> epsStart{0};
+    std::vector<int> eps;
+    std::vector<std::pair<int, Edge>> pending;
+    std::vector<std::pair<int, int>> pendingEps;
     int initState = -1;
     std::set<int> final_states{};
 
    public:
     NFA() : final_states(std::set<int>{}), initState(-1){};
 
-    /**
-     * Direct instantiation.
-     * @param nQ the number of numStates {0, ..., nQ-1}
-     * @param delta the transition function
-     * @param initState the initial state
-     * @param final_states the final numStates
-     */
-    NFA(int nQ,
-        std::map<int, std::set<std::pair<Words::Terminal *, int>>> delta,
-        std::map<int, std::set<int>> deltaEpsilon,
-        int initState, std::set<int> final_states)
-        : nQ(nQ),
-          delta(delta),
-          initState(initState),
-          final_states(final_states),
-          deltaEpsilon(deltaEpsilon){};
-
     ~NFA(){};
 
     bool accept(const Words::Word &);
 
     void removeEpsilonTransitions();
 
-    void get_reachable_states();
-
     NFA reduceToReachableState();
 
-    std::set<int> getFinalStates() { return final_states; }
+    const std::set<int> &getFinalStates() const { return final_states; }
 
     int getInitialState() const { return initState; }
 
-    std::map<int, std::set<int>> getDeltaEpsilon() {return deltaEpsilon;}
-
     int new_state();
 
     std::string toString();
@@ -68,29 +86,86 @@ class NFA {
     int numStates() const { return nQ; }
 
     int numTransitions() {
-        int c = 0;
-        for (const auto &trans : delta) {
-            c += trans.second.size();
-        }
-        return c;
+        compact();
+        return (int)out.size();
+    }
+
+    /**
+     * Outgoing (label, target) edges of state q, sorted by label.
+     */
+    Span<Edge> successors(int q) {
+        compact();
+        return Span<Edge>(out.data() + outStart[q], out.data() + outStart[q + 1]);
+    }
+
+    /**
+     * Incoming (label, source) edges of state q, sorted by label.
+     */
+    Span<Edge> predecessors(int q) {
+        compact();
+        return Span<Edge>(in.data() + inStart[q], in.data() + inStart[q + 1]);
     }
 
-    std::map<int, std::set<std::pair<Words::Terminal *, int>>> getDelta() {
-        return delta;
+    /**
+     * Targets of the epsilon transitions leaving state q.
+     */
+    Span<int> epsilonSuccessors(int q) {
+        compact();
+        return Span<int>(eps.data() + epsStart[q], eps.data() + epsStart[q + 1]);
     }
+
     std::unordered_map<int, int> minReachable{};
     std::unordered_map<int, int> maxReachable{};
     std::unordered_map<int, int> maxrAbs{};
     std::unordered_map<int, int> minrAbs{};
 
     /*
-     * Returns a transition function for this automaton, where all states are
-     * offset by a specific number. Required for merging NFAs without having
-     * numStates clash.
+     * Copies all transitions of M into this automaton, with all states of M offset by a specific number.
+     * Required for merging NFAs without having numStates clash.
+     */
+    void embed(NFA &M, int of);
+};
+
+/**
+ * Bit-parallel simulation of an NFA. Sets of states are bitsets and for every letter a table maps
+ * each state to the epsilon closure of its successors. Automata with at most 64 states use byte-indexed
+ * tables instead, so a step is one lookup per byte of the current state set. Wider automata OR the rows
+ * of the current states together in a loop vectorised through OpenMP SIMD (-fopenmp-simd).
+ * The simulator is read only after construction and can be shared between threads.
+ */
+class Simulator {
+   public:
+    explicit Simulator(NFA &M);
+
+    bool accept(const Words::Word &) const;
+
+    /**
+     * Checks a batch of words, the i-th entry of the result tells whether the i-th word is accepted.
+     * Large batches are split over the hardware threads.
      */
-    std::map<int, std::vector<std::pair<Words::Terminal *, int>>> offset_delta(
-        int of);
-    std::map<int, std::set<int>> offset_delta_epsilon(int of);
+    std::vector<bool> accept(const std::vector<Words::Word> &) const;
+
+   private:
+    typedef uint64_t Block;
+
+    // Smaller batches are not worth starting a thread for
+    static const size_t minWordsPerThread = 64;
+
+    const Block *row(int letter, int q) const { return rows.data() + ((size_t)letter * nQ + q) * blocks; }
+
+    bool acceptSmall(const Words::Word &) const;
+
+    bool acceptWide(const Words::Word &) const;
+
+    int nQ;
+    size_t blocks;
+    // Index of each character in the tables, characters not labeling any transition share the last index
+    std::array<int, 256> letterIndex;
+    std::vector<Block> initial;
+    std::vector<Block> final;
+    std::vector<Block> rows;
+    // Automata with at most 64 states: successors of the states in a byte v at byte position k, by letter
+    std::vector<Block> byteTables;
 };
 
 /**
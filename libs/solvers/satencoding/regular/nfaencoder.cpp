@@ -12,7 +12,7 @@ using namespace chrono;
 
 namespace RegularEncoding {
 
-    set<set<int>> AutomatonEncoder::encode() {
+    void AutomatonEncoder::encode(ClauseSink &sink) {
 
         auto total_start = high_resolution_clock::now();
         
@@ -30,36 +30,41 @@ namespace RegularEncoding {
 
 
         auto start = high_resolution_clock::now();
-        Automaton::NFA M = Automaton::regexToNfa(*expr, ctx);
-
-        M.removeEpsilonTransitions();
+        shared_ptr<CompiledAutomaton> compiled = automata.find(*expr);
+        bool cached = compiled != nullptr;
+        if (!cached) {
+            compiled = compile(*expr);
+            automata.insert(*expr, compiled);
+        }
 
 
         if (pattern.noVariableWord()) {
             Glucose::Var v = solver.newVar();
-            if (M.accept(pattern)) {
-                return set<set<int>>{set<int>{v, -v}};
+            if (compiled->simulator->accept(pattern)) {
+                sink.addClause({v, -v});
             } else {
-                return set<set<int>>{set<int>{v}, set<int>{-v}};
+                sink.addClause({v});
+                sink.addClause({-v});
             }
+            return;
         }
 
-        M = M.reduceToReachableState();
-
-        if (M.getFinalStates().empty()) {
+        if (compiled->acceptsNothing) {
             // Does not accept anything
             Glucose::Var v = solver.newVar();
-            return set<set<int>>{set<int>{v}, set<int>{-v}};
+            sink.addClause({v});
+            sink.addClause({-v});
+            return;
         }
 
 
-        Automaton::NFA Mxi = filledAutomaton(M);
+        Automaton::NFA &Mxi = compiled->filled;
 
 
         auto stop = chrono::high_resolution_clock::now();
         auto duration = chrono::duration_cast<milliseconds>(stop - start);
         profiler.timeNFA = duration.count();
-        cout << "\t - Built filled NFA with " << Mxi.numStates() << " states and " << Mxi.numTransitions()
+        cout << "\t - " << (cached ? "Reused" : "Built") << " filled NFA with " << Mxi.numStates() << " states and " << Mxi.numTransitions()
              << " transitions. Took " << duration.count() << "ms\n";
 
 
@@ -75,22 +80,19 @@ namespace RegularEncoding {
         }
 
 
-        set<set<int>> cnf{};
-
         // Initial State, is a conjunction of literals
         PLFormula initialConj = encodeInitial(Mxi);
         // Add each literal as clause to cnf
         for (const auto &lit: initialConj.getSubformulae()) {
-            cnf.insert(set<int>{lit.getLiteral()});
+            sink.addClause({lit.getLiteral()});
         }
         // Final States, is a disjunction of literals
         PLFormula finalDisj = encodeFinal(Mxi, filledPat);
         // Add all literals as single clause to cnf
-        set<int> finalClause{};
         for (const auto &lit: finalDisj.getSubformulae()) {
-            finalClause.insert(lit.getLiteral());
+            sink.push(lit.getLiteral());
         }
-        cnf.insert(finalClause);
+        sink.commit();
 
         stop = chrono::high_resolution_clock::now();
         duration = chrono::duration_cast<milliseconds>(stop - start);
@@ -101,12 +103,11 @@ namespace RegularEncoding {
         // Transition constraint, is in cnf
         PLFormula transitionCnf = encodeTransition(Mxi, filledPat);
         
-        for (auto disj: transitionCnf.getSubformulae()) {
-            set<int> clause{};
+        for (auto &disj: transitionCnf.getSubformulae()) {
             for (const auto &lit: disj.getSubformulae()) {
-                clause.insert(lit.getLiteral());
+                sink.push(lit.getLiteral());
             }
-            cnf.insert(clause);
+            sink.commit();
         }
         
 
@@ -118,29 +119,10 @@ namespace RegularEncoding {
         start = high_resolution_clock::now();
         // Predecessor constraint
 
-        auto delta = M.getDelta();
-
-
-
-        map<int, set<pair<Words::Terminal *, int>>> pred;
-        for (auto &trans: Mxi.getDelta()) {
-            int qsrc = trans.first;
-            for (auto &target: trans.second) {
-                Words::Terminal *label = target.first;
-                int qdst = target.second;
-                if (pred.count(qdst) == 1) {
-                    pred[qdst].insert(make_pair(label, qsrc));
-                } else {
-                    pred[qdst] = set<pair<Words::Terminal *, int>>{make_pair(label, qsrc)};
-                }
-            }
-        }
-
-
         set<pair<int, int>> tmpv{};
         vector<PLFormula> predFormulae;
         for (auto qf: Mxi.getFinalStates()) {
-            PLFormula predPart = encodePredNew(Mxi, filledPat, qf, (int) filledPat.size(), tmpv, pred);
+            PLFormula predPart = encodePredNew(Mxi, filledPat, qf, (int) filledPat.size(), tmpv);
 
             predFormulae.push_back(predPart);
 
@@ -161,22 +143,16 @@ namespace RegularEncoding {
              << predecessor.size() << "). Took " << duration.count() << "ms\n";
 
         start = high_resolution_clock::now();
-        set<set<int>> predecessorCnf = tseytin_cnf(predecessor, solver);
+        tseytin_cnf(predecessor, solver, sink);
         stop = chrono::high_resolution_clock::now();
         duration = chrono::duration_cast<milliseconds>(stop - start);
         profiler.timeTseytinPredecessor = duration.count();
         cout << "\t - Created CNF. Took " << duration.count() << "ms\n";
-        for (const auto &clause: predecessorCnf) {
-            cnf.insert(clause);
-        }
 
 
         duration = duration_cast<milliseconds>(high_resolution_clock::now() - total_start);
         cout << "[*] Encoding done. Took " << duration.count() << "ms in total" << endl;
 
-
-        return cnf;
-
     }
 
     PLFormula AutomatonEncoder::encodeInitial(Automaton::NFA &Mxi) {
@@ -203,14 +179,18 @@ namespace RegularEncoding {
     PLFormula AutomatonEncoder::encodeTransition(Automaton::NFA &Mxi, std::vector<FilledPos> filledPat) {
         vector<PLFormula> disj;
         
-        for (auto &trans: Mxi.getDelta()) {
+        for (int q = 0; q < Mxi.numStates(); q++) {
+            auto succs = Mxi.successors(q);
+            if (succs.empty()) {
+                continue;
+            }
             for (int i = 0; i < filledPat.size(); i++) {
-                if (numTerminals(filledPat, i) > Mxi.maxrAbs[trans.first] || filledPat.size() - i < Mxi.minrAbs[trans.first]) {
+                if (numTerminals(filledPat, i) > Mxi.maxrAbs[q] || filledPat.size() - i < Mxi.minrAbs[q]) {
                     //int succVar = -stateVars[make_pair(trans.first, i)];
                     //disj.push_back(PLFormula::lit(succVar));
                     continue;
                 }
-                for (auto &target: trans.second) {
+                for (auto &target: succs) {
 
 
                     vector<PLFormula> clause;
@@ -224,14 +204,14 @@ namespace RegularEncoding {
                         k = tIndices->at(target.first);
                     }
 
-                    int s = stateVars[make_pair(trans.first, i)];
+                    int s = stateVars[make_pair(q, i)];
                     int word;
                     if (filledPat[i].isTerminal()) {
                         int ci = filledPat[i].getTerminalIndex();
-                        word = constantsVars->at(make_pair(ci, k));
+                        word = (*constantsVars)(ci, k);
                     } else {
                         pair<int, int> xij = filledPat[i].getVarIndex();
-                        word = variableVars->at(make_pair(xij, k));
+                        word = (*variableVars)(xij.first, xij.second, k);
                     }
                     int ssucc = stateVars[make_pair(target.second, i + 1)];
 
@@ -250,7 +230,7 @@ namespace RegularEncoding {
 
 
 
-    bool checkLength(int q, int q0, map<int, set<pair<Words::Terminal *, int>>> &pred, int minLength, int maxLenght) {
+    bool checkLength(int q, int q0, Automaton::NFA &nfa, int minLength, int maxLenght) {
         std::stack<std::pair<int, int>> todo{};
         todo.push(std::make_pair(q, maxLenght));
         std::set<std::pair<int, int>> seen{};
@@ -266,7 +246,7 @@ namespace RegularEncoding {
                 }
             } else {
                 if (minLength < ci) {
-                    for (auto& tran: pred[cq]) {
+                    for (auto& tran: nfa.predecessors(cq)) {
                         if (!tran.first->isEpsilon()) {
                             std::pair<int, int> next = std::make_pair(tran.second, ci-1);
                             if (seen.find(next) == seen.end()) {
@@ -284,21 +264,6 @@ namespace RegularEncoding {
      * Deprecated, use AutomatonEncoder::encodePredNew
      */
     PLFormula AutomatonEncoder::encodePredecessor(Automaton::NFA &Mxi, std::vector<FilledPos> filledPat) {
-        // calc pred
-        map<int, set<pair<Words::Terminal *, int>>> pred;
-        for (auto &trans: Mxi.getDelta()) {
-            int qsrc = trans.first;
-            for (auto &target: trans.second) {
-                Words::Terminal *label = target.first;
-                int qdst = target.second;
-                if (pred.count(qdst) == 1) {
-                    pred[qdst].insert(make_pair(label, qsrc));
-                } else {
-                    pred[qdst] = set<pair<Words::Terminal *, int>>{make_pair(label, qsrc)};
-                }
-            }
-        }
-
         set<pair<int, int>> visited{};
 
 
@@ -312,7 +277,7 @@ namespace RegularEncoding {
 
                 int currentPos = i - 1; // Current position in pattern
                 set<pair<Words::Terminal *, int>> preds{}; // Predecessors of q
-                for (auto t: pred[q]) {
+                for (auto t: Mxi.predecessors(q)) {
                     if (filledPat.at(currentPos).isTerminal()) {
                         if (!t.first->isEpsilon() &&
                             tIndices->at(t.first) == filledPat[currentPos].getTerminalIndex()) {
@@ -327,7 +292,7 @@ namespace RegularEncoding {
                 while (currentPos - 1 >= 1 && filledPat.at(currentPos - 1).isTerminal()) {
                     set<pair<Words::Terminal *, int>> predPreds{};
                     for (auto p: preds) {
-                        for (auto pp: pred[p.second]) { // Predecessors of p
+                        for (auto pp: Mxi.predecessors(p.second)) { // Predecessors of p
                             if (!pp.first->isEpsilon() &&
                                 tIndices->at(pp.first) == filledPat.at(currentPos - 1).getTerminalIndex()) {
                                 predPreds.insert(pp);
@@ -365,10 +330,10 @@ namespace RegularEncoding {
                                 // UNSAT!
                                 continue;
                             }
-                            word = constantsVars->at(make_pair(ci, k));
+                            word = (*constantsVars)(ci, k);
                         } else {
                             pair<int, int> xij = filledPat[currentPos].getVarIndex();
-                            word = variableVars->at(make_pair(xij, k));
+                            word = (*variableVars)(xij.first, xij.second, k);
                         }
                         conj.push_back(sqip);
                         conj.push_back(PLFormula::lit(word));
@@ -395,9 +360,8 @@ namespace RegularEncoding {
 
     // Encodes: If after [i] transitions in state [q], there must be a state [q'] reachable after [i]-1 transitions and
     // an edge from [q] to [q'] labeled with [filledPat[i-1]]
-    PLFormula AutomatonEncoder::encodePredNew(Automaton::NFA &Mxi, std::vector<FilledPos> filledPat, int q, int i,
-                                              set<pair<int, int>> &visited,
-                                              map<int, set<pair<Words::Terminal *, int>>> &pred) {
+    PLFormula AutomatonEncoder::encodePredNew(Automaton::NFA &Mxi, std::vector<FilledPos> &filledPat, int q, int i,
+                                              set<pair<int, int>> &visited) {
 
 
         visited.insert(make_pair(q, i));
@@ -418,7 +382,7 @@ namespace RegularEncoding {
 
         // Find all predecessors q' of q where there is an edge labeled with filledPat[i-1] (always the case if filledPat[i-1] is variable)
         set<pair<Words::Terminal *, int>> preds{};
-        for (auto t: pred[q]) {
+        for (auto t: Mxi.predecessors(q)) {
             if (filledPat.at(currentPos).isTerminal()) {
                 if (!t.first->isEpsilon() && tIndices->at(t.first) == filledPat[currentPos].getTerminalIndex()) {
                     preds.insert(t);
@@ -432,7 +396,7 @@ namespace RegularEncoding {
         while (filledPat[i - 1].isTerminal() && currentPos - 1 >= 0 && filledPat[currentPos - 1].isTerminal()) {
             set<pair<Words::Terminal *, int>> predPreds{};
             for (auto p: preds) {
-                for (auto pp: pred[p.second]) {
+                for (auto pp: Mxi.predecessors(p.second)) {
                     if ((!pp.first->isEpsilon() &&
                          tIndices->at(pp.first) == filledPat.at(currentPos - 1).getTerminalIndex())) {
                         predPreds.insert(pp);
@@ -448,7 +412,6 @@ namespace RegularEncoding {
         // If preds is empty, we know that Sqi has no valid predecessor and we'll encode -Sqi.
         vector<PLFormula> disj;
         // For all reachable states q' in succ, encode that q is the predecessor after reading i symbols
-        auto delta = Mxi.getDelta();
         vector<PLFormula> conj;
         // Predecessor Sq^i
         int succVar = -stateVars[make_pair(q, i)];
@@ -466,10 +429,10 @@ namespace RegularEncoding {
             int word;
             if (filledPat.at(currentPos).isTerminal()) {
                 int ci = filledPat[currentPos].getTerminalIndex();
-                word = constantsVars->at(make_pair(ci, k));
+                word = (*constantsVars)(ci, k);
             } else {
                 pair<int, int> xij = filledPat[currentPos].getVarIndex();
-                word = variableVars->at(make_pair(xij, k));
+                word = (*variableVars)(xij.first, xij.second, k);
             }
             auto predF = PLFormula::land(vector<PLFormula>{PLFormula::lit(word), PLFormula::lit(predVar)});
             conj.push_back(predF);
@@ -491,7 +454,7 @@ namespace RegularEncoding {
             for (auto qh: preds) {
                 if (visited.count(make_pair(qh.second, currentPos)) == 0) {
                     //Call recursively for preds
-                    f.push_back(encodePredNew(Mxi, filledPat, qh.second, currentPos, visited, pred));
+                    f.push_back(encodePredNew(Mxi, filledPat, qh.second, currentPos, visited));
                 }
             }
         }
@@ -504,13 +467,49 @@ namespace RegularEncoding {
     }
 
 
+    shared_ptr<CompiledAutomaton> AutomatonEncoder::compile(Words::RegularConstraints::RegNode &expr) {
+        auto compiled = make_shared<CompiledAutomaton>();
+        compiled->nfa = Automaton::regexToNfa(expr, ctx);
+        compiled->nfa.removeEpsilonTransitions();
+        compiled->simulator = make_unique<Automaton::Simulator>(compiled->nfa);
+
+        Automaton::NFA M = compiled->nfa.reduceToReachableState();
+        if (M.getFinalStates().empty()) {
+            compiled->acceptsNothing = true;
+            return compiled;
+        }
+        compiled->filled = filledAutomaton(M);
+        // Build the transition indexes once, the encoders only read them
+        compiled->filled.numTransitions();
+        return compiled;
+    }
+
+    shared_ptr<CompiledAutomaton> AutomatonCache::find(Words::RegularConstraints::RegNode &expr) {
+        auto range = entries.equal_range(expr.hash());
+        if (range.first == range.second) {
+            return nullptr;
+        }
+        string repr = expr.toString();
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.first == repr) {
+                return it->second.second;
+            }
+        }
+        return nullptr;
+    }
+
+    void AutomatonCache::insert(Words::RegularConstraints::RegNode &expr, shared_ptr<CompiledAutomaton> compiled) {
+        entries.emplace(expr.hash(), make_pair(expr.toString(), std::move(compiled)));
+    }
+
     Automaton::NFA AutomatonEncoder::filledAutomaton(Automaton::NFA &nfa) {
-        Automaton::NFA Mxi(nfa.numStates(), nfa.getDelta(), nfa.getDeltaEpsilon(), nfa.getInitialState(), nfa.getFinalStates());
+        Automaton::NFA Mxi(nfa);
         for (int q = 0; q < Mxi.numStates(); q++) {
             Mxi.add_transition(q, ctx.getEpsilon(), q);
         }
-        Mxi.maxReachable = nfa.maxReachable;
-        Mxi.minReachable = nfa.minReachable;
+        // Only the reachability bounds carry over to the filled automaton
+        Mxi.maxrAbs.clear();
+        Mxi.minrAbs.clear();
         return Mxi;
     }
 
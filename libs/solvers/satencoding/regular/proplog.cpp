@@ -1,4 +1,7 @@
 #include "regencoding.h"
+#include <algorithm>
+#include <limits>
+#include <sstream>
 #include <vector>
 #include <set>
 #include <iostream>
@@ -9,14 +12,92 @@ namespace RegularEncoding {
 
     namespace PropositionalLogic {
 
-        PLFormula::PLFormula(Junctor junctor, std::vector<PLFormula> subformulae) : junctor(junctor),
-                                                                                    subformulae(subformulae),
-                                                                                    literal(0) {}
+        namespace {
+            thread_local FormulaArena defaultArena;
+            thread_local FormulaArena *installedArena = nullptr;
+        }
+
+        FormulaArena::Scope::Scope() : arena(new FormulaArena()), previous(installedArena) {
+            installedArena = arena;
+        }
+
+        FormulaArena::Scope::~Scope() {
+            installedArena = previous;
+            delete arena;
+        }
+
+        FormulaArena &FormulaArena::current() {
+            return installedArena ? *installedArena : defaultArena;
+        }
+
+        size_t FormulaArena::hash(Junctor junctor, int literal, const uint32_t *children, size_t n) const {
+            size_t h = static_cast<size_t>(junctor) * 0x9e3779b97f4a7c15ULL ^ static_cast<uint32_t>(literal);
+            for (size_t i = 0; i < n; i++) {
+                h ^= children[i] + 0x9e3779b9 + (h << 6) + (h >> 2);
+            }
+            return h;
+        }
+
+        bool FormulaArena::equals(const Node &node, Junctor junctor, int literal, const uint32_t *children, size_t n) const {
+            return node.junctor == junctor && node.literal == literal && node.count == n &&
+                   std::equal(children, children + n, childIds.begin() + node.first);
+        }
+
+        void FormulaArena::grow() {
+            vector<uint32_t> grown(table.size() * 2, 0);
+            size_t mask = grown.size() - 1;
+            for (uint32_t id = 0; id < nodes.size(); id++) {
+                const Node &n = nodes[id];
+                size_t i = hash(n.junctor, n.literal, children(n), n.count) & mask;
+                while (grown[i] != 0) {
+                    i = (i + 1) & mask;
+                }
+                grown[i] = id + 1;
+            }
+            table.swap(grown);
+        }
+
+        PLFormula FormulaArena::make(Junctor junctor, int literal, const uint32_t *children, size_t n) {
+            if (2 * (nodes.size() + 1) > table.size()) {
+                grow();
+            }
+            size_t mask = table.size() - 1;
+            size_t i = hash(junctor, literal, children, n) & mask;
+            while (table[i] != 0) {
+                if (equals(nodes[table[i] - 1], junctor, literal, children, n)) {
+                    return PLFormula(table[i] - 1);
+                }
+                i = (i + 1) & mask;
+            }
 
+            Node node{junctor, literal, static_cast<uint32_t>(childIds.size()), static_cast<uint32_t>(n), 1,
+                      junctor == Junctor::LIT ? abs(literal) : -1, 1};
+            for (size_t c = 0; c < n; c++) {
+                const Node &child = nodes[children[c]];
+                node.depth = std::max(node.depth, child.depth + 1);
+                node.maxVar = std::max(node.maxVar, child.maxVar);
+                node.size += child.size;
+            }
+            childIds.insert(childIds.end(), children, children + n);
+            nodes.push_back(node);
+            table[i] = nodes.size();
+            return PLFormula(nodes.size() - 1);
+        }
 
-        PLFormula::PLFormula(int literal) : junctor(Junctor::LIT), literal(literal), subformulae(vector<PLFormula>{}) {}
+        namespace {
+            PLFormula makeNode(Junctor junctor, const vector<PLFormula> &subformulae) {
+                vector<uint32_t> ids;
+                ids.reserve(subformulae.size());
+                for (const auto &f: subformulae) {
+                    ids.push_back(f.getId());
+                }
+                return FormulaArena::current().make(junctor, 0, ids.data(), ids.size());
+            }
+        }
 
         bool PLFormula::valid() {
+            Junctor junctor = getJunctor();
+            vector<PLFormula> subformulae = getSubformulae();
             if (junctor == Junctor::LIT) {
                 if (subformulae.size() != 0) {
                     std::cout << "Literals can' have operands\n";
@@ -35,7 +116,9 @@ namespace RegularEncoding {
             }
 
             for (auto s: subformulae) {
-                return s.valid();
+                if (!s.valid()) {
+                    return false;
+                }
             }
 
             return true;
@@ -45,14 +128,14 @@ namespace RegularEncoding {
         string PLFormula::toString() {
             stringstream ss;
 
-            switch (junctor) {
+            switch (getJunctor()) {
 
                 case Junctor::LIT:
-                    ss << literal;
+                    ss << getLiteral();
                     break;
                 case Junctor::AND:
                     ss << "AND (";
-                    for (auto s: subformulae) {
+                    for (auto s: getSubformulae()) {
                         ss << s.toString();
                         ss << " ";
                     }
@@ -60,7 +143,7 @@ namespace RegularEncoding {
                     break;
                 case Junctor::OR:
                     ss << "OR(";
-                    for (auto s: subformulae) {
+                    for (auto s: getSubformulae()) {
                         ss << s.toString();
                         ss << " ";
                     }
@@ -68,7 +151,7 @@ namespace RegularEncoding {
                     break;
                 case Junctor::NOT:
                     ss << "-(";
-                    for (auto s: subformulae) {
+                    for (auto s: getSubformulae()) {
                         ss << s.toString();
                         ss << " ";
                     }
@@ -80,11 +163,12 @@ namespace RegularEncoding {
         }
 
         bool PLFormula::is_nenf() {
-            if (junctor == Junctor::NOT) {
-                if (subformulae[0].junctor != Junctor::LIT) {
+            vector<PLFormula> subformulae = getSubformulae();
+            if (getJunctor() == Junctor::NOT) {
+                if (subformulae[0].getJunctor() != Junctor::LIT) {
                     return false;
                 }
-            } else if (junctor != Junctor::LIT) {
+            } else if (getJunctor() != Junctor::LIT) {
                 for (int i = 0; i < subformulae.size(); i++) {
                     if (!subformulae[i].is_nenf()) {
                         return false;
@@ -94,47 +178,53 @@ namespace RegularEncoding {
             return true;
         }
 
-        // TODO: Use pointers instread of copying
-        void PLFormula::makeBinary() {
-            if (junctor == Junctor::AND || junctor == Junctor::OR) {
-                if (subformulae.size() > 2) {
-                    PLFormula left = subformulae[0];
-                    vector<PLFormula> rightsubs(subformulae.begin() + 1, subformulae.end());
-                    PLFormula right = PLFormula(junctor, rightsubs);
-                    subformulae = vector<PLFormula>{left, right};
-                } else if (subformulae.size() == 1) {
-                    auto subf = subformulae[0];
-                    junctor = subf.junctor;
-                    literal = subf.literal;
-                    subformulae = subf.subformulae;
-                } else if (subformulae.empty()) {
-                    cout << "Invalid formula, junctor has " << subformulae.size() << " operands\n";
-                    cout << toString() << "\n";
-                    exit(-1);
+        namespace {
+            // Shared subformulae are only rewritten once
+            PLFormula binary(PLFormula f, unordered_map<uint32_t, PLFormula> &done) {
+                auto it = done.find(f.getId());
+                if (it != done.end()) {
+                    return it->second;
                 }
+                Junctor junctor = f.getJunctor();
+                vector<PLFormula> subformulae = f.getSubformulae();
+                PLFormula result = f;
+                if (junctor == Junctor::AND || junctor == Junctor::OR) {
+                    if (subformulae.size() > 2) {
+                        PLFormula left = binary(subformulae[0], done);
+                        vector<PLFormula> rightsubs(subformulae.begin() + 1, subformulae.end());
+                        PLFormula right = binary(makeNode(junctor, rightsubs), done);
+                        result = makeNode(junctor, vector<PLFormula>{left, right});
+                    } else if (subformulae.size() == 1) {
+                        result = binary(subformulae[0], done);
+                    } else if (subformulae.empty()) {
+                        cout << "Invalid formula, junctor has " << subformulae.size() << " operands\n";
+                        cout << f.toString() << "\n";
+                        exit(-1);
+                    } else {
+                        PLFormula left = binary(subformulae[0], done);
+                        PLFormula right = binary(subformulae[1], done);
+                        result = makeNode(junctor, vector<PLFormula>{left, right});
+                    }
+                } else if (junctor == Junctor::NOT) {
+                    result = PLFormula::lnot(binary(subformulae[0], done));
+                }
+                done.emplace(f.getId(), result);
+                return result;
             }
-            for (int i = 0; i < subformulae.size(); i++) {
-                subformulae[i].makeBinary();
-            }
+        }
+
+        void PLFormula::makeBinary() {
+            unordered_map<uint32_t, PLFormula> done;
+            *this = binary(*this, done);
         }
 
         int PLFormula::depth() {
-            if (junctor == Junctor::LIT) {
-                return 1;
-            } else {
-                int max = -1;
-                for (int i = 0; i < subformulae.size(); i++) {
-                    int d = subformulae[i].depth();
-                    if (d > max) {
-                        max = d;
-                    }
-                }
-                return max + 1;
-            }
+            return FormulaArena::current().node(*this).depth;
         }
 
         bool PLFormula::isFalse() {
-            if (junctor == Junctor::AND){
+            if (getJunctor() == Junctor::AND) {
+                vector<PLFormula> subformulae = getSubformulae();
                 if (subformulae.size() == 2) {
                     if (subformulae[0].getLiteral() == -subformulae[1].getLiteral()) {
                         return true;
@@ -144,234 +234,123 @@ namespace RegularEncoding {
             return false;
         }
 
-        int PLFormula::size() {
-            if (junctor == Junctor::LIT) {
-                return 1;
-            } else {
-                int sz = 1;
-                for (int i = 0; i < subformulae.size(); i++) {
-                    int d = subformulae[i].size();
-                    sz+=d;
-                }
-                return sz;
-            }
+        size_t PLFormula::size() {
+            return FormulaArena::current().node(*this).size;
         }
 
         int PLFormula::max_var() {
-            if (junctor == Junctor::LIT) {
-                return abs(literal);
-            } else {
-                int max = -1;
-                for (int i = 0; i < subformulae.size(); i++) {
-                    int v = subformulae[i].max_var();
-                    if (v > max) {
-                        max = v;
-                    }
-                }
-                return max;
-            }
-        }
-
-        PLFormula PLFormula::lit(int literal) {
-            return PLFormula(literal);
+            return FormulaArena::current().node(*this).maxVar;
         }
 
-        PLFormula PLFormula::land(std::vector<PLFormula> subformulae) {
-            return PLFormula(Junctor::AND, subformulae);
+        Junctor PLFormula::getJunctor() {
+            return FormulaArena::current().node(*this).junctor;
         }
 
-        PLFormula PLFormula::lor(std::vector<PLFormula> subformulae) {
-            return PLFormula(Junctor::OR, subformulae);
+        vector<PLFormula> PLFormula::getSubformulae() {
+            const FormulaArena &arena = FormulaArena::current();
+            const FormulaArena::Node &n = arena.node(*this);
+            const uint32_t *children = arena.children(n);
+            vector<PLFormula> subformulae;
+            subformulae.reserve(n.count);
+            for (uint32_t i = 0; i < n.count; i++) {
+                subformulae.push_back(PLFormula(children[i]));
+            }
+            return subformulae;
         }
 
-        PLFormula PLFormula::lnot(PLFormula subformula) {
-            return PLFormula(Junctor::NOT, vector<PLFormula>{subformula});
+        int PLFormula::getLiteral() const {
+            return FormulaArena::current().node(*this).literal;
         }
 
-
-        PLFormulaPtd::PLFormulaPtd(int lit): junctor(Junctor::LIT), literal(lit), subformulae(vector<shared_ptr<PLFormulaPtd>>{}) {};
-
-        PLFormulaPtd::PLFormulaPtd(Junctor junctor, std::vector<std::shared_ptr<PLFormulaPtd>> subformulae) : junctor(junctor),
-                                                                                    subformulae(subformulae),
-                                                                                    literal(0) {}
-
-        shared_ptr<PLFormulaPtd> PLFormulaPtd::lor(std::vector<std::shared_ptr<PLFormulaPtd>> f) { return make_shared<PLFormulaPtd>(PLFormulaPtd(Junctor::OR, f));}
-        shared_ptr<PLFormulaPtd> PLFormulaPtd::land(std::vector<std::shared_ptr<PLFormulaPtd>> f) { return make_shared<PLFormulaPtd>(PLFormulaPtd(Junctor::AND, f));}
-        shared_ptr<PLFormulaPtd> PLFormulaPtd::lit(int f) { return make_shared<PLFormulaPtd>(PLFormulaPtd(f));}
-        shared_ptr<PLFormulaPtd> PLFormulaPtd::lnot(std::shared_ptr<PLFormulaPtd> f) {
-            vector<shared_ptr<PLFormulaPtd>> n;
-            n.push_back(f);
-            return make_shared<PLFormulaPtd>(PLFormulaPtd(Junctor::NOT, n));
+        PLFormula PLFormula::lit(int literal) {
+            return FormulaArena::current().make(Junctor::LIT, literal, nullptr, 0);
         }
 
-
-
-        string PLFormulaPtd::toString() {
-            stringstream ss;
-
-            switch (junctor) {
-
-                case Junctor::LIT:
-                    ss << literal;
-                    break;
-                case Junctor::AND:
-                    ss << "AND (";
-                    for (auto s: subformulae) {
-                        ss << s->toString();
-                        ss << " ";
-                    }
-                    ss << ") ";
-                    break;
-                case Junctor::OR:
-                    ss << "OR(";
-                    for (auto s: subformulae) {
-                        ss << s->toString();
-                        ss << " ";
-                    }
-                    ss << ") ";
-                    break;
-                case Junctor::NOT:
-                    ss << "-(";
-                    for (auto s: subformulae) {
-                        ss << s->toString();
-                        ss << " ";
-                    }
-                    ss << ") ";
-                    break;
-            }
-
-            return ss.str();
+        PLFormula PLFormula::land(const std::vector<PLFormula> &subformulae) {
+            return makeNode(Junctor::AND, subformulae);
         }
 
-        int PLFormulaPtd::size() {
-            if (junctor == Junctor::LIT) {
-                return 1;
-            } else {
-                int sz = 1;
-                for (int i = 0; i < subformulae.size(); i++) {
-                    int d = subformulae[i]->size();
-                    sz+=d;
-                }
-                return sz;
-            }
+        PLFormula PLFormula::lor(const std::vector<PLFormula> &subformulae) {
+            return makeNode(Junctor::OR, subformulae);
         }
 
-        std::shared_ptr<PLFormulaPtd> PLFormulaPtd::fromPLF(PLFormula &f) {
-            if (f.getJunctor() == Junctor::LIT) {
-                auto x = PLFormulaPtd::lit(f.getLiteral());
-                return x;
-            }
-            if (f.getJunctor() == Junctor::AND) {
-                vector<shared_ptr<PLFormulaPtd>> chldn;
-                for (auto c: f.getSubformulae()) {
-                    chldn.push_back(PLFormulaPtd::fromPLF(c));
-                }
-                return PLFormulaPtd::land(chldn);
-            }
-            if (f.getJunctor() == Junctor::OR) {
-                vector<shared_ptr<PLFormulaPtd>> chldn;
-                for (auto c: f.getSubformulae()) {
-                    chldn.push_back(PLFormulaPtd::fromPLF(c));
-                }
-                return PLFormulaPtd::lor(chldn);
-            }
-            if (f.getJunctor() == Junctor::NOT) {
-                shared_ptr<PLFormulaPtd> ch = PLFormulaPtd::fromPLF(f.getSubformulae()[0]);
-                return PLFormulaPtd::lnot(ch);
-            }
-
+        PLFormula PLFormula::lnot(PLFormula subformula) {
+            return makeNode(Junctor::NOT, vector<PLFormula>{subformula});
         }
 
 
-
         namespace {
-            shared_ptr<PLFormulaPtd>
-            defstep(Junctor, shared_ptr<PLFormulaPtd> , shared_ptr<PLFormulaPtd> , list<tuple<int, shared_ptr<PLFormulaPtd>>> &, Glucose::Solver &solver);
-
-            shared_ptr<PLFormulaPtd>
-            maincnf(shared_ptr<PLFormulaPtd> &f, list<tuple<int, shared_ptr<PLFormulaPtd>>> &defs, Glucose::Solver &solver) {
-
-                if (f->getJunctor() == Junctor::AND) {
-                    return defstep(Junctor::AND, f->getSubformulae()[0], f->getSubformulae()[1], defs, solver);
-                } else if (f->getJunctor() == Junctor::OR) {
-                    return defstep(Junctor::OR, f->getSubformulae()[0], f->getSubformulae()[1], defs, solver);
-                } else if (f->getJunctor() == Junctor::NOT) {
-                    int lit = -f->getSubformulae()[0]->getLiteral();
-                    return PLFormulaPtd::lit(lit);
-                } else {
-                    // Literal
-                    return PLFormulaPtd::lit(f->getLiteral());
-                }
-
-            }
-            int c = 0;
-            shared_ptr<PLFormulaPtd>
-            defstep(Junctor junctor, shared_ptr<PLFormulaPtd> f1, shared_ptr<PLFormulaPtd> f2, list<tuple<int, shared_ptr<PLFormulaPtd>>> &defs, Glucose::Solver &solver) {
-
+            /**
+             * Defines one fresh variable per AND/OR node of the DAG.
+             * Shared nodes are defined once, n-ary junctors are encoded directly instead of being made binary.
+             */
+            class Tseytin {
+            public:
+                Tseytin(const FormulaArena &arena, Glucose::Solver &solver, ClauseSink &sink)
+                        : arena(arena), solver(solver), sink(sink), defs(arena.size(), undefined) {}
+
+                int literal(uint32_t id) {
+                    const FormulaArena::Node &n = arena.node(arena.formula(id));
+                    const uint32_t *children = arena.children(n);
+                    if (n.junctor == Junctor::LIT) {
+                        return n.literal;
+                    } else if (n.junctor == Junctor::NOT) {
+                        return -literal(children[0]);
+                    } else if (n.count == 1) {
+                        return literal(children[0]);
+                    }
+                    if (defs[id] != undefined) {
+                        return defs[id];
+                    }
 
-                shared_ptr<PLFormulaPtd> left = maincnf(f1, defs, solver);
-                shared_ptr<PLFormulaPtd> right = maincnf(f2, defs, solver);
-                vector<shared_ptr<PLFormulaPtd>> chld{left, right};
+                    vector<int> chld;
+                    chld.reserve(n.count);
+                    for (uint32_t i = 0; i < n.count; i++) {
+                        chld.push_back(literal(children[i]));
+                    }
 
+                    int l = solver.newVar();
+                    if (n.junctor == Junctor::AND) {
+                        // l <-> fl1 /\ ... /\ fln <==> (-l \/ fl1) /\ ... /\ (-l \/ fln) /\ (-fl1 \/ ... \/ -fln \/ l)
+                        for (int fln: chld) {
+                            sink.addClause({-l, fln});
+                        }
+                        sink.push(l);
+                        for (int fln: chld) {
+                            sink.push(-fln);
+                        }
+                        sink.commit();
+                    } else if (n.junctor == Junctor::OR) {
+                        // l <-> fl1 \/ ... \/ fln <==> (-l \/ fl1 \/ ... \/ fln) /\ (l \/ -fl1) ... /\ (l \/ -fln)
+                        for (int fln: chld) {
+                            sink.addClause({l, -fln});
+                        }
+                        sink.push(-l);
+                        for (int fln: chld) {
+                            sink.push(fln);
+                        }
+                        sink.commit();
+                    } else {
+                        throw logic_error("Something went wrong :S");
+                    }
+                    defs[id] = l;
+                    return l;
+                }
 
-                shared_ptr<PLFormulaPtd> phi = (junctor == Junctor::AND) ? PLFormulaPtd::land(chld)
-                                                          : PLFormulaPtd::lor(chld);
+            private:
+                static constexpr int undefined = std::numeric_limits<int>::min();
 
-                int n2 = solver.newVar();
-                tuple<int, shared_ptr<PLFormulaPtd>> newDef = make_tuple(n2, phi);
-                defs.push_back(newDef);
-                return PLFormulaPtd::lit(n2);
-            }
+                const FormulaArena &arena;
+                Glucose::Solver &solver;
+                ClauseSink &sink;
+                vector<int> defs;
+            };
         }
 
-        set<set<int>> tseytin_cnf(PLFormula &formula, Glucose::Solver &solver) {
-
-            formula.makeBinary();
-
-            cout.flush();
-            list<tuple<int, shared_ptr<PLFormulaPtd>>> tmp{};
-
-            shared_ptr<PLFormulaPtd> plfp = PLFormulaPtd::fromPLF(formula);
-
-
-            PLFormulaPtd phi = *maincnf(plfp, tmp, solver);
-
-            set<set<int>> cnf{};
-            cnf.insert(set<int>{phi.getLiteral()});
-
-            for (auto def: tmp) {
-
-                int l = get<0>(def);
-                PLFormulaPtd fl = *get<1>(def);
-
-
-                if (fl.getJunctor() == Junctor::AND) {
-                    // l <-> fl1 /\ ... /\ fln <==> (-l \/ fl1) /\ ... /\ (-l \/ fln) /\ (-fl1 \/ ... \/ -fln \/ l)
-                    set<int> rtl = set<int>{l};
-                    for (int n = 0; n < fl.getSubformulae().size(); n++) {
-                        shared_ptr<PLFormulaPtd> fln = fl.getSubformulae()[n];
-                        rtl.insert(-fln->getLiteral());
-                        set<int> lrtn{-l, fln->getLiteral()};
-                        cnf.insert(lrtn);
-                    }
-                    cnf.insert(rtl);
-                } else if (fl.getJunctor() == Junctor::OR) {
-                    // l <-> fl1 \/ ... \/ fln <==> (-l \/ fl1 \/ ... \/ fln) /\ (l \/ -fl1) ... /\ (l \/ -fln)
-                    set<int> ltr = set<int>{-l};
-                    for (int n = 0; n < fl.getSubformulae().size(); n++) {
-                        shared_ptr<PLFormulaPtd> fln = fl.getSubformulae()[n];
-                        ltr.insert(fln->getLiteral());
-                        set<int> rtln{l, -fln->getLiteral()};
-                        cnf.insert(rtln);
-                    }
-                    cnf.insert(ltr);
-                } else {
-                    throw logic_error("Something went wrong :S");
-                }
-
-            }
-            return cnf;
+        void tseytin_cnf(PLFormula &formula, Glucose::Solver &solver, ClauseSink &sink) {
+            Tseytin tseytin(FormulaArena::current(), solver, sink);
+            sink.addClause({tseytin.literal(formula.getId())});
         }
 
     }
-}
\ No newline at end of file
+}
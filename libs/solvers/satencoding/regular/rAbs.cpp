@@ -196,7 +196,7 @@ namespace RegularEncoding {
          */
 
         // i = transtitions done, N = max transtitions
-        vector<vector<unordered_set<int>>> buildS(int N, map<int, set<pair<Words::Terminal *, int>>> &delta) {
+        vector<vector<unordered_set<int>>> buildS(int N, Automaton::NFA &nfa) {
             auto start = chrono::high_resolution_clock::now();
 
             //TODO: cache
@@ -212,13 +212,14 @@ namespace RegularEncoding {
 
             int p = pow(N, 2);
 
+            // Build the transition indexes before the parallel region, the views are read only
+            nfa.numTransitions();
             int q;
             for (int i = 1; i < p; i++) {
                 #pragma omp parallel for
                 for (q = 0; q < N; q++) {
                     for (int pre: Sq[q][i - 1]) {
-                        for (auto &tr: delta[pre]) {
-                            #pragma omp critical
+                        for (auto &tr: nfa.successors(pre)) {
                             Sq[q][i].insert(tr.second);
                         }
                     }
@@ -238,11 +239,10 @@ namespace RegularEncoding {
             adjm = buildAdjacencyMatrix();
             statewiserAbs = std::map<int, std::shared_ptr<ArithmeticProgressions>>{};
             N = int(adjm.size());
-            auto delta = nfa.getDelta();
 
 
             if (buildSCache.count(nfa.toString()) == 0) {
-                Sq = buildS(N, delta);
+                Sq = buildS(N, nfa);
                 buildSCache[nfa.toString()] = Sq;
             } else {
                 Sq = buildSCache.at(nfa.toString());
@@ -250,7 +250,7 @@ namespace RegularEncoding {
 
 
 
-            if (!nfa.getDelta().empty()) {
+            if (!nfa.numTransitions() == 0) {
 
                 sccs = commons::scc(adjm);
 
@@ -286,7 +286,7 @@ namespace RegularEncoding {
 
 
             // No transitions, length abstraction is (0,0) if q0 in F, and {} otherwise
-            if (nfa.getDelta().empty()) {
+            if (nfa.numTransitions() == 0) {
                 if (nfa.getFinalStates().count(nfa.getInitialState()) > 0) {
                     ArithmeticProgressions aps;
                     aps.add(make_pair(0, 0));
@@ -566,11 +566,9 @@ namespace RegularEncoding {
                 matrix[i] = row;
             }
 
-            for (auto trans: nfa.getDelta()) {
-                int qsrc = trans.first;
-                for (auto target: trans.second) {
-                    int qt = target.second;
-                    matrix[qsrc][qt] = true;
+            for (int qsrc = 0; qsrc < n; qsrc++) {
+                for (auto &target: nfa.successors(qsrc)) {
+                    matrix[qsrc][target.second] = true;
                 }
             }
             return matrix;
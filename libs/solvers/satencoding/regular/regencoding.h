@@ -14,7 +14,9 @@
 #include "core/Solver.h"
 #include <fstream>
 #include <ctime>
+#include <cstdint>
 #include "nfa.h"
+#include "clausesink.h"
 
 namespace RegularEncoding {
 
@@ -32,21 +34,25 @@ namespace RegularEncoding {
             AND = 1, OR = 2, NOT = 3, LIT = 0
         };
 
+        class FormulaArena;
+
+        /**
+         * Handle of a formula node in the current FormulaArena.
+         * Nodes are hash-consed, building the same formula twice yields the same node,
+         * so a handle is only valid as long as the arena it was created in.
+         */
         class PLFormula {
         private:
-            PLFormula(Junctor, std::vector<PLFormula>);
+            explicit PLFormula(uint32_t id) : id(id) {}
 
-            explicit PLFormula(int); // Literal formula
-            //~PLFormula();
+            uint32_t id;
 
-            Junctor junctor;
-            int literal;
-            std::vector<PLFormula> subformulae;
+            friend class FormulaArena;
 
         public:
-            static PLFormula land(std::vector<PLFormula>);
+            static PLFormula land(const std::vector<PLFormula> &);
 
-            static PLFormula lor(std::vector<PLFormula>);
+            static PLFormula lor(const std::vector<PLFormula> &);
 
             static PLFormula lnot(PLFormula);
 
@@ -60,7 +66,7 @@ namespace RegularEncoding {
 
             int depth();
 
-            int size();
+            size_t size();
 
             void makeBinary();
 
@@ -68,50 +74,80 @@ namespace RegularEncoding {
 
             std::string toString();
 
-            Junctor getJunctor() { return junctor; }
+            Junctor getJunctor();
+
+            std::vector<PLFormula> getSubformulae();
 
-            std::vector<PLFormula> getSubformulae() { return subformulae; }
+            int getLiteral() const;
 
-            int getLiteral() const { return literal; }
+            uint32_t getId() const { return id; }
+
+            bool operator==(const PLFormula &other) const { return id == other.id; }
         };
 
-        class PLFormulaPtd {
-        private:
-            PLFormulaPtd(Junctor, std::vector<std::shared_ptr<PLFormulaPtd>>);
+        /**
+         * Stores the nodes of a formula DAG in flat arrays, the children of a node are
+         * a contiguous range of node ids.
+         * Formulas are built in the current arena of the thread, which is a
+         * thread-local default unless a Scope installed another one.
+         */
+        class FormulaArena {
+        public:
+            struct Node {
+                Junctor junctor;
+                int literal;
+                uint32_t first; // first child in children
+                uint32_t count;
+                int depth;
+                int maxVar;
+                size_t size;   // size of the formula as a tree
+            };
 
-            explicit PLFormulaPtd(int); // Literal formula
-            //~PLFormula();
+            // Installs a fresh arena as the current one, the previous one is restored on destruction
+            class Scope {
+            public:
+                Scope();
 
-            Junctor junctor;
-            int literal;
-            std::vector<std::shared_ptr<PLFormulaPtd>> subformulae;
+                ~Scope();
 
-        public:
-            static std::shared_ptr<PLFormulaPtd> land(std::vector<std::shared_ptr<PLFormulaPtd>>);
+                Scope(const Scope &) = delete;
 
-            static std::shared_ptr<PLFormulaPtd> lor(std::vector<std::shared_ptr<PLFormulaPtd>>);
+                Scope &operator=(const Scope &) = delete;
 
-            static std::shared_ptr<PLFormulaPtd> lnot(std::shared_ptr<PLFormulaPtd>);
+            private:
+                FormulaArena *arena;
+                FormulaArena *previous;
+            };
 
-            static std::shared_ptr<PLFormulaPtd> lit(int);
+            FormulaArena() : table(1024, 0) {}
 
-            void makeBinary();
+            static FormulaArena &current();
 
-            static std::shared_ptr<PLFormulaPtd> fromPLF(PLFormula &f);
+            // Returns the node of the given formula, creates it if it does not exist yet
+            PLFormula make(Junctor, int literal, const uint32_t *children, size_t n);
 
+            const Node &node(PLFormula f) const { return nodes[f.id]; }
 
-            int size();
+            PLFormula formula(uint32_t id) const { return PLFormula(id); }
 
-            std::string toString();
+            const uint32_t *children(const Node &n) const { return childIds.data() + n.first; }
+
+            size_t size() const { return nodes.size(); }
+
+        private:
+            size_t hash(Junctor, int literal, const uint32_t *children, size_t n) const;
 
-            Junctor getJunctor() { return junctor; }
+            bool equals(const Node &, Junctor, int literal, const uint32_t *children, size_t n) const;
 
-            std::vector<std::shared_ptr<PLFormulaPtd>> getSubformulae() { return subformulae; }
+            void grow();
 
-            int getLiteral() const { return literal; }
+            std::vector<Node> nodes;
+            std::vector<uint32_t> childIds;
+            std::vector<uint32_t> table; // open addressing, node id + 1, 0 is empty
         };
 
-        std::set<std::set<int>> tseytin_cnf(PLFormula &, Glucose::Solver &s);
+        // Emits the Tseytin transformation of the formula, definitions get fresh variables of s
+        void tseytin_cnf(PLFormula &, Glucose::Solver &s, ClauseSink &sink);
 
     } // namespace PropositionalLogic
 
@@ -0,0 +1,140 @@
+#pragma once
+#include <cassert>
+#include <vector>
+
+#include "core/Solver.h"
+#include "words/words.hpp"
+
+namespace RegularEncoding {
+
+/**
+ * Dense (variable, position, letter) -> Var cube of the SAT encoding.
+ * The letters of a position and the positions of a variable are stored
+ * contiguously, letter `sigmaSize` stands for epsilon.
+ * Cells that were not created yet hold var_Undef.
+ */
+class VariableTable {
+   public:
+    void reset(int variables, int letters) {
+        numVariables = variables;
+        numLetters = letters;
+        numPositions = 0;
+        cells.clear();
+    }
+
+    // Makes room for the positions [0, positions) of every variable, keeping the existing cells
+    void reservePositions(int positions) {
+        if (positions <= numPositions) {
+            return;
+        }
+        std::vector<Glucose::Var> grown(static_cast<size_t>(numVariables) * positions * numLetters, var_Undef);
+        for (int i = 0; i < numVariables; i++) {
+            std::copy(cells.begin() + index(i, 0, 0), cells.begin() + index(i, numPositions, 0), grown.begin() + static_cast<size_t>(i) * positions * numLetters);
+        }
+        numPositions = positions;
+        cells.swap(grown);
+    }
+
+    bool contains(int variable, int position, int letter) const {
+        return variable >= 0 && variable < numVariables && position >= 0 && position < numPositions && letter >= 0 && letter < numLetters &&
+               cells[index(variable, position, letter)] != var_Undef;
+    }
+
+    Glucose::Var &operator()(int variable, int position, int letter) {
+        assert(variable < numVariables && position < numPositions && letter < numLetters);
+        return cells[index(variable, position, letter)];
+    }
+
+    Glucose::Var operator()(int variable, int position, int letter) const {
+        assert(contains(variable, position, letter));
+        return cells[index(variable, position, letter)];
+    }
+
+    // All letters of one position
+    const Glucose::Var *letters(int variable, int position) const { return cells.data() + index(variable, position, 0); }
+
+    int variables() const { return numVariables; }
+
+    int positions() const { return numPositions; }
+
+   private:
+    size_t index(int variable, int position, int letter) const { return (static_cast<size_t>(variable) * numPositions + position) * numLetters + letter; }
+
+    int numVariables = 0;
+    int numPositions = 0;
+    int numLetters = 0;
+    std::vector<Glucose::Var> cells;
+};
+
+/**
+ * Dense (letter, letter) -> Var table of the constants C_{i,j}, which are true iff i == j.
+ */
+class ConstantTable {
+   public:
+    void reset(int letters) {
+        numLetters = letters;
+        cells.assign(static_cast<size_t>(letters) * letters, var_Undef);
+    }
+
+    bool contains(int i, int j) const { return i >= 0 && i < numLetters && j >= 0 && j < numLetters && cells[i * numLetters + j] != var_Undef; }
+
+    Glucose::Var &operator()(int i, int j) {
+        assert(i < numLetters && j < numLetters);
+        return cells[i * numLetters + j];
+    }
+
+    Glucose::Var operator()(int i, int j) const {
+        assert(contains(i, j));
+        return cells[i * numLetters + j];
+    }
+
+    // All letters j of C_{i,j}
+    const Glucose::Var *letters(int i) const { return cells.data() + i * numLetters; }
+
+   private:
+    int numLetters = 0;
+    std::vector<Glucose::Var> cells;
+};
+
+/**
+ * Maps the variables resp. terminals of an encoding to consecutive indices.
+ * Lookups go through IEntry::getIndex, which is dense per symbol kind of a context.
+ */
+template <class Symbol>
+class SymbolIndices {
+   public:
+    void clear() {
+        indices.clear();
+        count = 0;
+    }
+
+    bool contains(Symbol *s) const {
+        size_t i = s->getIndex();
+        return i < indices.size() && indices[i] >= 0;
+    }
+
+    int at(Symbol *s) const {
+        assert(contains(s));
+        return indices[s->getIndex()];
+    }
+
+    // Returns the index of s, assigning the next free one if s is new
+    int insert(Symbol *s) {
+        size_t i = s->getIndex();
+        if (i >= indices.size()) {
+            indices.resize(i + 1, -1);
+        }
+        if (indices[i] < 0) {
+            indices[i] = count++;
+        }
+        return indices[i];
+    }
+
+    size_t size() const { return count; }
+
+   private:
+    std::vector<int> indices;
+    int count = 0;
+};
+
+}  // namespace RegularEncoding
@@ -10,9 +10,8 @@ using namespace chrono;
 using namespace RegularEncoding::PropositionalLogic;
 
 namespace RegularEncoding {
-int skipped = 0;
 
-set<set<int>> InductiveEncoder::encode() {
+void InductiveEncoder::encode(ClauseSink &sink) {
     skipped = 0;
     auto startEncoding = chrono::high_resolution_clock::now();
     cout << "\n[*] Encoding ";
@@ -42,21 +41,17 @@ set<set<int>> InductiveEncoder::encode() {
     profiler.skipped = skipped;
 
     auto startTsey = high_resolution_clock::now();
-    set<set<int>> cnf = tseytin_cnf(f, solver);
+    size_t clausesBefore = sink.clauses();
+    size_t literalsBefore = sink.literals();
+    tseytin_cnf(f, solver, sink);
     auto stopTsy = high_resolution_clock::now();
     auto durationTsey = duration_cast<milliseconds>(stopTsy - startTsey);
     profiler.timeTseytin = durationTsey.count();
 
-    int litTotal = 0;
-    for (const auto &cl : cnf) {
-        litTotal += int(cl.size());
-    }
-
     auto stopEncoding = chrono::high_resolution_clock::now();
     auto durationEncoding = duration_cast<milliseconds>(stopEncoding - startEncoding);
-    cout << "\t - CNF done, " << cnf.size() << " clauses and " << litTotal << " literals in total\n";
+    cout << "\t - CNF done, " << sink.clauses() - clausesBefore << " clauses and " << sink.literals() - literalsBefore << " literals in total\n";
     cout << "[*] Encoding done. Took " << durationEncoding.count() << "ms" << endl;
-    return cnf;
 }
 
 PLFormula InductiveEncoder::doEncode(const vector<FilledPos> &filledPat, const shared_ptr<Words::RegularConstraints::RegNode> &expression) {
@@ -320,7 +315,7 @@ PLFormula InductiveEncoder::encodeWord(vector<FilledPos> filledPat, vector<int>
                     return ffalse;
                 } else {
                     pair<int, int> xij = fp.getVarIndex();
-                    auto word = variableVars->at(make_pair(xij, sigmaSize));
+                    auto word = (*variableVars)(xij.first, xij.second, sigmaSize);
                     conj.push_back(PLFormula::lit(word));
                 }
             }
@@ -355,11 +350,11 @@ PLFormula InductiveEncoder::encodeWord(vector<FilledPos> filledPat, vector<int>
                     valid = false;
                     break;
                 }
-                auto word = constantsVars->at(make_pair(ci, k));
+                auto word = (*constantsVars)(ci, k);
                 conj.push_back(PLFormula::lit(word));
             } else {
                 pair<int, int> xij = filledPat[i].getVarIndex();
-                auto word = variableVars->at(make_pair(xij, k));
+                auto word = (*variableVars)(xij.first, xij.second, k);
                 conj.push_back(PLFormula::lit(word));
             }
         }
@@ -370,13 +365,13 @@ PLFormula InductiveEncoder::encodeWord(vector<FilledPos> filledPat, vector<int>
         // Match j+1-th position in pat to lambda and match pattern[j+2:] to expression[j:]
         if (j + 1 < filledPat.size()) {
             pair<int, int> xij = filledPat[j + 1].getVarIndex();
-            auto word = variableVars->at(make_pair(xij, sigmaSize));
+            auto word = (*variableVars)(xij.first, xij.second, sigmaSize);
             conj.push_back(PLFormula::lit(word));
 
             // Remaining of this variable must also be set to lambda
             int k = j + 2;
             while (k < filledPat.size() && filledPat[k].isVariable() && filledPat[k].getVarIndex().first == xij.first) {
-                auto wordLambda = variableVars->at(make_pair(filledPat[k].getVarIndex(), sigmaSize));
+                auto wordLambda = (*variableVars)(xij.first, filledPat[k].getVarIndex().second, sigmaSize);
                 conj.push_back(PLFormula::lit(wordLambda));
 
                 k++;
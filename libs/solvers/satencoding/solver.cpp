@@ -2,6 +2,7 @@
 #include <iostream>
 
 #include <numeric>
+#include <thread>
 
 #include "words/exceptions.hpp"
 #include "words/words.hpp"
@@ -11,6 +12,7 @@
 #include "core/Solver.h"
 #include "solver.hpp"
 #include "regular/regencoding.h"
+#include "encodingcontext.hpp"
 //#include "regular/commons.h"
 
 
@@ -20,18 +22,6 @@ namespace commons {
 
 
 
-Words::Solvers::Result setupSolverMain(Words::Options &opt); //std::vector<std::string>&, std::vector<std::string>&);
-void clearLinears();
-
-void addLinearConstraint(std::vector<std::pair<Words::Variable *, int>> lhs, int rhs);
-
-template<bool>
-::Words::Solvers::Result runSolver(const bool squareAuto, size_t bound, const Words::Context &, Words::Substitution &,
-                                   Words::Solvers::Timing::Keeper &, std::ostream *,
-                                   RegularEncoding::EncodingProfiler *);
-
-
-
 namespace Words {
     namespace Solvers {
         namespace SatEncoding {
@@ -39,6 +29,15 @@ namespace Words {
             ::Words::Solvers::Result
             Solver<encoding>::Solve(Words::Options &opt, ::Words::Solvers::MessageRelay &relay) {
                 relay.pushMessage("SatSolver Ready");
+                {
+                    std::lock_guard<std::mutex> lock(contextsMutex);
+                    contexts.clear();
+                    for (size_t k = 0; k < concurrentBounds; k++) {
+                        contexts.push_back(std::make_unique<EncodingContext>());
+                    }
+                }
+                if (stop)
+                    return ::Words::Solvers::Result::NoIdea;
                 if (opt.hasIneqquality())
                     return ::Words::Solvers::Result::NoIdea;
                 /*if (!opt.context->conformsToConventions ())  {
@@ -84,17 +83,19 @@ namespace Words {
                     rhs.push_back(str.str());
                 }
 
-                Words::Solvers::Result retPreprocessing = setupSolverMain(opt); //(lhs,rhs);
-                // preprocessing match
-                if (retPreprocessing != Words::Solvers::Result::NoIdea) {
-                    return retPreprocessing;
-                }
+                for (auto &context: contexts) {
+                    Words::Solvers::Result retPreprocessing = context->setupSolverMain(opt); //(lhs,rhs);
+                    // preprocessing match
+                    if (retPreprocessing != Words::Solvers::Result::NoIdea) {
+                        return retPreprocessing;
+                    }
 
-                clearLinears();
+                    context->clearLinears();
 
-                for (auto &constraint: opt.constraints) {
-                    if (!handleConstraint(*constraint, relay, entry))
-                        return ::Words::Solvers::Result::NoIdea;
+                    for (auto &constraint: opt.constraints) {
+                        if (!handleConstraint(*context, *constraint, relay, entry))
+                            return ::Words::Solvers::Result::NoIdea;
+                    }
                 }
 
 
@@ -139,13 +140,25 @@ namespace Words {
 
                 Words::Solvers::Result ret = Words::Solvers::Result::NoSolution;
                 std::vector<RegularEncoding::EncodingProfiler> profilers;
-                while (i < actualb || i < actualbre) {
+                if (contexts.size() > 1) {
+                    ret = raceBounds(*opt.context, i + 1, std::max(actualb, actualbre), profilers);
+                    if (ret == Words::Solvers::Result::DefinitelyNoSolution)
+                        return ret;
+                    commons::profileToCsv(profilers);
+                    if (stop && ret != Words::Solvers::Result::HasSolution)
+                        return ::Words::Solvers::Result::NoIdea;
+                    return ret;
+                }
+                EncodingContext &context = *contexts.front();
+                // runSolver keeps its SAT solver (and learnt clauses) across the
+                // iterations; setupSolverMain started a fresh one for this instance
+                while ((i < actualb || i < actualbre) && !stop) {
                     i++;
                     int currentBound = std::pow(i, 2);
                     try {
                         RegularEncoding::EncodingProfiler profiler{};
-                        ret = runSolver<encoding>(false, static_cast<size_t> (currentBound), *opt.context, sub,
-                                                  timekeep, (diagnostic ? &diagStr : nullptr), &profiler);
+                        ret = context.runSolver<encoding>(false, static_cast<size_t> (currentBound), *opt.context, sub,
+                                                          timekeep, (diagnostic ? &diagStr : nullptr), &profiler);
                         profilers.push_back(profiler);
                         if (ret == Words::Solvers::Result::HasSolution) {
                             commons::profileToCsv(profilers);
@@ -158,8 +171,87 @@ namespace Words {
                     }
                 }
                 commons::profileToCsv(profilers);
+                if (stop)
+                    return ::Words::Solvers::Result::NoIdea;
+                return ret;
+
+            }
+
+            // Solves the bounds first^2, ..., last^2 with one thread per context. Each
+            // thread takes the smallest bound not started yet, so the bounds of one
+            // context still grow and it can keep its solver. A solution or a
+            // bound-independent unsat at any bound interrupts the other threads.
+            template<bool encoding>
+            ::Words::Solvers::Result
+            Solver<encoding>::raceBounds(const Words::Context &ctx, int first, int last,
+                                         std::vector<RegularEncoding::EncodingProfiler> &profilers) {
+                std::atomic<int> next{first};
+                // Guards everything below as well as sub, timekeep, diagStr and profilers
+                std::mutex mutex;
+                bool decided = false;
+                ::Words::Solvers::Result ret = ::Words::Solvers::Result::NoSolution;
+                std::exception_ptr error;
+                auto decide = [&]() {
+                    decided = true;
+                    for (auto &context: contexts) {
+                        context->interruptSolver();
+                    }
+                };
+
+                auto race = [&](EncodingContext &context) {
+                    Words::Substitution substitution;
+                    Words::Solvers::Timing::Keeper keeper;
+                    std::stringstream diag;
+                    try {
+                        for (int i = next++; i <= last && !stop; i = next++) {
+                            RegularEncoding::EncodingProfiler profiler{};
+                            auto res = context.runSolver<encoding>(false, static_cast<size_t> (i * i), ctx, substitution,
+                                                                   keeper, (diagnostic ? &diag : nullptr), &profiler);
+                            std::lock_guard<std::mutex> lock(mutex);
+                            profilers.push_back(profiler);
+                            if (decided)
+                                break;
+                            if (res == ::Words::Solvers::Result::HasSolution ||
+                                res == ::Words::Solvers::Result::DefinitelyNoSolution) {
+                                ret = res;
+                                sub = substitution;
+                                decide();
+                                break;
+                            }
+                            // Without a decision the largest bound answers, as in the sequential loop
+                            if (i == last)
+                                ret = res;
+                        }
+                    } catch (Glucose::OutOfMemoryException &e) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error)
+                            error = std::make_exception_ptr(Words::Solvers::OutOfMemoryException());
+                        decide();
+                    }
+                    std::lock_guard<std::mutex> lock(mutex);
+                    timekeep.append(keeper);
+                    diagStr << diag.str();
+                };
+
+                std::vector<std::thread> threads;
+                for (auto &context: contexts) {
+                    threads.emplace_back(race, std::ref(*context));
+                }
+                for (auto &t: threads) {
+                    t.join();
+                }
+                if (error)
+                    std::rethrow_exception(error);
                 return ret;
+            }
 
+            template<bool encoding>
+            void Solver<encoding>::interrupt() {
+                stop = true;
+                std::lock_guard<std::mutex> lock(contextsMutex);
+                for (auto &context: contexts) {
+                    context->interruptSolver();
+                }
             }
 
             //Should only be called if Result returned HasSolution
@@ -173,8 +265,8 @@ namespace Words {
 
             template<bool encoding>
             bool
-            Solver<encoding>::handleConstraint(Words::Constraints::Constraint &c, ::Words::Solvers::MessageRelay &relay,
-                                               Words::IEntry *e) {
+            Solver<encoding>::handleConstraint(EncodingContext &context, Words::Constraints::Constraint &c,
+                                               ::Words::Solvers::MessageRelay &relay, Words::IEntry *e) {
                 //std::cerr << "Handle " << c << std::endl;
                 const Words::Constraints::LinearConstraint *lc = c.getLinconstraint();
                 if (lc) {
@@ -188,7 +280,7 @@ namespace Words {
                         int coefficient = vm.number;
                         lhs.push_back(std::make_pair(vm.entry->getVariable(), coefficient));
                     }
-                    addLinearConstraint(lhs, rhs);
+                    context.addLinearConstraint(lhs, rhs);
 
                     return true;
                 } else {
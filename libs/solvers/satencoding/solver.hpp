@@ -1,12 +1,18 @@
 #ifndef _SAT_SOLVER__
 #define _SAT_SOLVER__
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 #include "words/words.hpp"
 #include "words/constraints.hpp"
 #include "solvers/solvers.hpp"
 #include "solvers/timing.hpp"
+#include "encodingcontext.hpp"
 
 namespace Words {
   namespace Solvers {
@@ -14,26 +20,37 @@ namespace Words {
 	  template<bool encoding>
 	  class Solver : public ::Words::Solvers::Solver {
 	  public:
-		Solver (size_t bound) : bound(bound) {} 
+		// concurrentBounds > 1 solves that many bounds at once on separate threads
+		Solver (size_t bound, size_t concurrentBounds = 1) : bound(bound), concurrentBounds(std::max<size_t> (concurrentBounds,1)) {} 
 		Result Solve (Words::Options&,Words::Solvers::MessageRelay&) override;
 		//Should only be called if Result returned HasSolution
 		void getResults (Words::Solvers::ResultGatherer& r) override;
 		virtual void enableDiagnosticOutput () override {
 		  diagnostic= true;
 		}
+		void interrupt () override;
 	  private:
-		bool handleConstraint (Words::Constraints::Constraint&, ::Words::Solvers::MessageRelay&,Words::IEntry* = nullptr);
+		bool handleConstraint (EncodingContext&, Words::Constraints::Constraint&, ::Words::Solvers::MessageRelay&,Words::IEntry* = nullptr);
+		Result raceBounds (const Words::Context&, int first, int last, std::vector<RegularEncoding::EncodingProfiler>&);
 		Words::Substitution sub;
 		std::stringstream diagStr;
 		bool diagnostic = false;
 		Words::Solvers::Timing::Keeper timekeep;
 		size_t bound;
+		std::atomic<bool> stop{false};
+		size_t concurrentBounds;
+		// One context per bound solved at a time, the vector is guarded by contextsMutex
+		std::vector<std::unique_ptr<EncodingContext>> contexts;
+		std::mutex contextsMutex;
 	  };
 	}
 
 	template<>
 	Solver_ptr makeSolver<Types::SatEncoding,size_t> (size_t bound ) {return std::make_unique<SatEncoding::Solver<true>> (bound);}
 
+	template<>
+	Solver_ptr makeSolver<Types::SatEncoding,size_t,size_t> (size_t bound, size_t concurrentBounds) {return std::make_unique<SatEncoding::Solver<true>> (bound,concurrentBounds);}
+
 	template<>
 	Solver_ptr makeSolver<Types::SatEncodingOld,size_t> (size_t bound) {return std::make_unique<SatEncoding::Solver<false>> (bound);}
 	
@@ -1,7 +1,9 @@
 #ifndef _ALGORITHMS__
 #define _ALGORITHMS__
 
+#include <cstdint>
 #include <unordered_map>
+#include <vector>
 #include "words/words.hpp"
 
 namespace Words {
@@ -16,6 +18,53 @@ namespace Words {
     void emptyParikhMatrix(Equation& eq, ParikhMatrix& image);
 	void calculateParikhMatrices (Word& w, ParikhMatrix& p_pm, ParikhMatrix& s_pm);
 
+	// The Parikh image of one word minus that of another, built a symbol at
+	// a time. The counters are kept densely, indexed by IEntry::getIndex (),
+	// and so is the number of variables and terminals with a count other
+	// than zero, so comparing the two images costs nothing.
+	class ParikhBalance {
+	public:
+	  // All counters zero, room for the alphabets of the context
+	  void reset (const Context& ctxt) {
+		variables.assign (ctxt.getVariableAlphabet ().size (),0);
+		terminals.assign (ctxt.getTerminalAlphabet ().size (),0);
+		unbalancedVariables = 0;
+		unbalancedTerminals = 0;
+	  }
+
+	  void add (IEntry* e) {change (e,1);}
+	  void remove (IEntry* e) {change (e,-1);}
+
+	  bool variablesBalanced () const {return !unbalancedVariables;}
+	  bool terminalsBalanced () const {return !unbalancedTerminals;}
+
+	  int64_t operator[] (IEntry* e) const {
+		auto& counts = e->isVariable () ? variables : terminals;
+		auto i = e->getIndex ();
+		return i < counts.size () ? counts[i] : 0;
+	  }
+
+	private:
+	  void change (IEntry* e, int32_t d) {
+		bool var = e->isVariable ();
+		auto& counts = var ? variables : terminals;
+		auto& unbalanced = var ? unbalancedVariables : unbalancedTerminals;
+		auto i = e->getIndex ();
+		if (i >= counts.size ()) {
+		  // Added to the context after the reset
+		  counts.resize (i+1,0);
+		}
+		unbalanced -= (counts[i] != 0);
+		counts[i] += d;
+		unbalanced += (counts[i] != 0);
+	  }
+
+	  std::vector<int32_t> variables;
+	  std::vector<int32_t> terminals;
+	  std::size_t unbalancedVariables = 0;
+	  std::size_t unbalancedTerminals = 0;
+	};
+
   }
 }
 
@@ -2,7 +2,9 @@
 #define _WORDS__
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
 #include <map>
@@ -23,36 +25,53 @@ namespace Words {
 
     class Context;
 
+    class Symbol;
+
+    class SubstitutionTable;
+
     class IEntry {
     public:
-        IEntry(char repr, size_t i, Context *ctxt)
-                : index(i), repr(repr), context(ctxt) {}
+        // Kept in every entry, so telling entries apart, indexing them and
+        // taking their length needs no virtual call
+        enum class Kind : uint8_t {
+            Terminal = 0,
+            Variable = 1,
+            Sequence = 2
+        };
+
+        IEntry(char repr, size_t i, Context *ctxt, Kind kind, size_t length = 1)
+                : index(i), repr(repr), kind(kind), len(static_cast<uint32_t>(length)), context(ctxt) {}
 
         virtual ~IEntry() {}
 
-        virtual size_t getIndex() { return index; }
+        size_t getIndex() const { return index; }
+
+        Kind getKind() const { return kind; }
+
+        // The kind and index of this entry in 32 bits
+        inline Symbol symbol() const;
 
-        virtual bool isVariable() const { return false; }
+        bool isVariable() const { return kind == Kind::Variable; }
 	
 	virtual bool isTemporary() const { return false; }
 
 	virtual void setTemporary() {}
 
-        virtual bool isTerminal() const { return false; }
+        bool isTerminal() const { return kind == Kind::Terminal; }
 
-        virtual bool isSequence() const { return false; }
+        bool isSequence() const { return kind == Kind::Sequence; }
 
-        virtual Variable *getVariable() { return nullptr; }
+        inline Variable *getVariable();
 
-        virtual Terminal *getTerminal() { return nullptr; }
+        inline Terminal *getTerminal();
 
-        virtual Sequence *getSequence() { return nullptr; }
+        inline Sequence *getSequence();
 
-        virtual const Variable *getVariable() const { return nullptr; }
+        inline const Variable *getVariable() const;
 
-        virtual const Terminal *getTerminal() const { return nullptr; }
+        inline const Terminal *getTerminal() const;
 
-        virtual const Sequence *getSequence() const { return nullptr; }
+        inline const Sequence *getSequence() const;
 
         Context *getContext() const { return context; }
 
@@ -62,23 +81,60 @@ namespace Words {
 
         virtual std::string getName() const = 0;
 
-        virtual std::size_t length() const { return 1; }
+        // Characters, more than one only for sequences
+        std::size_t length() const { return len; }
 
     private:
         size_t index;
         char repr;
+        Kind kind;
+        uint32_t len;
         Context *context;
     };
 
-    class Variable : public IEntry {
+    // A symbol of a context as its index with the kind in the two low bits,
+    // for code that would rather not follow IEntry pointers. Context::getEntry
+    // turns it back into an entry.
+    class Symbol {
     public:
-        friend class Context;
+        Symbol() = default;
+
+        Symbol(IEntry::Kind kind, size_t index)
+                : id(static_cast<uint32_t>(index) << 2 | static_cast<uint32_t>(kind)) {}
+
+        static Symbol fromRaw(uint32_t id) {
+            Symbol s;
+            s.id = id;
+            return s;
+        }
+
+        IEntry::Kind kind() const { return static_cast<IEntry::Kind>(id & 3); }
 
-        bool isVariable() const override { return true; }
+        size_t index() const { return id >> 2; }
 
-        virtual Variable *getVariable() override { return this; }
+        uint32_t raw() const { return id; }
 
-        virtual const Variable *getVariable() const override { return this; }
+        bool isVariable() const { return kind() == IEntry::Kind::Variable; }
+
+        bool isTerminal() const { return kind() == IEntry::Kind::Terminal; }
+
+        bool isSequence() const { return kind() == IEntry::Kind::Sequence; }
+
+        bool operator==(const Symbol &s) const { return id == s.id; }
+
+        bool operator!=(const Symbol &s) const { return id != s.id; }
+
+        bool operator<(const Symbol &s) const { return id < s.id; }
+
+    private:
+        uint32_t id = 0;
+    };
+
+    inline Symbol IEntry::symbol() const { return Symbol(kind, index); }
+
+    class Variable : public IEntry {
+    public:
+        friend class Context;
 
 	bool isTemporary() const override { return temp_var;}
 
@@ -98,7 +154,7 @@ namespace Words {
 
     protected:
         Variable(const std::string &s, size_t index, Context *ctxt)
-                : IEntry('@', index, ctxt), str(s) {}
+                : IEntry('@', index, ctxt, Kind::Variable), str(s) {}
 
     private:
         std::string str;
@@ -116,12 +172,6 @@ namespace Words {
 
         friend class Context;
 
-        bool isSequence() const override { return true; }
-
-        virtual Sequence *getSequence() override { return this; }
-
-        virtual const Sequence *getSequence() const override { return this; }
-
         const_iterator begin() const { return entries.begin(); }
 
         const_iterator end() const { return entries.end(); }
@@ -157,8 +207,6 @@ namespace Words {
 
         bool operator!=(const Sequence &s) { return entries != s.entries; }
 
-        size_t length() const override { return entries.size(); }
-
         bool isFactorOf(const Sequence &seq) {
             if (length() > seq.length()) {
                 return false;
@@ -174,7 +222,7 @@ namespace Words {
                 for (; oit != oend; ++oit) {
                     if (*it == *oit) {
                         auto currentOit = oit;
-                        for (; it != mend; ++currentOit, ++it) {
+                        for (; it != mend && currentOit != oend; ++currentOit, ++it) {
                             if (*it != *currentOit) {
                                 break;
                             }
@@ -240,7 +288,7 @@ namespace Words {
 
     protected:
         Sequence(size_t index, std::vector<IEntry *> e, Context *ctxt)
-                : IEntry('#', index, ctxt), entries(e) {}
+                : IEntry('#', index, ctxt, Kind::Sequence, e.size()), entries(e) {}
 
     private:
         std::vector<IEntry *> entries;
@@ -250,12 +298,6 @@ namespace Words {
     public:
         friend class Context;
 
-        bool isTerminal() const override { return true; }
-
-        virtual Terminal *getTerminal() override { return this; }
-
-        virtual const Terminal *getTerminal() const override { return this; }
-
         virtual bool isEpsilon() const { return epsilon; }
 
         virtual std::ostream &output(std::ostream &os) const override { return os << repr; }
@@ -266,12 +308,24 @@ namespace Words {
 
     protected:
         Terminal(char repr, size_t index, Context *ctxt, bool eps = false)
-                : IEntry(repr, index, ctxt), repr(repr), epsilon(eps) {}
+                : IEntry(repr, index, ctxt, Kind::Terminal), repr(repr), epsilon(eps) {}
 
         char repr;
         bool epsilon;
     };
 
+    inline Variable *IEntry::getVariable() { return isVariable() ? static_cast<Variable *>(this) : nullptr; }
+
+    inline Terminal *IEntry::getTerminal() { return isTerminal() ? static_cast<Terminal *>(this) : nullptr; }
+
+    inline Sequence *IEntry::getSequence() { return isSequence() ? static_cast<Sequence *>(this) : nullptr; }
+
+    inline const Variable *IEntry::getVariable() const { return isVariable() ? static_cast<const Variable *>(this) : nullptr; }
+
+    inline const Terminal *IEntry::getTerminal() const { return isTerminal() ? static_cast<const Terminal *>(this) : nullptr; }
+
+    inline const Sequence *IEntry::getSequence() const { return isSequence() ? static_cast<const Sequence *>(this) : nullptr; }
+
     template<class Iter>
     struct SegIter {
         static void begin(Sequence &seq, Iter &iter) { iter = seq.begin(); }
@@ -307,6 +361,12 @@ namespace Words {
         }
     };
 
+    // The entries of a word are shared between copies and only copied when
+    // one of them is modified, so copying an equation system costs as much
+    // as the words that actually change afterwards. The same goes for
+    // hashing it through digest(). Iterators from the non-const accessors
+    // belong to an unshared copy and stay valid as long as the word is not
+    // copied in between.
     class Word {
     public:
         template<class base_iter, class innerIter>
@@ -322,14 +382,14 @@ namespace Words {
             }
 
             value_type operator*() {
-                if (internal) return *internal->it;
+                if (inner) return *it;
                 return *cur;
             }
 
             bool operator==(const Iterator<base_iter, innerIter> &oth) {
-                if (internal && oth.internal)
-                    return internal->it == oth.internal->it && cur == oth.cur;
-                if (internal || oth.internal) return false;
+                if (inner && oth.inner)
+                    return it == oth.it && cur == oth.cur;
+                if (inner || oth.inner) return false;
                 return cur == oth.cur;
             }
 
@@ -346,31 +406,34 @@ namespace Words {
 
         private:
             void increment() {
-                if (internal) {
-                    ++internal->it;
-                    if (internal->it != internal->end) return;
+                if (inner) {
+                    ++it;
+                    if (it != itEnd) return;
                 }
-                internal.reset();
+                inner = false;
                 ++cur;
                 seqCheck();
             }
 
+            // Steps into the sequence at cur, if any. The position inside it
+            // is kept in the iterator itself, so iterating never allocates.
             void seqCheck() {
-                if (cur != end && (*cur)->isSequence()) {
+                for (; cur != end && (*cur)->isSequence(); ++cur) {
                     auto seq = (*cur)->getSequence();
-                    internal = std::make_unique<Internal>();
-                    SegIter<innerIter>::begin(*seq, internal->it);
-                    SegIter<innerIter>::end(*seq, internal->end);
+                    SegIter<innerIter>::begin(*seq, it);
+                    SegIter<innerIter>::end(*seq, itEnd);
+                    if (it != itEnd) {
+                        inner = true;
+                        return;
+                    }
                 }
             }
 
-            struct Internal {
-                innerIter it;
-                innerIter end;
-            };
             base_iter cur;
             base_iter end;
-            std::unique_ptr<Internal> internal = nullptr;
+            innerIter it{};
+            innerIter itEnd{};
+            bool inner = false;
         };
 
         using iterator =
@@ -391,20 +454,16 @@ namespace Words {
 
         friend class WordBuilder;
 
-        Word() {}
+        Word() : word(emptyEntries()) {}
 
-        Word(std::initializer_list<IEntry *> list) : word(list) {}
+        Word(std::initializer_list<IEntry *> list) : word(std::make_shared<Entries>(list)) { count(); }
 
-        Word(std::vector<IEntry *> &&list) : word(list) {}
+        Word(std::vector<IEntry *> &&list) : word(std::make_shared<Entries>(std::move(list))) { count(); }
 
         ~Word() {}
 
-        size_t characters() const {
-            std::size_t l = 0;
-            for (auto e: word) l += e->length();
-            return l;
-            // return word.size();
-        }
+        // Kept up to date by everything modifying the entries
+        size_t characters() const { return chars; }
 
         void sepearteCharacterCount(size_t &terminals, size_t &variables) const {
             auto end = eend();
@@ -418,41 +477,53 @@ namespace Words {
             }
         }
 
-        size_t entries() const { return word.size(); }
+        size_t entries() const { return word->size(); }
 
-        auto begin() const { return const_iterator(word.begin(), word.end()); }
+        auto begin() const { return const_iterator(word->cbegin(), word->cend()); }
 
-        auto end() const { return const_iterator(word.end(), word.end()); }
+        auto end() const { return const_iterator(word->cend(), word->cend()); }
 
-        entry_iterator ebegin() { return word.begin(); }
+        entry_iterator ebegin() {
+            detach();
+            return word->begin();
+        }
 
-        entry_iterator eend() { return word.end(); }
+        entry_iterator eend() {
+            detach();
+            return word->end();
+        }
 
-        const_entry_iterator ebegin() const { return word.begin(); }
+        const_entry_iterator ebegin() const { return word->cbegin(); }
 
-        const_entry_iterator eend() const { return word.end(); }
+        const_entry_iterator eend() const { return word->cend(); }
 
-        reverse_entry_iterator rebegin() { return word.rbegin(); }
+        reverse_entry_iterator rebegin() {
+            detach();
+            return word->rbegin();
+        }
 
-        reverse_entry_iterator reend() { return word.rend(); }
+        reverse_entry_iterator reend() {
+            detach();
+            return word->rend();
+        }
 
-        reverse_const_entry_iterator rebegin() const { return word.rbegin(); }
+        reverse_const_entry_iterator rebegin() const { return word->crbegin(); }
 
-        reverse_const_entry_iterator reend() const { return word.rend(); }
+        reverse_const_entry_iterator reend() const { return word->crend(); }
 
-        auto rbegin() const { return const_riterator(word.rbegin(), word.rend()); }
+        auto rbegin() const { return const_riterator(word->crbegin(), word->crend()); }
 
-        auto rend() const { return const_riterator(word.rend(), word.rend()); }
+        auto rend() const { return const_riterator(word->crend(), word->crend()); }
 
         // auto rbegin () {return riterator(word.rbegin(),word.rend());}
         // auto rend () {return riterator(word.rend(),word.rend());}
 
         uint32_t hash(uint32_t seed) const {
-            return Words::Hash::Hash<const IEntry *>(word.data(), word.size(), seed);
+            return Words::Hash::Hash<const IEntry *>(word->data(), word->size(), seed);
         }
 
         void getSequences(std::vector<Sequence *> &seq) const {
-            for (auto i: word) {
+            for (auto i: *word) {
                 if (i->isSequence()) {
                     seq.push_back(i->getSequence());
                 }
@@ -467,16 +538,16 @@ namespace Words {
             }
         }
 
-        bool containsVariable(const IEntry *var) {
-            for (auto i: word) {
+        bool containsVariable(const IEntry *var) const {
+            for (auto i: *word) {
                 if (i->isVariable() && i == var) return true;
             }
             return false;
         }
 
         bool noVariableWord() const {
-            return (word.size() == 1 && word.at(0)->isSequence()) ||
-                   word.size() == 0;
+            return (word->size() == 1 && word->at(0)->isSequence()) ||
+                   word->size() == 0;
         }
 
         bool noTerminalWord() const {
@@ -485,13 +556,14 @@ namespace Words {
             return seqs.size() == 0;
         }
 
+        // Leaves the entries shared if variable does not occur
         bool substitudeVariable(IEntry *variable, const Word &to) {
             bool replaced = false;
-            auto last_pos = word.begin();
+            auto last_pos = word->cbegin();
             Word newWord;  // predict size
             bool ranOnce = false;
-            auto it = word.begin();
-            auto end = word.end();
+            auto it = word->cbegin();
+            auto end = word->cend();
             for (; it != end; ++it) {
                 if (*it == variable) {
                     if (ranOnce) {
@@ -506,34 +578,51 @@ namespace Words {
             }
 
             if (replaced) {
-                if (last_pos != word.begin() && last_pos != word.end()) {
+                if (last_pos != word->cbegin() && last_pos != word->cend()) {
                     newWord.insert(last_pos, it);
                 }
-                word = newWord.word;
+                word = std::move(newWord.word);
+                chars = newWord.chars;
             }
             return replaced;
         }
 
-        void erase_entry(entry_iterator it) { word.erase(it); }
+        // Replaces every variable with an image in sub at the same time, in
+        // one pass. Leaves the entries shared if none of them occurs.
+        bool substitute(const SubstitutionTable &sub);
+
+        // The iterators passed to erase_entry and replace_entry come from the
+        // non-const accessors, so the entries are not shared any more
+        void erase_entry(entry_iterator it) {
+            changed();
+            chars -= (*it)->length();
+            word->erase(it);
+        }
 
         void replace_entry(entry_iterator it, IEntry *e) {
+            changed();
+            chars = chars - (*it)->length() + e->length();
             std::replace(it, it + 1, *it, e);
         }
 
         void erase_entry(reverse_entry_iterator it) {
             auto base = it.base() - 1;
-            word.erase(base);
+            changed();
+            chars -= (*base)->length();
+            word->erase(base);
         }
 
         void replace_entry(reverse_entry_iterator it, IEntry *e) {
             auto base = it.base() - 1;
+            changed();
+            chars = chars - (*base)->length() + e->length();
             std::replace(base, base + 1, *it, e);
         }
 
         std::vector<Word> getConstSequences() {
             std::vector<Word> words;
             Word currentWord;
-            for (IEntry *x: word) {
+            for (IEntry *x: *word) {
                 if (x->isVariable()) {
                     if (currentWord.characters() == 0) continue;
                     words.push_back(currentWord);
@@ -546,10 +635,26 @@ namespace Words {
         }
 
         std::vector<IEntry *> getWord() {
-            return word;
+            return *word;
+        }
+
+        bool operator==(Word const &rhs) const {
+            if (word == rhs.word) return true;
+            if (word->digested && rhs.word->digested &&
+                (word->high != rhs.word->high || word->low != rhs.word->low)) return false;
+            return *word == *rhs.word;
         }
 
-        bool operator==(Word const &rhs) const { return word == rhs.word; }
+        // 128-bit hash of the symbols of the word, independent of where the
+        // context keeps them. It is worked out once and shared by all copies
+        // of the word until one of them changes.
+        void digest(uint64_t out[2]) const {
+            if (!word->digested.load(std::memory_order_acquire)) {
+                computeDigest();
+            }
+            out[0] = word->high.load(std::memory_order_relaxed);
+            out[1] = word->low.load(std::memory_order_relaxed);
+        }
 
         bool operator!=(Word const &rhs) const { return !(*this == rhs); }
 
@@ -562,19 +667,71 @@ namespace Words {
         }
 
     protected:
-        void append(IEntry *e) { word.push_back(e); }
+        void append(IEntry *e) {
+            detach();
+            word->push_back(e);
+            chars += e->length();
+        }
 
-        void clear() { word.clear(); }
+        void clear() {
+            word = emptyEntries();
+            chars = 0;
+        }
 
     private:
         template<class iter>
         void insert(iter b, iter e) {
+            detach();
             for (; b != e; ++b) {
-                word.push_back(*b);
+                word->push_back(*b);
+                chars += (*b)->length();
             }
         }
 
-        std::vector<IEntry *> word;
+        void count() {
+            chars = 0;
+            for (auto e: *word) chars += e->length();
+        }
+
+        // The entries and, once asked for, their digest
+        struct Entries : std::vector<IEntry *> {
+            Entries() {}
+
+            Entries(std::initializer_list<IEntry *> list) : std::vector<IEntry *>(list) {}
+
+            Entries(std::vector<IEntry *> &&list) : std::vector<IEntry *>(std::move(list)) {}
+
+            // The digest is not copied along, the copy is about to change
+            Entries(const Entries &e) : std::vector<IEntry *>(e) {}
+
+            std::atomic<bool> digested{false};
+            std::atomic<uint64_t> high{0};
+            std::atomic<uint64_t> low{0};
+        };
+
+        void computeDigest() const;
+
+        // Only called on entries no other word shares
+        void changed() { word->digested.store(false, std::memory_order_relaxed); }
+
+        // Gives this word its own copy of the entries before modifying them
+        void detach() {
+            if (word.use_count() > 1) {
+                word = std::make_shared<Entries>(*word);
+            } else {
+                changed();
+            }
+        }
+
+        // All empty words share one vector, which is never modified
+        static const std::shared_ptr<Entries> &emptyEntries() {
+            static const auto empty = std::make_shared<Entries>();
+            return empty;
+        }
+
+        std::shared_ptr<Entries> word;
+        // Entries, with sequences counted by their length
+        std::size_t chars = 0;
     };
 
     class Context;
@@ -637,6 +794,19 @@ namespace Words {
 
         IEntry *getVariable(size_t s) const;
 
+        IEntry *getSequence(size_t s) const;
+
+        IEntry *getEntry(Symbol s) const {
+            switch (s.kind()) {
+                case IEntry::Kind::Variable:
+                    return getVariable(s.index());
+                case IEntry::Kind::Sequence:
+                    return getSequence(s.index());
+                default:
+                    return getTerminal(s.index());
+            }
+        }
+
         const std::vector<Terminal *> &getTerminalAlphabet() const;
 
         const std::vector<Variable *> &getVariableAlphabet() const;
@@ -692,6 +862,13 @@ namespace Words {
             return std::make_shared<Options>(*this);
         }
 
+        /**
+         * Copies the system into a fresh context, such that the copy can be modified and solved
+         * independently of (and concurrently with) this one. copy() shares the context and the regular expressions.
+         * entries receives the corresponding entry of the copy for each symbol used by this system.
+         */
+        std::shared_ptr<Options> deepCopy(std::map<const IEntry *, IEntry *> &entries) const;
+
         bool hasIneqquality() {
             for (auto &eq: equations) {
                 if (eq.type == Equation::EqType::NEq) return true;
@@ -702,6 +879,70 @@ namespace Words {
 
     using Substitution = std::map<IEntry *, Word>;
 
+    // The images of a substitution by variable index, for applying it to
+    // many words. It refers to the words of the substitution, which have to
+    // outlive it. With eraseOthers, variables without an image are erased.
+    class SubstitutionTable {
+    public:
+        explicit SubstitutionTable(const Substitution &sub, bool eraseOthers = false) : eraseOthers(eraseOthers) {
+            for (auto &s: sub) {
+                auto i = s.first->getIndex();
+                if (i >= images.size()) images.resize(i + 1, nullptr);
+                images[i] = &s.second;
+            }
+        }
+
+        // The image of e, nullptr if e stays
+        const Word *image(const IEntry *e) const {
+            if (!e->isVariable()) return nullptr;
+            auto i = e->getIndex();
+            if (i < images.size() && images[i]) return images[i];
+            return eraseOthers ? &empty : nullptr;
+        }
+
+    private:
+        std::vector<const Word *> images;
+        Word empty;
+        bool eraseOthers;
+    };
+
+    inline bool Word::substitute(const SubstitutionTable &sub) {
+        std::size_t size = 0;
+        bool replaced = false;
+        for (auto e: *word) {
+            auto image = sub.image(e);
+            replaced = replaced || image;
+            size += image ? image->entries() : 1;
+        }
+        if (!replaced) return false;
+
+        auto entries = std::make_shared<Entries>();
+        entries->reserve(size);
+        chars = 0;
+        for (auto e: *word) {
+            if (auto image = sub.image(e)) {
+                entries->insert(entries->end(), image->word->begin(), image->word->end());
+                chars += image->chars;
+            } else {
+                entries->push_back(e);
+                chars += e->length();
+            }
+        }
+        word = std::move(entries);
+        return true;
+    }
+
+    // Substitutes in both sides of every equation of opt, returns whether
+    // any of them changed
+    inline bool substitute(Options &opt, const SubstitutionTable &sub) {
+        bool replaced = false;
+        for (auto &eq: opt.equations) {
+            replaced = eq.lhs.substitute(sub) || replaced;
+            replaced = eq.rhs.substitute(sub) || replaced;
+        }
+        return replaced;
+    }
+
     inline std::ostream &operator<<(std::ostream &os, const IEntry &w) {
         return w.output(os);
     }
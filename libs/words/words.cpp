@@ -3,11 +3,14 @@
 #include <cassert>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
 
+#include "host/hash.hpp"
 #include "words/exceptions.hpp"
+#include "words/linconstraint.hpp"
 #include "words/regconstraints.hpp"
 
 namespace Words {
@@ -55,7 +58,11 @@ struct Context::Internals {
     }
 
     std::unordered_map<std::string, IEntry*> reprToEntry;
-    std::unordered_map<size_t, Sequence*> hashToSequence;
+    // Sequences are added while solving, possibly from several threads
+    std::mutex sequencesMutex;
+    // The hash is only 32 bits of the entries' addresses, so distinct
+    // sequences may share it
+    std::unordered_multimap<size_t, Sequence*> hashToSequence;
     std::vector<Variable*> vars;
     std::vector<Terminal*> terminals;
     std::vector<Sequence*> sequences;
@@ -75,15 +82,14 @@ IEntry* Context::addTemporaryVariable(const std::string& c) { return _internal->
 IEntry* Context::addTerminal(char c) { return _internal->addTerminal(c, this, false); }
 
 IEntry* Context::addSequence(const Context::SeqInput& s) {
+    std::lock_guard<std::mutex> lock(_internal->sequencesMutex);
     std::unique_ptr<Sequence> nentry(new Sequence(_internal->sequences.size(), s, this));
     auto hash = nentry->hash();
-    auto it = _internal->hashToSequence.find(hash);
-    if (it != _internal->hashToSequence.end()) {
-        assert(*nentry == *it->second && "Hash Collision");
-        if (*nentry != *it->second) {
-            throw Words::WordException("Hash Collision while adding Sequence");
+    auto range = _internal->hashToSequence.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (*nentry == *it->second) {
+            return it->second;
         }
-        return it->second;
     }
     Sequence* seq = nentry.release();
     _internal->sequences.push_back(seq);
@@ -113,6 +119,11 @@ size_t Context::nbTerms() const { return _internal->terminals.size(); }
 IEntry* Context::getTerminal(size_t s) const { return _internal->terminals[s]; }
 
 IEntry* Context::getVariable(size_t s) const { return _internal->vars[s]; }
+
+IEntry* Context::getSequence(size_t s) const {
+    std::lock_guard<std::mutex> lock(_internal->sequencesMutex);
+    return _internal->sequences[s];
+}
 const std::vector<Terminal*>& Context::getTerminalAlphabet() const { return _internal->terminals; }
 const std::vector<Variable*>& Context::getVariableAlphabet() const { return _internal->vars; }
 IEntry* Context::findSymbol(const std::string& c) const {
@@ -126,6 +137,88 @@ IEntry* Context::findSymbol(const std::string& c) const {
 
 Terminal* Context::getEpsilon() const { return _internal->terminals[0]; }
 
+namespace {
+IEntry* copyEntry(const IEntry* e, Context& ctx, std::map<const IEntry*, IEntry*>& entries) {
+    auto it = entries.find(e);
+    if (it != entries.end()) return it->second;
+    if (!e->isSequence()) {
+        throw WordException("Symbol '" + e->getName() + "' not in context");
+    }
+    Context::SeqInput input;
+    for (auto c : *e->getSequence()) {
+        input.push_back(copyEntry(c, ctx, entries));
+    }
+    return entries[e] = ctx.addSequence(input);
+}
+
+Word copyWord(const Word& w, Context& ctx, std::map<const IEntry*, IEntry*>& entries) {
+    std::vector<IEntry*> copied;
+    for (auto it = w.ebegin(); it != w.eend(); ++it) {
+        copied.push_back(copyEntry(*it, ctx, entries));
+    }
+    return Word(std::move(copied));
+}
+
+std::shared_ptr<RegularConstraints::RegNode> copyRegex(RegularConstraints::RegNode& node, Context& ctx,
+                                                       std::map<const IEntry*, IEntry*>& entries) {
+    using namespace RegularConstraints;
+    if (auto word = dynamic_cast<RegWord*>(&node)) {
+        return std::make_shared<RegWord>(copyWord(word->word, ctx, entries));
+    } else if (auto opr = dynamic_cast<RegOperation*>(&node)) {
+        std::vector<std::shared_ptr<RegNode>> children;
+        for (auto& c : opr->getChildren()) {
+            children.push_back(copyRegex(*c, ctx, entries));
+        }
+        return std::make_shared<RegOperation>(opr->getOperator(), children);
+    }
+    return std::make_shared<RegEmpty>();
+}
+}  // namespace
+
+std::shared_ptr<Options> Options::deepCopy(std::map<const IEntry*, IEntry*>& entries) const {
+    auto res = std::make_shared<Options>();
+    res->context = std::make_shared<Context>();
+    Context& ctx = *res->context;
+    // Keep the order of the symbols, so their indices agree with this context
+    for (auto t : context->getTerminalAlphabet()) {
+        entries[t] = t->isEpsilon() ? ctx.getEpsilon() : ctx.addTerminal(t->getChar());
+    }
+    for (auto v : context->getVariableAlphabet()) {
+        entries[v] = v->isTemporary() ? ctx.addTemporaryVariable(v->getName()) : ctx.addVariable(v->getName());
+    }
+
+    for (auto& eq : equations) {
+        Word lhs = copyWord(eq.lhs, ctx, entries);
+        Word rhs = copyWord(eq.rhs, ctx, entries);
+        Equation neq(lhs, rhs, eq.type);
+        neq.ctxt = &ctx;
+        res->equations.push_back(neq);
+    }
+
+    for (auto& c : constraints) {
+        if (auto lin = c->getLinconstraint()) {
+            std::vector<Constraints::VarMultiplicity> vars;
+            for (auto& vm : *lin) {
+                vars.emplace_back(copyEntry(vm.entry, ctx, entries), vm.number);
+            }
+            res->constraints.push_back(std::make_shared<Constraints::LinearConstraint>(std::move(vars), lin->getRHS()));
+        } else if (auto un = c->getUnrestricted()) {
+            res->constraints.push_back(
+                std::make_shared<Constraints::Unrestricted>(copyEntry(un->getUnrestrictedVar(), ctx, entries)));
+        } else {
+            res->constraints.push_back(c->copy());
+        }
+    }
+
+    for (auto& rc : recons) {
+        auto nrc = std::make_shared<RegularConstraints::RegConstraint>(copyWord(rc->pattern, ctx, entries),
+                                                                       copyRegex(*rc->expr, ctx, entries));
+        nrc->triviallySat = rc->triviallySat;
+        res->recons.push_back(nrc);
+    }
+    return res;
+}
+
 WordBuilder::~WordBuilder() { flush(); }
 
 WordBuilder& WordBuilder::operator<<(char c) { return operator<<(std::string(1, c)); }
@@ -154,6 +247,19 @@ void WordBuilder::flush() {
     input.clear();
 }
 
+void Word::computeDigest() const {
+    thread_local std::vector<uint32_t> symbols;
+    symbols.clear();
+    for (auto e : *word) {
+        symbols.push_back(e->symbol().raw());
+    }
+    uint64_t out[2];
+    Hash::Hash128<uint32_t>(symbols.data(), symbols.size(), 0, out);
+    word->high.store(out[0], std::memory_order_relaxed);
+    word->low.store(out[1], std::memory_order_relaxed);
+    word->digested.store(true, std::memory_order_release);
+}
+
 std::ostream& operator<<(std::ostream& os, const Word& w) {
     for (auto it = w.ebegin(); it != w.eend(); ++it) {
         os << **it;
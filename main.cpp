@@ -24,10 +24,15 @@ namespace po = boost::program_options;
 struct LevisHeuristics {
     size_t which = 0;
     size_t searchorder = 0;
+    size_t priority = 0;
     double varTerminalRatio = 1.1;
     size_t wlistLimit = 2;
     double growthFactor = 1.1;
     size_t eqLength = 100;
+    bool exactPassed = false;
+    bool canonicalPassed = false;
+    size_t spillMB = 0;
+    std::string profileFile;
 };
 
 
@@ -175,6 +180,9 @@ void setupLevis(LevisHeuristics &l) {
         case 1:
             setSearchOrder<SearchOrder::DepthFirst>();
             break;
+        case 2:
+            setSearchOrder<SearchOrder::BestFirst>(static_cast<Priority>(std::min<size_t>(l.priority, 2)));
+            break;
         case 0:
         default:
             setSearchOrder<SearchOrder::BreadthFirst>();
@@ -182,6 +190,11 @@ void setupLevis(LevisHeuristics &l) {
 
     }
 
+    setExactPassedCheck(l.exactPassed);
+    setCanonicalPassed(l.canonicalPassed);
+    setSpillThreshold(l.spillMB << 20);
+    setProfileFile(l.profileFile);
+
 
 }
 
@@ -205,19 +218,26 @@ void setSMTSolver(size_t i) {
     }
 }
 
-Words::Solvers::Solver_ptr buildSolver(size_t i) {
+Words::Solvers::Solver_ptr buildSolver(size_t i, size_t concurrentBounds = 1, size_t levisThreads = 1) {
     switch (i) {
         case 0:
             return nullptr;
             break;
         case 1:
-            return Words::Solvers::makeSolver<Words::Solvers::Types::SatEncoding>(static_cast<size_t> (0));
+            return Words::Solvers::makeSolver<Words::Solvers::Types::SatEncoding>(static_cast<size_t> (0), concurrentBounds);
         case 2:
             return Words::Solvers::makeSolver<Words::Solvers::Types::SatEncodingOld>(static_cast<size_t> (0));
         case 3:
             return Words::Solvers::makeSolver<Words::Solvers::Types::PureSMT>();
         case 4:
-            return Words::Solvers::makeSolver<Words::Solvers::Types::Levis>();
+            return Words::Solvers::makeSolver<Words::Solvers::Types::Levis>(levisThreads);
+        case 5: {
+            Words::Solvers::Portfolio::Members members;
+            members.emplace_back("SatEncoding", buildSolver(1, concurrentBounds));
+            members.emplace_back("Levis", buildSolver(4, concurrentBounds, levisThreads));
+            members.emplace_back("SMT", buildSolver(3));
+            return Words::Solvers::makeSolver<Words::Solvers::Types::Portfolio>(std::move(members));
+        }
     }
     return nullptr;
 }
@@ -231,6 +251,8 @@ int main(int argc, char **argv) {
     size_t cpulim = 0;
     size_t vmlim = 0;
     size_t solverr = 0;
+    size_t concurrentBounds = 1;
+    size_t levisThreads = 1;
     std::string conffile;
     std::string outputfile = "";
     std::string smtmodelfile = "";
@@ -255,9 +277,12 @@ int main(int argc, char **argv) {
                                                     "\t  2 Old Sat Encoding via Glucose\n"
                                                     "\t  3 SMT\n"
                                                     "\t  4 Levis Lemmas\n"
-            );
+                                                    "\t  5 Portfolio of 1, 3 and 4 in parallel\n"
+            )
+            ("bounds", po::value<size_t>(&concurrentBounds), "Number of bounds the Sat Encoding solves in parallel");
     size_t smtsolver = 0;
     size_t smttimeout = 0;
+    bool reusesmt = false;
     po::options_description smdesc("SMT Options");
     smdesc.add_options()
             ("smtsolver,S", po::value<size_t>(&smtsolver), "SMT Solver\n"
@@ -265,7 +290,8 @@ int main(int argc, char **argv) {
                                                            "\t 1 CVC4\n"
                                                            "\t 2 Z3Str3\n"
             )
-            ("smttimeout", po::value<size_t>(&smttimeout), "Set timeout for SMTSolver (ms)");
+            ("smttimeout", po::value<size_t>(&smttimeout), "Set timeout for SMTSolver (ms)")
+            ("reusesmt", po::bool_switch(&reusesmt), "Reuse one Z3 solver per thread for the queries of the Levis search instead of making a new one for every query");
 
     po::options_description levdesc("LevisSMT Options");
     levdesc.add_options()
@@ -282,7 +308,17 @@ int main(int argc, char **argv) {
             ("eqLength", po::value<size_t>(&lheu.eqLength), "Equation Length")
             ("SearchOrder", po::value<size_t>(&lheu.searchorder), "Search Order\n"
                                                                   "\t 0 BFS\n"
-                                                                  "\t 1 DFS");
+                                                                  "\t 1 DFS\n"
+                                                                  "\t 2 BestFirst")
+            ("priority", po::value<size_t>(&lheu.priority), "Priority of the BestFirst Search Order\n"
+                                                            "\t 0 Total length\n"
+                                                            "\t 1 Variable/terminal ratio\n"
+                                                            "\t 2 Distinct variables")
+            ("levisthreads", po::value<size_t>(&levisThreads), "Number of threads the Levis search runs on")
+            ("exactpassed", po::bool_switch(&lheu.exactPassed), "Verify passed list fingerprint matches against the stored systems")
+            ("canonical", po::bool_switch(&lheu.canonicalPassed), "Explore only one of the systems equal up to renaming of variables")
+            ("spill", po::value<size_t>(&lheu.spillMB), "Megabytes of waiting systems kept in memory by the BFS search order, newer ones are written to a temporary file (0 keeps all in memory)")
+            ("profile", po::value<std::string>(&lheu.profileFile), "File the rule firings, pruned successors and phase times of the search are written to as JSON (needs a build with ENABLE_PROFILINGLEVIS)");
 
 
     desc.add(smdesc);
@@ -307,6 +343,7 @@ int main(int argc, char **argv) {
     setSMTSolver(smtsolver);
 
     Words::SMT::setDefaultTimeout(smttimeout);
+    Words::SMT::setSolverReuse(reusesmt);
     if (!suppressbanner)
         printBanner(std::cout);
     if (conffile == "") {
@@ -349,7 +386,7 @@ int main(int argc, char **argv) {
             if (!job->options.hasIneqquality()) {
 
 
-                Words::Solvers::Solver_ptr solver = buildSolver(solverr);
+                Words::Solvers::Solver_ptr solver = buildSolver(solverr, concurrentBounds, levisThreads);
                 auto s = std::move(job->solver);
 
                 if (!solver) {
@@ -0,0 +1,140 @@
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "words/words.hpp"
+#include "words/linconstraint.hpp"
+#include "smt/smtsolvers.hpp"
+
+using namespace std;
+
+namespace {
+    Words::Options context() {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('a');
+        opt.context->addTerminal('b');
+        opt.context->addVariable('X');
+        opt.context->addVariable('Y');
+        return opt;
+    }
+
+    // X Y = rhs
+    void query(Words::Options &opt, vector<char> rhs) {
+        vector<Words::IEntry *> r;
+        for (auto c : rhs) {
+            r.push_back(opt.context->findSymbol(c));
+        }
+        Words::Word lhs({opt.context->findSymbol('X'), opt.context->findSymbol('Y')});
+        Words::Word w(std::move(r));
+        Words::Equation eq(lhs, w);
+        eq.ctxt = opt.context.get();
+        opt.equations.assign(1, eq);
+    }
+
+    // |X| >= n
+    Words::Constraints::Constraint_ptr atLeast(Words::Options &opt, int64_t n) {
+        auto builder = Words::Constraints::makeLinConstraintBuilder(Words::Constraints::Cmp::GEq);
+        builder->addLHS(opt.context->findSymbol('X'), 1);
+        builder->addRHS(n);
+        return builder->makeConstraint();
+    }
+
+    Words::SMT::SolverResult solve(Words::SMT::Session &session, Words::Options &opt) {
+        auto &solver = session.open(opt);
+        solver.addEquations(opt.equations.begin(), opt.equations.end());
+        solver.addConstraints(opt.constraints.begin(), opt.constraints.end());
+        return solver.solve();
+    }
+}
+
+TEST_CASE("SMT sessions reuse their solvers") {
+    Words::SMT::setSolverReuse(true);
+    Words::SMT::Session session;
+    Words::Options opt = context();
+
+    // Each query only sees its own equations and constraints
+    query(opt, {'a', 'b'});
+    opt.constraints.push_back(atLeast(opt, 3));
+    REQUIRE(solve(session, opt) == Words::SMT::SolverResult::NSatis);
+    opt.constraints.clear();
+    REQUIRE(solve(session, opt) == Words::SMT::SolverResult::Satis);
+    query(opt, {'b', 'a', 'a'});
+    opt.constraints.push_back(atLeast(opt, 3));
+    REQUIRE(solve(session, opt) == Words::SMT::SolverResult::Satis);
+
+    Words::Substitution sub;
+    Words::SMT::retriveSubstitution(session.open(opt), opt, sub);
+    REQUIRE(sub.size() == 2);
+
+    auto &ints = session.openInteger(opt);
+    ints.addConstraint(*atLeast(opt, 2));
+    REQUIRE(ints.solve() == Words::SMT::SolverResult::Satis);
+    REQUIRE(ints.evaluate(opt.context->findSymbol('X')->getVariable()) >= 2);
+    REQUIRE(session.openInteger(opt).solve() == Words::SMT::SolverResult::Satis);
+
+    REQUIRE(session.statistics().contexts == 2);
+    REQUIRE(session.statistics().queries == 6);
+
+    // A system over another context gets a new solver
+    Words::Options other = context();
+    query(other, {'a'});
+    REQUIRE(solve(session, other) == Words::SMT::SolverResult::Satis);
+    REQUIRE(session.statistics().contexts == 3);
+
+    // Without reuse every query gets a solver of its own
+    Words::SMT::setSolverReuse(false);
+    REQUIRE(solve(session, other) == Words::SMT::SolverResult::Satis);
+    REQUIRE(solve(session, opt) == Words::SMT::SolverResult::Satis);
+    REQUIRE(session.statistics().contexts == 5);
+}
+
+TEST_CASE("SMT models only use the alphabet") {
+    Words::Options opt = context();
+    auto x = opt.context->findSymbol('X');
+    auto y = opt.context->findSymbol('Y');
+    Words::Word lhs({x});
+    Words::Word rhs({y});
+    Words::Equation eq(lhs, rhs);
+    eq.ctxt = opt.context.get();
+    opt.equations.push_back(eq);
+    opt.constraints.push_back(atLeast(opt, 3));
+
+    // Z3 is free to pick any characters for X and Y
+    auto solver = Words::SMT::makeSolver();
+    Words::SMT::buildEquationSystem(*solver, opt);
+    REQUIRE(solver->solve() == Words::SMT::SolverResult::Satis);
+    Words::Substitution sub;
+    Words::SMT::retriveSubstitution(*solver, opt, sub);
+    REQUIRE(sub[x].characters() >= 3);
+    REQUIRE(sub[x] == sub[y]);
+    for (auto e : sub[x]) {
+        REQUIRE(e->isTerminal());
+        REQUIRE_FALSE(e->getTerminal()->isEpsilon());
+    }
+}
+
+TEST_CASE("SMT sessions against fresh solvers", "[.benchmark]") {
+    const size_t queries = 1000;
+    Words::Options opt = context();
+    query(opt, {'a', 'b', 'a'});
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < queries; i++) {
+        auto solver = Words::SMT::makeSolver();
+        Words::SMT::buildEquationSystem(*solver, opt);
+        REQUIRE(solver->solve() == Words::SMT::SolverResult::Satis);
+    }
+    auto middle = chrono::steady_clock::now();
+    Words::SMT::setSolverReuse(true);
+    Words::SMT::Session session;
+    for (size_t i = 0; i < queries; i++) {
+        REQUIRE(solve(session, opt) == Words::SMT::SolverResult::Satis);
+    }
+    auto end = chrono::steady_clock::now();
+    Words::SMT::setSolverReuse(false);
+    WARN(queries << " queries, fresh solvers: " << chrono::duration_cast<chrono::milliseconds>(middle - start).count() << " ms, "
+                 << "session: " << chrono::duration_cast<chrono::milliseconds>(end - middle).count() << " ms, "
+                 << session.statistics().setupTime << " ms of it setting up");
+}
@@ -0,0 +1,85 @@
+#include "catch2/catch.hpp"
+#include <memory>
+#include <vector>
+
+#include "words/words.hpp"
+#include "graph.hpp"
+
+using namespace std;
+using namespace Words::Solvers::Levis;
+
+namespace {
+    // X = rhs
+    shared_ptr<Words::Options> system(Words::Options &base, vector<char> rhs) {
+        auto opt = base.copy();
+        vector<Words::IEntry *> r;
+        for (auto c : rhs) {
+            r.push_back(opt->context->findSymbol(c));
+        }
+        Words::Word l({opt->context->findSymbol('X')});
+        Words::Word w(std::move(r));
+        Words::Equation eq(l, w);
+        eq.ctxt = opt->context.get();
+        opt->equations.push_back(eq);
+        return opt;
+    }
+
+    Words::Substitution substitution(Words::Options &opt, char var, vector<char> image) {
+        vector<Words::IEntry *> w;
+        for (auto c : image) {
+            w.push_back(opt.context->findSymbol(c));
+        }
+        Words::Substitution res;
+        res[opt.context->findSymbol(var)] = Words::Word(std::move(w));
+        return res;
+    }
+}
+
+TEST_CASE("Derivation graph") {
+    Words::Options base;
+    base.context = make_shared<Words::Context>();
+    base.context->addTerminal('a');
+    base.context->addTerminal('b');
+    base.context->addVariable('X');
+    base.context->addVariable('Y');
+
+    // X = aab, X -> aX gives X = ab, X -> aY gives Y = b, Y -> b solves it
+    Graph graph;
+    auto root = graph.makeNode(system(base, {'a', 'a', 'b'}));
+    auto first = graph.makeNode(system(base, {'a', 'b'}));
+    auto second = graph.makeNode(system(base, {'b'}));
+    auto solved = graph.makeDummyNode();
+    graph.addEdge(root, first, substitution(base, 'X', {'a', 'X'}));
+    graph.addEdge(first, second, substitution(base, 'X', {'a', 'Y'}));
+    graph.addEdge(second, solved, substitution(base, 'Y', {'b'}));
+    REQUIRE(graph.makeNode(system(base, {'a', 'b'})) == first);
+    REQUIRE(graph.getNode(*system(base, {'b'})) == second);
+
+    auto sub = graph.rootSolution(solved);
+    auto x = base.context->findSymbol('X');
+    REQUIRE(sub[x] == Words::Word({base.context->findSymbol('a'), base.context->findSymbol('a'), base.context->findSymbol('b')}));
+
+    // A second way into a node, through a cycle, leaves the answer alone
+    graph.addEdge(second, root, substitution(base, 'X', {'X'}));
+    REQUIRE(graph.rootSolution(solved)[x] == sub[x]);
+    REQUIRE(graph.substitution(graph.edge(root->incoming)) == substitution(base, 'X', {'X'}));
+}
+
+TEST_CASE("Derivation graph memory", "[.benchmark]") {
+    Words::Options base;
+    base.context = make_shared<Words::Context>();
+    base.context->addTerminal('a');
+    base.context->addVariable('X');
+    const size_t states = 100000;
+
+    Graph graph;
+    vector<char> rhs;
+    auto from = graph.makeNode(system(base, rhs));
+    for (size_t i = 0; i < states; i++) {
+        rhs.push_back('a');
+        auto to = graph.makeNode(system(base, rhs));
+        graph.addEdge(from, to, substitution(base, 'X', {'a', 'X'}));
+        from = to;
+    }
+    WARN(states << " states, " << graph.memoryUsage() / states << " bytes each");
+}
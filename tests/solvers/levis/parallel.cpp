@@ -0,0 +1,161 @@
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "parser/parsing.hpp"
+
+#ifndef TRACK1_DIR
+#define TRACK1_DIR "test/track1"
+#endif
+
+using namespace std;
+
+namespace {
+    unique_ptr<Words::Job> parse(const string &file) {
+        ifstream is(file);
+        REQUIRE(is.good());
+        stringstream err;
+        auto job = Words::makeParser(Words::ParserType::Standard, is)->Parse(err)->newJob();
+        REQUIRE(job);
+        return job;
+    }
+
+    class Gatherer : public Words::Solvers::DummyResultGatherer {
+    public:
+        void setSubstitution(Words::Substitution &s) override { sub = s; }
+
+        Words::Substitution sub;
+    };
+
+    string substitute(const Words::Word &w, Words::Substitution &sub) {
+        string res;
+        for (auto e: w) {
+            if (e->isVariable()) {
+                for (auto t: sub[e]) {
+                    res += t->getTerminal()->getChar();
+                }
+            } else {
+                res += e->getTerminal()->getChar();
+            }
+        }
+        return res;
+    }
+
+    Words::Solvers::Result solve(const string &file, size_t threads, bool verify = true, string *log = nullptr) {
+        auto job = parse(file);
+        auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::Levis>(threads);
+        stringstream messages;
+        Words::Solvers::StreamRelay relay(messages);
+        auto res = solver->Solve(job->options, relay);
+        if (log) {
+            *log = messages.str();
+        }
+        if (verify && res == Words::Solvers::Result::HasSolution) {
+            Gatherer gatherer;
+            solver->getResults(gatherer);
+            for (auto &eq: job->options.equations) {
+                REQUIRE(substitute(eq.lhs, gatherer.sub) == substitute(eq.rhs, gatherer.sub));
+            }
+        }
+        return res;
+    }
+
+    const vector<string> instances{"1", "3", "7", "8", "9", "10", "12"};
+}
+
+// The pure search, without calls to the SMT solver, finds the same answers
+// on any number of threads
+TEST_CASE("Parallel Levis search") {
+    Words::Solvers::Levis::selectNone();
+    Words::Solvers::Levis::setSearchOrder<Words::Solvers::Levis::SearchOrder::BreadthFirst>();
+    for (auto &i: instances) {
+        INFO("01.track_" << i << ".eq");
+        auto sequential = solve(TRACK1_DIR "/01.track_" + i + ".eq", 1);
+        for (size_t threads: {2, 4}) {
+            REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", threads) == sequential);
+        }
+    }
+}
+
+// Best-first only changes the order the states are expanded in
+TEST_CASE("Best-first Levis search") {
+    using namespace Words::Solvers::Levis;
+    selectNone();
+    for (auto &i: instances) {
+        INFO("01.track_" << i << ".eq");
+        setSearchOrder<SearchOrder::BreadthFirst>();
+        auto breadth = solve(TRACK1_DIR "/01.track_" + i + ".eq", 1);
+        for (auto priority: {Priority::TotalLength, Priority::DistinctVariables}) {
+            setSearchOrder<SearchOrder::BestFirst>(priority);
+            REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", 1) == breadth);
+            REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", 2) == breadth);
+        }
+    }
+    setSearchOrder<SearchOrder::BreadthFirst>();
+}
+
+// The parallel search has no best-first order and says so
+TEST_CASE("Best-first Levis search on several threads") {
+    using namespace Words::Solvers::Levis;
+    selectNone();
+    string log;
+    setSearchOrder<SearchOrder::BestFirst>(Priority::TotalLength);
+    solve(TRACK1_DIR "/01.track_1.eq", 2, true, &log);
+    REQUIRE(log.find("not supported with several threads") != string::npos);
+    solve(TRACK1_DIR "/01.track_1.eq", 1, true, &log);
+    REQUIRE(log.find("not supported with several threads") == string::npos);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+    solve(TRACK1_DIR "/01.track_1.eq", 2, true, &log);
+    REQUIRE(log.find("not supported with several threads") == string::npos);
+}
+
+// Dropping renamings of passed systems keeps the answers
+TEST_CASE("Levis search merging renamed systems") {
+    using namespace Words::Solvers::Levis;
+    selectNone();
+    setSearchOrder<SearchOrder::BreadthFirst>();
+    for (auto &i: instances) {
+        INFO("01.track_" << i << ".eq");
+        setCanonicalPassed(false);
+        auto plain = solve(TRACK1_DIR "/01.track_" + i + ".eq", 1);
+        setCanonicalPassed(true);
+        REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", 1) == plain);
+        REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", 2) == plain);
+    }
+    setCanonicalPassed(false);
+}
+
+// Writing most of the breadth-first waiting list to disk keeps the answers
+TEST_CASE("Levis search spilling the waiting list") {
+    using namespace Words::Solvers::Levis;
+    selectNone();
+    for (auto &i: instances) {
+        INFO("01.track_" << i << ".eq");
+        setSpillThreshold(0);
+        setSearchOrder<SearchOrder::BreadthFirst>();
+        auto plain = solve(TRACK1_DIR "/01.track_" + i + ".eq", 1);
+        setSpillThreshold(4096);
+        setSearchOrder<SearchOrder::BreadthFirst>();
+        REQUIRE(solve(TRACK1_DIR "/01.track_" + i + ".eq", 1) == plain);
+    }
+    setSpillThreshold(0);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+}
+
+TEST_CASE("Parallel Levis search scaling", "[.benchmark]") {
+    Words::Solvers::Levis::selectNone();
+    for (size_t threads: {1, 2, 4, 8, 16}) {
+        auto start = chrono::steady_clock::now();
+        for (auto &i: instances) {
+            solve(TRACK1_DIR "/01.track_" + i + ".eq", threads, false);
+        }
+        auto end = chrono::steady_clock::now();
+        WARN(threads << " threads: " << chrono::duration_cast<chrono::milliseconds>(end - start).count() << " ms");
+    }
+}
@@ -0,0 +1,420 @@
+#include "catch2/catch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "words/words.hpp"
+#include "words/linconstraint.hpp"
+#include "words/regconstraints.hpp"
+#include "solvers/solvers.hpp"
+#include "fingerprint.hpp"
+#include "passed.hpp"
+
+using namespace std;
+using namespace Words::Solvers::Levis;
+
+namespace {
+    // X = a^n b^m, plus |X| <= n + m when constrained
+    shared_ptr<Words::Options> system(Words::Options &base, size_t n, size_t m, bool constrained = false) {
+        auto opt = base.copy();
+        Words::IEntry *x = opt->context->findSymbol('X');
+        vector<Words::IEntry *> rhs(n, opt->context->findSymbol('a'));
+        rhs.insert(rhs.end(), m, opt->context->findSymbol('b'));
+        Words::Word l(vector<Words::IEntry *>{x});
+        Words::Word r(std::move(rhs));
+        Words::Equation eq(l, r);
+        eq.ctxt = opt->context.get();
+        opt->equations.push_back(eq);
+        if (constrained) {
+            auto builder = Words::Constraints::makeLinConstraintBuilder(Words::Constraints::Cmp::LEq);
+            builder->addLHS(x, 1);
+            builder->addRHS(static_cast<int64_t> (n + m));
+            opt->constraints.push_back(builder->makeConstraint());
+        }
+        return opt;
+    }
+
+    Words::Options context() {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('a');
+        opt.context->addTerminal('b');
+        opt.context->addVariable('X');
+        return opt;
+    }
+}
+
+TEST_CASE("Fingerprints of equation systems") {
+    Words::Options base = context();
+    vector<uint32_t> form, other;
+    serialise(*system(base, 2, 1), form);
+    serialise(*system(base, 2, 1)->copy(), other);
+    REQUIRE(form == other);
+    REQUIRE(fingerprint(form) == fingerprint(other));
+
+    serialise(*system(base, 1, 2), other);
+    REQUIRE(form != other);
+    serialise(*system(base, 2, 1, true), other);
+    REQUIRE(form != other);
+    REQUIRE(fingerprint(form) != fingerprint(other));
+}
+
+TEST_CASE("Fingerprints follow changes to words") {
+    Words::Options base = context();
+    auto opt = system(base, 2, 1);
+    auto copy = opt->copy();
+    REQUIRE(fingerprint(*opt) == fingerprint(*copy));
+    REQUIRE(fingerprint(*opt) == fingerprint(*system(base, 2, 1)));
+
+    // Changing the copy leaves the digests of the original alone
+    auto x = opt->context->findSymbol('X');
+    auto a = opt->context->findSymbol('a');
+    Words::Word image({a, x});
+    copy->equations[0].lhs.substitudeVariable(x, image);
+    REQUIRE(fingerprint(*opt) != fingerprint(*copy));
+    REQUIRE(fingerprint(*opt) == fingerprint(*system(base, 2, 1)));
+    copy->equations[0].lhs.erase_entry(copy->equations[0].lhs.ebegin());
+    copy->equations[0].rhs.erase_entry(copy->equations[0].rhs.ebegin());
+    REQUIRE(fingerprint(*copy) == fingerprint(*system(base, 1, 1)));
+    REQUIRE(opt->equations[0].lhs == copy->equations[0].lhs);
+    REQUIRE(opt->equations[0].rhs != copy->equations[0].rhs);
+}
+
+TEST_CASE("Passed set") {
+    Words::Options base = context();
+    for (bool exact: {false, true}) {
+        PassedSet passed(exact);
+        // Enough systems to grow the table a few times
+        for (size_t n = 0; n < 100; n++) {
+            for (size_t m = 0; m < 50; m++) {
+                REQUIRE(passed.insert(*system(base, n, m, m % 2)));
+            }
+        }
+        REQUIRE(passed.size() == 5000);
+        for (size_t n = 0; n < 100; n++) {
+            for (size_t m = 0; m < 50; m++) {
+                REQUIRE(passed.contains(*system(base, n, m, m % 2)));
+                REQUIRE_FALSE(passed.contains(*system(base, n, m, !(m % 2))));
+                REQUIRE_FALSE(passed.insert(*system(base, n, m, m % 2)));
+            }
+        }
+        REQUIRE(passed.size() == 5000);
+        REQUIRE(passed.collisions() == 0);
+        REQUIRE(passed.memoryUsage() > 5000 * sizeof(Fingerprint));
+    }
+}
+
+TEST_CASE("Passed set tells colliding systems apart") {
+    Fingerprint same;
+    same.high = 42;
+    same.low = 7;
+    vector<uint32_t> first{1, 2, 3};
+    vector<uint32_t> second{1, 2, 4};
+
+    PassedSet fingerprints;
+    REQUIRE(fingerprints.insert(same, first));
+    REQUIRE(fingerprints.contains(same, second));
+    REQUIRE_FALSE(fingerprints.insert(same, second));
+
+    PassedSet exact(true);
+    REQUIRE(exact.insert(same, first));
+    REQUIRE_FALSE(exact.contains(same, second));
+    REQUIRE(exact.insert(same, second));
+    REQUIRE(exact.contains(same, first));
+    REQUIRE(exact.contains(same, second));
+    REQUIRE(exact.size() == 2);
+    REQUIRE(exact.collisions() > 0);
+}
+
+TEST_CASE("Canonical forms of equation systems") {
+    Words::Options base = context();
+    base.context->addVariable('Y');
+    base.context->addVariable('Z');
+    auto equation = [&](Words::Options &opt, vector<char> lhs, vector<char> rhs) {
+        vector<Words::IEntry *> l, r;
+        for (auto c : lhs) {
+            l.push_back(opt.context->findSymbol(c));
+        }
+        for (auto c : rhs) {
+            r.push_back(opt.context->findSymbol(c));
+        }
+        Words::Word lw(std::move(l));
+        Words::Word rw(std::move(r));
+        Words::Equation eq(lw, rw);
+        eq.ctxt = opt.context.get();
+        opt.equations.push_back(eq);
+    };
+    auto atMost = [&](Words::Options &opt, char v, int64_t n) {
+        auto builder = Words::Constraints::makeLinConstraintBuilder(Words::Constraints::Cmp::LEq);
+        builder->addLHS(opt.context->findSymbol(v), 1);
+        builder->addRHS(n);
+        opt.constraints.push_back(builder->makeConstraint());
+    };
+
+    // XaY = bZ, Z = Xb, |Y| <= 2 and, renamed and reordered, Z = Yb, YaX = bZ, |X| <= 2
+    auto first = base.copy();
+    equation(*first, {'X', 'a', 'Y'}, {'b', 'Z'});
+    equation(*first, {'Z'}, {'X', 'b'});
+    atMost(*first, 'Y', 2);
+    auto second = base.copy();
+    equation(*second, {'Z'}, {'Y', 'b'});
+    equation(*second, {'Y', 'a', 'X'}, {'b', 'Z'});
+    atMost(*second, 'X', 2);
+    // The same with the bound on the other variable
+    auto third = base.copy();
+    equation(*third, {'Z'}, {'Y', 'b'});
+    equation(*third, {'Y', 'a', 'X'}, {'b', 'Z'});
+    atMost(*third, 'Y', 2);
+
+    vector<uint32_t> form, other;
+    REQUIRE(canonicalise(*first, form));
+    REQUIRE(canonicalise(*second, other));
+    REQUIRE(form == other);
+    REQUIRE(canonicalise(*third, other));
+    REQUIRE(form != other);
+    serialise(*first, other);
+    REQUIRE(form != other);
+
+    for (bool exact: {false, true}) {
+        PassedSet passed(exact, true);
+        REQUIRE(passed.insert(*first));
+        REQUIRE(passed.contains(*first));
+        REQUIRE(passed.merged() == 0);
+        REQUIRE(passed.contains(*second));
+        REQUIRE_FALSE(passed.insert(*second));
+        REQUIRE(passed.merged() == 2);
+        REQUIRE_FALSE(passed.contains(*third));
+        REQUIRE(passed.size() == 1);
+    }
+    PassedSet plain;
+    REQUIRE(plain.insert(*first));
+    REQUIRE(plain.insert(*second));
+    REQUIRE(plain.merged() == 0);
+
+    // X in a* is Y in a* after renaming, so the systems are no longer
+    // renamings of each other
+    vector<shared_ptr<Words::RegularConstraints::RegNode>> as{
+        make_shared<Words::RegularConstraints::RegWord>(Words::Word({base.context->findSymbol('a')}))};
+    auto star = make_shared<Words::RegularConstraints::RegOperation>(Words::RegularConstraints::RegularOperator::STAR, as);
+    first->recons.push_back(make_shared<Words::RegularConstraints::RegConstraint>(Words::Word({base.context->findSymbol('X')}), star));
+    second->recons.push_back(make_shared<Words::RegularConstraints::RegConstraint>(Words::Word({base.context->findSymbol('X')}), star));
+    REQUIRE_FALSE(canonicalise(*first, form));
+    PassedSet regular(false, true);
+    REQUIRE(regular.insert(*first));
+    REQUIRE(regular.insert(*second));
+    REQUIRE(regular.merged() == 0);
+}
+
+TEST_CASE("Best-first search order") {
+    Words::Options base = context();
+    setSearchOrder<SearchOrder::BestFirst>(Priority::TotalLength);
+    auto &queue = getQueue();
+    auto longer = system(base, 3, 2);
+    auto shorter = system(base, 1, 1);
+    auto same = system(base, 2, 0);
+    queue.push(longer);
+    queue.push(shorter);
+    queue.push(same);
+    REQUIRE(queue.size() == 3);
+    REQUIRE(queue.front() == shorter);
+    queue.pop();
+    REQUIRE(queue.front() == same);
+    queue.pop();
+    REQUIRE(queue.front() == longer);
+    queue.pop();
+    REQUIRE(queue.size() == 0);
+    REQUIRE(queue.getStatistics() == "Heap pushes: 3, pops: 3");
+
+    // Fewest bs first, ties in insertion order
+    setSearchOrder<SearchOrder::BestFirst, PriorityFunction>([](const Words::Options &opt) {
+        auto &rhs = opt.equations[0].rhs;
+        return static_cast<double> (count(rhs.ebegin(), rhs.eend(), opt.context->findSymbol('b')));
+    });
+    auto &custom = getQueue();
+    custom.push(longer);
+    custom.push(same);
+    custom.push(shorter);
+    REQUIRE(custom.front() == same);
+    custom.pop();
+    REQUIRE(custom.front() == shorter);
+    custom.clear();
+    REQUIRE(custom.size() == 0);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+}
+
+TEST_CASE("Waiting list spilling to disk") {
+    // Has no compact form, so it stays in memory
+    struct Opaque : public Words::Constraints::Constraint {
+        std::ostream &output(std::ostream &os) const override { return os << "Opaque"; }
+        uint32_t hash(uint32_t seed) const override { return seed; }
+        Words::Constraints::Constraint_ptr copy() const override { return make_shared<Opaque>(); }
+    };
+
+    Words::Options base = context();
+    auto x = base.context->findSymbol('X');
+    auto sequence = base.context->addSequence({base.context->findSymbol('b'), base.context->findSymbol('a')});
+    setSpillThreshold(1024);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+    auto &queue = getQueue();
+    vector<shared_ptr<Words::Options>> pushed;
+    size_t popped = 0;
+    for (size_t n = 0; n < 50; n++) {
+        for (size_t m = 0; m < 20; m++) {
+            auto opt = system(base, n, m, m % 2);
+            if (m == 3) {
+                opt->constraints.push_back(make_shared<Words::Constraints::Unrestricted>(x));
+                Words::Word lhs(vector<Words::IEntry *>{x, sequence});
+                Words::Word rhs(vector<Words::IEntry *>{sequence, x});
+                Words::Equation eq(lhs, rhs);
+                eq.ctxt = opt->context.get();
+                opt->equations.push_back(eq);
+            }
+            if (m == 7) {
+                opt->constraints.push_back(make_shared<Opaque>());
+            }
+            queue.push(opt);
+            pushed.push_back(opt);
+        }
+        // Take some out on the way, so reading and writing interleave
+        for (size_t i = 0; i < 7; i++, popped++) {
+            vector<uint32_t> form, other;
+            serialise(*queue.front(), form);
+            serialise(*pushed[popped], other);
+            REQUIRE(form == other);
+            queue.pop();
+        }
+        REQUIRE(queue.size() == pushed.size() - popped);
+    }
+    REQUIRE(queue.spilledStates() > 0);
+    REQUIRE(queue.spilledBytes() > queue.spilledStates() * 8);
+    for (; popped < pushed.size(); popped++) {
+        auto front = queue.front();
+        vector<uint32_t> form, other;
+        serialise(*front, form);
+        serialise(*pushed[popped], other);
+        REQUIRE(form == other);
+        if (popped % 20 == 7) {
+            REQUIRE(front == pushed[popped]);
+        }
+        queue.pop();
+    }
+    REQUIRE(queue.size() == 0);
+
+    // Every system is over the threshold on its own
+    setSpillThreshold(1);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+    auto &small = getQueue();
+    pushed.clear();
+    for (size_t n = 0; n < 5; n++) {
+        pushed.push_back(system(base, n, 1));
+        small.push(pushed.back());
+        REQUIRE(small.front() == pushed[0]);
+    }
+    for (size_t i = 0; i < pushed.size(); i++) {
+        vector<uint32_t> form, other;
+        serialise(*small.front(), form);
+        serialise(*pushed[i], other);
+        REQUIRE(form == other);
+        small.pop();
+    }
+    REQUIRE(small.size() == 0);
+
+    // A long search keeps writing to the file while reading from it, the
+    // file must not keep the systems read long ago
+    setSpillThreshold(1024);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+    auto &steady = getQueue();
+    pushed.clear();
+    popped = 0;
+    size_t largest = 0;
+    for (size_t n = 0; n < 20000; n++) {
+        pushed.push_back(system(base, n % 50, n % 20));
+        steady.push(pushed.back());
+        if (n >= 100) {
+            vector<uint32_t> form, other;
+            serialise(*steady.front(), form);
+            serialise(*pushed[popped], other);
+            REQUIRE(form == other);
+            steady.pop();
+            popped++;
+        }
+        largest = max(largest, steady.spillFileBytes());
+    }
+    INFO("spilled " << steady.spilledBytes() << " bytes, file took at most " << largest);
+    // At most a few times the 100 systems waiting
+    REQUIRE(largest < 4 * 100 * steady.spilledBytes() / steady.spilledStates());
+    REQUIRE(largest * 50 < steady.spilledBytes());
+    setSpillThreshold(0);
+    setSearchOrder<SearchOrder::BreadthFirst>();
+}
+
+TEST_CASE("Passed set lookups against std::set", "[.benchmark]") {
+    const size_t states = 1 << 20;
+    vector<Fingerprint> keys(states);
+    vector<uint32_t> form;
+    for (size_t i = 0; i < states; i++) {
+        form.assign({static_cast<uint32_t> (i), static_cast<uint32_t> (i >> 16)});
+        keys[i] = fingerprint(form);
+    }
+
+    set<uint32_t> tree;
+    PassedSet table;
+    for (auto &k: keys) {
+        tree.insert(static_cast<uint32_t> (k.low));
+        table.insert(k, form);
+    }
+
+    size_t found = 0;
+    auto start = chrono::steady_clock::now();
+    for (auto &k: keys) {
+        found += tree.count(static_cast<uint32_t> (k.low));
+    }
+    auto middle = chrono::steady_clock::now();
+    for (auto &k: keys) {
+        found += table.contains(k, form);
+    }
+    auto end = chrono::steady_clock::now();
+
+    REQUIRE(found == 2 * states);
+    WARN("std::set: " << chrono::duration_cast<chrono::milliseconds>(middle - start).count() << " ms, "
+                      << "PassedSet: " << chrono::duration_cast<chrono::milliseconds>(end - middle).count() << " ms, "
+                      << table.memoryUsage() / table.size() << " bytes per state");
+}
+
+TEST_CASE("Fingerprints from digests against serialising", "[.benchmark]") {
+    Words::Options base = context();
+    vector<shared_ptr<Words::Options>> systems;
+    for (size_t n = 0; n < 1000; n++) {
+        auto opt = system(base, 500 + n, 500);
+        for (size_t i = 0; i < 9; i++) {
+            opt->equations.push_back(opt->equations[0]);
+        }
+        systems.push_back(opt);
+    }
+
+    size_t distinct = 0;
+    vector<uint32_t> form;
+    auto start = chrono::steady_clock::now();
+    for (auto &opt: systems) {
+        serialise(*opt, form);
+        distinct += !fingerprint(form).empty();
+    }
+    auto middle = chrono::steady_clock::now();
+    for (auto &opt: systems) {
+        distinct += !fingerprint(*opt).empty();
+    }
+    auto end = chrono::steady_clock::now();
+    for (auto &opt: systems) {
+        distinct += !fingerprint(*opt).empty();
+    }
+    auto again = chrono::steady_clock::now();
+
+    REQUIRE(distinct == 3 * systems.size());
+    WARN(systems.size() << " systems of 10 equations of about 2000 symbols, serialised: "
+                        << chrono::duration_cast<chrono::microseconds>(middle - start).count() << " us, "
+                        << "first digests: " << chrono::duration_cast<chrono::microseconds>(end - middle).count() << " us, "
+                        << "cached digests: " << chrono::duration_cast<chrono::microseconds>(again - end).count() << " us");
+}
@@ -0,0 +1,76 @@
+#include "catch2/catch.hpp"
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "parser/parsing.hpp"
+
+#ifndef TRACK1_DIR
+#define TRACK1_DIR "test/track1"
+#endif
+
+using namespace std;
+
+// Only builds with ENABLELEVISPROFILE print the profile
+#ifdef ENABLELEVISPROFILE
+namespace {
+    // The "Name: value" lines of getMoreInformation
+    map<string, double> information(const string &file) {
+        ifstream is(file);
+        REQUIRE(is.good());
+        stringstream err;
+        auto job = Words::makeParser(Words::ParserType::Standard, is)->Parse(err)->newJob();
+        REQUIRE(job);
+        auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::Levis>();
+        stringstream messages;
+        Words::Solvers::StreamRelay relay(messages);
+        solver->Solve(job->options, relay);
+        stringstream info;
+        solver->getMoreInformation(info);
+        map<string, double> res;
+        string line;
+        while (getline(info, line)) {
+            auto colon = line.find(':');
+            res[line.substr(0, colon)] = stod(line.substr(colon + 1));
+        }
+        return res;
+    }
+}
+
+TEST_CASE("Levis profile") {
+    Words::Solvers::Levis::selectNone();
+    Words::Solvers::Levis::setSearchOrder<Words::Solvers::Levis::SearchOrder::BreadthFirst>();
+    string json = "levisprofile.json";
+    Words::Solvers::Levis::setProfileFile(json);
+    for (string i : {"1", "6", "12"}) {
+        INFO("01.track_" << i << ".eq");
+        auto info = information(TRACK1_DIR "/01.track_" + i + ".eq");
+
+        // Every successor comes from one rule firing, and is dropped at most once
+        double fired = 0;
+        for (auto &entry : info) {
+            if (entry.first.rfind("Fired", 0) == 0) {
+                fired += entry.second;
+            }
+        }
+        REQUIRE(fired > 0);
+        REQUIRE(fired == info["SuccessorsProduced"]);
+        REQUIRE(info["PrunedDuplicate"] + info["PrunedUnsat"] + info["PrunedSimplifierSat"] <= info["SuccessorsProduced"]);
+        REQUIRE(info.count("TimeRules"));
+        REQUIRE(info.count("TimeRootSolution"));
+
+        ifstream is(json);
+        REQUIRE(is.good());
+        stringstream dump;
+        dump << is.rdbuf();
+        REQUIRE(dump.str().find("\"Produced\": " + to_string(static_cast<size_t>(info["SuccessorsProduced"]))) != string::npos);
+    }
+    Words::Solvers::Levis::setProfileFile("");
+    remove(json.c_str());
+}
+#endif
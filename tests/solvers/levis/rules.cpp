@@ -0,0 +1,67 @@
+#include "catch2/catch.hpp"
+#include <memory>
+#include <vector>
+
+#include "words/words.hpp"
+#include "rules.hpp"
+
+using namespace std;
+
+namespace {
+    Words::Equation equation(Words::Options &opt, vector<Words::IEntry *> lhs, vector<Words::IEntry *> rhs) {
+        Words::Word l(std::move(lhs));
+        Words::Word r(std::move(rhs));
+        Words::Equation eq(l, r);
+        eq.ctxt = opt.context.get();
+        return eq;
+    }
+
+    const Words::IEntry *first(const Words::Word &w) {
+        return *w.ebegin();
+    }
+
+    const Words::IEntry *const *data(const Words::Word &w) {
+        return &*w.ebegin();
+    }
+}
+
+TEST_CASE("Successors share the unchanged words") {
+    Words::Options opt;
+    opt.context = make_shared<Words::Context>();
+    opt.context->addTerminal('a');
+    opt.context->addTerminal('b');
+    Words::IEntry *a = opt.context->findSymbol('a');
+    Words::IEntry *b = opt.context->findSymbol('b');
+    Words::IEntry *x = opt.context->addVariable('X');
+    Words::IEntry *y = opt.context->addVariable('Y');
+    // X a = a X, Y b = b Y
+    opt.equations.push_back(equation(opt, {x, a}, {a, x}));
+    opt.equations.push_back(equation(opt, {y, b}, {b, y}));
+
+    Words::Substitution subs;
+    subs[x] = Words::Word({a, x});
+    auto next = successor(opt, subs);
+
+    REQUIRE(next->equations[0].lhs == Words::Word({a, x, a}));
+    REQUIRE(next->equations[0].rhs == Words::Word({a, a, x}));
+    REQUIRE(opt.equations[0].lhs == Words::Word({x, a}));
+    REQUIRE(data(next->equations[1].lhs) == data(opt.equations[1].lhs));
+    REQUIRE(data(next->equations[1].rhs) == data(opt.equations[1].rhs));
+
+    // Modifying the successor leaves the parent alone
+    auto &lhs = next->equations[1].lhs;
+    lhs.erase_entry(lhs.ebegin());
+    REQUIRE(first(lhs) == b);
+    REQUIRE(first(opt.equations[1].lhs) == y);
+    REQUIRE(opt.equations[1].lhs.entries() == 2);
+
+    // Empty words share their entries as well
+    Words::Word empty;
+    Words::Word built;
+    auto wb = opt.context->makeWordBuilder(built);
+    *wb << 'a';
+    wb->flush();
+    REQUIRE(built.entries() == 1);
+    REQUIRE(empty.entries() == 0);
+    REQUIRE(Words::Word().entries() == 0);
+}
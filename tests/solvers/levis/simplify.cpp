@@ -0,0 +1,169 @@
+#include "catch2/catch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/simplifiers.hpp"
+#include "parser/parsing.hpp"
+#include "fingerprint.hpp"
+#include "rules.hpp"
+
+#ifndef TRACK1_DIR
+#define TRACK1_DIR "test/track1"
+#endif
+
+using namespace std;
+using Words::Solvers::CoreSimplifier;
+using Words::Solvers::DirtyEquations;
+using Words::Solvers::Simplified;
+
+namespace {
+    // The equations of count consecutive track1 instances as one system
+    unique_ptr<Words::Job> parse(size_t first, size_t count) {
+        string variables, terminals, equations;
+        for (size_t i = first; i < first + count; i++) {
+            ifstream is(TRACK1_DIR "/01.track_" + to_string(i) + ".eq");
+            REQUIRE(is.good());
+            string line;
+            while (getline(is, line)) {
+                auto brace = line.substr(line.find('{') + 1, line.find('}') - line.find('{') - 1);
+                if (line.rfind("Variables", 0) == 0) {
+                    variables += brace;
+                } else if (line.rfind("Terminals", 0) == 0) {
+                    terminals += brace;
+                } else if (line.rfind("Equation:", 0) == 0) {
+                    equations += line + "\n";
+                }
+            }
+        }
+        sort(variables.begin(), variables.end());
+        variables.erase(unique(variables.begin(), variables.end()), variables.end());
+        sort(terminals.begin(), terminals.end());
+        terminals.erase(unique(terminals.begin(), terminals.end()), terminals.end());
+        stringstream is("Variables {" + variables + "}\nTerminals {" + terminals + "}\n" + equations + "SatGlucose(100)");
+        stringstream err;
+        auto job = Words::makeParser(Words::ParserType::Standard, is)->Parse(err)->newJob();
+        REQUIRE(job);
+        return job;
+    }
+
+    Simplified full(Words::Options &opt, Words::Substitution &sub) {
+        vector<Words::Constraints::Constraint_ptr> cstr;
+        return CoreSimplifier::solverReduce(opt, sub, cstr);
+    }
+
+    Simplified incremental(const Words::Options &from, const Words::Substitution &subs, Words::Options &opt, Words::Substitution &sub) {
+        vector<Words::Constraints::Constraint_ptr> cstr;
+        DirtyEquations dirty;
+        changedEquations(from, subs, dirty);
+        return CoreSimplifier::solverReduce(opt, sub, cstr, dirty);
+    }
+
+    // The substitutions the Levis rules make for X
+    vector<Words::Substitution> substitutions(Words::Options &opt, Words::IEntry *x) {
+        vector<Words::Substitution> res(1);
+        res.back()[x] = Words::Word();
+        for (auto a : opt.context->getTerminalAlphabet()) {
+            res.emplace_back();
+            res.back()[x] = Words::Word({a, x});
+        }
+        for (auto y : opt.context->getVariableAlphabet()) {
+            if (y != x) {
+                res.emplace_back();
+                res.back()[x] = Words::Word({y, x});
+            }
+        }
+        return res;
+    }
+
+    vector<uint32_t> form(const Words::Options &opt) {
+        vector<uint32_t> res;
+        Words::Solvers::Levis::serialise(opt, res);
+        return res;
+    }
+}
+
+// Skipping the equations a substitution left alone gives the same system
+// as simplifying all of them
+TEST_CASE("Incremental simplification") {
+    size_t compared = 0;
+    for (size_t count : {1, 4}) {
+        for (size_t i = 1; i + count <= 41; i += count) {
+            INFO(count << " instances from 01.track_" << i << ".eq");
+            auto job = parse(i, count);
+            auto root = job->options.copy();
+            Words::Substitution rootSub;
+            if (full(*root, rootSub) != Simplified::JustReduced) {
+                continue;
+            }
+
+            // Two levels of successors, the second derived from the incremental results
+            vector<shared_ptr<Words::Options>> parents{root};
+            for (size_t depth = 0; depth < 2; depth++) {
+                vector<shared_ptr<Words::Options>> next;
+                for (auto &parent : parents) {
+                    for (auto x : parent->context->getVariableAlphabet()) {
+                        for (auto &subs : substitutions(*parent, x)) {
+                            auto expected = successor(*parent, subs);
+                            auto actual = successor(*parent, subs);
+                            Words::Substitution expectedSub, actualSub;
+                            auto res = full(*expected, expectedSub);
+                            REQUIRE(incremental(*parent, subs, *actual, actualSub) == res);
+                            if (res == Simplified::ReducedNsatis) {
+                                continue;
+                            }
+                            REQUIRE(form(*actual) == form(*expected));
+                            REQUIRE(actualSub == expectedSub);
+                            compared++;
+                            if (res == Simplified::JustReduced && next.size() < 10) {
+                                next.push_back(actual);
+                            }
+                        }
+                    }
+                }
+                parents = next;
+            }
+        }
+    }
+    REQUIRE(compared > 0);
+}
+
+// Systems of eight equations each, taken from consecutive track1 instances
+TEST_CASE("Incremental simplification against full", "[.benchmark]") {
+    vector<pair<shared_ptr<Words::Options>, Words::Substitution>> successors;
+    vector<unique_ptr<Words::Job>> jobs;
+    for (size_t i = 1; i + 8 <= 201; i += 8) {
+        jobs.push_back(parse(i, 8));
+        auto root = jobs.back()->options.copy();
+        Words::Substitution rootSub;
+        if (full(*root, rootSub) != Simplified::JustReduced) {
+            continue;
+        }
+        for (auto x : root->context->getVariableAlphabet()) {
+            for (auto &subs : substitutions(*root, x)) {
+                successors.emplace_back(root, subs);
+            }
+        }
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (auto &s : successors) {
+        auto to = successor(*s.first, s.second);
+        Words::Substitution sub;
+        full(*to, sub);
+    }
+    auto middle = chrono::steady_clock::now();
+    for (auto &s : successors) {
+        auto to = successor(*s.first, s.second);
+        Words::Substitution sub;
+        incremental(*s.first, s.second, *to, sub);
+    }
+    auto end = chrono::steady_clock::now();
+    WARN(successors.size() << " successors, full: " << chrono::duration_cast<chrono::milliseconds>(middle - start).count() << " ms, "
+                           << "incremental: " << chrono::duration_cast<chrono::milliseconds>(end - middle).count() << " ms");
+}
@@ -0,0 +1,168 @@
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "parser/parsing.hpp"
+
+#ifndef TRACK1_DIR
+#define TRACK1_DIR "test/track1"
+#endif
+
+using namespace std;
+using Words::Solvers::Result;
+
+namespace {
+    // Assigns "a" to every variable after a delay, or waits until interrupted
+    class FakeSolver : public Words::Solvers::Solver {
+    public:
+        FakeSolver(Result result, bool waitForInterrupt, chrono::milliseconds delay = chrono::milliseconds(0))
+                : result(result), waitForInterrupt(waitForInterrupt), delay(delay) {}
+
+        Result Solve(Words::Options &opt, Words::Solvers::MessageRelay &relay) override {
+            relay.pushMessage("started");
+            if (waitForInterrupt) {
+                while (!stop) {
+                    this_thread::sleep_for(chrono::milliseconds(1));
+                }
+                return Result::NoIdea;
+            }
+            this_thread::sleep_for(delay);
+            ctx = opt.context;
+            // Temporary variables of a member never reach the original system
+            opt.context->addTemporaryVariable("T");
+            Words::IEntry *a = opt.context->addTerminal('a');
+            for (auto v: opt.context->getVariableAlphabet()) {
+                sub[v] = Words::Word({a});
+            }
+            return result;
+        }
+
+        void getResults(Words::Solvers::ResultGatherer &r) override { r.setSubstitution(sub); }
+
+        void interrupt() override { stop = true; }
+
+        atomic<bool> stop{false};
+
+    private:
+        Result result;
+        bool waitForInterrupt;
+        chrono::milliseconds delay;
+        shared_ptr<Words::Context> ctx;
+        Words::Substitution sub;
+    };
+
+    class Gatherer : public Words::Solvers::DummyResultGatherer {
+    public:
+        void setSubstitution(Words::Substitution &s) override { sub = s; }
+
+        Words::Substitution sub;
+    };
+
+    class Relay : public Words::Solvers::MessageRelay {
+    public:
+        void pushMessage(const string &s) override { messages.push_back(s); }
+
+        void progressMessage(const string &) override {}
+
+        vector<string> messages;
+    };
+
+    Words::Options system() {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('b');
+        Words::IEntry *x = opt.context->addVariable("X");
+        Words::IEntry *b = opt.context->findSymbol('b');
+        Words::Word lhs({x, b});
+        Words::Word rhs({b, x});
+        Words::Equation eq(lhs, rhs);
+        eq.ctxt = opt.context.get();
+        opt.equations.push_back(eq);
+        return opt;
+    }
+}
+
+TEST_CASE("Deep copies are independent") {
+    Words::Options opt = system();
+    map<const Words::IEntry *, Words::IEntry *> entries;
+    auto copy = opt.deepCopy(entries);
+    REQUIRE(copy->context != opt.context);
+    REQUIRE(copy->context->nbVars() == 1);
+    REQUIRE(copy->context->nbTerms() == 2);
+    Words::IEntry *x = opt.context->findSymbol("X");
+    REQUIRE(entries.at(x) == copy->context->findSymbol("X"));
+    REQUIRE(copy->equations.size() == 1);
+    REQUIRE(*copy->equations[0].lhs.ebegin() == entries.at(x));
+
+    copy->context->addVariable("Y");
+    REQUIRE(opt.context->nbVars() == 1);
+}
+
+TEST_CASE("First definitive result wins") {
+    Words::Options opt = system();
+    Words::Solvers::Portfolio::Members members;
+    members.emplace_back("waiting", make_unique<FakeSolver>(Result::NoIdea, true));
+    members.emplace_back("bounded", make_unique<FakeSolver>(Result::NoSolution, false));
+    members.emplace_back("solving", make_unique<FakeSolver>(Result::HasSolution, false));
+    auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::Portfolio>(std::move(members));
+
+    Relay relay;
+    REQUIRE(solver->Solve(opt, relay) == Result::HasSolution);
+    REQUIRE(relay.messages.back() == "Portfolio: solving decided the instance");
+
+    Gatherer gatherer;
+    solver->getResults(gatherer);
+    Words::IEntry *x = opt.context->findSymbol("X");
+    REQUIRE(gatherer.sub.size() == 1);
+    REQUIRE(gatherer.sub.count(x) == 1);
+    REQUIRE(gatherer.sub[x].characters() == 1);
+    REQUIRE((*gatherer.sub[x].begin())->getContext() == opt.context.get());
+}
+
+TEST_CASE("Bounded results are reported without a winner") {
+    Words::Options opt = system();
+    Words::Solvers::Portfolio::Members members;
+    members.emplace_back("bounded", make_unique<FakeSolver>(Result::NoSolution, false));
+    members.emplace_back("clueless", make_unique<FakeSolver>(Result::NoIdea, false));
+    auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::Portfolio>(std::move(members));
+
+    Relay relay;
+    REQUIRE(solver->Solve(opt, relay) == Result::NoSolution);
+}
+
+TEST_CASE("Levis gives up its SMT query when another member wins") {
+    ifstream is(TRACK1_DIR "/01.track_11.eq");
+    REQUIRE(is.good());
+    stringstream err;
+    shared_ptr<Words::Job> job = Words::makeParser(Words::ParserType::Standard, is)->Parse(err)->newJob();
+    REQUIRE(job);
+
+    // Levis spends well over ten seconds in its first Z3 query on this instance
+    Words::Solvers::Levis::selectVariableTerminalRatio(1.1);
+    Words::Solvers::Levis::setSearchOrder<Words::Solvers::Levis::SearchOrder::BreadthFirst>();
+    Words::Solvers::Portfolio::Members members;
+    members.emplace_back("levis", Words::Solvers::makeSolver<Words::Solvers::Types::Levis>());
+    members.emplace_back("satencoding", make_unique<FakeSolver>(Result::HasSolution, false, chrono::milliseconds(500)));
+    Words::Solvers::Solver *levis = members[0].second.get();
+    shared_ptr<Words::Solvers::Solver> solver = Words::Solvers::makeSolver<Words::Solvers::Types::Portfolio>(std::move(members));
+
+    // A hanging portfolio fails the test instead of blocking it
+    auto relay = make_shared<Relay>();
+    auto done = make_shared<promise<Result>>();
+    future<Result> result = done->get_future();
+    thread([=]() { done->set_value(solver->Solve(job->options, *relay)); }).detach();
+    REQUIRE(result.wait_for(chrono::seconds(10)) == future_status::ready);
+    Words::Solvers::Levis::selectNone();
+
+    REQUIRE(result.get() == Result::HasSolution);
+    REQUIRE(relay->messages.back() == "Portfolio: satencoding decided the instance");
+    stringstream info;
+    levis->getMoreInformation(info);
+    REQUIRE(info.str().find("SMTCalls: 0 ") == string::npos);
+}
@@ -0,0 +1,92 @@
+#include "catch2/catch.hpp"
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "parser/parsing.hpp"
+
+#ifndef TRACK1_DIR
+#define TRACK1_DIR "test/track1"
+#endif
+
+using namespace std;
+
+namespace {
+    unique_ptr<Words::Job> parse(const string &file) {
+        ifstream is(file);
+        REQUIRE(is.good());
+        stringstream err;
+        auto job = Words::makeParser(Words::ParserType::Standard, is)->Parse(err)->newJob();
+        REQUIRE(job);
+        if (!job->solver) {
+            job->solver = Words::Solvers::makeSolver<Words::Solvers::Types::SatEncoding>(static_cast<size_t> (0));
+        }
+        return job;
+    }
+
+    class Gatherer : public Words::Solvers::DummyResultGatherer {
+    public:
+        void setSubstitution(Words::Substitution &s) override { sub = s; }
+
+        Words::Substitution sub;
+    };
+
+    string substitute(const Words::Word &w, Words::Substitution &sub) {
+        string res;
+        for (auto e: w) {
+            if (e->isVariable()) {
+                for (auto t: sub[e]) {
+                    res += t->getTerminal()->getChar();
+                }
+            } else {
+                res += e->getTerminal()->getChar();
+            }
+        }
+        return res;
+    }
+}
+
+// Solves different instances on several threads at once, each with its own
+// SAT encoding. All of test/track1 is satisfiable.
+TEST_CASE("Concurrent SAT encodings", "[stress]") {
+    const size_t threads = 8;
+    const size_t instances = 32;
+
+    // The parser is not reentrant, only the solving runs concurrently
+    vector<unique_ptr<Words::Job>> jobs;
+    for (size_t i = 1; i <= instances; i++) {
+        jobs.push_back(parse(TRACK1_DIR "/01.track_" + to_string(i) + ".eq"));
+    }
+
+    vector<Words::Solvers::Result> results(instances, Words::Solvers::Result::NoIdea);
+    vector<Gatherer> gatherers(instances);
+    vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            stringstream messages;
+            Words::Solvers::StreamRelay relay(messages);
+            for (size_t i = t; i < instances; i += threads) {
+                results[i] = jobs[i]->solver->Solve(jobs[i]->options, relay);
+                if (results[i] == Words::Solvers::Result::HasSolution) {
+                    jobs[i]->solver->getResults(gatherers[i]);
+                }
+            }
+        });
+    }
+    for (auto &w: workers) {
+        w.join();
+    }
+
+    for (size_t i = 0; i < instances; i++) {
+        INFO("01.track_" << i + 1 << ".eq");
+        REQUIRE(results[i] == Words::Solvers::Result::HasSolution);
+        for (auto &eq: jobs[i]->options.equations) {
+            REQUIRE(substitute(eq.lhs, gatherers[i].sub) == substitute(eq.rhs, gatherers[i].sub));
+        }
+    }
+}
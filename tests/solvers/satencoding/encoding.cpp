@@ -0,0 +1,52 @@
+#include "catch2/catch.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+#include "solvers/timing.hpp"
+#include "regular/regencoding.h"
+#include "encodingcontext.hpp"
+
+using namespace std;
+
+namespace {
+    // X_i a X_{i+1} = X_{i+1} a X_i for consecutive variables, none of the bounds can be sharpened
+    Words::Options chainedEquations(size_t variables) {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('a');
+        vector<Words::IEntry *> xs;
+        for (size_t i = 0; i < variables; i++) {
+            xs.push_back(opt.context->addVariable("X" + to_string(i)));
+        }
+        Words::IEntry *a = opt.context->findSymbol('a');
+        for (size_t i = 0; i + 1 < variables; i++) {
+            Words::Word lhs({xs[i], a, xs[i + 1]});
+            Words::Word rhs({xs[i + 1], a, xs[i]});
+            Words::Equation eq(lhs, rhs);
+            eq.ctxt = opt.context.get();
+            opt.equations.push_back(eq);
+        }
+        return opt;
+    }
+}
+
+// Encoding time of single bounds from scratch, i.e. total minus solving time as reported by the profiler
+TEST_CASE("Encoding time per bound", "[.][benchmark]") {
+    const size_t variables = 120;
+    for (size_t bound : {4, 16, 36, 64}) {
+        Words::Options opt = chainedEquations(variables);
+        EncodingContext encoding;
+        REQUIRE(encoding.setupSolverMain(opt) == Words::Solvers::Result::NoIdea);
+
+        Words::Substitution sub;
+        Words::Solvers::Timing::Keeper keeper;
+        RegularEncoding::EncodingProfiler profiler{};
+        auto res = encoding.runSolver<true>(false, bound, *opt.context, sub, keeper, nullptr, &profiler);
+        CHECK(res == Words::Solvers::Result::HasSolution);
+        cout << "variables: " << variables << ", bound: " << bound
+             << ", encoding: " << profiler.timeTotal - profiler.timeSolving << " ms" << endl;
+    }
+}
@@ -0,0 +1,91 @@
+#include "catch2/catch.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "words/words.hpp"
+#include "solvers/solvers.hpp"
+
+using namespace std;
+
+namespace {
+    Words::Equation equation(Words::Options &opt, vector<Words::IEntry *> lhs, vector<Words::IEntry *> rhs) {
+        Words::Word l(std::move(lhs));
+        Words::Word r(std::move(rhs));
+        Words::Equation eq(l, r);
+        eq.ctxt = opt.context.get();
+        return eq;
+    }
+
+    // X_i a X_{i+1} = X_{i+1} a X_i and X_0 b = a^10 b, which needs bound 16
+    Words::Options commuting(size_t variables) {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('a');
+        opt.context->addTerminal('b');
+        Words::IEntry *a = opt.context->findSymbol('a');
+        Words::IEntry *b = opt.context->findSymbol('b');
+        vector<Words::IEntry *> xs;
+        for (size_t i = 0; i < variables; i++) {
+            xs.push_back(opt.context->addVariable("X" + to_string(i)));
+        }
+        for (size_t i = 0; i + 1 < variables; i++) {
+            opt.equations.push_back(equation(opt, {xs[i], a, xs[i + 1]}, {xs[i + 1], a, xs[i]}));
+        }
+        vector<Words::IEntry *> rhs(10, a);
+        rhs.push_back(b);
+        opt.equations.push_back(equation(opt, {xs[0], b}, rhs));
+        return opt;
+    }
+
+    class Gatherer : public Words::Solvers::DummyResultGatherer {
+    public:
+        void setSubstitution(Words::Substitution &s) override { sub = s; }
+
+        Words::Substitution sub;
+    };
+
+    string substitute(const Words::Word &w, Words::Substitution &sub) {
+        string res;
+        for (auto e: w) {
+            if (e->isVariable()) {
+                for (auto t: sub[e]) {
+                    res += t->getTerminal()->getChar();
+                }
+            } else {
+                res += e->getTerminal()->getChar();
+            }
+        }
+        return res;
+    }
+}
+
+TEST_CASE("Racing bounds") {
+    for (size_t concurrentBounds: {1, 3}) {
+        Words::Options opt = commuting(4);
+        auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::SatEncoding>(static_cast<size_t> (0),
+                                                                                     concurrentBounds);
+        Words::Solvers::StreamRelay relay(cerr);
+        REQUIRE(solver->Solve(opt, relay) == Words::Solvers::Result::HasSolution);
+        Gatherer gatherer;
+        solver->getResults(gatherer);
+        for (auto &eq: opt.equations) {
+            REQUIRE(substitute(eq.lhs, gatherer.sub) == substitute(eq.rhs, gatherer.sub));
+        }
+    }
+}
+
+TEST_CASE("Racing bounds of an unsatisfiable instance") {
+    for (size_t concurrentBounds: {1, 3}) {
+        Words::Options opt;
+        opt.context = make_shared<Words::Context>();
+        opt.context->addTerminal('a');
+        opt.context->addTerminal('b');
+        Words::IEntry *x = opt.context->addVariable("X");
+        opt.equations.push_back(equation(opt, {opt.context->findSymbol('a'), x}, {opt.context->findSymbol('b'), x}));
+        auto solver = Words::Solvers::makeSolver<Words::Solvers::Types::SatEncoding>(static_cast<size_t> (0),
+                                                                                     concurrentBounds);
+        Words::Solvers::StreamRelay relay(cerr);
+        REQUIRE(solver->Solve(opt, relay) != Words::Solvers::Result::HasSolution);
+    }
+}
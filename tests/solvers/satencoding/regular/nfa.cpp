@@ -0,0 +1,185 @@
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "words/words.hpp"
+#include "words/regconstraints.hpp"
+#include "regular/nfa.h"
+
+using namespace std;
+using namespace Words::RegularConstraints;
+using namespace RegularEncoding::Automaton;
+
+namespace {
+    Words::Word word(Words::Context &ctx, const string &str) {
+        vector<Words::IEntry *> entries;
+        for (char c: str) {
+            entries.push_back(ctx.findSymbol(c));
+        }
+        return Words::Word(std::move(entries));
+    }
+}
+
+TEST_CASE("NFA transition indexes") {
+    Words::Context ctx;
+    ctx.addTerminal('a');
+    ctx.addTerminal('b');
+    Words::Terminal *a = ctx.findSymbol('a')->getTerminal();
+    Words::Terminal *b = ctx.findSymbol('b')->getTerminal();
+
+    NFA M;
+    int q0 = M.new_state();
+    int q1 = M.new_state();
+    int q2 = M.new_state();
+    M.set_initial_state(q0);
+    M.add_final_state(q2);
+    M.add_transition(q0, b, q2);
+    M.add_transition(q0, a, q1);
+    M.add_transition(q0, a, q1);
+    M.add_transition(q1, b, q2);
+
+    REQUIRE(M.numTransitions() == 3);
+    REQUIRE(M.successors(q0).size() == 2);
+    REQUIRE(M.successors(q2).empty());
+    REQUIRE(M.predecessors(q2).size() == 2);
+    REQUIRE(M.predecessors(q0).empty());
+
+    // Adding a state after the indexes have been built
+    int q3 = M.new_state();
+    M.add_eps_transition(q2, q3);
+    REQUIRE(M.successors(q3).empty());
+    REQUIRE(M.epsilonSuccessors(q2).size() == 1);
+    REQUIRE(M.numTransitions() == 3);
+}
+
+TEST_CASE("NFA acceptance") {
+    Words::Context ctx;
+    ctx.addTerminal('a');
+    ctx.addTerminal('b');
+
+    // (ab)*|b
+    auto ab = make_shared<RegWord>(word(ctx, "ab"));
+    auto star = make_shared<RegOperation>(RegularOperator::STAR, vector<shared_ptr<RegNode>>{ab});
+    auto bw = make_shared<RegWord>(word(ctx, "b"));
+    RegOperation expr(RegularOperator::UNION, vector<shared_ptr<RegNode>>{star, bw});
+
+    NFA M = regexToNfa(expr, ctx);
+    for (bool removeEps: {false, true}) {
+        if (removeEps) {
+            M.removeEpsilonTransitions();
+            M = M.reduceToReachableState();
+            for (int q = 0; q < M.numStates(); q++) {
+                REQUIRE(M.epsilonSuccessors(q).empty());
+            }
+        }
+        REQUIRE(M.accept(word(ctx, "")));
+        REQUIRE(M.accept(word(ctx, "ab")));
+        REQUIRE(M.accept(word(ctx, "abab")));
+        REQUIRE(M.accept(word(ctx, "b")));
+        REQUIRE_FALSE(M.accept(word(ctx, "a")));
+        REQUIRE_FALSE(M.accept(word(ctx, "aba")));
+        REQUIRE_FALSE(M.accept(word(ctx, "bb")));
+    }
+}
+
+TEST_CASE("Bit-parallel simulation") {
+    Words::Context ctx;
+    ctx.addTerminal('a');
+    ctx.addTerminal('b');
+    ctx.addTerminal('c');
+
+    // (ab|ba)*a(b*) is small, ((ab|ba)*a(b*))|aabbaabb...|bbaabbaa... needs several blocks
+    auto ab = make_shared<RegWord>(word(ctx, "ab"));
+    auto ba = make_shared<RegWord>(word(ctx, "ba"));
+    auto uni = make_shared<RegOperation>(RegularOperator::UNION, vector<shared_ptr<RegNode>>{ab, ba});
+    auto star = make_shared<RegOperation>(RegularOperator::STAR, vector<shared_ptr<RegNode>>{uni});
+    auto bstar = make_shared<RegOperation>(RegularOperator::STAR, vector<shared_ptr<RegNode>>{make_shared<RegWord>(word(ctx, "b"))});
+    auto small = make_shared<RegOperation>(RegularOperator::CONCAT,
+                                           vector<shared_ptr<RegNode>>{star, make_shared<RegWord>(word(ctx, "a")), bstar});
+    string longA, longB;
+    for (int i = 0; i < 20; i++) {
+        longA += "aabb";
+        longB += "bbaa";
+    }
+    auto wide = make_shared<RegOperation>(RegularOperator::UNION, vector<shared_ptr<RegNode>>{
+            small, make_shared<RegWord>(word(ctx, longA)), make_shared<RegWord>(word(ctx, longB))});
+
+    // All words up to length 7 plus the long ones
+    vector<Words::Word> words;
+    vector<string> strs{""};
+    for (size_t i = 0; i < strs.size(); i++) {
+        if (strs[i].size() < 7) {
+            for (char c: {'a', 'b', 'c'}) {
+                strs.push_back(strs[i] + c);
+            }
+        }
+    }
+    strs.push_back(longA);
+    strs.push_back(longB);
+    strs.push_back(longA + "a");
+    for (auto &str: strs) {
+        words.push_back(word(ctx, str));
+    }
+
+    for (auto &expr: vector<shared_ptr<RegNode>>{small, wide}) {
+        for (bool removeEps: {false, true}) {
+            NFA M = regexToNfa(*expr, ctx);
+            if (removeEps) {
+                M.removeEpsilonTransitions();
+            }
+            Simulator sim(M);
+            vector<bool> batch = sim.accept(words);
+            REQUIRE(batch.size() == words.size());
+            for (size_t i = 0; i < words.size(); i++) {
+                bool expected = M.accept(words[i]);
+                REQUIRE(sim.accept(words[i]) == expected);
+                REQUIRE(batch[i] == expected);
+            }
+        }
+    }
+}
+
+// Many states active at once: (a|b)*a(a|b)^k remembers the last k+1 letters
+TEST_CASE("Bit-parallel simulation of wide state sets", "[.benchmark]") {
+    Words::Context ctx;
+    ctx.addTerminal('a');
+    ctx.addTerminal('b');
+
+    auto a = make_shared<RegWord>(word(ctx, "a"));
+    auto b = make_shared<RegWord>(word(ctx, "b"));
+    auto any = make_shared<RegOperation>(RegularOperator::UNION, vector<shared_ptr<RegNode>>{a, b});
+    vector<shared_ptr<RegNode>> parts{make_shared<RegOperation>(RegularOperator::STAR, vector<shared_ptr<RegNode>>{any}), a};
+    for (int i = 0; i < 200; i++) {
+        parts.push_back(any);
+    }
+    RegOperation expr(RegularOperator::CONCAT, parts);
+    NFA M = regexToNfa(expr, ctx);
+    M.removeEpsilonTransitions();
+    Simulator sim(M);
+
+    mt19937 rand(7);
+    vector<Words::Word> words;
+    for (int i = 0; i < 200; i++) {
+        string str;
+        for (int j = 0; j < 400; j++) {
+            str += rand() % 2 ? 'a' : 'b';
+        }
+        words.push_back(word(ctx, str));
+    }
+
+    // Best of five runs
+    vector<bool> accepted;
+    long best = 0;
+    for (int run = 0; run < 5; run++) {
+        auto start = chrono::steady_clock::now();
+        accepted = sim.accept(words);
+        auto time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        best = run ? min(best, (long)time) : time;
+    }
+    WARN(M.numStates() << " states, " << words.size() << " words: " << best << " ms");
+    for (size_t i = 0; i < 5; i++) {
+        REQUIRE(accepted[i] == M.accept(words[i]));
+    }
+}
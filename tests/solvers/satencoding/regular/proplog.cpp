@@ -1,12 +1,27 @@
 
 #include "catch2/catch.hpp"
-#include "../lib/proplog.cpp"
-
 #include <set>
 
+#include "core/Solver.h"
+#include "regular/clausesink.h"
+#include "regular/regencoding.h"
+
+using namespace RegularEncoding;
 using namespace PropositionalLogic;
 using namespace std;
 
+TEST_CASE("Deduplicating clause sink") {
+    RegularEncoding::ClauseBuffer buffer(true);
+    buffer.addClause({2, -1, 2});
+    buffer.addClause({-1, 2});
+    buffer.addClause({3, -3});
+    buffer.addClause({-4});
+
+    REQUIRE(buffer.size() == 2);
+    CHECK(vector<int>(buffer.begin(0), buffer.end(0)) == vector<int>{-1, 2});
+    CHECK(vector<int>(buffer.begin(1), buffer.end(1)) == vector<int>{-4});
+}
+
 TEST_CASE("Valid formulae") {
 
 
@@ -53,6 +68,19 @@ TEST_CASE("Max var") {
     CHECK(PLFormula::lor(vector<PLFormula>{PLFormula::lit(-12), PLFormula::lit(452)}).max_var() == 452);
 }
 
+TEST_CASE("Hash consing") {
+    FormulaArena::Scope scope;
+    PLFormula a = PLFormula::land(vector<PLFormula>{PLFormula::lit(1), PLFormula::lit(-2)});
+    PLFormula b = PLFormula::land(vector<PLFormula>{PLFormula::lit(1), PLFormula::lit(-2)});
+    PLFormula c = PLFormula::lor(vector<PLFormula>{PLFormula::lit(1), PLFormula::lit(-2)});
+
+    CHECK(a == b);
+    CHECK(!(a == c));
+    // 1, -2, AND and OR
+    CHECK(FormulaArena::current().size() == 4);
+    CHECK(PLFormula::lor(vector<PLFormula>{a, b}).size() == 7);
+}
+
 TEST_CASE("Tseytin") {
     PLFormula phi = PLFormula::land(vector<PLFormula>{
         PLFormula::lor(vector<PLFormula>{
@@ -65,8 +93,18 @@ TEST_CASE("Tseytin") {
         PLFormula::lit(4)
     });
 
-    
-    set<set<int>> cnf = tseytin_cnf(phi);
+    // Literals 1 to 4 are taken, the definitions start at 5
+    Glucose::Solver solver;
+    for (int v = 0; v <= 4; v++) {
+        solver.newVar();
+    }
+    RegularEncoding::ClauseBuffer buffer(true);
+    tseytin_cnf(phi, solver, buffer);
+
+    set<set<int>> cnf;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        cnf.insert(set<int>(buffer.begin(i), buffer.end(i)));
+    }
 
     CHECK(cnf.size() == 10);
     CHECK( (cnf.find(set<int>{1, 5,-6}) != cnf.end()) );
@@ -80,4 +118,29 @@ TEST_CASE("Tseytin") {
     CHECK( (cnf.find(set<int>{4, -7}) != cnf.end()) );
     CHECK( (cnf.find(set<int>{-5, -3}) != cnf.end()) );
       
-}
\ No newline at end of file
+}
+TEST_CASE("Tseytin on shared subformulas") {
+    FormulaArena::Scope scope;
+    PLFormula shared = PLFormula::land(vector<PLFormula>{PLFormula::lit(1), PLFormula::lit(2)});
+    PLFormula phi = PLFormula::land(vector<PLFormula>{
+        PLFormula::lor(vector<PLFormula>{shared, PLFormula::lit(3)}),
+        PLFormula::lor(vector<PLFormula>{shared, PLFormula::lit(-4)})
+    });
+
+    Glucose::Solver solver;
+    for (int v = 0; v <= 4; v++) {
+        solver.newVar();
+    }
+    RegularEncoding::ClauseBuffer buffer(true);
+    tseytin_cnf(phi, solver, buffer);
+
+    // One definition each for the shared AND, the two ORs and the root
+    int maxVar = 0;
+    for (size_t i = 0; i < buffer.size(); i++) {
+        for (auto l = buffer.begin(i); l != buffer.end(i); ++l) {
+            maxVar = max(maxVar, abs(*l));
+        }
+    }
+    CHECK(maxVar == 8);
+    CHECK(solver.nVars() == 9);
+}
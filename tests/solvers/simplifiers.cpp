@@ -0,0 +1,184 @@
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "words/words.hpp"
+#include "words/algorithms.hpp"
+#include "solvers/simplifiers.hpp"
+
+using namespace std;
+using Words::Solvers::ParikhMatrixMismatch;
+using Words::Solvers::Simplified;
+
+namespace {
+    shared_ptr<Words::Context> context() {
+        auto ctxt = make_shared<Words::Context>();
+        ctxt->addTerminal('a');
+        ctxt->addTerminal('b');
+        ctxt->addVariable('X');
+        ctxt->addVariable('Y');
+        ctxt->addVariable('Z');
+        return ctxt;
+    }
+
+    Words::Word word(Words::Context &ctxt, mt19937 &rand, size_t length) {
+        vector<Words::IEntry *> symbols;
+        for (auto t : ctxt.getTerminalAlphabet()) {
+            if (!t->isEpsilon()) {
+                symbols.push_back(t);
+            }
+        }
+        for (auto v : ctxt.getVariableAlphabet()) {
+            symbols.push_back(v);
+        }
+        vector<Words::IEntry *> w;
+        for (size_t i = 0; i < length; i++) {
+            w.push_back(symbols[rand() % symbols.size()]);
+        }
+        return Words::Word(std::move(w));
+    }
+
+    Simplified streamingMismatch(Words::Equation &eq) {
+        Words::Substitution sub;
+        vector<Words::Constraints::Constraint_ptr> cstr;
+        return ParikhMatrixMismatch::solverReduce(eq, sub, cstr);
+    }
+
+    // The same checks on full Parikh matrices of the prefixes
+    Simplified matrixMismatch(Words::Equation &eq) {
+        size_t lSize = eq.lhs.characters();
+        size_t rSize = eq.rhs.characters();
+        if (!lSize || !rSize) {
+            // Not a matter of Parikh images
+            return streamingMismatch(eq);
+        }
+        Words::Algorithms::ParikhMatrix lhs, rhs, suffixes;
+        Words::Algorithms::calculateParikhMatrices(eq.lhs, lhs, suffixes);
+        Words::Algorithms::calculateParikhMatrices(eq.rhs, rhs, suffixes);
+        int64_t coefficient = 0;
+        bool seenTwoVariables = false;
+        for (auto a : eq.ctxt->getVariableAlphabet()) {
+            if (coefficient) {
+                seenTwoVariables = true;
+                break;
+            }
+            coefficient = lhs[lSize - 1][a] - rhs[rSize - 1][a];
+        }
+        if (!seenTwoVariables) {
+            int64_t sum = 0;
+            for (auto a : eq.ctxt->getTerminalAlphabet()) {
+                sum += lhs[lSize - 1][a] - rhs[rSize - 1][a];
+            }
+            if (coefficient && sum % coefficient) {
+                return Simplified::ReducedNsatis;
+            }
+        }
+        for (size_t i = 1; i < min(lSize, rSize); i++) {
+            bool variables = true;
+            for (auto x : eq.ctxt->getVariableAlphabet()) {
+                variables = variables && lhs[i][x] == rhs[i][x];
+            }
+            bool terminals = true;
+            for (auto x : eq.ctxt->getTerminalAlphabet()) {
+                terminals = terminals && lhs[i][x] == rhs[i][x];
+            }
+            if (variables && !terminals) {
+                return Simplified::ReducedNsatis;
+            }
+        }
+        return Simplified::JustReduced;
+    }
+}
+
+TEST_CASE("Parikh mismatch detection") {
+    auto ctxt = context();
+    mt19937 rand(7);
+    size_t unsat = 0;
+    for (size_t n = 0; n < 20000; n++) {
+        auto lhs = word(*ctxt, rand, rand() % 12);
+        auto rhs = word(*ctxt, rand, rand() % 12);
+        Words::Equation eq(lhs, rhs);
+        eq.ctxt = ctxt.get();
+        INFO(eq.lhs << " = " << eq.rhs);
+        auto res = streamingMismatch(eq);
+        REQUIRE(res == matrixMismatch(eq));
+        unsat += res == Simplified::ReducedNsatis;
+    }
+    REQUIRE(unsat > 0);
+
+    // Xab = aXb has balanced prefixes throughout, XaXb = XbXa does not
+    auto x = ctxt->findSymbol('X');
+    auto a = ctxt->findSymbol('a');
+    auto b = ctxt->findSymbol('b');
+    Words::Word xab({x, a, b}), axb({a, x, b});
+    Words::Equation same(xab, axb);
+    same.ctxt = ctxt.get();
+    REQUIRE(streamingMismatch(same) == Simplified::JustReduced);
+    Words::Word xaxb({x, a, x, b}), xbxa({x, b, x, a});
+    Words::Equation swapped(xaxb, xbxa);
+    swapped.ctxt = ctxt.get();
+    REQUIRE(streamingMismatch(swapped) == Simplified::ReducedNsatis);
+}
+
+TEST_CASE("Parikh mismatch detection on long equations", "[.benchmark]") {
+    auto ctxt = context();
+    mt19937 rand(7);
+    vector<Words::Equation> equations;
+    for (size_t n = 0; n < 50; n++) {
+        // Balanced prefixes, so neither side stops early
+        auto w = word(*ctxt, rand, 2000);
+        equations.emplace_back(w, w);
+        equations.back().ctxt = ctxt.get();
+    }
+
+    auto start = chrono::steady_clock::now();
+    for (auto &eq : equations) {
+        REQUIRE(matrixMismatch(eq) == Simplified::JustReduced);
+    }
+    auto middle = chrono::steady_clock::now();
+    for (auto &eq : equations) {
+        REQUIRE(streamingMismatch(eq) == Simplified::JustReduced);
+    }
+    auto end = chrono::steady_clock::now();
+    WARN(equations.size() << " equations of 2000 symbols a side, matrices: " << chrono::duration_cast<chrono::milliseconds>(middle - start).count() << " ms, "
+                          << "streaming: " << chrono::duration_cast<chrono::microseconds>(end - middle).count() << " us");
+}
+
+TEST_CASE("Prefix and suffix reduction copy only the words they shorten") {
+    auto ctxt = context();
+    Words::IEntry *a = ctxt->findSymbol('a');
+    Words::IEntry *b = ctxt->findSymbol('b');
+    Words::IEntry *x = ctxt->findSymbol('X');
+    Words::IEntry *y = ctxt->findSymbol('Y');
+    Words::Substitution sub;
+    vector<Words::Constraints::Constraint_ptr> cstr;
+
+    // X a Y = Y b X has nothing to strip
+    Words::Word xay({x, a, y});
+    Words::Word ybx({y, b, x});
+    Words::Equation parent(xay, ybx);
+    parent.ctxt = ctxt.get();
+    Words::Equation eq = parent;
+    const Words::Word &lhs = eq.lhs;
+    const Words::Word &rhs = eq.rhs;
+    REQUIRE(Words::Solvers::PrefixReducer::solverReduce(eq, sub, cstr) == Simplified::JustReduced);
+    REQUIRE(Words::Solvers::SuffixReducer::solverReduce(eq, sub, cstr) == Simplified::JustReduced);
+    const Words::Word &plhs = parent.lhs;
+    const Words::Word &prhs = parent.rhs;
+    REQUIRE(&*lhs.ebegin() == &*plhs.ebegin());
+    REQUIRE(&*rhs.ebegin() == &*prhs.ebegin());
+
+    // X a Y = X b Y loses X and Y, the parent keeps them
+    Words::Word xby({x, b, y});
+    parent = Words::Equation(xay, xby);
+    parent.ctxt = ctxt.get();
+    eq = parent;
+    REQUIRE(Words::Solvers::PrefixReducer::solverReduce(eq, sub, cstr) == Simplified::JustReduced);
+    REQUIRE(Words::Solvers::SuffixReducer::solverReduce(eq, sub, cstr) == Simplified::JustReduced);
+    REQUIRE(eq.lhs == Words::Word({a}));
+    REQUIRE(eq.rhs == Words::Word({b}));
+    REQUIRE(parent.lhs == Words::Word({x, a, y}));
+    REQUIRE(parent.rhs == Words::Word({x, b, y}));
+}
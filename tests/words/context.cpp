@@ -0,0 +1,56 @@
+#include "catch2/catch.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "words/words.hpp"
+
+using namespace std;
+
+namespace {
+    // The sequence of a's and b's spelling out the low bits of n
+    Words::Context::SeqInput sequence(Words::Context &ctxt, uint32_t n, size_t length) {
+        Words::Context::SeqInput seq;
+        for (size_t i = 0; i < length; i++) {
+            seq.push_back(ctxt.findSymbol((n >> i) & 1 ? 'b' : 'a'));
+        }
+        return seq;
+    }
+
+    // Same as Sequence::hash
+    size_t sequenceHash(const Words::Context::SeqInput &seq) {
+        return Words::Hash::Hash<const Words::IEntry *>(seq.data(), seq.size(), static_cast<uint32_t>(seq.size()));
+    }
+}
+
+TEST_CASE("Sequences with colliding hashes") {
+    Words::Context ctxt;
+    ctxt.addTerminal('a');
+    ctxt.addTerminal('b');
+
+    // With 2^20 sequences of 32-bit hashes a collision is all but certain
+    const size_t length = 20;
+    unordered_map<size_t, uint32_t> seen;
+    Words::Context::SeqInput first, second;
+    for (uint32_t n = 0; n < (1u << length); n++) {
+        auto seq = sequence(ctxt, n, length);
+        auto res = seen.emplace(sequenceHash(seq), n);
+        if (!res.second) {
+            first = sequence(ctxt, res.first->second, length);
+            second = seq;
+            break;
+        }
+    }
+    REQUIRE(!first.empty());
+    REQUIRE(first != second);
+    REQUIRE(sequenceHash(first) == sequenceHash(second));
+
+    auto a = ctxt.addSequence(first);
+    auto b = ctxt.addSequence(second);
+    REQUIRE(a != b);
+    REQUIRE(ctxt.addSequence(first) == a);
+    REQUIRE(ctxt.addSequence(second) == b);
+    REQUIRE(vector<Words::IEntry *>(a->getSequence()->begin(), a->getSequence()->end()) == first);
+    REQUIRE(vector<Words::IEntry *>(b->getSequence()->begin(), b->getSequence()->end()) == second);
+}
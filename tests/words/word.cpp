@@ -0,0 +1,211 @@
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "words/words.hpp"
+
+using namespace std;
+
+namespace {
+    // Variables between constant sequences of one to eight terminals
+    Words::Word word(Words::Context &ctxt, mt19937 &rand, size_t entries, vector<Words::IEntry *> &flat) {
+        auto x = ctxt.findSymbol('X');
+        vector<Words::IEntry *> terminals{ctxt.findSymbol('a'), ctxt.findSymbol('b')};
+        vector<Words::IEntry *> w;
+        flat.clear();
+        for (size_t i = 0; i < entries; i++) {
+            if (i % 2) {
+                w.push_back(x);
+                flat.push_back(x);
+                continue;
+            }
+            Words::Context::SeqInput seq;
+            for (size_t j = 0, n = 1 + rand() % 8; j < n; j++) {
+                seq.push_back(terminals[rand() % 2]);
+            }
+            flat.insert(flat.end(), seq.begin(), seq.end());
+            w.push_back(seq.size() == 1 ? seq[0] : ctxt.addSequence(seq));
+        }
+        return Words::Word(std::move(w));
+    }
+
+    vector<Words::IEntry *> forward(const Words::Word &w) {
+        vector<Words::IEntry *> res;
+        for (auto e : w) {
+            res.push_back(e);
+        }
+        return res;
+    }
+
+    vector<Words::IEntry *> backward(const Words::Word &w) {
+        vector<Words::IEntry *> res;
+        for (auto it = w.rbegin(), end = w.rend(); it != end; ++it) {
+            res.push_back(*it);
+        }
+        return res;
+    }
+}
+
+TEST_CASE("Word iteration through sequences") {
+    Words::Context ctxt;
+    ctxt.addTerminal('a');
+    ctxt.addTerminal('b');
+    ctxt.addVariable('X');
+    auto x = ctxt.findSymbol('X');
+    auto a = ctxt.findSymbol('a');
+    mt19937 rand(3);
+    vector<Words::IEntry *> flat;
+
+    for (size_t n = 0; n < 100; n++) {
+        auto w = word(ctxt, rand, n, flat);
+        REQUIRE(w.characters() == flat.size());
+        REQUIRE(forward(w) == flat);
+        REQUIRE(backward(w) == vector<Words::IEntry *>(flat.rbegin(), flat.rend()));
+
+        // The count follows every change to the entries
+        auto copy = w;
+        Words::Word image({a, x, a});
+        copy.substitudeVariable(x, image);
+        size_t expected = 0;
+        for (auto e : flat) {
+            expected += e == x ? 3 : 1;
+        }
+        REQUIRE(copy.characters() == expected);
+        REQUIRE(w.characters() == flat.size());
+        if (w.entries()) {
+            auto length = (*w.ebegin())->length();
+            w.replace_entry(w.ebegin(), x);
+            REQUIRE(w.characters() == flat.size() - length + 1);
+            w.erase_entry(w.rebegin());
+            REQUIRE(w.characters() == forward(w).size());
+        }
+    }
+}
+
+TEST_CASE("Word iteration throughput", "[.benchmark]") {
+    Words::Context ctxt;
+    ctxt.addTerminal('a');
+    ctxt.addTerminal('b');
+    ctxt.addVariable('X');
+    mt19937 rand(3);
+    vector<Words::IEntry *> flat;
+    auto w = word(ctxt, rand, 10000, flat);
+    const size_t rounds = 1000;
+
+    size_t visited = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        for (auto e : w) {
+            visited += e == flat[0];
+        }
+    }
+    auto middle = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds * 100; i++) {
+        visited += w.characters();
+    }
+    auto end = chrono::steady_clock::now();
+    REQUIRE(visited > 0);
+    auto ms = chrono::duration_cast<chrono::milliseconds>(middle - start).count();
+    WARN(rounds << " passes over " << w.characters() << " symbols in " << w.entries() << " entries: " << ms << " ms, "
+                << (ms ? rounds * w.characters() / ms / 1000 : 0) << " M symbols/s, "
+                << rounds * 100 << " calls to characters(): " << chrono::duration_cast<chrono::microseconds>(end - middle).count() << " us");
+}
+
+TEST_CASE("Substituting several variables at once") {
+    Words::Context ctxt;
+    ctxt.addTerminal('a');
+    ctxt.addTerminal('b');
+    for (char c : string("XYZU")) {
+        ctxt.addVariable(c);
+    }
+    auto u = ctxt.findSymbol('U');
+    mt19937 rand(5);
+    auto random = [&](size_t length, const string &alphabet) {
+        vector<Words::IEntry *> w;
+        for (size_t i = 0; i < length; i++) {
+            w.push_back(ctxt.findSymbol(alphabet[rand() % alphabet.size()]));
+        }
+        return Words::Word(std::move(w));
+    };
+
+    for (size_t n = 0; n < 2000; n++) {
+        // No image holds another substituted variable, so doing them one
+        // by one gives the same word
+        Words::Substitution sub;
+        for (char c : string("XYZ")) {
+            if (rand() % 2) {
+                sub[ctxt.findSymbol(c)] = random(rand() % 4, "ab");
+            }
+        }
+        if (rand() % 2) {
+            sub[u] = random(rand() % 4, "abU");
+        }
+        auto w = random(rand() % 20, "abXYZU");
+        auto expected = w;
+        bool changed = false;
+        for (auto &s : sub) {
+            changed = expected.substitudeVariable(s.first, s.second) || changed;
+        }
+        auto original = w;
+        auto copy = w;
+        REQUIRE(copy.substitute(Words::SubstitutionTable(sub)) == changed);
+        INFO(original << " to " << expected);
+        REQUIRE(copy == expected);
+        REQUIRE(copy.characters() == expected.characters());
+        REQUIRE(w == original);
+
+        // Erasing the others leaves no variable but those in the images
+        Words::SubstitutionTable erase(sub, true);
+        copy = w;
+        copy.substitute(erase);
+        bool left = sub.count(u) && w.containsVariable(u) && sub[u].containsVariable(u);
+        for (auto e : copy) {
+            REQUIRE((!e->isVariable() || (left && e == u)));
+        }
+    }
+}
+
+TEST_CASE("Substituting several variables at once against one by one", "[.benchmark]") {
+    Words::Context ctxt;
+    ctxt.addTerminal('a');
+    vector<Words::IEntry *> variables;
+    for (char c = 'A'; c <= 'Z'; c++) {
+        variables.push_back(ctxt.addVariable(string(1, c)));
+    }
+    Words::Substitution sub;
+    Words::Word image({ctxt.findSymbol('a'), ctxt.findSymbol('a')});
+    for (auto x : variables) {
+        sub[x] = image;
+    }
+    mt19937 rand(3);
+    vector<Words::IEntry *> entries;
+    for (size_t i = 0; i < 100000; i++) {
+        entries.push_back(variables[rand() % variables.size()]);
+    }
+    Words::Word w(std::move(entries));
+    const size_t rounds = 20;
+
+    size_t chars = 0;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        auto copy = w;
+        for (auto &s : sub) {
+            copy.substitudeVariable(s.first, s.second);
+        }
+        chars += copy.characters();
+    }
+    auto middle = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++) {
+        auto copy = w;
+        copy.substitute(Words::SubstitutionTable(sub));
+        chars += copy.characters();
+    }
+    auto end = chrono::steady_clock::now();
+    REQUIRE(chars == 2 * rounds * 2 * w.characters());
+    WARN(rounds << " substitutions of " << sub.size() << " variables in " << w.characters() << " symbols, one by one: "
+                << chrono::duration_cast<chrono::milliseconds>(middle - start).count() << " ms, at once: "
+                << chrono::duration_cast<chrono::milliseconds>(end - middle).count() << " ms");
+}